@@ -0,0 +1,218 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: glob_bench.c                                */
+/*          Description:                                             */
+/*              Times the glob engine against glibc glob(3) on a     */
+/*              tree of 1000 directories holding the given number    */
+/*              of files between them, half of them *.c. The tree    */
+/*              is made on the first run and kept for the next.      */
+/*              glob(3) has no **, so it is given the same matches   */
+/*              spelled out one level deep.                          */
+/*                                                                   */
+/*                  usage: glob_bench [dir] [files]                  */
+/*                                                                   */
+/*********************************************************************/
+
+#include <time.h>
+#include <glob.h>
+#include "../lib/glob_engine.h"
+
+/* macros */
+#define DEFAULT_DIR "/tmp/jshell_glob_tree"
+#define DEFAULT_FILES 1000000
+#define N_DIRS 1000
+#define ROUNDS 3
+#define PATH_SIZE 4096
+
+/* local prototypes */
+static int      make_tree( const char* dir, int n_files );
+static double   time_engine( const char* pattern, int* n_matches );
+static double   time_glibc( const char* pattern, int* n_matches );
+static double   now_ms( void );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: main                                          */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int argc: number of command line arguments.              */
+/*          char** argv: "glob_bench [dir] [files]".                 */
+/*                                                                   */
+/*      Description:                                                 */
+/*          prints the best of ROUNDS for each pattern and engine,   */
+/*          and fails if the two disagree on the number of matches.  */
+/*                                                                   */
+/*********************************************************************/
+int main( int argc, char** argv )
+{
+    const char* dir = ( argc > 1 ? argv[1] : DEFAULT_DIR );
+    int n_files = ( argc > 2 ? atoi( argv[2] ) : DEFAULT_FILES );
+    const char* ours[] = { "%s/*/*.c", "%s/d1*/f*6.c", "%s/**/*.c" };
+    const char* theirs[] = { "%s/*/*.c", "%s/d1*/f*6.c", "%s/*/*.c" };
+    char pattern[PATH_SIZE], glibc_pattern[PATH_SIZE];
+    double engine_ms, glibc_ms;
+    int n_engine, n_glibc, status = EXIT_SUCCESS;
+
+    if ( make_tree( dir, n_files ) == FAILURE )
+        return EXIT_FAILURE;
+
+    printf( "%-28s %9s %10s %10s %8s\n", "pattern", "matches", "engine ms",
+            "glob(3) ms", "speedup" );
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        snprintf( pattern, sizeof(pattern), ours[i], dir );
+        snprintf( glibc_pattern, sizeof(glibc_pattern), theirs[i], dir );
+
+        engine_ms = time_engine( pattern, &n_engine );
+        glibc_ms = time_glibc( glibc_pattern, &n_glibc );
+
+        printf( "%-28s %9d %10.1f %10.1f %7.2fx\n", pattern + strlen( dir ),
+                n_engine, engine_ms, glibc_ms, glibc_ms / engine_ms );
+
+        if ( n_engine != n_glibc )
+        {
+            fprintf( stderr, "Error: glob(3) found %d matches.\n", n_glibc );
+            status = EXIT_FAILURE;
+        }
+    }
+
+    return status;
+} /* end main() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: make_tree                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* dir: where the tree goes.                    */
+/*          int n_files: how many files it should hold.              */
+/*                                                                   */
+/*      Description:                                                 */
+/*          does nothing if dir already exists, so the tree is only  */
+/*          made once.                                               */
+/*                                                                   */
+/*********************************************************************/
+static int make_tree( const char* dir, int n_files )
+{
+    char path[PATH_SIZE];
+    int fd;
+
+    if ( mkdir( dir, 0755 ) == -1 )
+        return ( errno == EEXIST ? SUCCESS : FAILURE );
+
+    fprintf( stderr, "making %d files under %s\n", n_files, dir );
+
+    for ( int d = 0; d < N_DIRS; d++ )
+    {
+        snprintf( path, sizeof(path), "%s/d%03d", dir, d );
+
+        if ( mkdir( path, 0755 ) == -1 )
+        {
+            fprintf( stderr, "Error: Could not create %s\n", path );
+            return FAILURE;
+        }
+    }
+
+    for ( int f = 0; f < n_files; f++ )
+    {
+        snprintf( path, sizeof(path), "%s/d%03d/f%07d.%c", dir, f % N_DIRS,
+                  f, f % 2 == 0 ? 'c' : 'h' );
+
+        if ( ( fd = open( path, O_WRONLY | O_CREAT, 0644 ) ) == -1 )
+        {
+            fprintf( stderr, "Error: Could not create %s\n", path );
+            return FAILURE;
+        }
+
+        close( fd );
+    }
+
+    return SUCCESS;
+} /* end make_tree() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: time_engine                                   */
+/*      Return type:   static double                                 */
+/*      Parameter(s):                                                */
+/*          const char* pattern: what to expand.                     */
+/*          int* n_matches: set to how many paths it matched.        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the best of ROUNDS expand_glob() calls, in ms.           */
+/*                                                                   */
+/*********************************************************************/
+static double time_engine( const char* pattern, int* n_matches )
+{
+    double best = -1, start, ms;
+    char** matches;
+
+    for ( int round = 0; round < ROUNDS; round++ )
+    {
+        start = now_ms();
+
+        if ( expand_glob( pattern, &matches, n_matches ) == FAILURE )
+            *n_matches = 0;
+        else
+            free_matches( matches, *n_matches );
+
+        if ( ( ms = now_ms() - start ) < best || best < 0 )
+            best = ms;
+    }
+
+    return best;
+} /* end time_engine() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: time_glibc                                    */
+/*      Return type:   static double                                 */
+/*      Parameter(s):                                                */
+/*          const char* pattern: what to expand.                     */
+/*          int* n_matches: set to how many paths it matched.        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the best of ROUNDS glob(3) calls, in ms, sorted as the   */
+/*          engine's are.                                            */
+/*                                                                   */
+/*********************************************************************/
+static double time_glibc( const char* pattern, int* n_matches )
+{
+    double best = -1, start, ms;
+    glob_t g;
+
+    for ( int round = 0; round < ROUNDS; round++ )
+    {
+        start = now_ms();
+
+        *n_matches = ( glob( pattern, 0, NULL, &g ) == 0 ?
+                       (int) g.gl_pathc : 0 );
+        globfree( &g );
+
+        if ( ( ms = now_ms() - start ) < best || best < 0 )
+            best = ms;
+    }
+
+    return best;
+} /* end time_glibc() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: now_ms                                        */
+/*      Return type:   static double                                 */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*********************************************************************/
+static double now_ms( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+} /* end now_ms() */
@@ -0,0 +1,53 @@
+#!/bin/sh
+#
+# Speedup of the parallel builtin on CPU-bound jobs: eight sha256sum
+# runs over a file held in the page cache, with "parallel -j" at 1, 2,
+# 4 and the number of CPUs. The work is the same at every -j, so the
+# speedup is the -j 1 time over the row's time. Each row is the
+# fastest of three runs, timed by the shell's own "time".
+#
+#   usage: parallel_scaling.sh [shell] [MB] [jobs]
+
+shell=$(cd "$(dirname "${1:-../src/shell}")" && pwd)/$(basename "${1:-../src/shell}")
+mb=${2:-64}
+jobs=${3:-8}
+dir=$(mktemp -d) || exit 1
+cpus=$(nproc)
+
+trap 'rm -rf "$dir"' EXIT
+
+if [ ! -x "$shell" ]; then
+    echo "parallel_scaling.sh: $shell is not built" >&2
+    exit 1
+fi
+
+head -c "${mb}M" /dev/urandom > "$dir/data"
+files=
+k=0
+
+while [ $k -lt "$jobs" ]; do
+    files="$files $dir/data"
+    k=$(( k + 1 ))
+done
+
+echo "cpus $cpus, $jobs jobs of sha256sum over $mb MB"
+printf '%-6s %8s %8s\n' "-j" seconds speedup
+
+base=
+for j in $(printf '%s\n' 1 2 4 "$cpus" | sort -n -u); do
+    echo "time parallel -j $j sha256sum :::$files" > "$dir/t.jsh"
+    best=
+
+    for round in 1 2 3; do
+        real=$("$shell" "$dir/t.jsh" 2>&1 >/dev/null |
+               awk '/^real/ { sub( "s", "", $2 ); print $2 }')
+
+        if [ -z "$best" ] || awk "BEGIN { exit !( $real < $best ) }"; then
+            best=$real
+        fi
+    done
+
+    base=${base:-$best}
+    printf '%-6s %8s %8s\n' "$j" "$best" \
+           "$(awk "BEGIN { printf \"%.2f\", $base / $best }")"
+done
@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# Throughput and context switches of a four stage pipeline moving the
+# given amount of data, with its pipes at 64 KiB, 1 MiB and 4 MiB
+# ("pipesize N" in front of it). Sizes above
+# /proc/sys/fs/pipe-max-size are capped there by the shell. Each row
+# is the fastest of three runs, timed by the shell's own "time".
+#
+#   usage: pipe_size.sh [shell] [MB]
+
+shell=$(cd "$(dirname "${1:-../src/shell}")" && pwd)/$(basename "${1:-../src/shell}")
+mb=${2:-4096}
+dir=$(mktemp -d) || exit 1
+
+trap 'rm -rf "$dir"' EXIT
+
+if [ ! -x "$shell" ]; then
+    echo "pipe_size.sh: $shell is not built" >&2
+    exit 1
+fi
+
+echo "pipe-max-size $(cat /proc/sys/fs/pipe-max-size)"
+printf '%-10s %8s %8s %12s\n' pipesize seconds "GB/s" switches
+
+for size in 65536 1048576 4194304; do
+    printf 'time pipesize %s head -c %sM /dev/zero | cat | cat | wc -c\n' \
+           "$size" "$mb" > "$dir/t.jsh"
+    best=
+
+    for round in 1 2 3; do
+        set -- $("$shell" "$dir/t.jsh" 2>&1 >/dev/null |
+                 awk '/^real/ { sub( "s", "", $2 ); real = $2 }
+                      /^csw/  { csw = $2 + $4 }
+                      END     { print real, csw }')
+
+        if [ -z "$best" ] || awk "BEGIN { exit !( $1 < $best ) }"; then
+            best=$1
+            switches=$2
+        fi
+    done
+
+    printf '%-10s %8s %8s %12s\n' "$size" "$best" \
+           "$(awk "BEGIN { printf \"%.2f\", $mb / 1024 / $best }")" \
+           "$switches"
+done
@@ -0,0 +1,44 @@
+#!/bin/sh
+#
+# Runs every bench/*.jsh script with the given shell and prints the best
+# wall time of several rounds. The scripts are also the training run for
+# "make pgo", so they should cover what the shell spends its time on.
+#
+#   usage: run.sh [shell] [rounds]
+
+shell=$(cd "$(dirname "${1:-../src/shell}")" && pwd)/$(basename "${1:-../src/shell}")
+rounds=${2:-3}
+status=0
+
+cd "$(dirname "$0")" || exit 1
+
+if [ ! -x "$shell" ]; then
+    echo "run.sh: $shell is not built" >&2
+    exit 1
+fi
+
+printf '%-12s %10s\n' script "best ms"
+
+for script in *.jsh; do
+    best=
+
+    for round in $(seq "$rounds"); do
+        start=$(date +%s%N)
+
+        if ! "$shell" "$script" > /dev/null 2>&1; then
+            echo "run.sh: $script failed" >&2
+            status=1
+            break
+        fi
+
+        ms=$(( ( $(date +%s%N) - start ) / 1000000 ))
+
+        if [ -z "$best" ] || [ "$ms" -lt "$best" ]; then
+            best=$ms
+        fi
+    done
+
+    printf '%-12s %10s\n' "${script%.jsh}" "${best:--}"
+done
+
+exit $status
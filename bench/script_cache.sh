@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# Startup to first exec for a long script: the time from starting the
+# shell to the script's first line, "date +%s%N", running. The shell
+# loads the whole script before that line, so this is the cost of
+# reading it: cold, with no .jshc to map (it is compiled and saved),
+# and warm, from the .jshc the cold run left. Best of five each.
+#
+#   usage: script_cache.sh [shell] [lines]
+
+shell=$(cd "$(dirname "${1:-../src/shell}")" && pwd)/$(basename "${1:-../src/shell}")
+lines=${2:-5000}
+dir=$(mktemp -d) || exit 1
+script=$dir/long.jsh
+
+trap 'rm -rf "$dir"' EXIT
+
+if [ ! -x "$shell" ]; then
+    echo "script_cache.sh: $shell is not built" >&2
+    exit 1
+fi
+
+# the first line is timed, "exit" stops it there, the rest is a mix
+# of what scripts hold
+{
+    echo 'date +%s%N'
+    echo 'exit'
+    k=0
+
+    while [ $k -lt "$lines" ]; do
+        case $(( k % 5 )) in
+            0) echo "name$k = value$k" ;;
+            1) echo "echo line $k \$HOME {a,b}$k > /dev/null" ;;
+            2) echo "if test \$k -gt $k; then echo big \$k; fi" ;;
+            3) echo "for w in a b c$k; do echo \$w | wc -c; done" ;;
+            4) echo "ls /tmp | grep -c x$k | sort -n | head -1" ;;
+        esac
+        k=$(( k + 1 ))
+    done
+} > "$script"
+
+# microseconds from launch to the first line running
+first_exec() {
+    start=$(date +%s%N)
+    first=$("$shell" "$script" 2>/dev/null </dev/null)
+
+    case $first in
+        ''|*[!0-9]*) return ;;
+    esac
+
+    echo $(( ( first - start ) / 1000 ))
+}
+
+best_of_five() {
+    best=
+
+    for round in 1 2 3 4 5; do
+        [ "$1" = cold ] && rm -f "$script.jshc"
+        us=$(first_exec)
+
+        if [ -z "$us" ]; then
+            continue
+        elif [ -z "$best" ] || [ "$us" -lt "$best" ]; then
+            best=$us
+        fi
+    done
+
+    echo "$best"
+}
+
+cold=$(best_of_five cold)
+warm=$(best_of_five warm)
+
+if [ -z "$cold" ] || [ -z "$warm" ]; then
+    echo "script_cache.sh: $shell did not run $script" >&2
+    exit 1
+fi
+
+printf '%-8s %10s\n' "$lines" "first us"
+printf '%-8s %10s\n' cold "$cold" warm "$warm"
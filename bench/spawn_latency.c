@@ -0,0 +1,153 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: spawn_latency.c                             */
+/*          Description:                                             */
+/*              Times /bin/true started through the shell's own      */
+/*              generate_process(), first with the spawn helper      */
+/*              doing the fork and then with this process forking    */
+/*              directly, at each resident size given in MB.         */
+/*                                                                   */
+/*                  usage: spawn_latency [MB ...]   (50 500)         */
+/*                                                                   */
+/*********************************************************************/
+
+#include <time.h>
+#include "../lib/execution.h"
+
+/* macros */
+#define SPAWNS 300
+#define MB ( 1024 * 1024 )
+
+/* local prototypes */
+static double   time_spawns( void );
+static long     resident_kb( void );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: main                                          */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int argc: number of command line arguments.              */
+/*          char** argv: the sizes to grow to, in MB.                */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the helper is forked while this process is small, as     */
+/*          the shell does. Each size is then touched into memory    */
+/*          and timed through the helper; the helper is stopped and  */
+/*          the sizes are timed again, forked directly.              */
+/*                                                                   */
+/*********************************************************************/
+int main( int argc, char** argv )
+{
+    const char* defaults[] = { "50", "500" };
+    const char** sizes = ( argc > 1 ? (const char**) argv + 1 : defaults );
+    int n_sizes = ( argc > 1 ? argc - 1 : 2 );
+    double helper[16], direct[16];
+    long rss[16];
+    char* ballast;
+
+    if ( n_sizes > 16 )
+        n_sizes = 16;
+
+    init_instrument();
+
+    if ( start_spawn_server() == FAILURE || init_supervisor() == FAILURE )
+    {
+        fprintf( stderr, "Error: Could not start the spawn helper.\n" );
+        return EXIT_FAILURE;
+    }
+
+    for ( int pass = 0; pass < 2; pass++ )
+    {
+        if ( pass == 1 )
+            stop_spawn_server();
+
+        for ( int i = 0; i < n_sizes; i++ )
+        {
+            if ( ( ballast = malloc( (size_t) atoi( sizes[i] ) * MB ) )
+                 == NULL )
+            {
+                fprintf( stderr, "Error: Could not allocate %s MB.\n",
+                         sizes[i] );
+                return EXIT_FAILURE;
+            }
+
+            memset( ballast, 1, (size_t) atoi( sizes[i] ) * MB );
+            rss[i] = resident_kb();
+
+            if ( pass == 0 )
+                helper[i] = time_spawns();
+            else
+                direct[i] = time_spawns();
+
+            free( ballast );
+        }
+    }
+
+    printf( "%10s %12s %12s %8s\n", "rss MB", "helper us", "direct us",
+            "speedup" );
+
+    for ( int i = 0; i < n_sizes; i++ )
+        printf( "%10ld %12.1f %12.1f %7.2fx\n", rss[i] / 1024, helper[i],
+                direct[i], direct[i] / helper[i] );
+
+    return EXIT_SUCCESS;
+} /* end main() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: time_spawns                                   */
+/*      Return type:   static double                                 */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs /bin/true SPAWNS times, each waited for, and        */
+/*          returns the mean microseconds per run.                   */
+/*                                                                   */
+/*********************************************************************/
+static double time_spawns( void )
+{
+    char* words[] = { "/bin/true", NULL };
+    char** prog = words;
+    struct timespec start, end;
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for ( int i = 0; i < SPAWNS; i++ )
+        generate_process( STDIN_FILENO, STDOUT_FILENO, &prog );
+
+    clock_gettime( CLOCK_MONOTONIC, &end );
+
+    return ( ( end.tv_sec - start.tv_sec ) * 1e6 +
+             ( end.tv_nsec - start.tv_nsec ) / 1e3 ) / SPAWNS;
+} /* end time_spawns() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: resident_kb                                   */
+/*      Return type:   static long                                   */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          VmRSS from /proc/self/status, 0 if it can't be read.     */
+/*                                                                   */
+/*********************************************************************/
+static long resident_kb( void )
+{
+    char line[256];
+    long kb = 0;
+    FILE* fp;
+
+    if ( ( fp = fopen( "/proc/self/status", "r" ) ) == NULL )
+        return 0;
+
+    while ( fgets( line, sizeof(line), fp ) != NULL )
+        if ( sscanf( line, "VmRSS: %ld", &kb ) == 1 )
+            break;
+
+    fclose( fp );
+    return kb;
+} /* end resident_kb() */
@@ -0,0 +1,49 @@
+#!/bin/sh
+#
+# GB/s of cat and tee run as the zero-copy builtins ("set -o zerocopy")
+# against the coreutils binaries, moving a file of the given size
+# file to file, through a pipe, and through tee to a file and a pipe.
+# Each figure is the best of three, timed by the shell's own "time".
+#
+#   usage: zero_copy.sh [shell] [MB]
+
+shell=$(cd "$(dirname "${1:-../src/shell}")" && pwd)/$(basename "${1:-../src/shell}")
+mb=${2:-1024}
+dir=$(mktemp -d) || exit 1
+
+trap 'rm -rf "$dir"' EXIT
+
+if [ ! -x "$shell" ]; then
+    echo "zero_copy.sh: $shell is not built" >&2
+    exit 1
+fi
+
+head -c "${mb}M" /dev/urandom > "$dir/in" || exit 1
+
+# best GB/s of three runs of $2, with $1 as the script's first line
+gbps() {
+    printf '%s\ntime %s\n' "$1" "$2" > "$dir/t.jsh"
+    best=
+
+    for round in 1 2 3; do
+        real=$("$shell" "$dir/t.jsh" 2>&1 >/dev/null |
+               awk '/^real/ { sub( "s", "", $2 ); print $2 }')
+
+        if [ -z "$best" ] || awk "BEGIN { exit !( $real < $best ) }"; then
+            best=$real
+        fi
+    done
+
+    awk "BEGIN { printf \"%8.2f\", $mb / 1024 / $best }"
+}
+
+printf '%-28s %8s %8s\n' "$mb MB" coreutil builtin
+
+# a pipeline can't end in a redirection, so wc -c drains the pipes
+for case in "cat $dir/in > $dir/out" \
+            "cat $dir/in | cat | wc -c" \
+            "cat $dir/in | tee $dir/out | wc -c"; do
+    printf '%-28s %s %s\n' "$(echo "$case" | sed "s|$dir/||g")" \
+           "$(gbps "set +o zerocopy" "$case")" \
+           "$(gbps "set -o zerocopy" "$case")"
+done
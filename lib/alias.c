@@ -1,8 +1,12 @@
 #include "alias.h"
-
-/* globals */
-int     n_aliases = 0;
-int     n_tokens = 0; 
+#include "./jshell.h"
+
+/* the calling thread's shell's aliases (see jshell.h) */
+#define alias_arr   ( jshell->aliases.table )
+#define n_aliases   ( jshell->aliases.n_aliases )
+#define trans       ( jshell->aliases.trans )
+#define token       ( jshell->aliases.token )
+#define n_tokens    ( jshell->aliases.n_tokens )
 
 /*********************************************************************/
 /*                                                                   */
@@ -27,13 +27,15 @@ typedef struct alias_t
     int     n_cmds;
 } alias;
 
-/* global variables */
-char**          trans;
-char*           token;  
-extern int      n_cmds;
-
-/* global variable to hold aliases */
-alias   alias_arr[ALIAS_LIMIT];
+/* one shell's aliases, and the words of the one being added */
+typedef struct alias_state_t
+{
+    alias   table[ALIAS_LIMIT];
+    int     n_aliases;
+    char**  trans;
+    char*   token;
+    int     n_tokens;
+} alias_state;
 
 /* prototypes */
 alias*  add_alias( const char*, char* );
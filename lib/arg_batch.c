@@ -0,0 +1,672 @@
+#include "arg_batch.h"
+#include "./execution.h"
+
+extern char** environ;
+
+/* local prototypes */
+static size_t   env_bytes( void );
+static int      fixed_words( char** );
+static void     launch_batch( batch_runner*, char** );
+static void     wait_batch( batch_runner* );
+static int      stream_batches( batch_runner*, char**, int, word_source, void*,
+                                size_t, int, int );
+static int      argv_next( void*, const char**, size_t* );
+static int      stdin_next( void*, const char**, size_t* );
+static int      parse_xargs_options( char**, xargs_options* );
+static int      read_char( arg_reader* );
+static int      next_arg( arg_reader*, const xargs_options*, char*, size_t* );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: arg_space                                     */
+/*      Return type:   size_t                                        */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns how many bytes of argv, counted with ARG_COST(), */
+/*          a new program can take: ARG_MAX less the environment     */
+/*          and ARG_HEADROOM, as POSIX asks of xargs.                */
+/*                                                                   */
+/*********************************************************************/
+size_t arg_space( void )
+{
+    long max = sysconf( _SC_ARG_MAX );
+    size_t env = env_bytes() + ARG_HEADROOM;
+
+    if ( max <= 0 )
+        max = ARG_STRLEN_MAX;
+
+    return ( (size_t) max > env ? (size_t) max - env : 0 );
+} /* end arg_space() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: argv_too_long                                 */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: NULL terminated argv of a program.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T if exec would fail on prog with E2BIG, either for the  */
+/*          total size or for one argument over the per-string       */
+/*          limit.                                                   */
+/*                                                                   */
+/*********************************************************************/
+int argv_too_long( char** prog )
+{
+    size_t total = sizeof(char*), len;
+
+    for ( int i = 0; prog[i] != NULL; i++ )
+    {
+        if ( ( len = strlen( prog[i] ) ) >= ARG_STRLEN_MAX )
+            return T;
+
+        total += ARG_COST( len );
+    }
+
+    return ( total > arg_space() ? T : F );
+} /* end argv_too_long() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_batches                                   */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          const char* path: resolved program, NULL to use $PATH.   */
+/*          char** prog: an argv too long for one exec, or with      */
+/*                       BRACE_MARKER words still to expand.         */
+/*          int max_procs: most runs to have going at once.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs prog as several programs. The name and any leading  */
+/*          options (up to "--") are repeated in every run and the   */
+/*          remaining words are shared out in order, each run taking */
+/*          as many as fit. Called in a forked child in place of     */
+/*          exec; it exits with the status xargs would.              */
+/*                                                                   */
+/*********************************************************************/
+void run_batches( const char* path, char** prog, int max_procs )
+{
+    batch_runner br = { path, max_procs, 0, 0, F, F };
+    argv_source source = { prog, fixed_words( prog ), NULL };
+
+    _exit( stream_batches( &br, prog, source.next, argv_next, &source,
+                           arg_space(), 0, F ) );
+} /* end run_batches() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_xargs_builtin                              */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: NULL terminated argv of a program.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T if prog is an xargs the builtin can run: options -0,   */
+/*          -n N, -P N, -s N, -r and -t. Anything else is left to    */
+/*          the real xargs.                                          */
+/*                                                                   */
+/*********************************************************************/
+int is_xargs_builtin( char** prog )
+{
+    xargs_options opts;
+
+    if ( strcmp( prog[0], "xargs" ) != 0 )
+        return F;
+
+    return ( parse_xargs_options( prog, &opts ) == SUCCESS ? T : F );
+} /* end is_xargs_builtin() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_xargs                                     */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: argv accepted by is_xargs_builtin().        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          reads words from stdin and runs the command (echo by     */
+/*          default) with as many as fit, again and again. Words     */
+/*          are blank separated with ' " and \ quoting, or NUL       */
+/*          separated with -0. Called in a forked child; returns     */
+/*          the exit status.                                         */
+/*                                                                   */
+/*********************************************************************/
+int run_xargs( char** prog )
+{
+    static char* echo_cmd[] = { "echo", NULL };
+    static arg_reader reader;
+    char path[PATH_MAX];
+    batch_runner br = { path, 1, 0, 0, T, F };
+    stdin_source source = { &reader, NULL, NULL };
+    xargs_options opts;
+    size_t space;
+    int n_fixed = 0, status;
+    char** cmd;
+
+    parse_xargs_options( prog, &opts );
+    cmd = ( prog[opts.cmd_start] == NULL ? echo_cmd : prog + opts.cmd_start );
+
+    br.max_procs = opts.max_procs;
+    br.trace = opts.trace;
+
+    if ( resolve_program( cmd[0], path, sizeof(path) ) == FAILURE )
+        br.path = NULL;
+
+    space = arg_space();
+
+    if ( opts.max_chars > 0 && opts.max_chars < space )
+        space = opts.max_chars;
+
+    while ( cmd[n_fixed] != NULL )
+        n_fixed++;
+
+    if ( ( source.token = malloc( ARG_STRLEN_MAX ) ) == NULL )
+    {
+        fprintf( stderr, "xargs: out of memory.\n" );
+        return BATCH_FAILED;
+    }
+
+    reader.fd = STDIN_FILENO;
+    source.opts = &opts;
+
+    status = stream_batches( &br, cmd, n_fixed, stdin_next, &source, space,
+                             opts.max_args, !opts.no_empty );
+
+    free( source.token );
+
+    return status;
+} /* end run_xargs() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: stream_batches                                */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          batch_runner* br: how to run the command.                */
+/*          char** cmd: the words every run starts with.             */
+/*          int n_fixed: how many of them there are.                 */
+/*          word_source next: hands out the words to share out.      */
+/*          void* ctx: passed to next.                               */
+/*          size_t space: bytes of argv a run may have.              */
+/*          int max_args: most words per run, 0 for no limit.        */
+/*          int run_empty: T to run once even with no words.         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs cmd with as many words as fit, again and again.     */
+/*          Only one run's worth of words is held at a time: once    */
+/*          a run is forked its buffer is reused for the next, so    */
+/*          memory stays the same however many words there are.      */
+/*          Returns the exit status xargs would.                     */
+/*                                                                   */
+/*********************************************************************/
+static int stream_batches( batch_runner* br, char** cmd, int n_fixed,
+                           word_source next, void* ctx, size_t space,
+                           int max_args, int run_empty )
+{
+    size_t fixed = sizeof(char*), used, arena_used = 0, len;
+    int n_args = 0, argv_size = n_fixed + 64, ran = F, got;
+    char **argv, **grown, *arena;
+    const char* word;
+
+    for ( int i = 0; i < n_fixed; i++ )
+        fixed += ARG_COST( strlen( cmd[i] ) );
+
+    if ( fixed >= space )
+    {
+        fprintf( stderr, "Error: %s is too long to run.\n", cmd[0] );
+        return BATCH_TOO_LONG;
+    }
+
+    arena = malloc( space );
+    argv = malloc( argv_size * sizeof(char*) );
+
+    if ( arena == NULL || argv == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory.\n" );
+        free( arena );
+        free( argv );
+        return BATCH_FAILED;
+    }
+
+    memcpy( argv, cmd, n_fixed * sizeof(char*) );
+    used = fixed;
+
+    while ( ( got = next( ctx, &word, &len ) ) != 0 )
+    {
+        if ( got == -1 )
+        {
+            fprintf( stderr, "Error: Argument of %s is too long.\n", cmd[0] );
+            br->status = BATCH_TOO_LONG;
+            break;
+        }
+
+        /* start a run once this word won't fit in the current one */
+        if ( n_args > 0 && ( used + ARG_COST( len ) > space ||
+                             n_args == max_args ) )
+        {
+            argv[n_fixed + n_args] = NULL;
+            launch_batch( br, argv );
+            ran = T;
+            n_args = 0;
+            arena_used = 0;
+            used = fixed;
+        }
+
+        if ( used + ARG_COST( len ) > space )
+        {
+            fprintf( stderr, "Error: Argument of %s is too long.\n", cmd[0] );
+            br->status = BATCH_TOO_LONG;
+            break;
+        }
+
+        /* room for this word and the NULL after it */
+        if ( n_fixed + n_args + 2 > argv_size )
+        {
+            if ( ( grown = realloc( argv, argv_size * 2 * sizeof(char*) ) )
+                 == NULL )
+            {
+                fprintf( stderr, "Error: Out of memory.\n" );
+                br->status = BATCH_FAILED;
+                break;
+            }
+
+            argv = grown;
+            argv_size *= 2;
+        }
+
+        memcpy( arena + arena_used, word, len + 1 );
+        argv[n_fixed + n_args++] = arena + arena_used;
+        arena_used += len + 1;
+        used += ARG_COST( len );
+    }
+
+    /* like GNU xargs, run once even with no input unless -r */
+    if ( n_args > 0 || ( !ran && run_empty && got == 0 ) )
+    {
+        argv[n_fixed + n_args] = NULL;
+        launch_batch( br, argv );
+    }
+
+    while ( br->running > 0 )
+        wait_batch( br );
+
+    free( arena );
+    free( argv );
+
+    return br->status;
+} /* end stream_batches() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: argv_next                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          void* ctx: an argv_source.                               */
+/*          const char** word: set to the next word.                 */
+/*          size_t* len: set to its length.                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the word_source for run_batches(). A BRACE_MARKER word   */
+/*          is compiled and its expansions handed out one by one.    */
+/*                                                                   */
+/*********************************************************************/
+static int argv_next( void* ctx, const char** word, size_t* len )
+{
+    argv_source* source = ctx;
+
+    for ( ;; )
+    {
+        if ( source->gen != NULL )
+        {
+            if ( brace_next( source->gen, word ) == SUCCESS )
+                break;
+
+            brace_free( source->gen );
+            source->gen = NULL;
+        }
+
+        if ( source->words[source->next] == NULL )
+            return 0;
+
+        *word = source->words[source->next++];
+
+        if ( (*word)[0] != BRACE_MARKER )
+            break;
+
+        if ( ( source->gen = brace_compile( ++*word ) ) == NULL )
+            break;
+    }
+
+    *len = strlen( *word );
+    return ( *len >= ARG_STRLEN_MAX ? -1 : 1 );
+} /* end argv_next() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: stdin_next                                    */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          void* ctx: a stdin_source.                               */
+/*          const char** word: set to the next word.                 */
+/*          size_t* len: set to its length.                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the word_source for run_xargs().                         */
+/*                                                                   */
+/*********************************************************************/
+static int stdin_next( void* ctx, const char** word, size_t* len )
+{
+    stdin_source* source = ctx;
+
+    *word = source->token;
+    return next_arg( source->reader, source->opts, source->token, len );
+} /* end stdin_next() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: env_bytes                                     */
+/*      Return type:   static size_t                                 */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the room the environment takes next to argv.     */
+/*                                                                   */
+/*********************************************************************/
+static size_t env_bytes( void )
+{
+    size_t total = sizeof(char*);
+
+    for ( char** env = environ; env != NULL && *env != NULL; env++ )
+        total += ARG_COST( strlen( *env ) );
+
+    return total;
+} /* end env_bytes() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: fixed_words                                   */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char** prog: NULL terminated argv of a program.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns how many words every batch repeats: the program  */
+/*          name and the options after it, up to and including       */
+/*          "--". A trailing target, as in "cp *.c dir", is not      */
+/*          recognised, which is why batching is opt-in.             */
+/*                                                                   */
+/*********************************************************************/
+static int fixed_words( char** prog )
+{
+    int i = 1;
+
+    while ( prog[i] != NULL && prog[i][0] == '-' && prog[i][1] != '\0' )
+    {
+        if ( strcmp( prog[i++], "--" ) == 0 )
+            break;
+    }
+
+    return i;
+} /* end fixed_words() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: launch_batch                                  */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          batch_runner* br: the runs of this command.              */
+/*          char** argv: one run's argv.                             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          forks a run of argv, first waiting for one to finish if  */
+/*          max_procs are going. The child has its own copy of argv, */
+/*          so the caller may refill it as soon as this returns.     */
+/*                                                                   */
+/*********************************************************************/
+static void launch_batch( batch_runner* br, char** argv )
+{
+    pid_t pid;
+    int fd;
+
+    while ( br->running >= br->max_procs )
+        wait_batch( br );
+
+    if ( br->trace )
+    {
+        for ( int i = 0; argv[i] != NULL; i++ )
+            fprintf( stderr, "%s%s", i == 0 ? "" : " ", argv[i] );
+
+        fputc( '\n', stderr );
+    }
+
+    if ( ( pid = fork() ) == -1 )
+    {
+        fprintf( stderr, "Error: Calling fork() failed.\n" );
+        br->status = BATCH_FAILED;
+        return;
+    }
+
+    if ( pid == 0 )
+    {
+        /* the words came from stdin, the command must not eat them */
+        if ( br->null_stdin &&
+             ( fd = open( "/dev/null", O_RDONLY ) ) != -1 )
+        {
+            dup2( fd, STDIN_FILENO );
+            close( fd );
+        }
+
+        exec_program( br->path, argv );
+    }
+
+    br->running++;
+} /* end launch_batch() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: wait_batch                                    */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          batch_runner* br: the runs of this command.              */
+/*                                                                   */
+/*      Description:                                                 */
+/*          waits for any one run and folds its status into br:      */
+/*          123 if a run failed, 125 if one was killed, 126 or 127   */
+/*          if the command couldn't be run, the worst one winning.   */
+/*                                                                   */
+/*********************************************************************/
+static void wait_batch( batch_runner* br )
+{
+    int wstatus, status = 0;
+
+    if ( waitpid( -1, &wstatus, 0 ) == -1 )
+    {
+        br->running = 0;
+        return;
+    }
+
+    br->running--;
+
+    if ( WIFSIGNALED( wstatus ) )
+        status = BATCH_KILLED;
+    else if ( WEXITSTATUS( wstatus ) >= 126 )
+        status = WEXITSTATUS( wstatus );
+    else if ( WEXITSTATUS( wstatus ) != 0 )
+        status = BATCH_FAILED;
+
+    if ( status > br->status )
+        br->status = status;
+} /* end wait_batch() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_xargs_options                           */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char** prog: an xargs argv.                              */
+/*          xargs_options* opts: filled in from it.                  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns FAILURE for an option the builtin doesn't have.  */
+/*                                                                   */
+/*********************************************************************/
+static int parse_xargs_options( char** prog, xargs_options* opts )
+{
+    int i;
+
+    memset( opts, 0, sizeof(*opts) );
+    opts->max_procs = 1;
+
+    for ( i = 1; prog[i] != NULL && prog[i][0] == '-'; i++ )
+    {
+        if ( strcmp( prog[i], "--" ) == 0 )
+        {
+            i++;
+            break;
+        }
+        else if ( strcmp( prog[i], "-0" ) == 0 ||
+                  strcmp( prog[i], "--null" ) == 0 )
+            opts->null_sep = T;
+        else if ( strcmp( prog[i], "-r" ) == 0 ||
+                  strcmp( prog[i], "--no-run-if-empty" ) == 0 )
+            opts->no_empty = T;
+        else if ( strcmp( prog[i], "-t" ) == 0 ||
+                  strcmp( prog[i], "--verbose" ) == 0 )
+            opts->trace = T;
+        else if ( prog[i + 1] != NULL && isdigit( prog[i + 1][0] ) &&
+                  strcmp( prog[i], "-n" ) == 0 )
+            opts->max_args = atoi( prog[++i] );
+        else if ( prog[i + 1] != NULL && isdigit( prog[i + 1][0] ) &&
+                  strcmp( prog[i], "-P" ) == 0 )
+            opts->max_procs = atoi( prog[++i] );
+        else if ( prog[i + 1] != NULL && isdigit( prog[i + 1][0] ) &&
+                  strcmp( prog[i], "-s" ) == 0 )
+            opts->max_chars = (size_t) atol( prog[++i] );
+        else
+            return FAILURE;
+    }
+
+    /* -P 0 means as many as possible */
+    if ( opts->max_procs <= 0 || opts->max_procs > ARG_MAX_PROCS )
+        opts->max_procs = ARG_MAX_PROCS;
+
+    opts->cmd_start = i;
+    return SUCCESS;
+} /* end parse_xargs_options() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: read_char                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          arg_reader* r: the input.                                */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the next byte of input, or EOF.                  */
+/*                                                                   */
+/*********************************************************************/
+static int read_char( arg_reader* r )
+{
+    ssize_t n;
+
+    if ( r->pos == r->len )
+    {
+        do
+            n = read( r->fd, r->buf, sizeof(r->buf) );
+        while ( n == -1 && errno == EINTR );
+
+        if ( n <= 0 )
+            return EOF;
+
+        r->pos = 0;
+        r->len = (size_t) n;
+    }
+
+    return (unsigned char) r->buf[r->pos++];
+} /* end read_char() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: next_arg                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          arg_reader* r: the input.                                */
+/*          const xargs_options* opts: how words are separated.      */
+/*          char* word: gets the word, ARG_STRLEN_MAX bytes.         */
+/*          size_t* len: set to its length.                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns 1 for a word, 0 at the end of input, or -1 if    */
+/*          the word is longer than any program could take.          */
+/*                                                                   */
+/*********************************************************************/
+static int next_arg( arg_reader* r, const xargs_options* opts, char* word,
+                     size_t* len )
+{
+    int c, quote = 0, any = F;
+
+    *len = 0;
+
+    if ( opts->null_sep )
+    {
+        while ( ( c = read_char( r ) ) != EOF && c != '\0' )
+        {
+            if ( *len + 1 >= ARG_STRLEN_MAX )
+                return -1;
+
+            word[(*len)++] = (char) c;
+        }
+
+        word[*len] = '\0';
+        return ( c == EOF && *len == 0 ? 0 : 1 );
+    }
+
+    while ( ( c = read_char( r ) ) != EOF && isspace( c ) )
+        ;
+
+    for ( ; c != EOF; c = read_char( r ) )
+    {
+        if ( quote == 0 && isspace( c ) )
+            break;
+
+        if ( quote == 0 && ( c == '\'' || c == '"' ) )
+        {
+            quote = c;
+            any = T;
+            continue;
+        }
+
+        if ( c == quote )
+        {
+            quote = 0;
+            continue;
+        }
+
+        if ( quote == 0 && c == '\\' && ( c = read_char( r ) ) == EOF )
+            break;
+
+        if ( *len + 1 >= ARG_STRLEN_MAX )
+            return -1;
+
+        word[(*len)++] = (char) c;
+    }
+
+    word[*len] = '\0';
+    return ( *len > 0 || any ? 1 : 0 );
+} /* end next_arg() */
@@ -0,0 +1,110 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: arg_batch.h                                 */
+/*          Description:                                             */
+/*              This module keeps commands under the kernel's        */
+/*              ARG_MAX. A program whose argv and environment would  */
+/*              not fit is split into the fewest runs that do, with  */
+/*              "set -o argbatch", and an xargs builtin streams its  */
+/*              stdin into such runs with one fixed size buffer.     */
+/*              Brace words too big to expand in the shell are       */
+/*              expanded here, a run's worth at a time.              */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef ARG_BATCH_H
+#define ARG_BATCH_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "./string_module.h"
+#include "./brace_expand.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define ARG_HEADROOM 2048
+#define ARG_STRLEN_MAX ( 32 * 4096 )
+#define ARG_READ_SIZE ( 64 * 1024 )
+#define ARG_MAX_PROCS 64
+
+/* exit statuses, as GNU xargs uses them */
+#define BATCH_FAILED 123
+#define BATCH_KILLED 125
+#define BATCH_TOO_LONG 1
+
+/* bytes one argument takes on the new program's stack */
+#define ARG_COST( len ) ( (size_t) (len) + 1 + sizeof(char*) )
+
+/* one set of runs of the same command */
+typedef struct batch_runner_t
+{
+    const char* path;
+    int         max_procs;
+    int         running;
+    int         status;
+    int         null_stdin;
+    int         trace;
+} batch_runner;
+
+/* what the xargs builtin was asked to do */
+typedef struct xargs_options_t
+{
+    int     null_sep;
+    int     max_args;
+    int     max_procs;
+    int     no_empty;
+    int     trace;
+    size_t  max_chars;
+    int     cmd_start;
+} xargs_options;
+
+/* stdin, read in large blocks and handed out a character at a time */
+typedef struct arg_reader_t
+{
+    int     fd;
+    size_t  pos;
+    size_t  len;
+    char    buf[ARG_READ_SIZE];
+} arg_reader;
+
+/* hands out the words to run with: 1 for a word, 0 at the end, -1
+ * for a word too long for any run */
+typedef int (*word_source)( void* ctx, const char** word, size_t* len );
+
+/* the words of an argv, expanding BRACE_MARKER words as it goes */
+typedef struct argv_source_t
+{
+    char**      words;
+    int         next;
+    brace_gen*  gen;
+} argv_source;
+
+/* the words xargs reads from stdin */
+typedef struct stdin_source_t
+{
+    arg_reader*             reader;
+    const xargs_options*    opts;
+    char*                   token;
+} stdin_source;
+
+/* function prototypes */
+size_t  arg_space( void );
+int     argv_too_long( char** prog );
+void    run_batches( const char* path, char** prog, int max_procs );
+int     is_xargs_builtin( char** prog );
+int     run_xargs( char** prog );
+
+#endif
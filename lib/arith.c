@@ -0,0 +1,819 @@
+#include "arith.h"
+
+/* binary operators, loosest first; "||" and "&&" jump, so are apart */
+#define ARITH_LEVELS 8
+
+static const arith_binop levels[ARITH_LEVELS][5] =
+{
+    { { "|", ARITH_BIT_OR }, { NULL, ARITH_POP } },
+    { { "^", ARITH_BIT_XOR }, { NULL, ARITH_POP } },
+    { { "&", ARITH_BIT_AND }, { NULL, ARITH_POP } },
+    { { "==", ARITH_EQ }, { "!=", ARITH_NE }, { NULL, ARITH_POP } },
+    { { "<=", ARITH_LE }, { ">=", ARITH_GE }, { "<", ARITH_LT },
+      { ">", ARITH_GT }, { NULL, ARITH_POP } },
+    { { "<<", ARITH_SHL }, { ">>", ARITH_SHR }, { NULL, ARITH_POP } },
+    { { "+", ARITH_ADD }, { "-", ARITH_SUB }, { NULL, ARITH_POP } },
+    { { "*", ARITH_MUL }, { "/", ARITH_DIV }, { "%", ARITH_MOD },
+      { NULL, ARITH_POP } }
+};
+
+/* "op=" assignments, and the operator each applies */
+static const arith_binop assigns[] =
+{
+    { "+=", ARITH_ADD }, { "-=", ARITH_SUB }, { "*=", ARITH_MUL },
+    { "/=", ARITH_DIV }, { "%=", ARITH_MOD }, { "<<=", ARITH_SHL },
+    { ">>=", ARITH_SHR }, { "&=", ARITH_BIT_AND }, { "^=", ARITH_BIT_XOR },
+    { "|=", ARITH_BIT_OR }, { "=", ARITH_POP }, { NULL, ARITH_POP }
+};
+
+/* local prototypes */
+static void         parse_comma( arith_parser* );
+static void         parse_assign( arith_parser* );
+static void         parse_ternary( arith_parser* );
+static void         parse_logic( arith_parser*, const char* );
+static void         parse_binary( arith_parser*, int );
+static void         parse_unary( arith_parser* );
+static void         parse_primary( arith_parser* );
+static int          match( arith_parser*, const char* );
+static int          read_name( arith_parser*, int );
+static int          emit( arith_parser*, arith_code, int64_t );
+static void         syntax_error( arith_parser* );
+static int64_t      read_var( const char* );
+static int          write_var( const char*, int64_t );
+static int64_t      apply( arith_code, int64_t, int64_t );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: arith_compile                                 */
+/*      Return type:   arith_prog*                                   */
+/*      Parameter(s):                                                */
+/*          const char* source: the text between "((" and "))".      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the compiled expression, or NULL after reporting */
+/*          a syntax error. An empty expression is 0.                */
+/*                                                                   */
+/*********************************************************************/
+arith_prog* arith_compile( const char* source )
+{
+    arith_prog* prog = calloc( 1, sizeof(arith_prog) );
+    arith_parser p = { source, prog, 0, 0, F };
+
+    if ( prog == NULL || ( prog->source = strdup( source ) ) == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory compiling arithmetic.\n" );
+        arith_free( prog );
+        return NULL;
+    }
+
+    while ( isspace( (unsigned char) *p.pos ) )
+        p.pos++;
+
+    if ( *p.pos == '\0' )
+        emit( &p, ARITH_NUM, 0 );
+    else
+        parse_comma( &p );
+
+    while ( !p.error && isspace( (unsigned char) *p.pos ) )
+        p.pos++;
+
+    if ( !p.error && *p.pos != '\0' )
+        syntax_error( &p );
+
+    if ( !p.error && p.max_depth > ARITH_STACK_SIZE )
+    {
+        fprintf( stderr, "Error: Arithmetic nested too deeply: %s\n",
+                 source );
+        p.error = T;
+    }
+
+    if ( p.error )
+    {
+        arith_free( prog );
+        return NULL;
+    }
+
+    return prog;
+} /* end arith_compile() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: arith_eval                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          arith_prog* prog: a compiled expression.                 */
+/*          int64_t* result: set to its value.                       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs the program on a stack in this frame, which the     */
+/*          compiler made sure is deep enough. FAILURE on division   */
+/*          by zero or a variable that can't be set.                 */
+/*                                                                   */
+/*********************************************************************/
+int arith_eval( arith_prog* prog, int64_t* result )
+{
+    int64_t stack[ARITH_STACK_SIZE];
+    const arith_op* op;
+    int64_t value;
+    int sp = 0;
+
+    for ( int pc = 0; pc < prog->n_ops; pc++ )
+    {
+        op = &prog->ops[pc];
+
+        switch ( op->code )
+        {
+            case ARITH_NUM:
+                stack[sp++] = op->arg;
+                break;
+
+            case ARITH_VAR:
+                stack[sp++] = read_var( prog->names[op->arg] );
+                break;
+
+            case ARITH_STORE:
+                if ( write_var( prog->names[op->arg], stack[sp - 1] )
+                     == FAILURE )
+                    return FAILURE;
+                break;
+
+            case ARITH_PRE_INC:
+            case ARITH_POST_INC:
+                value = read_var( prog->names[op->arg >> 1] );
+
+                if ( write_var( prog->names[op->arg >> 1],
+                                apply( ARITH_ADD, value,
+                                       op->arg & 1 ? -1 : 1 ) ) == FAILURE )
+                    return FAILURE;
+
+                stack[sp++] = ( op->code == ARITH_POST_INC ? value :
+                                apply( ARITH_ADD, value,
+                                       op->arg & 1 ? -1 : 1 ) );
+                break;
+
+            case ARITH_NEG:
+                stack[sp - 1] = apply( ARITH_SUB, 0, stack[sp - 1] );
+                break;
+
+            case ARITH_NOT:
+                stack[sp - 1] = !stack[sp - 1];
+                break;
+
+            case ARITH_COMPL:
+                stack[sp - 1] = ~stack[sp - 1];
+                break;
+
+            case ARITH_BOOL:
+                stack[sp - 1] = ( stack[sp - 1] != 0 );
+                break;
+
+            case ARITH_AND_JUMP:
+                if ( stack[sp - 1] == 0 )
+                    pc = (int) op->arg - 1;
+                else
+                    sp--;
+                break;
+
+            case ARITH_OR_JUMP:
+                if ( stack[sp - 1] != 0 )
+                {
+                    stack[sp - 1] = 1;
+                    pc = (int) op->arg - 1;
+                }
+                else
+                    sp--;
+                break;
+
+            case ARITH_JUMP_ZERO:
+                if ( stack[--sp] == 0 )
+                    pc = (int) op->arg - 1;
+                break;
+
+            case ARITH_JUMP:
+                pc = (int) op->arg - 1;
+                break;
+
+            case ARITH_POP:
+                sp--;
+                break;
+
+            default:
+                if ( ( op->code == ARITH_DIV || op->code == ARITH_MOD ) &&
+                     stack[sp - 1] == 0 )
+                {
+                    fprintf( stderr, "Error: Division by zero in %s\n",
+                             prog->source );
+                    return FAILURE;
+                }
+
+                sp--;
+                stack[sp - 1] = apply( op->code, stack[sp - 1], stack[sp] );
+                break;
+        }
+    }
+
+    *result = ( sp > 0 ? stack[sp - 1] : 0 );
+    return SUCCESS;
+} /* end arith_eval() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: arith_string                                  */
+/*      Return type:   const char*                                   */
+/*      Parameter(s):                                                */
+/*          arith_prog* prog: a compiled expression.                 */
+/*                                                                   */
+/*      Description:                                                 */
+/*          evaluates prog into its own text buffer, which the next  */
+/*          evaluation overwrites. NULL on failure.                  */
+/*                                                                   */
+/*********************************************************************/
+const char* arith_string( arith_prog* prog )
+{
+    int64_t value;
+
+    if ( arith_eval( prog, &value ) == FAILURE )
+        return NULL;
+
+    snprintf( prog->text, sizeof(prog->text), "%lld", (long long) value );
+    return prog->text;
+} /* end arith_string() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: arith_free                                    */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          arith_prog* prog: a compiled expression, may be NULL.    */
+/*                                                                   */
+/*********************************************************************/
+void arith_free( arith_prog* prog )
+{
+    if ( prog == NULL )
+        return;
+
+    for ( int i = 0; i < prog->n_names; i++ )
+        free( prog->names[i] );
+
+    free( prog->names );
+    free( prog->ops );
+    free( prog->source );
+    free( prog );
+} /* end arith_free() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_comma                                   */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          arith_parser* p: the compiler.                           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          EXPR [, EXPR]..., whose value is the last one's.         */
+/*                                                                   */
+/*********************************************************************/
+static void parse_comma( arith_parser* p )
+{
+    parse_assign( p );
+
+    while ( !p->error && match( p, "," ) )
+    {
+        emit( p, ARITH_POP, 0 );
+        parse_assign( p );
+    }
+} /* end parse_comma() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_assign                                  */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          arith_parser* p: the compiler.                           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          NAME = EXPR and NAME op= EXPR, which group to the right, */
+/*          or else a conditional expression.                        */
+/*                                                                   */
+/*********************************************************************/
+static void parse_assign( arith_parser* p )
+{
+    const char* start = p->pos;
+    int name;
+
+    if ( ( name = read_name( p, F ) ) >= 0 )
+    {
+        for ( int i = 0; assigns[i].text != NULL; i++ )
+        {
+            if ( !match( p, assigns[i].text ) )
+                continue;
+
+            if ( assigns[i].code != ARITH_POP )
+                emit( p, ARITH_VAR, name );
+
+            parse_assign( p );
+
+            if ( assigns[i].code != ARITH_POP )
+                emit( p, assigns[i].code, 0 );
+
+            emit( p, ARITH_STORE, name );
+            return;
+        }
+    }
+
+    /* not an assignment after all; the name is read again below */
+    p->pos = start;
+    parse_ternary( p );
+} /* end parse_assign() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_ternary                                 */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          arith_parser* p: the compiler.                           */
+/*                                                                   */
+/*********************************************************************/
+static void parse_ternary( arith_parser* p )
+{
+    int to_else, to_end;
+
+    parse_logic( p, "||" );
+
+    if ( p->error || !match( p, "?" ) )
+        return;
+
+    to_else = emit( p, ARITH_JUMP_ZERO, 0 );
+    parse_comma( p );
+    to_end = emit( p, ARITH_JUMP, 0 );
+
+    /* the else branch starts from the depth the then branch did */
+    p->depth--;
+
+    if ( !match( p, ":" ) )
+    {
+        syntax_error( p );
+        return;
+    }
+
+    p->prog->ops[to_else].arg = p->prog->n_ops;
+    parse_assign( p );
+    p->prog->ops[to_end].arg = p->prog->n_ops;
+} /* end parse_ternary() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_logic                                   */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          arith_parser* p: the compiler.                           */
+/*          const char* op: "||" or "&&".                            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the right hand side is jumped over once the left one     */
+/*          decides the answer, as in C.                             */
+/*                                                                   */
+/*********************************************************************/
+static void parse_logic( arith_parser* p, const char* op )
+{
+    int jump;
+
+    if ( op[0] == '|' )
+        parse_logic( p, "&&" );
+    else
+        parse_binary( p, 0 );
+
+    while ( !p->error && match( p, op ) )
+    {
+        jump = emit( p, op[0] == '|' ? ARITH_OR_JUMP : ARITH_AND_JUMP, 0 );
+
+        if ( op[0] == '|' )
+            parse_logic( p, "&&" );
+        else
+            parse_binary( p, 0 );
+
+        emit( p, ARITH_BOOL, 0 );
+        p->prog->ops[jump].arg = p->prog->n_ops;
+    }
+} /* end parse_logic() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_binary                                  */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          arith_parser* p: the compiler.                           */
+/*          int level: index into levels, ARITH_LEVELS for unary.    */
+/*                                                                   */
+/*********************************************************************/
+static void parse_binary( arith_parser* p, int level )
+{
+    int found = T;
+
+    if ( level == ARITH_LEVELS )
+    {
+        parse_unary( p );
+        return;
+    }
+
+    parse_binary( p, level + 1 );
+
+    while ( !p->error && found )
+    {
+        found = F;
+
+        for ( int i = 0; levels[level][i].text != NULL && !found; i++ )
+        {
+            if ( match( p, levels[level][i].text ) )
+            {
+                parse_binary( p, level + 1 );
+                emit( p, levels[level][i].code, 0 );
+                found = T;
+            }
+        }
+    }
+} /* end parse_binary() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_unary                                   */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          arith_parser* p: the compiler.                           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          ++NAME, --NAME, -, +, ! and ~. The increments carry the  */
+/*          name's index shifted left one, the low bit set for --.   */
+/*                                                                   */
+/*********************************************************************/
+static void parse_unary( arith_parser* p )
+{
+    int name, down;
+
+    if ( ( down = match( p, "--" ) ) || match( p, "++" ) )
+    {
+        if ( ( name = read_name( p, F ) ) < 0 )
+            syntax_error( p );
+        else
+            emit( p, ARITH_PRE_INC, ( name << 1 ) | down );
+    }
+    else if ( match( p, "-" ) )
+    {
+        parse_unary( p );
+        emit( p, ARITH_NEG, 0 );
+    }
+    else if ( match( p, "+" ) )
+        parse_unary( p );
+    else if ( match( p, "!" ) )
+    {
+        parse_unary( p );
+        emit( p, ARITH_NOT, 0 );
+    }
+    else if ( match( p, "~" ) )
+    {
+        parse_unary( p );
+        emit( p, ARITH_COMPL, 0 );
+    }
+    else
+        parse_primary( p );
+} /* end parse_unary() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_primary                                 */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          arith_parser* p: the compiler.                           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          a number, decimal or 0x hex, a variable, written NAME,   */
+/*          $NAME or $N, NAME++, NAME-- or ( EXPR ).                 */
+/*                                                                   */
+/*********************************************************************/
+static void parse_primary( arith_parser* p )
+{
+    const char* start;
+    char* end;
+    int64_t value;
+    int name, down;
+
+    while ( isspace( (unsigned char) *p->pos ) )
+        p->pos++;
+
+    start = p->pos;
+
+    if ( match( p, "(" ) )
+    {
+        parse_comma( p );
+
+        if ( !p->error && !match( p, ")" ) )
+            syntax_error( p );
+    }
+    else if ( isdigit( (unsigned char) *start ) )
+    {
+        if ( start[0] == '0' && ( start[1] == 'x' || start[1] == 'X' ) )
+            value = (int64_t) strtoull( start + 2, &end, 16 );
+        else
+            value = (int64_t) strtoull( start, &end, 10 );
+
+        p->pos = end;
+
+        if ( isalnum( (unsigned char) *end ) || *end == '_' )
+            syntax_error( p );
+        else
+            emit( p, ARITH_NUM, value );
+    }
+    else if ( ( name = read_name( p, T ) ) >= 0 )
+    {
+        if ( ( down = match( p, "--" ) ) || match( p, "++" ) )
+            emit( p, ARITH_POST_INC, ( name << 1 ) | down );
+        else
+            emit( p, ARITH_VAR, name );
+    }
+    else
+        syntax_error( p );
+} /* end parse_primary() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: match                                         */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          arith_parser* p: the compiler.                           */
+/*          const char* op: operator to look for.                    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T, and op is skipped, if it comes next and is not the    */
+/*          start of a longer operator: "<" does not match "<<" or   */
+/*          "<=", nor "=" "==".                                      */
+/*                                                                   */
+/*********************************************************************/
+static int match( arith_parser* p, const char* op )
+{
+    size_t len = strlen( op );
+    char next;
+
+    while ( isspace( (unsigned char) *p->pos ) )
+        p->pos++;
+
+    if ( strncmp( p->pos, op, len ) != 0 )
+        return F;
+
+    next = p->pos[len];
+
+    if ( strchr( "()?:,~", op[0] ) == NULL &&
+         ( ( next == '=' && op[len - 1] != '=' ) ||
+           ( next == '=' && len == 1 ) ||
+           ( len == 1 && next == op[0] ) ) )
+        return F;
+
+    p->pos += len;
+    return T;
+} /* end match() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: read_name                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          arith_parser* p: the compiler.                           */
+/*          int dollar: T to also take $NAME and $N.                 */
+/*                                                                   */
+/*      Description:                                                 */
+/*          reads a variable name and returns its index in the       */
+/*          program's names, or -1, with nothing read, if there is   */
+/*          none.                                                    */
+/*                                                                   */
+/*********************************************************************/
+static int read_name( arith_parser* p, int dollar )
+{
+    const char* start;
+    char** grown;
+    size_t len = 0;
+    arith_prog* prog = p->prog;
+
+    while ( isspace( (unsigned char) *p->pos ) )
+        p->pos++;
+
+    start = p->pos;
+
+    if ( dollar && *start == '$' )
+    {
+        start++;
+
+        if ( isdigit( (unsigned char) *start ) )
+            while ( isdigit( (unsigned char) start[len] ) )
+                len++;
+    }
+
+    if ( len == 0 && ( isalpha( (unsigned char) *start ) || *start == '_' ) )
+        while ( isalnum( (unsigned char) start[len] ) || start[len] == '_' )
+            len++;
+
+    if ( len == 0 )
+        return -1;
+
+    p->pos = start + len;
+
+    for ( int i = 0; i < prog->n_names; i++ )
+        if ( strncmp( prog->names[i], start, len ) == 0 &&
+             prog->names[i][len] == '\0' )
+            return i;
+
+    if ( ( grown = realloc( prog->names, ( prog->n_names + 1 ) *
+                                         sizeof(char*) ) ) == NULL ||
+         ( grown[prog->n_names] = strndup( start, len ) ) == NULL )
+    {
+        if ( grown != NULL )
+            prog->names = grown;
+
+        fprintf( stderr, "Error: Out of memory compiling arithmetic.\n" );
+        p->error = T;
+        return -1;
+    }
+
+    prog->names = grown;
+    return prog->n_names++;
+} /* end read_name() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: emit                                          */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          arith_parser* p: the compiler.                           */
+/*          arith_code code: instruction to add.                     */
+/*          int64_t arg: its argument.                               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          appends the instruction, keeping track of how deep the   */
+/*          stack can get, and returns its index for jumps to be     */
+/*          patched.                                                 */
+/*                                                                   */
+/*********************************************************************/
+static int emit( arith_parser* p, arith_code code, int64_t arg )
+{
+    arith_prog* prog = p->prog;
+    arith_op* grown;
+
+    if ( p->error )
+        return 0;
+
+    if ( prog->n_ops == prog->cap )
+    {
+        if ( ( grown = realloc( prog->ops, ( prog->cap + ARITH_OPS_SIZE ) *
+                                           sizeof(arith_op) ) ) == NULL )
+        {
+            fprintf( stderr, "Error: Out of memory compiling arithmetic.\n" );
+            p->error = T;
+            return 0;
+        }
+
+        prog->ops = grown;
+        prog->cap += ARITH_OPS_SIZE;
+    }
+
+    switch ( code )
+    {
+        case ARITH_NUM:
+        case ARITH_VAR:
+        case ARITH_PRE_INC:
+        case ARITH_POST_INC:
+            if ( ++p->depth > p->max_depth )
+                p->max_depth = p->depth;
+            break;
+
+        case ARITH_STORE:
+        case ARITH_NEG:
+        case ARITH_NOT:
+        case ARITH_COMPL:
+        case ARITH_BOOL:
+        case ARITH_JUMP:
+            break;
+
+        default:
+            p->depth--;
+            break;
+    }
+
+    prog->ops[prog->n_ops].code = code;
+    prog->ops[prog->n_ops].arg = arg;
+
+    return prog->n_ops++;
+} /* end emit() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: syntax_error                                  */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          arith_parser* p: the compiler.                           */
+/*                                                                   */
+/*********************************************************************/
+static void syntax_error( arith_parser* p )
+{
+    if ( !p->error )
+        fprintf( stderr, "Error: Bad arithmetic near \"%s\" in %s\n",
+                 *p->pos == '\0' ? "end" : p->pos, p->prog->source );
+
+    p->error = T;
+} /* end syntax_error() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: read_var                                      */
+/*      Return type:   static int64_t                                */
+/*      Parameter(s):                                                */
+/*          const char* name: variable to read.                      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          an unset or non-numeric variable is 0.                   */
+/*                                                                   */
+/*********************************************************************/
+static int64_t read_var( const char* name )
+{
+    const char* value = var_get( name );
+
+    return ( value == NULL ? 0 : (int64_t) strtoll( value, NULL, 10 ) );
+} /* end read_var() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: write_var                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* name: variable to set.                       */
+/*          int64_t value: its new value.                            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          formatted on the stack; var_set() reuses the variable's  */
+/*          buffer, so nothing is allocated.                         */
+/*                                                                   */
+/*********************************************************************/
+static int write_var( const char* name, int64_t value )
+{
+    char text[ARITH_TEXT_SIZE];
+
+    snprintf( text, sizeof(text), "%lld", (long long) value );
+    return var_set( name, text );
+} /* end write_var() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: apply                                         */
+/*      Return type:   static int64_t                                */
+/*      Parameter(s):                                                */
+/*          arith_code code: a binary operator.                      */
+/*          int64_t a: left operand.                                 */
+/*          int64_t b: right operand, not 0 for / and %.             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          overflow wraps round rather than being undefined, and    */
+/*          shift counts are taken modulo 64.                        */
+/*                                                                   */
+/*********************************************************************/
+static int64_t apply( arith_code code, int64_t a, int64_t b )
+{
+    uint64_t x = (uint64_t) a, y = (uint64_t) b;
+
+    switch ( code )
+    {
+        case ARITH_MUL:     return (int64_t) ( x * y );
+        case ARITH_ADD:     return (int64_t) ( x + y );
+        case ARITH_SUB:     return (int64_t) ( x - y );
+        case ARITH_SHL:     return (int64_t) ( x << ( y & 63 ) );
+        case ARITH_SHR:     return a >> ( y & 63 );
+        case ARITH_LT:      return a < b;
+        case ARITH_LE:      return a <= b;
+        case ARITH_GT:      return a > b;
+        case ARITH_GE:      return a >= b;
+        case ARITH_EQ:      return a == b;
+        case ARITH_NE:      return a != b;
+        case ARITH_BIT_AND: return a & b;
+        case ARITH_BIT_XOR: return a ^ b;
+        case ARITH_BIT_OR:  return a | b;
+
+        /* INT64_MIN / -1 is the one quotient that overflows */
+        case ARITH_DIV:     return ( b == -1 ? (int64_t) ( 0 - x ) : a / b );
+        case ARITH_MOD:     return ( b == -1 ? 0 : a % b );
+
+        default:            return 0;
+    }
+} /* end apply() */
@@ -0,0 +1,111 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: arith.h                                     */
+/*          Description:                                             */
+/*              This module evaluates $(( )) and (( )). An           */
+/*              expression is compiled once into a postfix program   */
+/*              over 64 bit integers, with the usual C operators,    */
+/*              assignments and ++/--, which then runs on a fixed    */
+/*              stack without allocating, so ((i++)) in a loop       */
+/*              costs two variable lookups and no fork.              */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef ARITH_H
+#define ARITH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include "./string_module.h"
+#include "./variables.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define ARITH_STACK_SIZE 64
+#define ARITH_TEXT_SIZE 24
+#define ARITH_OPS_SIZE 16
+
+/* a word holding a compiled $(( )) starts with this, then its index */
+#define ARITH_MARKER '\035'
+
+/* one instruction; what arg is depends on the code */
+typedef enum arith_code_t
+{
+    ARITH_NUM,          /* push arg */
+    ARITH_VAR,          /* push variable arg */
+    ARITH_STORE,        /* set variable arg to the top, kept */
+    ARITH_PRE_INC,      /* add arg to a variable, push the new value */
+    ARITH_POST_INC,     /* add arg to a variable, push the old value */
+    ARITH_NEG,
+    ARITH_NOT,
+    ARITH_COMPL,
+    ARITH_MUL,
+    ARITH_DIV,
+    ARITH_MOD,
+    ARITH_ADD,
+    ARITH_SUB,
+    ARITH_SHL,
+    ARITH_SHR,
+    ARITH_LT,
+    ARITH_LE,
+    ARITH_GT,
+    ARITH_GE,
+    ARITH_EQ,
+    ARITH_NE,
+    ARITH_BIT_AND,
+    ARITH_BIT_XOR,
+    ARITH_BIT_OR,
+    ARITH_AND_JUMP,     /* top 0: jump to arg keeping it, else pop */
+    ARITH_OR_JUMP,      /* top not 0: make it 1 and jump, else pop */
+    ARITH_JUMP_ZERO,    /* pop, jump to arg if it was 0 */
+    ARITH_JUMP,
+    ARITH_BOOL,         /* top becomes 0 or 1 */
+    ARITH_POP
+} arith_code;
+
+typedef struct arith_op_t
+{
+    arith_code  code;
+    int64_t     arg;
+} arith_op;
+
+/* a binary operator of one precedence level */
+typedef struct arith_binop_t
+{
+    const char* text;
+    arith_code  code;
+} arith_binop;
+
+/* a compiled expression */
+typedef struct arith_prog_t
+{
+    char*       source;
+    arith_op*   ops;
+    int         n_ops;
+    int         cap;
+    char**      names;
+    int         n_names;
+    char        text[ARITH_TEXT_SIZE];
+} arith_prog;
+
+/* the compiler's place in the source */
+typedef struct arith_parser_t
+{
+    const char* pos;
+    arith_prog* prog;
+    int         depth;
+    int         max_depth;
+    int         error;
+} arith_parser;
+
+/* function prototypes */
+arith_prog* arith_compile( const char* source );
+int         arith_eval( arith_prog* prog, int64_t* result );
+const char* arith_string( arith_prog* prog );
+void        arith_free( arith_prog* prog );
+
+#endif
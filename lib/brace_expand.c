@@ -0,0 +1,724 @@
+#include "brace_expand.h"
+
+/* local prototypes */
+static brace_gen*   parse_gen( const char*, size_t );
+static int          parse_group( brace_part*, const char*, size_t );
+static int          parse_seq( brace_part*, const char*, size_t );
+static int          is_number( const char* );
+static long         find_close( const char*, size_t, size_t );
+static int          advance_gen( brace_gen* );
+static int          advance_part( brace_part* );
+static void         reset_gen( brace_gen* );
+static char*        render( const brace_gen*, char* );
+static size_t       number_len( long, int );
+static void         free_gen( brace_gen* );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: has_braces                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* word: word to check.                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          a quick test that rules out almost every word: SUCCESS   */
+/*          if word has a "{" and a later "}" with a "," or ".."     */
+/*          somewhere. brace_compile() makes the real decision.      */
+/*                                                                   */
+/*********************************************************************/
+int has_braces( const char* word )
+{
+    const char* open = strchr( word, '{' );
+
+    if ( open == NULL || strchr( open, '}' ) == NULL )
+        return FAILURE;
+
+    return ( strchr( open, ',' ) != NULL || strstr( open, ".." ) != NULL ?
+             SUCCESS : FAILURE );
+} /* end has_braces() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: brace_compile                                 */
+/*      Return type:   brace_gen*                                    */
+/*      Parameter(s):                                                */
+/*          const char* word: word to compile.                       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns a generator for word, or NULL if it has nothing  */
+/*          to expand. A "{" without a valid list or sequence        */
+/*          inside, like "{}" or "{a}", is kept as text, as in bash. */
+/*                                                                   */
+/*********************************************************************/
+brace_gen* brace_compile( const char* word )
+{
+    brace_gen* gen;
+    char* source;
+    int expands = 0;
+
+    if ( has_braces( word ) == FAILURE ||
+         ( source = strdup( word ) ) == NULL )
+        return NULL;
+
+    if ( ( gen = parse_gen( source, strlen( source ) ) ) == NULL )
+    {
+        free( source );
+        return NULL;
+    }
+
+    gen->source = source;
+
+    for ( int i = 0; i < gen->n_parts; i++ )
+        if ( gen->parts[i].kind != BRACE_TEXT )
+            expands = 1;
+
+    /* every expansion is built in the same buffer */
+    gen->buf_size = brace_max_len( gen ) + 1;
+
+    if ( !expands || ( gen->buf = malloc( gen->buf_size ) ) == NULL )
+    {
+        brace_free( gen );
+        return NULL;
+    }
+
+    return gen;
+} /* end brace_compile() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: brace_next                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          brace_gen* gen: a generator from brace_compile().        */
+/*          const char** word: set to the next expansion. It is      */
+/*                             overwritten by the next call.         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          hands out expansions in bash's order, the last group     */
+/*          changing fastest. Returns FAILURE when there are no      */
+/*          more.                                                    */
+/*                                                                   */
+/*********************************************************************/
+int brace_next( brace_gen* gen, const char** word )
+{
+    char* end;
+
+    if ( !gen->started )
+    {
+        reset_gen( gen );
+        gen->started = 1;
+    }
+    else if ( !advance_gen( gen ) )
+        return FAILURE;
+
+    end = render( gen, gen->buf );
+    *end = '\0';
+    *word = gen->buf;
+
+    return SUCCESS;
+} /* end brace_next() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: brace_reset                                   */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          brace_gen* gen: generator to rewind.                     */
+/*                                                                   */
+/*********************************************************************/
+void brace_reset( brace_gen* gen )
+{
+    gen->started = 0;
+} /* end brace_reset() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: brace_count                                   */
+/*      Return type:   long                                          */
+/*      Parameter(s):                                                */
+/*          const brace_gen* gen: a compiled word.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns how many words gen expands to, without making    */
+/*          them. Saturates at LONG_MAX.                             */
+/*                                                                   */
+/*********************************************************************/
+long brace_count( const brace_gen* gen )
+{
+    long total = 1, n;
+    const brace_part* part;
+
+    for ( int i = 0; i < gen->n_parts; i++ )
+    {
+        part = &gen->parts[i];
+
+        switch ( part->kind )
+        {
+            case BRACE_LIST:
+                n = 0;
+                for ( int a = 0; a < part->n_alts; a++ )
+                {
+                    long sub = brace_count( part->alts[a] );
+                    n = ( n > LONG_MAX - sub ? LONG_MAX : n + sub );
+                }
+                break;
+            case BRACE_SEQ:
+            case BRACE_CHARS:
+                n = labs( part->end - part->start ) / labs( part->step ) + 1;
+                break;
+            default:
+                n = 1;
+        }
+
+        total = ( n != 0 && total > LONG_MAX / n ? LONG_MAX : total * n );
+    }
+
+    return total;
+} /* end brace_count() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: brace_max_len                                 */
+/*      Return type:   size_t                                        */
+/*      Parameter(s):                                                */
+/*          const brace_gen* gen: a compiled word.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the length of gen's longest expansion.           */
+/*                                                                   */
+/*********************************************************************/
+size_t brace_max_len( const brace_gen* gen )
+{
+    size_t total = 0, longest, len;
+    const brace_part* part;
+
+    for ( int i = 0; i < gen->n_parts; i++ )
+    {
+        part = &gen->parts[i];
+
+        switch ( part->kind )
+        {
+            case BRACE_TEXT:
+                total += part->len;
+                break;
+            case BRACE_LIST:
+                longest = 0;
+                for ( int a = 0; a < part->n_alts; a++ )
+                    if ( ( len = brace_max_len( part->alts[a] ) ) > longest )
+                        longest = len;
+                total += longest;
+                break;
+            case BRACE_SEQ:
+                len = number_len( part->start, part->width );
+                longest = number_len( part->end, part->width );
+                total += ( len > longest ? len : longest );
+                break;
+            case BRACE_CHARS:
+                total += 1;
+                break;
+        }
+    }
+
+    return total;
+} /* end brace_max_len() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: brace_free                                    */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          brace_gen* gen: generator from brace_compile().          */
+/*                                                                   */
+/*********************************************************************/
+void brace_free( brace_gen* gen )
+{
+    if ( gen == NULL )
+        return;
+
+    free( gen->source );
+    free( gen->buf );
+    free_gen( gen );
+} /* end brace_free() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: has_deferred_braces                           */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: NULL terminated argv of a program.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T if a word of prog was left for the child to expand.    */
+/*                                                                   */
+/*********************************************************************/
+int has_deferred_braces( char** prog )
+{
+    for ( int i = 0; prog[i] != NULL; i++ )
+        if ( prog[i][0] == BRACE_MARKER )
+            return 1;
+
+    return 0;
+} /* end has_deferred_braces() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_gen                                     */
+/*      Return type:   static brace_gen*                             */
+/*      Parameter(s):                                                */
+/*          const char* s: text to compile, kept by the generator.   */
+/*          size_t len: its length.                                  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          splits s into text and groups. A group is a "{" with     */
+/*          its matching "}"; a backslash hides the next character.  */
+/*                                                                   */
+/*********************************************************************/
+static brace_gen* parse_gen( const char* s, size_t len )
+{
+    size_t pos = 0, text_start = 0;
+    brace_part* part;
+    brace_gen* gen;
+    long close;
+
+    if ( ( gen = calloc( 1, sizeof(brace_gen) ) ) == NULL ||
+         ( gen->parts = calloc( len + 1, sizeof(brace_part) ) ) == NULL )
+    {
+        free( gen );
+        return NULL;
+    }
+
+    while ( pos < len )
+    {
+        if ( s[pos] == '\\' )
+        {
+            pos += 2;
+            continue;
+        }
+
+        if ( s[pos] != '{' || ( close = find_close( s, pos, len ) ) == -1 )
+        {
+            pos++;
+            continue;
+        }
+
+        part = &gen->parts[gen->n_parts + ( pos > text_start )];
+
+        if ( parse_group( part, s + pos + 1, (size_t) close - pos - 1 )
+             == FAILURE )
+        {
+            pos++;
+            continue;
+        }
+
+        /* the text before the group, then the group */
+        if ( pos > text_start )
+        {
+            gen->parts[gen->n_parts].kind = BRACE_TEXT;
+            gen->parts[gen->n_parts].text = s + text_start;
+            gen->parts[gen->n_parts++].len = pos - text_start;
+        }
+
+        gen->n_parts++;
+        pos = text_start = (size_t) close + 1;
+    }
+
+    if ( len > text_start || gen->n_parts == 0 )
+    {
+        gen->parts[gen->n_parts].kind = BRACE_TEXT;
+        gen->parts[gen->n_parts].text = s + text_start;
+        gen->parts[gen->n_parts++].len = len - text_start;
+    }
+
+    return gen;
+} /* end parse_gen() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_group                                   */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          brace_part* part: set to the group.                      */
+/*          const char* s: what is between the braces.               */
+/*          size_t len: its length.                                  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          a group with a "," at its own level is a list, each      */
+/*          item compiled in turn so lists can nest. Otherwise it    */
+/*          must be a sequence. Returns FAILURE if it is neither.    */
+/*                                                                   */
+/*********************************************************************/
+static int parse_group( brace_part* part, const char* s, size_t len )
+{
+    size_t start = 0;
+    int depth = 0, n_alts = 1;
+
+    for ( size_t i = 0; i < len; i++ )
+    {
+        if ( s[i] == '\\' )
+            i++;
+        else if ( s[i] == '{' )
+            depth++;
+        else if ( s[i] == '}' )
+            depth--;
+        else if ( s[i] == ',' && depth == 0 )
+            n_alts++;
+    }
+
+    if ( n_alts == 1 )
+        return parse_seq( part, s, len );
+
+    memset( part, 0, sizeof(*part) );
+    part->kind = BRACE_LIST;
+
+    if ( ( part->alts = calloc( n_alts, sizeof(brace_gen*) ) ) == NULL )
+        return FAILURE;
+
+    depth = 0;
+
+    for ( size_t i = 0; i <= len; i++ )
+    {
+        if ( i < len && s[i] == '\\' )
+            i++;
+        else if ( i < len && s[i] == '{' )
+            depth++;
+        else if ( i < len && s[i] == '}' )
+            depth--;
+        else if ( i == len || ( s[i] == ',' && depth == 0 ) )
+        {
+            if ( ( part->alts[part->n_alts++] = parse_gen( s + start,
+                                                           i - start ) )
+                 == NULL )
+                return FAILURE;
+
+            start = i + 1;
+        }
+    }
+
+    return SUCCESS;
+} /* end parse_group() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_seq                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          brace_part* part: set to the sequence.                   */
+/*          const char* s: what is between the braces.               */
+/*          size_t len: its length.                                  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          reads X..Y or X..Y..STEP, where X and Y are both whole   */
+/*          numbers or both single letters. The step's sign is       */
+/*          ignored: the sequence runs from X towards Y. Numbers     */
+/*          written with a leading zero are padded to the width of   */
+/*          the longer end, as in bash.                              */
+/*                                                                   */
+/*********************************************************************/
+static int parse_seq( brace_part* part, const char* s, size_t len )
+{
+    char text[BRACE_NUM_SIZE * 3];
+    char *first, *second, *third = NULL, *dots;
+    long step = 1;
+
+    if ( len >= sizeof(text) )
+        return FAILURE;
+
+    memcpy( text, s, len );
+    text[len] = '\0';
+    first = text;
+
+    if ( ( dots = strstr( first, ".." ) ) == NULL )
+        return FAILURE;
+
+    *dots = '\0';
+    second = dots + 2;
+
+    if ( ( dots = strstr( second, ".." ) ) != NULL )
+    {
+        *dots = '\0';
+        third = dots + 2;
+
+        if ( !is_number( third ) )
+            return FAILURE;
+
+        if ( ( step = labs( atol( third ) ) ) == 0 )
+            step = 1;
+    }
+
+    memset( part, 0, sizeof(*part) );
+
+    if ( is_number( first ) && is_number( second ) )
+    {
+        part->kind = BRACE_SEQ;
+        part->start = atol( first );
+        part->end = atol( second );
+
+        if ( ( first[first[0] == '-'] == '0' && strlen( first ) > 1 ) ||
+             ( second[second[0] == '-'] == '0' && strlen( second ) > 1 ) )
+            part->width = (int) ( strlen( first ) > strlen( second ) ?
+                                  strlen( first ) : strlen( second ) );
+    }
+    else if ( isalpha( (unsigned char) first[0] ) && first[1] == '\0' &&
+              isalpha( (unsigned char) second[0] ) && second[1] == '\0' )
+    {
+        part->kind = BRACE_CHARS;
+        part->start = (unsigned char) first[0];
+        part->end = (unsigned char) second[0];
+    }
+    else
+        return FAILURE;
+
+    part->step = ( part->start <= part->end ? step : -step );
+    part->cur = part->start;
+
+    return SUCCESS;
+} /* end parse_seq() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_number                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* s: text to check.                            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          1 if s is an optionally signed run of digits that fits   */
+/*          comfortably in a long.                                   */
+/*                                                                   */
+/*********************************************************************/
+static int is_number( const char* s )
+{
+    size_t n = 0;
+
+    if ( *s == '-' || *s == '+' )
+        s++;
+
+    for ( ; isdigit( (unsigned char) s[n] ); n++ )
+        ;
+
+    return ( n > 0 && s[n] == '\0' && n < 18 );
+} /* end is_number() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: find_close                                    */
+/*      Return type:   static long                                   */
+/*      Parameter(s):                                                */
+/*          const char* s: the text.                                 */
+/*          size_t open: index of a "{".                             */
+/*          size_t len: length of s.                                 */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the index of the matching "}", or -1.            */
+/*                                                                   */
+/*********************************************************************/
+static long find_close( const char* s, size_t open, size_t len )
+{
+    int depth = 0;
+
+    for ( size_t i = open; i < len; i++ )
+    {
+        if ( s[i] == '\\' )
+            i++;
+        else if ( s[i] == '{' )
+            depth++;
+        else if ( s[i] == '}' && --depth == 0 )
+            return (long) i;
+    }
+
+    return -1;
+} /* end find_close() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: advance_gen                                   */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          brace_gen* gen: generator to step.                       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          steps gen like an odometer, rightmost group first.       */
+/*          Returns 0, with gen back at its first word, once every   */
+/*          group has wrapped round.                                 */
+/*                                                                   */
+/*********************************************************************/
+static int advance_gen( brace_gen* gen )
+{
+    for ( int i = gen->n_parts - 1; i >= 0; i-- )
+        if ( advance_part( &gen->parts[i] ) )
+            return 1;
+
+    return 0;
+} /* end advance_gen() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: advance_part                                  */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          brace_part* part: part to step.                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns 0 if part wrapped back to its first value.       */
+/*                                                                   */
+/*********************************************************************/
+static int advance_part( brace_part* part )
+{
+    switch ( part->kind )
+    {
+        case BRACE_LIST:
+            if ( advance_gen( part->alts[part->alt] ) )
+                return 1;
+
+            if ( ++part->alt == part->n_alts )
+                part->alt = 0;
+
+            reset_gen( part->alts[part->alt] );
+            return ( part->alt != 0 );
+
+        case BRACE_SEQ:
+        case BRACE_CHARS:
+            part->cur += part->step;
+
+            if ( ( part->step > 0 && part->cur <= part->end ) ||
+                 ( part->step < 0 && part->cur >= part->end ) )
+                return 1;
+
+            part->cur = part->start;
+            return 0;
+
+        default:
+            return 0;
+    }
+} /* end advance_part() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: reset_gen                                     */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          brace_gen* gen: generator to put on its first word.      */
+/*                                                                   */
+/*********************************************************************/
+static void reset_gen( brace_gen* gen )
+{
+    brace_part* part;
+
+    for ( int i = 0; i < gen->n_parts; i++ )
+    {
+        part = &gen->parts[i];
+        part->cur = part->start;
+
+        if ( part->kind == BRACE_LIST )
+        {
+            part->alt = 0;
+            reset_gen( part->alts[0] );
+        }
+    }
+} /* end reset_gen() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: render                                        */
+/*      Return type:   static char*                                  */
+/*      Parameter(s):                                                */
+/*          const brace_gen* gen: generator to print.                */
+/*          char* out: where to write its current word.              */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the end of what was written. out must hold       */
+/*          brace_max_len() bytes.                                   */
+/*                                                                   */
+/*********************************************************************/
+static char* render( const brace_gen* gen, char* out )
+{
+    const brace_part* part;
+
+    for ( int i = 0; i < gen->n_parts; i++ )
+    {
+        part = &gen->parts[i];
+
+        switch ( part->kind )
+        {
+            case BRACE_TEXT:
+                memcpy( out, part->text, part->len );
+                out += part->len;
+                break;
+            case BRACE_LIST:
+                out = render( part->alts[part->alt], out );
+                break;
+            case BRACE_SEQ:
+                out += sprintf( out, "%0*ld", part->width, part->cur );
+                break;
+            case BRACE_CHARS:
+                *out++ = (char) part->cur;
+                break;
+        }
+    }
+
+    return out;
+} /* end render() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: number_len                                    */
+/*      Return type:   static size_t                                 */
+/*      Parameter(s):                                                */
+/*          long n: number to measure.                               */
+/*          int width: zero padded width, 0 for none.                */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns how many characters "%0*ld" prints for n.        */
+/*                                                                   */
+/*********************************************************************/
+static size_t number_len( long n, int width )
+{
+    char text[BRACE_NUM_SIZE];
+
+    return (size_t) snprintf( text, sizeof(text), "%0*ld", width, n );
+} /* end number_len() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: free_gen                                      */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          brace_gen* gen: a generator and the lists inside it.     */
+/*                                                                   */
+/*********************************************************************/
+static void free_gen( brace_gen* gen )
+{
+    for ( int i = 0; i < gen->n_parts; i++ )
+    {
+        if ( gen->parts[i].kind != BRACE_LIST )
+            continue;
+
+        for ( int a = 0; a < gen->parts[i].n_alts; a++ )
+            if ( gen->parts[i].alts[a] != NULL )
+                free_gen( gen->parts[i].alts[a] );
+
+        free( gen->parts[i].alts );
+    }
+
+    free( gen->parts );
+    free( gen );
+} /* end free_gen() */
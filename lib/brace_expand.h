@@ -0,0 +1,78 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: brace_expand.h                              */
+/*          Description:                                             */
+/*              This module expands {a,b,c}, {1..10}, {01..99..2}    */
+/*              and {a..z} in words. A word is compiled into a       */
+/*              generator that hands out one expansion at a time     */
+/*              from a single buffer, so even {1..10000000} takes    */
+/*              the same memory as {1..3}.                           */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef BRACE_EXPAND_H
+#define BRACE_EXPAND_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define BRACE_NUM_SIZE 32
+
+/* a word whose expansion was too big to put in cmds starts with this;
+ * the program's child expands it while running the batches */
+#define BRACE_MARKER '\036'
+
+/* what one part of a word is */
+typedef enum brace_kind_t
+{
+    BRACE_TEXT,         /* plain text between groups */
+    BRACE_LIST,         /* {a,b,c}, each alternative a generator */
+    BRACE_SEQ,          /* {1..10..2}, optionally zero padded */
+    BRACE_CHARS         /* {a..z} */
+} brace_kind;
+
+struct brace_gen_t;
+
+typedef struct brace_part_t
+{
+    brace_kind              kind;
+    const char*             text;
+    size_t                  len;
+    struct brace_gen_t**    alts;
+    int                     n_alts;
+    int                     alt;
+    long                    start;
+    long                    end;
+    long                    step;
+    long                    cur;
+    int                     width;
+} brace_part;
+
+/* a compiled word and where it has got to */
+typedef struct brace_gen_t
+{
+    brace_part*     parts;
+    int             n_parts;
+    int             started;
+    char*           source;
+    char*           buf;
+    size_t          buf_size;
+} brace_gen;
+
+/* function prototypes */
+int         has_braces( const char* word );
+brace_gen*  brace_compile( const char* word );
+int         brace_next( brace_gen* gen, const char** word );
+void        brace_reset( brace_gen* gen );
+long        brace_count( const brace_gen* gen );
+size_t      brace_max_len( const brace_gen* gen );
+void        brace_free( brace_gen* gen );
+int         has_deferred_braces( char** prog );
+
+#endif
@@ -1,7 +1,10 @@
 #include "command_history.h"
+#include "./jshell.h"
 
-/* globals */
-int history_count = 0;
+/* the calling thread's shell's history (see jshell.h) */
+#define history         ( jshell->history_log.entries )
+#define history_count   ( jshell->history_log.count )
+#define history_paused  ( jshell->history_log.paused )
 
 /*********************************************************************/
 /*                                                                   */
@@ -9,12 +12,19 @@ int history_count = 0;
 /*      Return type:   int                                           */
 /*      Parameter(s):                                                */
 /*          char** cmds:   command to add to history array           */
+/*          int n_cmds:    number of strings in cmds                 */
+/*          const run_stats* stats: resources the command used, or   */
+/*                         NULL if it wasn't measured                */
 /*                                                                   */
 /*********************************************************************/
-int add_cmds_to_history( char** cmds, int n_cmds )
+int add_cmds_to_history( char** cmds, int n_cmds, const run_stats* stats )
 {
     int ctr = 0;
 
+    /* commands run by a loop are not each worth a line */
+    if ( history_paused )
+        return SUCCESS;
+
     /* error handling */
     if ( history_count == CMD_LIMIT )
     {
@@ -36,6 +46,12 @@ int add_cmds_to_history( char** cmds, int n_cmds )
     /* set n_cmds to 0 */
     history[history_count].n_cmds = 0;
 
+    /* keep what the command used next to it */
+    if ( stats != NULL )
+        history[history_count].stats = *stats;
+    else
+        memset( &history[history_count].stats, 0, sizeof(run_stats) );
+
     /* add the cmds to the structure array */
     while( ctr != n_cmds )
     {
@@ -71,6 +87,46 @@ void print_history( FILE *fp )
 } /* end print_history() */
 
 
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: print_history_stats                           */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          FILE* fp: stream to print to.                            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          prints history with the wall, user and system time,      */
+/*          max RSS and exit status of each measured command.        */
+/*                                                                   */
+/*********************************************************************/
+void print_history_stats( FILE *fp )
+{
+    int ctr = 0, i = 0; 
+
+    fprintf( fp, "\t%8s %8s %8s %10s %6s  %s\n",
+             "real", "user", "sys", "maxrss(KB)", "status", "command" );
+
+    while( ctr < history_count )
+    {
+        cmd_history* h = &history[ctr];
+
+        if ( h->stats.valid )
+            fprintf( fp, "\t%8.3f %8.3f %8.3f %10ld %6d  ",
+                     h->stats.real, h->stats.user, h->stats.sys,
+                     h->stats.max_rss, h->stats.status );
+        else
+            fprintf( fp, "\t%8s %8s %8s %10s %6s  ", "-", "-", "-", "-", "-" );
+
+        for ( ; i < h->n_cmds; i++ )
+            fprintf( fp, "%s ", h->cmds[i] );
+
+        fprintf( fp, "\n" );
+        i = 0;
+        ctr++;
+    }
+} /* end print_history_stats() */
+
+
 /*********************************************************************/
 /*                                                                   */
 /*      Function name: write_history_to_file                         */
@@ -104,6 +160,29 @@ int write_history_to_file( void )
 } /* end write_history_to_file() */
 
 
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: pause_history                                 */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          int paused: T to stop recording, F to start again.       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the commands inside an if, loop or list are not added    */
+/*          one by one; the line that ran them is added instead.     */
+/*          Pauses nest, so a compound line in a script doesn't      */
+/*          start recording again while a script runs.               */
+/*                                                                   */
+/*********************************************************************/
+void pause_history( int paused )
+{
+    if ( paused )
+        history_paused++;
+    else if ( history_paused > 0 )
+        history_paused--;
+} /* end pause_history() */
+
+
 /*********************************************************************/
 /*                                                                   */
 /*      Function name: free_history                                  */
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <ctype.h>
 #include "string_module.h"
+#include "run_stats.h"
 
 /* macros */
 #define CMD_LIMIT 50
@@ -27,17 +28,25 @@
 /* structure to hold command input history */
 typedef struct cmd_history_t
 {
-    int     n_cmds; 
-    char**  cmds;
+    int         n_cmds; 
+    char**      cmds;
+    run_stats   stats;
 } cmd_history;
 
-/* globals */
-cmd_history     history[CMD_LIMIT];
+/* one shell's history */
+typedef struct history_state_t
+{
+    cmd_history entries[CMD_LIMIT];
+    int         count;
+    int         paused;     /* pause_history() depth, 0 records */
+} history_state;
 
 /* function prototypes */
-int     add_cmds_to_history( char**, int );
+int     add_cmds_to_history( char**, int, const run_stats* );
 void    print_history( FILE* );
+void    print_history_stats( FILE* );
 int     write_history_to_file( void );
+void    pause_history( int );
 int     free_history( void );
 
 #endif
\ No newline at end of file
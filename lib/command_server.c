@@ -0,0 +1,1048 @@
+#include "command_server.h"
+
+/* globals */
+static int              listen_fd = -1;
+static int              conn_fd = -1;
+static pid_t            server_pid = 0;
+static request_runner   run_text = NULL;
+static pid_t            workers[SERVE_MAX_WORKERS];
+static serve_request    request;
+static char             msg[SERVE_MSG_MAX];
+static char             chunk[SERVE_MSG_MAX];
+
+/* local prototypes */
+static int      open_listener( const char* );
+static pid_t    start_worker( void );
+static void     serve_connection( int );
+static int      read_request( int, serve_request* );
+static int      run_request( int, serve_request* );
+static pid_t    start_request( serve_request*, int, int );
+static int      relay_output( int, pid_t, int, int );
+static int      send_status( int, int );
+static int      send_frame( int, int, const void*, size_t );
+static int      pack_frame( size_t*, int, const char*, size_t );
+static int      pack_line( size_t*, char**, int );
+static int      read_full( int, void*, size_t );
+static int      write_full( int, const void*, size_t );
+static int      connect_server( const char* );
+static int      do_request( int, const char*, size_t, int );
+static int      run_bench( const char*, size_t, int, int );
+static void*    bench_connection( void* );
+static int      compare_doubles( const void*, const void* );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_command_server                            */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* path: where to put the socket.               */
+/*          int n_workers: most requests to run at once.             */
+/*          request_runner runner: runs a request's shell input.     */
+/*                                                                   */
+/*      Description:                                                 */
+/*          serves requests until killed. A worker killed by a       */
+/*          signal is replaced so the pool stays full. Returns       */
+/*          FAILURE if the socket can't be set up or no worker is    */
+/*          left.                                                    */
+/*                                                                   */
+/*********************************************************************/
+int run_command_server( const char* path, int n_workers,
+                        request_runner runner )
+{
+    int status;
+    pid_t pid;
+
+    if ( n_workers > SERVE_MAX_WORKERS )
+        n_workers = SERVE_MAX_WORKERS;
+
+    if ( ( listen_fd = open_listener( path ) ) == -1 )
+        return FAILURE;
+
+    run_text = runner;
+    server_pid = getpid();
+
+    /* a client that hangs up early must not kill its worker */
+    signal( SIGPIPE, SIG_IGN );
+
+    printf( "command server: %s, %d workers\n", path, n_workers );
+    fflush( stdout );
+
+    for ( int i = 0; i < n_workers; i++ )
+        if ( ( workers[i] = start_worker() ) == -1 )
+            fprintf( stderr, "Error: Could not start worker %d.\n", i + 1 );
+
+    while ( 1 )
+    {
+        if ( ( pid = wait( &status ) ) == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+            break;
+        }
+
+        /* one whose accept() failed would only fail again */
+        for ( int i = 0; i < n_workers; i++ )
+            if ( workers[i] == pid && WIFSIGNALED( status ) )
+                workers[i] = start_worker();
+    }
+
+    fprintf( stderr, "Error: Command server stopped: %s\n",
+             strerror( errno ) );
+    close( listen_fd );
+    unlink( path );
+    return FAILURE;
+} /* end run_command_server() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_client                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int argc: number of command line arguments.              */
+/*          char** argv: "shell --client socket [options] command".  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          sends one request and copies its output to stdout and    */
+/*          stderr, returning its exit status. The words of the      */
+/*          command are joined into a line for the shell, or with    */
+/*          -a run as a program. -C and -e set the directory and     */
+/*          environment, the directory defaulting to ours. With -n   */
+/*          it instead sends the request N times over -c             */
+/*          connections and reports requests/s and latencies.        */
+/*                                                                   */
+/*********************************************************************/
+int run_client( int argc, char** argv )
+{
+    char cwd[SERVE_PATH_SIZE];
+    const char* dir = NULL;
+    size_t len = 0;
+    int first, as_argv = F, count = 0, conns = 1, fd, status;
+
+    for ( first = 3; first < argc && argv[first][0] == '-'; first++ )
+    {
+        if ( strcmp( argv[first], "--" ) == 0 )
+        {
+            first++;
+            break;
+        }
+
+        if ( strcmp( argv[first], "-a" ) == 0 )
+            as_argv = T;
+        else if ( first + 1 < argc && strcmp( argv[first], "-C" ) == 0 )
+            dir = argv[++first];
+        else if ( first + 1 < argc && strcmp( argv[first], "-n" ) == 0 )
+            count = atoi( argv[++first] );
+        else if ( first + 1 < argc && strcmp( argv[first], "-c" ) == 0 )
+            conns = atoi( argv[++first] );
+        else if ( first + 1 < argc && strcmp( argv[first], "-e" ) == 0 &&
+                  pack_frame( &len, SERVE_ENV, argv[first + 1],
+                              strlen( argv[first + 1] ) ) == SUCCESS )
+            first++;
+        else
+        {
+            /* bad option: show the usage */
+            first = argc;
+            break;
+        }
+    }
+
+    if ( argc < 4 || first >= argc || count < 0 || conns < 1 )
+    {
+        fprintf( stderr, "usage: shell %s socket [-C dir] [-e NAME=VALUE]"
+                         "... [-a]\n       [-n requests [-c connections]]"
+                         " command ...\n", CLIENT_FLAG );
+        return EXIT_FAILURE;
+    }
+
+    if ( dir == NULL && ( dir = getcwd( cwd, sizeof(cwd) ) ) == NULL )
+    {
+        fprintf( stderr, "Error: Could not read the current directory.\n" );
+        return EXIT_FAILURE;
+    }
+
+    status = pack_frame( &len, SERVE_CWD, dir, strlen( dir ) );
+
+    for ( int i = first; as_argv && i < argc && status == SUCCESS; i++ )
+        status = pack_frame( &len, SERVE_ARG, argv[i], strlen( argv[i] ) );
+
+    if ( !as_argv && status == SUCCESS )
+        status = pack_line( &len, argv + first, argc - first );
+
+    if ( status == FAILURE || pack_frame( &len, SERVE_RUN, "", 0 )
+         == FAILURE )
+    {
+        fprintf( stderr, "Error: Request is too big.\n" );
+        return EXIT_FAILURE;
+    }
+
+    if ( count > 0 )
+        return run_bench( argv[2], len, count, conns );
+
+    if ( ( fd = connect_server( argv[2] ) ) == -1 )
+        return EXIT_FAILURE;
+
+    status = do_request( fd, msg, len, T );
+    close( fd );
+
+    if ( status == -1 )
+    {
+        fprintf( stderr, "Error: Lost the command server.\n" );
+        return EXIT_FAILURE;
+    }
+
+    return status;
+} /* end run_client() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: open_listener                                 */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* path: where to bind the socket.              */
+/*                                                                   */
+/*      Description:                                                 */
+/*          binds a Unix stream socket at path, replacing a socket   */
+/*          file nothing answers on. Returns the listening           */
+/*          descriptor or -1.                                        */
+/*                                                                   */
+/*********************************************************************/
+static int open_listener( const char* path )
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+
+    if ( strlen( path ) >= sizeof(addr.sun_path) )
+    {
+        fprintf( stderr, "Error: Socket path is too long: %s\n", path );
+        return -1;
+    }
+
+    strcpy( addr.sun_path, path );
+
+    if ( ( fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 ) ) == -1 )
+    {
+        fprintf( stderr, "Error: Could not create server socket.\n" );
+        return -1;
+    }
+
+    if ( connect( fd, (struct sockaddr*) &addr, sizeof(addr) ) == 0 )
+    {
+        fprintf( stderr, "Error: A server is already running on %s\n",
+                 path );
+        close( fd );
+        return -1;
+    }
+
+    unlink( path );
+
+    if ( bind( fd, (struct sockaddr*) &addr, sizeof(addr) ) == -1 ||
+         listen( fd, SERVE_BACKLOG ) == -1 )
+    {
+        fprintf( stderr, "Error: Could not listen on %s: %s\n", path,
+                 strerror( errno ) );
+        close( fd );
+        return -1;
+    }
+
+    return fd;
+} /* end open_listener() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: start_worker                                  */
+/*      Return type:   static pid_t                                  */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          forks a worker, which takes one connection at a time     */
+/*          off the shared listening socket and dies with the        */
+/*          server. Returns its pid or -1.                           */
+/*                                                                   */
+/*********************************************************************/
+static pid_t start_worker( void )
+{
+    pid_t pid;
+    int fd;
+
+    fflush( NULL );
+
+    if ( ( pid = fork() ) != 0 )
+        return pid;
+
+    prctl( PR_SET_PDEATHSIG, SIGTERM );
+
+    if ( getppid() != server_pid )
+        _exit( EXIT_SUCCESS );
+
+    while ( 1 )
+    {
+        if ( ( fd = accept4( listen_fd, NULL, NULL, SOCK_CLOEXEC ) ) == -1 )
+        {
+            if ( errno == EINTR || errno == ECONNABORTED )
+                continue;
+            _exit( EXIT_FAILURE );
+        }
+
+        serve_connection( fd );
+        close( fd );
+    }
+} /* end start_worker() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: serve_connection                              */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          int fd: an accepted connection.                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs requests one after another until the client hangs   */
+/*          up or sends something that isn't a request.              */
+/*                                                                   */
+/*********************************************************************/
+static void serve_connection( int fd )
+{
+    conn_fd = fd;
+
+    while ( read_request( fd, &request ) == SUCCESS )
+        if ( run_request( fd, &request ) == FAILURE )
+            break;
+
+    conn_fd = -1;
+} /* end serve_connection() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: read_request                                  */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          int fd: the connection.                                  */
+/*          serve_request* req: filled in with pointers into msg.    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          reads frames up to SERVE_RUN, NUL terminating each.      */
+/*          Returns FAILURE at the end of the connection, or for a   */
+/*          request that is malformed or bigger than msg.            */
+/*                                                                   */
+/*********************************************************************/
+static int read_request( int fd, serve_request* req )
+{
+    serve_frame frame;
+    size_t used = 0;
+    char* text;
+
+    req->cwd = NULL;
+    req->line = NULL;
+    req->n_env = 0;
+    req->argc = 0;
+
+    while ( read_full( fd, &frame, sizeof(frame) ) == SUCCESS )
+    {
+        if ( frame.type == SERVE_RUN )
+        {
+            req->argv[req->argc] = NULL;
+            return SUCCESS;
+        }
+
+        if ( frame.len >= sizeof(msg) - used )
+            return FAILURE;
+
+        text = msg + used;
+
+        if ( read_full( fd, text, frame.len ) == FAILURE )
+            return FAILURE;
+
+        text[frame.len] = '\0';
+        used += frame.len + 1;
+
+        if ( frame.type == SERVE_CWD )
+            req->cwd = text;
+        else if ( frame.type == SERVE_LINE )
+            req->line = text;
+        else if ( frame.type == SERVE_ENV && req->n_env < SERVE_MAX_WORDS )
+            req->env[req->n_env++] = text;
+        else if ( frame.type == SERVE_ARG && req->argc < SERVE_MAX_WORDS )
+            req->argv[req->argc++] = text;
+        else
+            return FAILURE;
+    }
+
+    return FAILURE;
+} /* end read_request() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_request                                   */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          int fd: the connection.                                  */
+/*          serve_request* req: what to run.                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs req and streams its reply. Returns FAILURE if the   */
+/*          client went away.                                        */
+/*                                                                   */
+/*********************************************************************/
+static int run_request( int fd, serve_request* req )
+{
+    static const char empty[] = "Error: Nothing to run.\n";
+    static const char no_pipes[] = "Error: Could not create pipes.\n";
+    int out[2], err[2];
+    pid_t pid;
+
+    if ( req->argc == 0 && req->line == NULL )
+        return ( send_frame( fd, SERVE_STDERR, empty, strlen( empty ) ) &&
+                 send_status( fd, EXIT_FAILURE ) );
+
+    if ( pipe2( out, O_CLOEXEC ) == -1 )
+        return ( send_frame( fd, SERVE_STDERR, no_pipes,
+                             strlen( no_pipes ) ) &&
+                 send_status( fd, EXIT_FAILURE ) );
+
+    if ( pipe2( err, O_CLOEXEC ) == -1 )
+    {
+        close( out[0] );
+        close( out[1] );
+        return ( send_frame( fd, SERVE_STDERR, no_pipes,
+                             strlen( no_pipes ) ) &&
+                 send_status( fd, EXIT_FAILURE ) );
+    }
+
+    pid = start_request( req, out[1], err[1] );
+    close( out[1] );
+    close( err[1] );
+
+    if ( pid == -1 )
+    {
+        close( out[0] );
+        close( err[0] );
+        return send_status( fd, EXIT_FAILURE );
+    }
+
+    return relay_output( fd, pid, out[0], err[0] );
+} /* end run_request() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: start_request                                 */
+/*      Return type:   static pid_t                                  */
+/*      Parameter(s):                                                */
+/*          serve_request* req: what to run.                         */
+/*          int out_fd: write end for its stdout.                    */
+/*          int err_fd: write end for its stderr.                    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          forks the process that runs req, in a process group of   */
+/*          its own so all of it can be killed, reading /dev/null.   */
+/*          The fork is a copy of the already started shell, so the  */
+/*          request pays for no exec or start-up, and nothing it     */
+/*          changes outlives it. Returns its pid or -1.              */
+/*                                                                   */
+/*********************************************************************/
+static pid_t start_request( serve_request* req, int out_fd, int err_fd )
+{
+    char* value;
+    pid_t pid;
+    int null_fd;
+
+    if ( ( pid = fork() ) != 0 )
+    {
+        if ( pid != -1 )
+            setpgid( pid, pid );
+        return pid;
+    }
+
+    setpgid( 0, 0 );
+    signal( SIGPIPE, SIG_DFL );
+    close( listen_fd );
+    close( conn_fd );
+
+    if ( ( null_fd = open( "/dev/null", O_RDONLY ) ) != -1 &&
+         null_fd != STDIN_FILENO )
+    {
+        dup2( null_fd, STDIN_FILENO );
+        close( null_fd );
+    }
+
+    dup2( out_fd, STDOUT_FILENO );
+    dup2( err_fd, STDERR_FILENO );
+    close( out_fd );
+    close( err_fd );
+
+    if ( req->cwd != NULL )
+    {
+        if ( chdir( req->cwd ) == -1 )
+        {
+            fprintf( stderr, "Error: Could not change to %s: %s\n",
+                     req->cwd, strerror( errno ) );
+            _exit( EXIT_FAILURE );
+        }
+
+        setenv( "PWD", req->cwd, 1 );
+    }
+
+    for ( int i = 0; i < req->n_env; i++ )
+    {
+        if ( ( value = strchr( req->env[i], '=' ) ) == NULL )
+            unsetenv( req->env[i] );
+        else
+        {
+            *value = '\0';
+            setenv( req->env[i], value + 1, 1 );
+        }
+    }
+
+    if ( req->argc > 0 )
+    {
+        execvp( req->argv[0], req->argv );
+        fprintf( stderr, "Error: Could not run %s: %s\n", req->argv[0],
+                 strerror( errno ) );
+        _exit( 127 );
+    }
+
+    exit( run_text( req->line ) );
+} /* end start_request() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: relay_output                                  */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          int fd: the connection.                                  */
+/*          pid_t pid: the request's process.                        */
+/*          int out_fd: read end of its stdout.                      */
+/*          int err_fd: read end of its stderr.                      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          sends output as it arrives until both pipes close, then  */
+/*          the exit status. If the client goes away, even while     */
+/*          the request is quiet, the request is killed and FAILURE  */
+/*          returned.                                                */
+/*                                                                   */
+/*********************************************************************/
+static int relay_output( int fd, pid_t pid, int out_fd, int err_fd )
+{
+    struct pollfd fds[3];
+    int n_open = 2, sent = SUCCESS, status = 0;
+    ssize_t n;
+
+    fds[0].fd = out_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = err_fd;
+    fds[1].events = POLLIN;
+    fds[2].fd = fd;
+    fds[2].events = POLLRDHUP;
+
+    while ( n_open > 0 )
+    {
+        if ( poll( fds, 3, -1 ) == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+            break;
+        }
+
+        if ( sent == SUCCESS && fds[2].revents != 0 )
+        {
+            sent = FAILURE;
+            fds[2].fd = -1;
+            kill( -pid, SIGKILL );
+        }
+
+        for ( int i = 0; i < 2; i++ )
+        {
+            if ( fds[i].fd == -1 || fds[i].revents == 0 )
+                continue;
+
+            if ( ( n = read( fds[i].fd, chunk, sizeof(chunk) ) ) > 0 )
+            {
+                if ( sent == SUCCESS &&
+                     ( sent = send_frame( fd, i == 0 ? SERVE_STDOUT :
+                                          SERVE_STDERR, chunk, (size_t) n ) )
+                     == FAILURE )
+                    kill( -pid, SIGKILL );
+            }
+            else if ( n == 0 || errno != EINTR )
+            {
+                close( fds[i].fd );
+                fds[i].fd = -1;
+                n_open--;
+            }
+        }
+    }
+
+    for ( int i = 0; i < 2; i++ )
+        if ( fds[i].fd != -1 )
+            close( fds[i].fd );
+
+    while ( waitpid( pid, &status, 0 ) == -1 && errno == EINTR )
+        continue;
+
+    if ( sent == FAILURE )
+        return FAILURE;
+
+    return send_status( fd, WIFSIGNALED( status ) ?
+                            128 + WTERMSIG( status ) :
+                            WEXITSTATUS( status ) );
+} /* end relay_output() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: send_status                                   */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          int fd: the connection.                                  */
+/*          int status: exit status ending the reply.                */
+/*                                                                   */
+/*********************************************************************/
+static int send_status( int fd, int status )
+{
+    return send_frame( fd, SERVE_STATUS, &status, sizeof(status) );
+} /* end send_status() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: send_frame                                    */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          int fd: the connection.                                  */
+/*          int type: what the bytes are.                            */
+/*          const void* data: the bytes.                             */
+/*          size_t len: how many.                                    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          writes the header and data with one writev() when it     */
+/*          can. Returns FAILURE if the connection is gone.          */
+/*                                                                   */
+/*********************************************************************/
+static int send_frame( int fd, int type, const void* data, size_t len )
+{
+    serve_frame frame = { type, (uint32_t) len };
+    struct iovec iov[2];
+    size_t n;
+    ssize_t written;
+
+    iov[0].iov_base = &frame;
+    iov[0].iov_len = sizeof(frame);
+    iov[1].iov_base = (void*) data;
+    iov[1].iov_len = len;
+
+    while ( ( written = writev( fd, iov, 2 ) ) == -1 && errno == EINTR )
+        continue;
+
+    if ( written == -1 )
+        return FAILURE;
+
+    /* finish a short write */
+    if ( ( n = (size_t) written ) < sizeof(frame) )
+        return ( write_full( fd, (char*) &frame + n, sizeof(frame) - n ) &&
+                 write_full( fd, data, len ) );
+
+    n -= sizeof(frame);
+    return write_full( fd, (const char*) data + n, len - n );
+} /* end send_frame() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: pack_frame                                    */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          size_t* len: bytes of msg in use, updated.               */
+/*          int type: what the frame holds.                          */
+/*          const char* text: its bytes.                             */
+/*          size_t n: how many.                                      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          appends a frame to the request being built in msg.       */
+/*          Returns FAILURE if it doesn't fit.                       */
+/*                                                                   */
+/*********************************************************************/
+static int pack_frame( size_t* len, int type, const char* text, size_t n )
+{
+    serve_frame frame = { type, (uint32_t) n };
+
+    if ( sizeof(frame) + n >= sizeof(msg) - *len )
+        return FAILURE;
+
+    memcpy( msg + *len, &frame, sizeof(frame) );
+    memcpy( msg + *len + sizeof(frame), text, n );
+    *len += sizeof(frame) + n;
+
+    return SUCCESS;
+} /* end pack_frame() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: pack_line                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          size_t* len: bytes of msg in use, updated.               */
+/*          char** words: the command's words.                       */
+/*          int n_words: how many.                                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          appends a SERVE_LINE frame of the words joined by        */
+/*          spaces. Returns FAILURE if it doesn't fit.               */
+/*                                                                   */
+/*********************************************************************/
+static int pack_line( size_t* len, char** words, int n_words )
+{
+    size_t n = 0, word_len;
+    char* pos;
+
+    for ( int i = 0; i < n_words; i++ )
+        n += strlen( words[i] ) + 1;
+
+    if ( pack_frame( len, SERVE_LINE, "", 0 ) == FAILURE ||
+         n >= sizeof(msg) - *len )
+        return FAILURE;
+
+    /* fill in the frame just added */
+    pos = msg + *len;
+    ((serve_frame*) ( pos - sizeof(serve_frame) ))->len = (uint32_t) n - 1;
+
+    for ( int i = 0; i < n_words; i++ )
+    {
+        word_len = strlen( words[i] );
+        memcpy( pos, words[i], word_len );
+        pos[word_len] = ' ';
+        pos += word_len + 1;
+    }
+
+    *len += n - 1;
+    return SUCCESS;
+} /* end pack_line() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: read_full                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          int fd: descriptor to read.                              */
+/*          void* buf: where to put the bytes.                       */
+/*          size_t len: how many to read.                            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns FAILURE if fd ends or fails before len bytes.    */
+/*                                                                   */
+/*********************************************************************/
+static int read_full( int fd, void* buf, size_t len )
+{
+    ssize_t n;
+
+    while ( len > 0 )
+    {
+        if ( ( n = read( fd, buf, len ) ) <= 0 )
+        {
+            if ( n == -1 && errno == EINTR )
+                continue;
+            return FAILURE;
+        }
+
+        buf = (char*) buf + n;
+        len -= (size_t) n;
+    }
+
+    return SUCCESS;
+} /* end read_full() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: write_full                                    */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          int fd: descriptor to write.                             */
+/*          const void* buf: the bytes.                              */
+/*          size_t len: how many.                                    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns FAILURE if fd fails before len bytes.            */
+/*                                                                   */
+/*********************************************************************/
+static int write_full( int fd, const void* buf, size_t len )
+{
+    ssize_t n;
+
+    while ( len > 0 )
+    {
+        if ( ( n = write( fd, buf, len ) ) == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+            return FAILURE;
+        }
+
+        buf = (const char*) buf + n;
+        len -= (size_t) n;
+    }
+
+    return SUCCESS;
+} /* end write_full() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: connect_server                                */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* path: the server's socket.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns a connection to the server or -1.                */
+/*                                                                   */
+/*********************************************************************/
+static int connect_server( const char* path )
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    snprintf( addr.sun_path, sizeof(addr.sun_path), "%s", path );
+
+    if ( ( fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 ) ) == -1 )
+        return -1;
+
+    if ( connect( fd, (struct sockaddr*) &addr, sizeof(addr) ) == -1 )
+    {
+        fprintf( stderr, "Error: No command server on %s, start one with "
+                         "\"shell %s %s\".\n", path, SERVE_FLAG, path );
+        close( fd );
+        return -1;
+    }
+
+    return fd;
+} /* end connect_server() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: do_request                                    */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          int fd: connection to the server.                        */
+/*          const char* req: the packed request.                     */
+/*          size_t len: its size.                                    */
+/*          int echo: T to copy the output to stdout and stderr,     */
+/*                    F to drop it.                                  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          sends req and reads the reply. Returns the exit status,  */
+/*          or -1 if the connection failed.                          */
+/*                                                                   */
+/*********************************************************************/
+static int do_request( int fd, const char* req, size_t len, int echo )
+{
+    char buf[SERVE_MSG_MAX];
+    serve_frame frame;
+    int status;
+
+    if ( write_full( fd, req, len ) == FAILURE )
+        return -1;
+
+    while ( read_full( fd, &frame, sizeof(frame) ) == SUCCESS &&
+            frame.len <= sizeof(buf) &&
+            read_full( fd, buf, frame.len ) == SUCCESS )
+    {
+        if ( frame.type == SERVE_STATUS && frame.len == sizeof(status) )
+        {
+            memcpy( &status, buf, sizeof(status) );
+            return status;
+        }
+
+        if ( echo )
+            write_full( frame.type == SERVE_STDERR ? STDERR_FILENO :
+                        STDOUT_FILENO, buf, frame.len );
+    }
+
+    return -1;
+} /* end do_request() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_bench                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* path: the server's socket.                   */
+/*          size_t len: size of the request packed in msg.           */
+/*          int count: how many times to send it.                    */
+/*          int conns: over how many connections at once.            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          load tests the server, one thread per connection, and    */
+/*          prints requests/s and latency percentiles. Returns       */
+/*          EXIT_FAILURE if any request was lost.                    */
+/*                                                                   */
+/*********************************************************************/
+static int run_bench( const char* path, size_t len, int count, int conns )
+{
+    struct timespec start, end;
+    bench_conn* work;
+    pthread_t* threads;
+    double* latency;
+    double secs;
+    int n = 0, failed = 0, nonzero = 0, offset = 0;
+
+    if ( conns > count )
+        conns = count;
+
+    work = calloc( conns, sizeof(bench_conn) );
+    threads = calloc( conns, sizeof(pthread_t) );
+    latency = malloc( count * sizeof(double) );
+
+    if ( work == NULL || threads == NULL || latency == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory.\n" );
+        free( work );
+        free( threads );
+        free( latency );
+        return EXIT_FAILURE;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for ( int i = 0; i < conns; i++ )
+    {
+        work[i].path = path;
+        work[i].request = msg;
+        work[i].len = len;
+        work[i].count = count / conns + ( i < count % conns ? 1 : 0 );
+        work[i].latency = latency + offset;
+        offset += work[i].count;
+
+        if ( pthread_create( &threads[i], NULL, bench_connection,
+                             &work[i] ) != 0 )
+        {
+            work[i].failed = work[i].count;
+            work[i].count = 0;
+        }
+    }
+
+    for ( int i = 0; i < conns; i++ )
+        if ( work[i].count > 0 )
+            pthread_join( threads[i], NULL );
+
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    secs = ( end.tv_sec - start.tv_sec ) +
+           ( end.tv_nsec - start.tv_nsec ) / 1e9;
+
+    /* gather the latencies of the requests that finished */
+    for ( int i = 0; i < conns; i++ )
+    {
+        memmove( latency + n, work[i].latency,
+                 work[i].done * sizeof(double) );
+        n += work[i].done;
+        failed += work[i].failed;
+        nonzero += work[i].nonzero;
+    }
+
+    qsort( latency, n, sizeof(double), compare_doubles );
+
+    printf( "%d requests over %d connections in %.3f s: %.0f requests/s\n",
+            n, conns, secs, n / secs );
+
+    if ( n > 0 )
+        printf( "latency ms: p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+                latency[( n * 50 + 99 ) / 100 - 1],
+                latency[( n * 90 + 99 ) / 100 - 1],
+                latency[( n * 99 + 99 ) / 100 - 1], latency[n - 1] );
+
+    if ( nonzero > 0 )
+        printf( "%d exited with a non-zero status\n", nonzero );
+
+    if ( failed > 0 )
+        printf( "%d failed\n", failed );
+
+    free( work );
+    free( threads );
+    free( latency );
+
+    return ( failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS );
+} /* end run_bench() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: bench_connection                              */
+/*      Return type:   static void*                                  */
+/*      Parameter(s):                                                */
+/*          void* arg: the bench_conn to run.                        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          sends the connection's requests one after another,       */
+/*          timing each.                                             */
+/*                                                                   */
+/*********************************************************************/
+static void* bench_connection( void* arg )
+{
+    bench_conn* conn = arg;
+    struct timespec start, end;
+    int fd, status;
+
+    if ( ( fd = connect_server( conn->path ) ) == -1 )
+    {
+        conn->failed = conn->count;
+        return NULL;
+    }
+
+    while ( conn->done < conn->count )
+    {
+        clock_gettime( CLOCK_MONOTONIC, &start );
+
+        if ( ( status = do_request( fd, conn->request, conn->len, F ) )
+             == -1 )
+        {
+            conn->failed = conn->count - conn->done;
+            break;
+        }
+
+        clock_gettime( CLOCK_MONOTONIC, &end );
+        conn->latency[conn->done++] = ( end.tv_sec - start.tv_sec ) * 1e3 +
+                                      ( end.tv_nsec - start.tv_nsec ) / 1e6;
+
+        if ( status != 0 )
+            conn->nonzero++;
+    }
+
+    close( fd );
+    return NULL;
+} /* end bench_connection() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: compare_doubles                               */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const void* a: a double.                                 */
+/*          const void* b: a double.                                 */
+/*                                                                   */
+/*      Description:                                                 */
+/*          qsort() comparison, ascending.                           */
+/*                                                                   */
+/*********************************************************************/
+static int compare_doubles( const void* a, const void* b )
+{
+    double x = *(const double*) a, y = *(const double*) b;
+
+    return ( x > y ) - ( x < y );
+} /* end compare_doubles() */
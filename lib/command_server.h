@@ -0,0 +1,105 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: command_server.h                            */
+/*          Description:                                             */
+/*              This module provides "shell --serve". The server     */
+/*              keeps a fixed pool of worker processes, forked once  */
+/*              after start-up, that take connections on a Unix      */
+/*              socket and run one request at a time each. Every     */
+/*              request runs in a fresh fork of its worker, with its */
+/*              own directory, environment and shell context, and    */
+/*              its stdout, stderr and exit status are streamed      */
+/*              back as they come. "shell --client" sends requests   */
+/*              and can load test a server.                          */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef COMMAND_SERVER_H
+#define COMMAND_SERVER_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include "./string_module.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define SERVE_FLAG "--serve"
+#define CLIENT_FLAG "--client"
+#define SERVE_BACKLOG 64
+#define SERVE_MSG_MAX 65536
+#define SERVE_MAX_WORKERS 1024
+#define SERVE_MAX_WORDS 4096
+#define SERVE_PATH_SIZE 4096
+
+/* a request is some of these frames, ended by SERVE_RUN */
+#define SERVE_CWD 'C'       /* directory to run in */
+#define SERVE_ENV 'E'       /* NAME=VALUE to set, or NAME to unset */
+#define SERVE_ARG 'A'       /* one word of a program to exec */
+#define SERVE_LINE 'L'      /* shell input, may be several lines */
+#define SERVE_RUN 'R'       /* run what came before */
+
+/* the reply is output frames, then exactly one status frame */
+#define SERVE_STDOUT '1'
+#define SERVE_STDERR '2'
+#define SERVE_STATUS 'S'    /* int exit status, 128 + N for signal N */
+
+/* in front of every frame's bytes; both ends are the same program */
+typedef struct serve_frame_t
+{
+    int         type;
+    uint32_t    len;
+} serve_frame;
+
+/* one request as the worker received it */
+typedef struct serve_request_t
+{
+    char*       cwd;
+    char*       env[SERVE_MAX_WORDS];
+    int         n_env;
+    char*       argv[SERVE_MAX_WORDS + 1];
+    int         argc;
+    char*       line;
+} serve_request;
+
+/* one load test connection and its share of the requests */
+typedef struct bench_conn_t
+{
+    const char* path;
+    const char* request;
+    size_t      len;
+    int         count;
+    int         done;
+    int         failed;
+    int         nonzero;
+    double*     latency;
+} bench_conn;
+
+/* runs shell input in a forked worker and returns its exit status */
+typedef int (*request_runner)( char* text );
+
+/* function prototypes */
+int     run_command_server( const char* path, int n_workers,
+                            request_runner runner );
+int     run_client( int argc, char** argv );
+
+#endif
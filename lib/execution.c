@@ -1,4 +1,12 @@
 #include "execution.h"
+#include "./jshell.h"
+#include "./parallel.h"
+
+/* descriptors and children that live until the command line is done */
+static int      held_fds[MAX_HELD];
+static int      n_held_fds = 0;
+static pid_t    held_pids[MAX_HELD];
+static int      n_held_pids = 0;
 
 
 // REDESIGN IDEAS:
@@ -21,20 +29,12 @@
 /*********************************************************************/
 void execute( void )
 {
-    int pid;
-
-    /* attempt to open /dev/tty */
-    int tty = open( "/dev/tty", O_RDWR );
-
-    /* error handling if can't open /dev/tty */
-    if(tty == -1)
-    {
-        fprintf(stderr, "Error: can't open /dev/tty\n");
-        return;
-    }
-    
-    /* spawn process and execute prog */
-    pid = generate_process( tty, tty, &cmds );
+    /* 
+     * use the shell's own stdin/stdout rather than /dev/tty so the
+     * program follows the shell when it runs inside a pipe, e.g. as a
+     * process substitution.
+     */
+    generate_process( STDIN_FILENO, STDOUT_FILENO, &jshell->cmds );
 
     return;
 
@@ -54,8 +54,7 @@ void execute( void )
 /*********************************************************************/
 void redirect_input( void )
 {
-    int pid;
-    int in_file_pos = find_string( "<", &cmds, n_cmds );
+    int in_file_pos = find_string( "<", &jshell->cmds, jshell->n_cmds );
 
     /* ensure we found input file */
     if ( in_file_pos == -1 )
@@ -65,23 +64,23 @@ void redirect_input( void )
     }
 
     /* open file with read access */
-    int fd_in = open( cmds[in_file_pos + 1], O_RDONLY);
+    int fd_in = open( jshell->cmds[in_file_pos + 1], O_RDONLY);
 
     /* error handling for opening a file */
     if ( fd_in == -1 )
     {
         /* print error to stderr and return */
         fprintf( stderr, "Error: Can't open file: %s\n", 
-                 cmds[in_file_pos + 1] );
+                 jshell->cmds[in_file_pos + 1] );
 
         return;
     }
 
     /* set last index to NULL for execvp */
-    cmds[in_file_pos] = NULL;
+    jshell->cmds[in_file_pos] = NULL;
 
     /* spawn process and execute prog */
-    pid = generate_process( fd_in, STDOUT_FILENO, &cmds );
+    generate_process( fd_in, STDOUT_FILENO, &jshell->cmds );
 
     return;
 } /* end redirect_input */
@@ -100,8 +99,7 @@ void redirect_input( void )
 /*********************************************************************/
 void redirect_output( void )
 {
-    int pid;
-    int out_file_pos = find_string( ">", &cmds, n_cmds );
+    int out_file_pos = find_string( ">", &jshell->cmds, jshell->n_cmds );
 
     /* ensure we found output file */
     if ( out_file_pos == -1 )
@@ -111,23 +109,23 @@ void redirect_output( void )
     }
 
     /* open file with read/write access or create new file */
-    int fd_out = open( cmds[out_file_pos + 1], O_RDWR | O_CREAT, 0666 );
+    int fd_out = open( jshell->cmds[out_file_pos + 1], O_RDWR | O_CREAT, 0666 );
 
     /* error handling for opening a file */
     if ( fd_out == -1 )
     {
         /* print error to stderr and return */
         fprintf( stderr, "Error: Can't open file: %s\n", 
-                 cmds[out_file_pos + 1] );
+                 jshell->cmds[out_file_pos + 1] );
 
         return;
     }
 
     /* set last index to NULL for execvp */
-    cmds[out_file_pos] = NULL;
+    jshell->cmds[out_file_pos] = NULL;
 
     /* spawn process and run program */
-    pid = generate_process( STDIN_FILENO, fd_out, &cmds );
+    generate_process( STDIN_FILENO, fd_out, &jshell->cmds );
 
     return;
 } /* end redirect_output() */
@@ -146,14 +144,8 @@ void redirect_output( void )
 /*********************************************************************/
 void redirect_input_and_output( void )
 {
-    pid_t pgid = getpgrp();
-    pid_t pid = 0;
-
-    int status, w;
-    void (*istat)(int), (*qstat)(int);
-
-    int out_file_pos = find_string( ">", &cmds, n_cmds );
-    int in_file_pos = find_string( "<", &cmds, n_cmds );
+    int out_file_pos = find_string( ">", &jshell->cmds, jshell->n_cmds );
+    int in_file_pos = find_string( "<", &jshell->cmds, jshell->n_cmds );
     int first_operator_pos = ( in_file_pos < out_file_pos ? 
                                in_file_pos : out_file_pos );
 
@@ -172,15 +164,15 @@ void redirect_input_and_output( void )
     }
 
     /* open input and output files */
-    int fd_out = open( cmds[out_file_pos + 1], O_RDWR | O_CREAT, 0666 );
-    int fd_in = open( cmds[in_file_pos + 1], O_RDONLY);
+    int fd_out = open( jshell->cmds[out_file_pos + 1], O_RDWR | O_CREAT, 0666 );
+    int fd_in = open( jshell->cmds[in_file_pos + 1], O_RDONLY);
 
     /* error handling for opening output file */
     if ( fd_out == -1 )
     {
         /* print error to stderr and return */
         fprintf( stderr, "Error: Can't open file: %s\n", 
-                 cmds[out_file_pos + 1] );
+                 jshell->cmds[out_file_pos + 1] );
 
         return;
     }
@@ -190,16 +182,16 @@ void redirect_input_and_output( void )
     {
         /* print error to stderr and return */
         fprintf( stderr, "Error: Can't open file: %s\n", 
-                 cmds[in_file_pos + 1] );
+                 jshell->cmds[in_file_pos + 1] );
 
         return;
     }
 
     /* set last index to NULL for execvp */
-    cmds[first_operator_pos] = NULL;
+    jshell->cmds[first_operator_pos] = NULL;
 
     /* spawn process and execute program */
-    pid = generate_process( fd_in, fd_out, &cmds );
+    generate_process( fd_in, fd_out, &jshell->cmds );
 
     return;
 } /* end redirect_output_and_input */
@@ -219,130 +211,236 @@ void redirect_input_and_output( void )
 /*********************************************************************/
 void execute_and_pipe( int n_pipes )
 {
-    char** current_program = cmds;
-    int pipe_loc, n_words = n_cmds;
-    pid_t pid, pgid = getpgrp();
-    int i, pipe_fd[n_pipes][2];
-    int status, w;
-
-    /* create first pipeline */
-    if ( pipe( pipe_fd[0] ) == -1 )
+    run_pipeline( STDIN_FILENO, n_pipes );
+} /* end execute_and_pipe */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: redirect_input_and_pipe                       */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          int n_pipes: number of pipes entered in command line.    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs a pipeline whose first program reads from a file,   */
+/*          e.g. "grep x < FILE | head". Only the first program may  */
+/*          redirect its input, the others read from a pipe.         */
+/*                                                                   */
+/*********************************************************************/
+void redirect_input_and_pipe( int n_pipes )
+{
+    int in_file_pos = find_string( "<", &jshell->cmds, jshell->n_cmds );
+    int pipe_pos = find_string( "|", &jshell->cmds, jshell->n_cmds );
+    int fd_in;
+
+    /* ensure the input file belongs to the first program */
+    if ( in_file_pos == -1 || in_file_pos + 1 >= pipe_pos )
     {
-        /* error handling */
-        fprintf( stderr, "Error: Calling pipe() failed.\n" );
+        fprintf( stderr, "Error: Only the first program of a pipeline can "
+                         "read from a file.\n" );
         return;
-    } /* pipe has been created */
+    }
 
-    /* process programs */
-    for ( i = 0; i < n_pipes; i++ )
+    if ( ( fd_in = open( jshell->cmds[in_file_pos + 1], O_RDONLY | O_CLOEXEC ) )
+            == -1 )
     {
-        pipe_loc = find_string( "|", &current_program, n_words );
+        fprintf( stderr, "Error: Can't open file: %s\n",
+                 jshell->cmds[in_file_pos + 1] );
+        return;
+    }
 
-        /* check that we found pipe_loc */
-        if ( pipe_loc == -1 && i != n_pipes - 1 )
-        {
-            fprintf( stderr, "Error: Can't get location of next pipe.\n" );
-            return;
-        }
+    /* drop "< FILE" so only the program's own words are left */
+    splice_strings( &jshell->cmds, &jshell->n_cmds, in_file_pos, 2, NULL, 0 );
 
-        /* adjust amount of words for next current_program */
-        n_words = n_words - pipe_loc; 
+    run_pipeline( fd_in, n_pipes );
+} /* end redirect_input_and_pipe */
 
-        /* set pipe_loc to null so execvp knows where to stop */
-        current_program[pipe_loc] = NULL;
 
-        /* first cmd running */ 
-        if ( i == 0 )
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_pipeline                                  */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          int fd_in: descriptor the first program reads from; it   */
+/*                     is closed once handed out.                    */
+/*          int n_pipes: number of pipes in cmds.                    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          starts every stage of cmds with its stdout connected to  */
+/*          the next one's stdin, then waits for all of them. With   */
+/*          "set -o meter" each pipe is cut in two with a relay in   */
+/*          between, and a report is printed once all have exited.   */
+/*                                                                   */
+/*********************************************************************/
+void run_pipeline( int fd_in, int n_pipes )
+{
+    char** current_program = jshell->cmds;
+    int pipe_loc = 0, n_words = jshell->n_cmds;
+    pid_t pids[n_pipes + 1];
+    int i, n_started = 0, pipe_fd[2], relay_fd[2];
+    int fd_out, n_edges = 0;
+    int metered = OPTION( OPT_METER ) && n_pipes > 0;
+    meter_edge edges[n_pipes + 1];
+    char names[n_pipes + 1][METER_NAME_SIZE];
+
+    /* process programs */
+    for ( i = 0; i <= n_pipes; i++ )
+    {
+        fd_out = STDOUT_FILENO;
+
+        /* every program but the last writes into a new pipe */
+        if ( i < n_pipes )
         {
-            /* create child process */
-            if( ( pid = fork() ) == 0 )
+            pipe_loc = find_string( "|", &current_program, n_words );
+
+            /* check that we found pipe_loc */
+            if ( pipe_loc == -1 )
             {
-                /* duplicate write end of pipe to stdout */
-                dup2( pipe_fd[0][WRITE_END], STDOUT_FILENO );
+                fprintf( stderr, "Error: Can't get location of next pipe.\n" );
+                break;
+            }
 
-                /* close pipe in child now that its been duped */
-                close( pipe_fd[0][READ_END] );
-                close( pipe_fd[0][WRITE_END] );
+            /* adjust amount of words for next current_program */
+            n_words = n_words - pipe_loc - 1; 
 
-                /* stdin not affected yet, run program */
-                execvp( current_program[0], current_program );
-            } /* parent process */
+            /* set pipe_loc to null so execvp knows where to stop */
+            current_program[pipe_loc] = NULL;
 
-            /* wait for child processes to finish */
-            while( ( w = wait( &status ) ) != pid && w != -1 )
-                continue;
-        }
-        else
-        {
-            /* create another pipeline */
-            if ( pipe( pipe_fd[i] ) == -1 )
+            /* close-on-exec so no other stage inherits this pipe */
+            if ( pipe2( pipe_fd, O_CLOEXEC ) == -1 )
             {
                 /* error handling */
                 fprintf( stderr, "Error: Calling pipe() failed.\n" );
-                return;
+                break;
             } /* pipe has been created */
 
-            /* create child process */ 
-            if( ( pid = fork() ) == 0 )
+            size_pipe( pipe_fd[WRITE_END] );
+            fd_out = pipe_fd[WRITE_END];
+
+            /* the next stage reads a second pipe the relay fills */
+            if ( metered )
             {
-                /* set stdin of current cmd to read end of previous pipe */
-                dup2( pipe_fd[i-1][READ_END], STDIN_FILENO );
+                if ( pipe2( relay_fd, O_CLOEXEC ) == -1 )
+                {
+                    fprintf( stderr, "Error: Calling pipe() failed.\n" );
+                    close( pipe_fd[READ_END] );
+                    close( pipe_fd[WRITE_END] );
+                    break;
+                }
 
-                /* set stdout of current cmd to write end of current pipe */
-                dup2( pipe_fd[i][WRITE_END], STDOUT_FILENO );
+                size_pipe( relay_fd[WRITE_END] );
 
-                /* close all pipes in child now that its been duped */
-                int counter = 0; 
-                for ( ; counter <= i; counter++ )
+                /* each relay hop is a context switch, make them move
+                 * more than the default 64K unless pipesize is set */
+                if ( SETTING( SET_PIPESIZE ) == 0 )
                 {
-                    close( pipe_fd[counter][READ_END] );
-                    close( pipe_fd[counter][WRITE_END] );
+                    fcntl( pipe_fd[WRITE_END], F_SETPIPE_SZ, METER_PIPE_SIZE );
+                    fcntl( relay_fd[WRITE_END], F_SETPIPE_SZ, METER_PIPE_SIZE );
                 }
 
-                /* execute program */
-                execvp( current_program[0], current_program );
+                if ( open_meter_edge( &edges[n_edges], pipe_fd[READ_END],
+                                      relay_fd[WRITE_END] ) == FAILURE )
+                {
+                    close( relay_fd[READ_END] );
+                    close( pipe_fd[WRITE_END] );
+                    break;
+                }
+
+                n_edges++;
+                pipe_fd[READ_END] = relay_fd[READ_END];
             }
         }
 
+        if ( metered )
+            snprintf( names[i], METER_NAME_SIZE, "%s", current_program[0] );
+
+        /* stdin is the previous pipe, stdout the current one */
+        if ( ( pids[n_started] = spawn_process( fd_in, fd_out,
+                                                current_program ) ) != -1 )
+            n_started++;
+
+        /* the parent is done with both ends it handed out */
+        if ( fd_in != STDIN_FILENO )
+            close( fd_in );
+
+        if ( fd_out != STDOUT_FILENO )
+            close( fd_out );
+
+        fd_in = pipe_fd[READ_END];
+
         /* adjust current_program to point to next set of cmds */
         current_program = &current_program[pipe_loc + 1];
     }
 
-    /* run final command */
-    if( ( pid = fork() ) == 0 )
-    {
-        /* set stdin of first cmd to write end of last pipe */
-        dup2( pipe_fd[n_pipes - 1][READ_END], STDIN_FILENO );
+    /* a stage failed to start, drop the pipe no one will read */
+    if ( i <= n_pipes && fd_in != STDIN_FILENO )
+        close( fd_in );
 
-        /* close all pipes in child now that its been duped */
-        int ctr = 0; 
-        for ( ; ctr < n_pipes; ctr++ )
-        {
-            close( pipe_fd[ctr][READ_END] );
-            close( pipe_fd[ctr][WRITE_END] );
-        }
+    /* the relays start once no more stages will be forked */
+    if ( metered )
+        start_meter( edges, n_edges );
 
-        /* execute last program */
-        execvp( current_program[0], current_program );
-    }
+    /* ignore ctrl-c & ctrl-\ */
+    ignore_interrupts();
 
-    /* close all pipes in parent */
-    int ctr = 0; 
-    for ( ; ctr < n_pipes; ctr++ )
-    {
-        close( pipe_fd[ctr][READ_END] );
-        close( pipe_fd[ctr][WRITE_END] );
-    }
+    /* reap every stage, the last one decides the status */
+    for ( i = 0; i < n_started; i++ )
+        reap_child( pids[i], NULL, 0 );
 
-    /* wait for child processes to finish */
-    while( ( w = wait( &status ) ) != pid && w != -1 )
-        continue;
+    if ( metered )
+        report_meter( edges, n_edges, names, stderr );
+
+    /* allow for ctrl-c & ctrl-\ */
+    restore_interrupts();
 
     return;
-} /* end execute_and_pipe */
+} /* end run_pipeline */
 
 
 
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: size_pipe                                     */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          int fd: either end of a new pipe.                        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          gives the pipe the buffer set with "set pipesize=N",     */
+/*          capped at /proc/sys/fs/pipe-max-size so unprivileged     */
+/*          users get the largest size allowed rather than EPERM.    */
+/*          Bigger buffers let each stage move more data per         */
+/*          context switch. Failure keeps the default size.          */
+/*                                                                   */
+/*********************************************************************/
+void size_pipe( int fd )
+{
+    static long max_size = 0;
+    long size = SETTING( SET_PIPESIZE );
+    FILE* fp;
+
+    if ( size == 0 )
+        return;
+
+    /* the limit only changes if root writes to /proc, read it once */
+    if ( max_size == 0 )
+    {
+        if ( ( fp = fopen( PIPE_MAX_SIZE_FILE, "r" ) ) == NULL ||
+             fscanf( fp, "%ld", &max_size ) != 1 || max_size <= 0 )
+            max_size = DEFAULT_PIPE_MAX_SIZE;
+
+        if ( fp != NULL )
+            fclose( fp );
+    }
+
+    if ( size > max_size )
+        size = max_size;
+
+    fcntl( fd, F_SETPIPE_SZ, (int) size );
+} /* end size_pipe() */
+
+
 /*********************************************************************/
 /*                                                                   */
 /*      Function name: generate_process                              */
@@ -355,52 +453,420 @@ void execute_and_pipe( int n_pipes )
 /*********************************************************************/
 int generate_process( int fd_in, int fd_out, char*** prog )
 {
-    pid_t pgid = getpgrp();
     pid_t pid; 
-    int status, w;
-    void (*istat)(int), (*qstat)(int);
+
+    /* spawn the child running prog */
+    if ( ( pid = spawn_process( fd_in, fd_out, *prog ) ) == -1 )
+        return -1;
+
+    /* ignore ctrl-c & ctrl-\ */
+    ignore_interrupts();
+
+    /* close descriptors if necessary in parent */
+    if ( fd_in != 0 )
+        close( fd_in );
+
+    if ( fd_out != 1 )
+        close( fd_out );
+
+    /* wait for the child, recording its resource usage */
+    reap_child( pid, NULL, 0 );
+
+    /* allow for ctrl-c & ctrl-\ */
+    restore_interrupts();
+
+    return pid;
+} /* end generate_process */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: spawn_process                                 */
+/*      Return type:   pid_t                                         */
+/*      Parameter(s):                                                */
+/*          int fd_in: descriptor to use as the child's stdin.       */
+/*          int fd_out: descriptor to use as the child's stdout.     */
+/*          char** prog: NULL terminated argv of the program.        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          starts a child running prog and returns its pid without  */
+/*          waiting for it. The spawn helper does the fork when it   */
+/*          is running, otherwise the shell forks itself. The        */
+/*          caller owns fd_in and fd_out and is responsible for      */
+/*          closing them and reaping the child. pin, nice, ionice    */
+/*          and sched prefixes are applied in the child before exec. */
+/*          Returns -1 if the fork failed or a prefix is malformed.  */
+/*                                                                   */
+/*********************************************************************/
+pid_t spawn_process( int fd_in, int fd_out, char** prog )
+{
+    pid_t pgid = getpgrp();
+    pid_t pid;
+    char path[PATH_MAX];
+    const char* resolved = path;
+    struct timespec ts;
+    int builtin = F, batched = F;
+    stage_attrs attrs;
+
+    /* an empty pipeline stage, there is nothing to run */
+    if ( prog[0] == NULL )
+    {
+        fprintf( stderr, "Error: Empty command in pipeline.\n" );
+        return -1;
+    }
+
+    /* strip pin/nice/ionice/sched, the child applies them itself */
+    if ( ( prog = parse_stage_prefixes( prog, &attrs ) ) == NULL )
+        return -1;
+
+    /* cat, tee, xargs and parallel can run as builtins, there is
+     * nothing to look up */
+    if ( ( OPTION( OPT_ZEROCOPY ) && is_copy_builtin( prog ) ) ||
+         ( OPTION( OPT_ARGBATCH ) && is_xargs_builtin( prog ) ) ||
+         is_parallel_builtin( prog ) )
+        builtin = T;
+
+    /* exec would fail with E2BIG, split it or say why up front; a
+     * brace word left unexpanded is always too big for one exec */
+    if ( has_deferred_braces( prog ) )
+        builtin = F;
+
+    if ( !builtin && ( has_deferred_braces( prog ) ||
+                       argv_too_long( prog ) ) )
+    {
+        if ( !OPTION( OPT_ARGBATCH ) )
+        {
+            fprintf( stderr, "Error: Argument list too long for %s, "
+                             "\"set -o argbatch\" splits it.\n", prog[0] );
+            return -1;
+        }
+
+        batched = T;
+    }
+
+    /* look the program up in the parent so the lookup can be timed */
+    STAT_START( ts );
+    if ( builtin || resolve_program( prog[0], path, sizeof(path) ) == FAILURE )
+        resolved = NULL;
+    STAT_STOP( PHASE_PATH, ts );
+
+    record_dispatch();
+
+    /* builtin output still buffered here goes out before the child
+     * writes, and a forked child won't flush a second copy of it */
+    fflush( NULL );
+
+    STAT_START( ts );
+
+    /* let the spawn helper fork if there is one. Held descriptors
+     * are named as /dev/fd/N in prog and only exist in this process,
+     * so those commands are still forked here */
+    if ( spawn_server_active() && n_held_fds == 0 && !builtin &&
+         !batched && !attrs.any &&
+         ( pid = remote_spawn( fd_in, fd_out, resolved, prog, pgid ) ) != -1 )
+    {
+        STAT_STOP( PHASE_SPAWN, ts );
+        return pid;
+    }
+
+    pid = fork();
+
+    if ( pid == -1 )
+    {
+        fprintf( stderr, "Error: Calling fork() failed.\n" );
+        return -1;
+    }
 
     /* if in child process */
-    if( ( pid = fork() ) == 0 )
+    if ( pid == 0 )
     {
         /* if we are not directing to stdout, reassign output */
-        if ( fd_out != 1 )
+        if ( fd_out != STDOUT_FILENO )
         {
             dup2( fd_out, STDOUT_FILENO );
             close( fd_out );
         }
 
         /* if we are not getting from stdin, reassign input. */
-        if ( fd_in != 0 )
+        if ( fd_in != STDIN_FILENO )
         {
             dup2( fd_in, STDIN_FILENO );
             close( fd_in );
         }
 
-        return execvp( (*prog)[0], (*prog) );
+        /* builtins don't exec, so close-on-exec won't drop these */
+        close_meter_fds();
+
+        if ( attrs.any )
+            apply_stage_attrs( &attrs );
+
+        if ( builtin )
+            exec_builtin( prog );
+
+        if ( batched )
+            run_batches( resolved, prog, SETTING( SET_BATCHJOBS ) > 0 ?
+                         (int) SETTING( SET_BATCHJOBS ) : 1 );
+
+        exec_program( resolved, prog );
     } /* parent process */
 
+    STAT_STOP( PHASE_SPAWN, ts );
+
     /* set process group ID */
     setpgid( pid, pgid );
 
-    /* ignore ctrl-c & ctrl-\ */
-    istat = signal(SIGINT, SIG_IGN);
-    qstat = signal(SIGQUIT, SIG_IGN);
+    /* its exit is delivered through the supervisor */
+    watch_child( pid );
 
-    /* close descriptors if necessary in parent */
-    if ( fd_in != 0 )
-        close( fd_in );
+    return pid;
+} /* end spawn_process() */
 
-    if ( fd_out != 1 )
-        close( fd_out );
 
-    /* wait for child processes to finish */
-    while( ( w = wait( &status ) ) != pid && w != -1 )
-        continue;
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: exec_program                                  */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          const char* path: resolved path of prog[0], or NULL to   */
+/*                            search $PATH with execvp().            */
+/*          char** prog: NULL terminated argv of the program.        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          replaces the current (child) process with prog. Never    */
+/*          returns: if the exec fails the child exits with 127 so   */
+/*          it can't fall back into the shell's command loop.        */
+/*          Signal dispositions and the signal mask the shell may    */
+/*          have changed are reset first, since exec keeps both.     */
+/*                                                                   */
+/*********************************************************************/
+void exec_program( const char* path, char** prog )
+{
+    reset_child_signals();
+
+    if ( path != NULL )
+        execv( path, prog );
+    else
+        execvp( prog[0], prog );
 
-    /* allow for ctrl-c & ctrl-\ */
-    signal(SIGINT, istat);
-    signal(SIGQUIT, qstat);
+    fprintf( stderr, "Error: Could not execute %s\n", prog[0] );
+    _exit( 127 );
+} /* end exec_program() */
 
-    return pid;
-} /* end generate_process */
\ No newline at end of file
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: exec_builtin                                  */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          char** prog: argv accepted by is_copy_builtin(),         */
+/*                       is_xargs_builtin() or                       */
+/*                       is_parallel_builtin().                      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the exec_program() of the cat, tee, xargs and parallel   */
+/*          builtins: runs prog in the forked child and exits with   */
+/*          its status.                                              */
+/*                                                                   */
+/*********************************************************************/
+void exec_builtin( char** prog )
+{
+    int n_args = 0;
+
+    reset_child_signals();
+
+    if ( strcmp( prog[0], "xargs" ) == 0 )
+        _exit( run_xargs( prog ) );
+
+    if ( is_parallel_builtin( prog ) )
+    {
+        /* the jobs are this child's, not the shell's */
+        reset_supervisor();
+        stop_spawn_server();
+
+        while ( prog[n_args] != NULL )
+            n_args++;
+
+        _exit( run_parallel( prog, n_args ) == SUCCESS ? 0 : 1 );
+    }
+
+    _exit( run_copy_builtin( prog ) );
+} /* end exec_builtin() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: reset_child_signals                           */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          undoes the shell's signal handling in a child: exec      */
+/*          keeps both ignored signals and the signal mask.          */
+/*                                                                   */
+/*********************************************************************/
+void reset_child_signals( void )
+{
+    sigset_t none;
+
+    signal( SIGINT, SIG_DFL );
+    signal( SIGQUIT, SIG_DFL );
+    sigemptyset( &none );
+    sigprocmask( SIG_SETMASK, &none, NULL );
+} /* end reset_child_signals() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: resolve_program                               */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* name: program name as typed.                 */
+/*          char* path: buffer receiving the full path.              */
+/*          size_t size: size of path.                               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          finds the executable execvp() would run for name. Names  */
+/*          containing a '/' are used as they are. Returns FAILURE   */
+/*          if nothing on $PATH matches.                             */
+/*                                                                   */
+/*********************************************************************/
+int resolve_program( const char* name, char* path, size_t size )
+{
+    const char* dirs = getenv( "PATH" );
+    const char* end;
+    struct stat buffer;
+    int len;
+
+    if ( name == NULL || *name == '\0' )
+        return FAILURE;
+
+    if ( strchr( name, '/' ) != NULL )
+    {
+        if ( strlen( name ) >= size )
+            return FAILURE;
+
+        strcpy( path, name );
+        return SUCCESS;
+    }
+
+    if ( dirs == NULL )
+        dirs = "/bin:/usr/bin";
+
+    /* try each directory on $PATH in order */
+    while ( *dirs != '\0' )
+    {
+        if ( ( end = strchr( dirs, ':' ) ) == NULL )
+            end = dirs + strlen( dirs );
+
+        /* an empty entry means the current directory */
+        if ( end == dirs )
+            len = snprintf( path, size, "./%s", name );
+        else
+            len = snprintf( path, size, "%.*s/%s", (int)( end - dirs ),
+                            dirs, name );
+
+        if ( len > 0 && (size_t) len < size &&
+             stat( path, &buffer ) == 0 && S_ISREG( buffer.st_mode ) &&
+             access( path, X_OK ) == 0 )
+            return SUCCESS;
+
+        dirs = ( *end == ':' ? end + 1 : end );
+    }
+
+    return FAILURE;
+} /* end resolve_program() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: hold_fd                                       */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int fd: descriptor the next program(s) must inherit.     */
+/*                                                                   */
+/*      Description:                                                 */
+/*          keeps fd open in the shell until release_held() is       */
+/*          called, so programs spawned for the current command      */
+/*          line can use it through /dev/fd/N.                       */
+/*                                                                   */
+/*********************************************************************/
+int hold_fd( int fd )
+{
+    if ( n_held_fds == MAX_HELD )
+    {
+        fprintf( stderr, "Error: Too many open substitutions.\n" );
+        return FAILURE;
+    }
+
+    held_fds[n_held_fds++] = fd;
+    return SUCCESS;
+} /* end hold_fd() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: hold_child                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          pid_t pid: helper child to reap with the command line.   */
+/*                                                                   */
+/*********************************************************************/
+int hold_child( pid_t pid )
+{
+    if ( n_held_pids == MAX_HELD )
+    {
+        fprintf( stderr, "Error: Too many open substitutions.\n" );
+        return FAILURE;
+    }
+
+    held_pids[n_held_pids++] = pid;
+    return SUCCESS;
+} /* end hold_child() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: close_held_fds                                */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          closes every held descriptor without forgetting the      */
+/*          held children. Helper children call this so they don't   */
+/*          keep each other's pipes open.                            */
+/*                                                                   */
+/*********************************************************************/
+void close_held_fds( void )
+{
+    for ( int i = 0; i < n_held_fds; i++ )
+        close( held_fds[i] );
+
+    n_held_fds = 0;
+} /* end close_held_fds() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: release_held                                  */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          closes the held descriptors and then reaps the held      */
+/*          children. Closing first lets a >(cmd) reader see EOF.    */
+/*          Their usage counts toward the command line, but the      */
+/*          status of the main program is kept.                      */
+/*                                                                   */
+/*********************************************************************/
+void release_held( void )
+{
+    int status = last_run.status;
+
+    close_held_fds();
+
+    for ( int i = 0; i < n_held_pids; i++ )
+        reap_child( held_pids[i], NULL, 0 );
+
+    n_held_pids = 0;
+    last_run.status = status;
+} /* end release_held() */
@@ -9,6 +9,11 @@
 #ifndef EXECUTION_H
 #define EXECUTION_H
 
+/* for pipe2() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 /* directives */
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,7 +23,19 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <limits.h>
+#include <string.h>
 #include "./string_module.h"
+#include "./run_stats.h"
+#include "./instrument.h"
+#include "./supervisor.h"
+#include "./spawn_server.h"
+#include "./shell_options.h"
+#include "./zero_copy.h"
+#include "./stage_attrs.h"
+#include "./arg_batch.h"
+#include "./pipe_meter.h"
 
 /* macros */
 #define OUTPUT 1
@@ -30,14 +47,24 @@
 #define SUCCESS 1
 #define READ_END 0
 #define WRITE_END 1
-
-/* globals */
-extern char** cmds; 
-extern int n_cmds;
+#define MAX_HELD 64
+#define PIPE_MAX_SIZE_FILE "/proc/sys/fs/pipe-max-size"
+#define DEFAULT_PIPE_MAX_SIZE ( 1024 * 1024 )
 
 /* function prototypes */
 int     generate_process( int fd_in, int fd_out, char*** prog );
 int 	generate_process_for_pipe( int fd_in, int fd_out, char*** prog );
+pid_t   spawn_process( int fd_in, int fd_out, char** prog );
+void    exec_program( const char* path, char** prog );
+void    exec_builtin( char** prog );
+void    reset_child_signals( void );
+int     resolve_program( const char* name, char* path, size_t size );
+
+/* descriptors and helpers kept for the current command line */
+int     hold_fd( int fd );
+int     hold_child( pid_t pid );
+void    close_held_fds( void );
+void    release_held( void );
 
 /* standard program execution */
 void    execute( void );
@@ -49,9 +76,11 @@ void    redirect_input_and_output( void );
 
 /* standard pipelines */
 void    execute_and_pipe( int );
+void    run_pipeline( int fd_in, int n_pipes );
+void    size_pipe( int fd );
 
 /* pipelines and redirections */
-void    redirect_input_and_pipe( void );
+void    redirect_input_and_pipe( int );
 void    redirect_output_and_pipe( void );
 void    redirect_both_and_pipe( void );
 
@@ -0,0 +1,976 @@
+#include "glob_engine.h"
+
+/* named classes allowed inside [...] */
+typedef struct glob_class_t
+{
+    const char* name;
+    int         (*test)( int );
+} glob_class;
+
+static const glob_class classes[] =
+{
+    { "alnum", isalnum },
+    { "alpha", isalpha },
+    { "blank", isblank },
+    { "digit", isdigit },
+    { "lower", islower },
+    { "print", isprint },
+    { "punct", ispunct },
+    { "space", isspace },
+    { "upper", isupper },
+    { "xdigit", isxdigit },
+    { NULL, NULL }
+};
+
+/* local prototypes */
+static int      compile_component( const char*, size_t, glob_component* );
+static int      parse_set( const char*, size_t, glob_op*, size_t* );
+static int      match_ops( const glob_op*, int, const char* );
+static int      match_component( const glob_component*, const char*,
+                                 size_t );
+static void*    walk_worker( void* );
+static void     run_task( glob_walk*, const glob_task*, char*,
+                          glob_tasks*, glob_list* );
+static void     visit_entry( glob_walk*, const glob_task*, int,
+                             const struct dirent64*, glob_tasks*,
+                             glob_list* );
+static int      entry_is_dir( int, const struct dirent64*, int );
+static char*    join_path( const char*, const char*, int );
+static int      push_task( glob_tasks*, char*, int );
+static int      push_match( glob_list*, char* );
+static int      compare_paths( const void*, const void* );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: has_glob_meta                                 */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* word: word to check.                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns SUCCESS if word has an unescaped *, ? or a       */
+/*          closed [...], so most words cost a single scan.          */
+/*                                                                   */
+/*********************************************************************/
+int has_glob_meta( const char* word )
+{
+    for ( const char* p = word; *p != '\0'; p++ )
+    {
+        if ( *p == '\\' && p[1] != '\0' )
+            p++;
+        else if ( *p == '*' || *p == '?' )
+            return SUCCESS;
+        else if ( *p == '[' && p[1] != '\0' )
+        {
+            /* a ] right after [ is part of the set, not its end */
+            for ( const char* q = p + 2; *q != '\0' && *q != '/'; q++ )
+                if ( *q == ']' )
+                    return SUCCESS;
+        }
+    }
+
+    return FAILURE;
+} /* end has_glob_meta() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: compile_glob                                  */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* pattern: the word to compile.                */
+/*          glob_pattern* gp: set to the compiled pattern.           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          splits pattern at each "/" and compiles every part.      */
+/*          Leading parts without wildcards are folded into the      */
+/*          base directory, so "/usr/include/x*.h" reads just one    */
+/*          directory. A trailing "/" matches directories only.      */
+/*          Returns FAILURE if pattern has no wildcards.             */
+/*                                                                   */
+/*********************************************************************/
+int compile_glob( const char* pattern, glob_pattern* gp )
+{
+    size_t len = strlen( pattern ), start, end, base_len = 0;
+    glob_component comp;
+    char* grown;
+
+    memset( gp, 0, sizeof(*gp) );
+
+    if ( has_glob_meta( pattern ) == FAILURE )
+        return FAILURE;
+
+    if ( ( gp->comps = calloc( len, sizeof(glob_component) ) ) == NULL ||
+         ( gp->base = malloc( len + 2 ) ) == NULL )
+    {
+        free_glob( gp );
+        return FAILURE;
+    }
+
+    gp->base[0] = '\0';
+
+    if ( pattern[0] == '/' )
+    {
+        strcpy( gp->base, "/" );
+        base_len = 1;
+    }
+
+    gp->dirs_only = ( len > 1 && pattern[len - 1] == '/' );
+
+    for ( start = 0; start < len; start = end + 1 )
+    {
+        end = start;
+
+        while ( end < len && pattern[end] != '/' )
+            end++;
+
+        /* "a//b" is "a/b" */
+        if ( end == start )
+            continue;
+
+        if ( compile_component( pattern + start, end - start, &comp )
+             == FAILURE )
+        {
+            free_glob( gp );
+            return FAILURE;
+        }
+
+        /* "**" twice in a row is the same as once */
+        if ( comp.kind == GLOB_RECURSE && gp->n_comps > 0 &&
+             gp->comps[gp->n_comps - 1].kind == GLOB_RECURSE )
+            continue;
+
+        /* plain directories before the first wildcard join the base */
+        if ( comp.kind == GLOB_LITERAL && gp->n_comps == 0 &&
+             has_glob_meta( pattern + end ) == SUCCESS )
+        {
+            memcpy( gp->base + base_len, comp.text, comp.len );
+            base_len += comp.len;
+            gp->base[base_len++] = '/';
+            gp->base[base_len] = '\0';
+            free( comp.text );
+            continue;
+        }
+
+        gp->recursive |= ( comp.kind == GLOB_RECURSE );
+        gp->comps[gp->n_comps++] = comp;
+    }
+
+    if ( ( grown = realloc( gp->base, base_len + 1 ) ) != NULL )
+        gp->base = grown;
+
+    return SUCCESS;
+} /* end compile_glob() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_glob                                      */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const glob_pattern* gp: a compiled pattern.              */
+/*          char*** matches: set to the sorted matching paths.       */
+/*          int* n_matches: set to the number of matches.            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          walks the directories the pattern can reach. A pattern   */
+/*          with "**" is walked by up to GLOB_MAX_THREADS threads,   */
+/*          the caller being one of them; others run on the caller   */
+/*          alone. Unreadable directories are skipped. Free the      */
+/*          result with free_matches().                              */
+/*                                                                   */
+/*********************************************************************/
+int run_glob( const glob_pattern* gp, char*** matches, int* n_matches )
+{
+    pthread_t threads[GLOB_MAX_THREADS];
+    int n_threads = 1, n_started = 0;
+    glob_walk walk;
+    char* root;
+
+    *matches = NULL;
+    *n_matches = 0;
+
+    if ( gp->n_comps == 0 || ( root = strdup( gp->base ) ) == NULL )
+        return FAILURE;
+
+    memset( &walk, 0, sizeof(walk) );
+    walk.gp = gp;
+    pthread_mutex_init( &walk.lock, NULL );
+    pthread_cond_init( &walk.wake, NULL );
+
+    push_task( &walk.tasks, root, 0 );
+    walk.pending = 1;
+
+    if ( gp->recursive )
+    {
+        n_threads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+
+        if ( n_threads > GLOB_MAX_THREADS )
+            n_threads = GLOB_MAX_THREADS;
+    }
+
+    for ( int i = 1; i < n_threads; i++ )
+        if ( pthread_create( &threads[n_started], NULL, walk_worker,
+                             &walk ) == 0 )
+            n_started++;
+
+    walk_worker( &walk );
+
+    for ( int i = 0; i < n_started; i++ )
+        pthread_join( threads[i], NULL );
+
+    pthread_mutex_destroy( &walk.lock );
+    pthread_cond_destroy( &walk.wake );
+    free( walk.tasks.items );
+
+    qsort( walk.matches.items, walk.matches.n, sizeof(char*),
+           compare_paths );
+
+    *matches = walk.matches.items;
+    *n_matches = walk.matches.n;
+
+    return ( walk.failed ? FAILURE : SUCCESS );
+} /* end run_glob() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: free_glob                                     */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          glob_pattern* gp: pattern from compile_glob().           */
+/*                                                                   */
+/*********************************************************************/
+void free_glob( glob_pattern* gp )
+{
+    for ( int i = 0; i < gp->n_comps; i++ )
+    {
+        free( gp->comps[i].text );
+        free( gp->comps[i].ops );
+    }
+
+    free( gp->comps );
+    free( gp->base );
+    memset( gp, 0, sizeof(*gp) );
+} /* end free_glob() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: expand_glob                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* word: the word to expand.                    */
+/*          char*** matches: set to the sorted matching paths.       */
+/*          int* n_matches: set to the number of matches.            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          compiles, runs and frees a pattern in one go. Returns    */
+/*          FAILURE if word is not a pattern.                        */
+/*                                                                   */
+/*********************************************************************/
+int expand_glob( const char* word, char*** matches, int* n_matches )
+{
+    glob_pattern gp;
+    int status;
+
+    *matches = NULL;
+    *n_matches = 0;
+
+    if ( compile_glob( word, &gp ) == FAILURE )
+        return FAILURE;
+
+    status = run_glob( &gp, matches, n_matches );
+    free_glob( &gp );
+
+    return status;
+} /* end expand_glob() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: free_matches                                  */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          char** matches: paths from run_glob().                   */
+/*          int n_matches: number of paths.                          */
+/*                                                                   */
+/*********************************************************************/
+void free_matches( char** matches, int n_matches )
+{
+    for ( int i = 0; i < n_matches; i++ )
+        free( matches[i] );
+
+    free( matches );
+} /* end free_matches() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: compile_component                             */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* text: start of the component.                */
+/*          size_t len: its length, up to the next "/".              */
+/*          glob_component* comp: set to the compiled component.     */
+/*                                                                   */
+/*      Description:                                                 */
+/*          turns the component into ops, then picks the cheapest    */
+/*          matcher that does the same job: a string compare for     */
+/*          literals, a prefix or suffix compare for "abc*" and      */
+/*          "*.c", and the ops themselves for everything else.       */
+/*                                                                   */
+/*********************************************************************/
+static int compile_component( const char* text, size_t len,
+                              glob_component* comp )
+{
+    int n_stars = 0, n_chars = 0, has_other = 0;
+    size_t used;
+    glob_op* op;
+
+    memset( comp, 0, sizeof(*comp) );
+    comp->dot_ok = ( text[0] == '.' || ( text[0] == '\\' && text[1] == '.' ) );
+
+    if ( len == 2 && text[0] == '*' && text[1] == '*' )
+    {
+        comp->kind = GLOB_RECURSE;
+        return SUCCESS;
+    }
+
+    if ( ( comp->ops = calloc( len, sizeof(glob_op) ) ) == NULL )
+        return FAILURE;
+
+    for ( size_t i = 0; i < len; i++ )
+    {
+        op = &comp->ops[comp->n_ops];
+
+        if ( text[i] == '*' )
+        {
+            if ( comp->n_ops > 0 && op[-1].kind == OP_STAR )
+                continue;
+
+            op->kind = OP_STAR;
+            n_stars++;
+        }
+        else if ( text[i] == '?' )
+        {
+            op->kind = OP_ANY;
+            has_other = 1;
+        }
+        else if ( text[i] == '[' &&
+                  parse_set( text + i, len - i, op, &used ) == SUCCESS )
+        {
+            i += used - 1;
+            has_other = 1;
+        }
+        else
+        {
+            if ( text[i] == '\\' && i + 1 < len )
+                i++;
+
+            op->kind = OP_CHAR;
+            op->c = (unsigned char) text[i];
+            n_chars++;
+        }
+
+        comp->n_ops++;
+    }
+
+    if ( n_stars == 0 && !has_other )
+        comp->kind = GLOB_LITERAL;
+    else if ( n_stars == 1 && !has_other && comp->n_ops == 1 )
+        comp->kind = GLOB_ALL;
+    else if ( n_stars == 1 && !has_other &&
+              comp->ops[comp->n_ops - 1].kind == OP_STAR )
+        comp->kind = GLOB_PREFIX;
+    else if ( n_stars == 1 && !has_other && comp->ops[0].kind == OP_STAR )
+        comp->kind = GLOB_SUFFIX;
+    else
+    {
+        comp->kind = GLOB_GENERIC;
+        return SUCCESS;
+    }
+
+    /* the simple kinds only need the literal characters */
+    if ( ( comp->text = malloc( n_chars + 1 ) ) == NULL )
+        return FAILURE;
+
+    for ( int i = 0; i < comp->n_ops; i++ )
+        if ( comp->ops[i].kind == OP_CHAR )
+            comp->text[comp->len++] = (char) comp->ops[i].c;
+
+    comp->text[comp->len] = '\0';
+    free( comp->ops );
+    comp->ops = NULL;
+    comp->n_ops = 0;
+
+    return SUCCESS;
+} /* end compile_component() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_set                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* text: a "[" in the pattern.                  */
+/*          size_t len: characters left in the component.            */
+/*          glob_op* op: set to an OP_SET.                           */
+/*          size_t* used: set to the characters consumed.            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          reads a bracket expression: ranges, [:class:] names,     */
+/*          and "!" or "^" to negate. A "]" first is an ordinary     */
+/*          member. The set becomes a 256 bit map, so matching a     */
+/*          character is one lookup. Returns FAILURE if there is no  */
+/*          closing "]", and the "[" is then matched literally.      */
+/*                                                                   */
+/*********************************************************************/
+static int parse_set( const char* text, size_t len, glob_op* op,
+                      size_t* used )
+{
+    size_t i = 1, name_len;
+    int negate = 0, first = 1;
+    unsigned char lo, hi;
+
+    memset( op, 0, sizeof(*op) );
+    op->kind = OP_SET;
+
+    if ( i < len && ( text[i] == '!' || text[i] == '^' ) )
+    {
+        negate = 1;
+        i++;
+    }
+
+    while ( i < len && ( text[i] != ']' || first ) )
+    {
+        first = 0;
+
+        /* [:name:] */
+        if ( text[i] == '[' && i + 1 < len && text[i + 1] == ':' )
+        {
+            const char* end = memchr( text + i + 2, ':', len - i - 2 );
+
+            if ( end != NULL && end + 1 < text + len && end[1] == ']' )
+            {
+                name_len = (size_t) ( end - ( text + i + 2 ) );
+
+                for ( int c = 0; classes[c].name != NULL; c++ )
+                {
+                    if ( strlen( classes[c].name ) != name_len ||
+                         strncmp( classes[c].name, text + i + 2,
+                                  name_len ) != 0 )
+                        continue;
+
+                    for ( int ch = 0; ch < 256; ch++ )
+                        if ( classes[c].test( ch ) )
+                            op->set[ch >> 3] |= (unsigned char)
+                                                ( 1 << ( ch & 7 ) );
+                }
+
+                i = (size_t) ( end - text ) + 2;
+                continue;
+            }
+        }
+
+        if ( text[i] == '\\' && i + 1 < len )
+            i++;
+
+        lo = hi = (unsigned char) text[i++];
+
+        if ( i + 1 < len && text[i] == '-' && text[i + 1] != ']' )
+        {
+            if ( text[i + 1] == '\\' && i + 2 < len )
+                i++;
+
+            hi = (unsigned char) text[i + 1];
+            i += 2;
+        }
+
+        for ( int ch = lo; ch <= hi; ch++ )
+            op->set[ch >> 3] |= (unsigned char) ( 1 << ( ch & 7 ) );
+    }
+
+    if ( i >= len )
+        return FAILURE;
+
+    if ( negate )
+        for ( int b = 0; b < GLOB_SET_BYTES; b++ )
+            op->set[b] = (unsigned char) ~op->set[b];
+
+    *used = i + 1;
+    return SUCCESS;
+} /* end parse_set() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: match_ops                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const glob_op* ops: a compiled component.                */
+/*          int n_ops: number of ops.                                */
+/*          const char* name: directory entry to test.               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          matches left to right, going back only to the last "*"   */
+/*          on a mismatch, so no pattern takes more than             */
+/*          O(ops * name) steps.                                     */
+/*                                                                   */
+/*********************************************************************/
+static int match_ops( const glob_op* ops, int n_ops, const char* name )
+{
+    int op_i = 0, star_op = -1;
+    size_t name_i = 0, star_name = 0;
+    unsigned char c;
+
+    while ( name[name_i] != '\0' )
+    {
+        c = (unsigned char) name[name_i];
+
+        if ( op_i < n_ops )
+        {
+            if ( ops[op_i].kind == OP_STAR )
+            {
+                star_op = op_i++;
+                star_name = name_i;
+                continue;
+            }
+
+            if ( ops[op_i].kind == OP_ANY ||
+                 ( ops[op_i].kind == OP_CHAR && ops[op_i].c == c ) ||
+                 ( ops[op_i].kind == OP_SET &&
+                   ( ops[op_i].set[c >> 3] & ( 1 << ( c & 7 ) ) ) ) )
+            {
+                op_i++;
+                name_i++;
+                continue;
+            }
+        }
+
+        /* let the last star swallow one more character */
+        if ( star_op == -1 )
+            return 0;
+
+        op_i = star_op + 1;
+        name_i = ++star_name;
+    }
+
+    while ( op_i < n_ops && ops[op_i].kind == OP_STAR )
+        op_i++;
+
+    return ( op_i == n_ops );
+} /* end match_ops() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: match_component                               */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const glob_component* comp: a compiled component.        */
+/*          const char* name: directory entry to test.               */
+/*          size_t len: length of name.                              */
+/*                                                                   */
+/*      Description:                                                 */
+/*          a leading "." only matches a pattern that starts with    */
+/*          one, and "." and ".." only match themselves.             */
+/*                                                                   */
+/*********************************************************************/
+static int match_component( const glob_component* comp, const char* name,
+                            size_t len )
+{
+    if ( name[0] == '.' )
+    {
+        if ( len <= 2 && ( len == 1 || name[1] == '.' ) )
+            return ( comp->kind == GLOB_LITERAL &&
+                     strcmp( comp->text, name ) == 0 );
+
+        if ( !comp->dot_ok )
+            return 0;
+    }
+
+    switch ( comp->kind )
+    {
+        case GLOB_LITERAL:
+            return ( len == comp->len && memcmp( name, comp->text, len ) == 0 );
+        case GLOB_ALL:
+            return 1;
+        case GLOB_PREFIX:
+            return ( len >= comp->len &&
+                     memcmp( name, comp->text, comp->len ) == 0 );
+        case GLOB_SUFFIX:
+            return ( len >= comp->len &&
+                     memcmp( name + len - comp->len, comp->text,
+                             comp->len ) == 0 );
+        case GLOB_GENERIC:
+            return match_ops( comp->ops, comp->n_ops, name );
+        default:
+            return 0;
+    }
+} /* end match_component() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: walk_worker                                   */
+/*      Return type:   static void*                                  */
+/*      Parameter(s):                                                */
+/*          void* arg: the glob_walk being run.                      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          takes directories off the shared list until none are     */
+/*          left and none are being read. New directories and        */
+/*          matches are kept locally while a directory is read and   */
+/*          handed over afterwards, so the lock is taken once per    */
+/*          directory rather than once per entry.                    */
+/*                                                                   */
+/*********************************************************************/
+static void* walk_worker( void* arg )
+{
+    glob_walk* walk = arg;
+    glob_tasks found = { NULL, 0, 0 };
+    glob_list matches = { NULL, 0, 0 };
+    glob_task task;
+    char* buf;
+
+    if ( ( buf = malloc( GLOB_DENTS_SIZE ) ) == NULL )
+        walk->failed = 1;
+
+    pthread_mutex_lock( &walk->lock );
+
+    while ( 1 )
+    {
+        while ( walk->tasks.n == 0 && walk->pending > 0 )
+            pthread_cond_wait( &walk->wake, &walk->lock );
+
+        if ( walk->tasks.n == 0 || buf == NULL )
+            break;
+
+        task = walk->tasks.items[--walk->tasks.n];
+        pthread_mutex_unlock( &walk->lock );
+
+        run_task( walk, &task, buf, &found, &matches );
+        free( task.dir );
+
+        pthread_mutex_lock( &walk->lock );
+
+        for ( int i = 0; i < found.n; i++ )
+        {
+            if ( push_task( &walk->tasks, found.items[i].dir,
+                            found.items[i].comp ) == FAILURE )
+            {
+                free( found.items[i].dir );
+                walk->failed = 1;
+            }
+            else
+                walk->pending++;
+        }
+
+        /* wake the others for new work, or to let them finish */
+        if ( --walk->pending == 0 || found.n > 0 )
+            pthread_cond_broadcast( &walk->wake );
+
+        found.n = 0;
+    }
+
+    for ( int i = 0; i < matches.n; i++ )
+        if ( push_match( &walk->matches, matches.items[i] ) == FAILURE )
+            free( matches.items[i] );
+
+    pthread_mutex_unlock( &walk->lock );
+
+    free( matches.items );
+    free( found.items );
+    free( buf );
+    return NULL;
+} /* end walk_worker() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_task                                      */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          glob_walk* walk: the walk being run.                     */
+/*          const glob_task* task: directory and component to match. */
+/*          char* buf: GLOB_DENTS_SIZE bytes for getdents64.         */
+/*          glob_tasks* found: gets directories still to read.       */
+/*          glob_list* matches: gets matching paths.                 */
+/*                                                                   */
+/*      Description:                                                 */
+/*          a literal component needs no directory read: the path    */
+/*          is built and checked, or passed down. Anything else      */
+/*          reads the whole directory, many entries per syscall.     */
+/*                                                                   */
+/*********************************************************************/
+static void run_task( glob_walk* walk, const glob_task* task, char* buf,
+                      glob_tasks* found, glob_list* matches )
+{
+    const glob_pattern* gp = walk->gp;
+    const glob_component* comp = &gp->comps[task->comp];
+    const struct dirent64* entry;
+    struct stat st;
+    char* path;
+    long n_read;
+    int fd, last = ( task->comp == gp->n_comps - 1 );
+
+    if ( comp->kind == GLOB_LITERAL )
+    {
+        if ( ( path = join_path( task->dir, comp->text, !last ) ) == NULL )
+            return;
+
+        if ( !last )
+            push_task( found, path, task->comp + 1 );
+        else if ( fstatat( AT_FDCWD, path, &st, gp->dirs_only ? 0 :
+                           AT_SYMLINK_NOFOLLOW ) == 0 &&
+                  ( !gp->dirs_only || S_ISDIR( st.st_mode ) ) )
+        {
+            free( path );
+            push_match( matches, join_path( task->dir, comp->text,
+                                            gp->dirs_only ) );
+        }
+        else
+            free( path );
+
+        return;
+    }
+
+    if ( ( fd = open( task->dir[0] == '\0' ? "." : task->dir,
+                      O_RDONLY | O_DIRECTORY | O_CLOEXEC ) ) == -1 )
+        return;
+
+    while ( ( n_read = syscall( SYS_getdents64, fd, buf,
+                                GLOB_DENTS_SIZE ) ) > 0 )
+    {
+        for ( long off = 0; off < n_read; off += entry->d_reclen )
+        {
+            entry = (const struct dirent64*) ( buf + off );
+
+            if ( entry->d_name[0] == '.' && ( entry->d_name[1] == '\0' ||
+                 ( entry->d_name[1] == '.' && entry->d_name[2] == '\0' ) ) )
+                continue;
+
+            visit_entry( walk, task, fd, entry, found, matches );
+        }
+    }
+
+    close( fd );
+} /* end run_task() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: visit_entry                                   */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          glob_walk* walk: the walk being run.                     */
+/*          const glob_task* task: directory and component to match. */
+/*          int fd: the open directory.                              */
+/*          const struct dirent64* entry: one entry in it.           */
+/*          glob_tasks* found: gets directories still to read.       */
+/*          glob_list* matches: gets matching paths.                 */
+/*                                                                   */
+/*      Description:                                                 */
+/*          "**" matches no directories or any number. Under it      */
+/*          each entry is tried against the next component, and      */
+/*          every visible subdirectory is read with "**" again.      */
+/*          Symbolic links are not followed by "**" itself, so a     */
+/*          link loop can't make the walk endless.                   */
+/*                                                                   */
+/*********************************************************************/
+static void visit_entry( glob_walk* walk, const glob_task* task, int fd,
+                         const struct dirent64* entry, glob_tasks* found,
+                         glob_list* matches )
+{
+    const glob_pattern* gp = walk->gp;
+    const glob_component* comp = &gp->comps[task->comp];
+    const char* name = entry->d_name;
+    size_t len = strlen( name );
+    int next = task->comp + 1, last = ( next == gp->n_comps );
+    char* path;
+
+    if ( comp->kind == GLOB_RECURSE )
+    {
+        if ( name[0] != '.' && entry_is_dir( fd, entry, 0 ) &&
+             ( path = join_path( task->dir, name, 1 ) ) != NULL )
+            push_task( found, path, task->comp );
+
+        /* a trailing "**" matches everything visible below */
+        if ( last )
+        {
+            if ( name[0] != '.' &&
+                 ( !gp->dirs_only || entry_is_dir( fd, entry, 0 ) ) )
+                push_match( matches, join_path( task->dir, name,
+                                                gp->dirs_only ) );
+            return;
+        }
+
+        comp = &gp->comps[next++];
+        last = ( next == gp->n_comps );
+    }
+
+    if ( !match_component( comp, name, len ) )
+        return;
+
+    if ( last )
+    {
+        if ( !gp->dirs_only || entry_is_dir( fd, entry, 1 ) )
+            push_match( matches, join_path( task->dir, name,
+                                            gp->dirs_only ) );
+    }
+    else if ( entry_is_dir( fd, entry, 1 ) &&
+              ( path = join_path( task->dir, name, 1 ) ) != NULL )
+        push_task( found, path, next );
+} /* end visit_entry() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: entry_is_dir                                  */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          int fd: the directory holding entry.                     */
+/*          const struct dirent64* entry: entry to test.             */
+/*          int follow: non-zero to count links to directories.      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          d_type answers this without a stat on most file          */
+/*          systems; fstatat() is only called for links and for      */
+/*          file systems that report DT_UNKNOWN.                     */
+/*                                                                   */
+/*********************************************************************/
+static int entry_is_dir( int fd, const struct dirent64* entry, int follow )
+{
+    struct stat st;
+
+    if ( entry->d_type == DT_DIR )
+        return 1;
+
+    if ( entry->d_type != DT_UNKNOWN && ( entry->d_type != DT_LNK ||
+                                          !follow ) )
+        return 0;
+
+    if ( fstatat( fd, entry->d_name, &st, follow ? 0 :
+                  AT_SYMLINK_NOFOLLOW ) == -1 )
+        return 0;
+
+    return S_ISDIR( st.st_mode );
+} /* end entry_is_dir() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: join_path                                     */
+/*      Return type:   static char*                                  */
+/*      Parameter(s):                                                */
+/*          const char* dir: "" or a path ending in "/".             */
+/*          const char* name: name to add.                           */
+/*          int slash: non-zero to end the result with "/".          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns a new string, or NULL if out of memory.          */
+/*                                                                   */
+/*********************************************************************/
+static char* join_path( const char* dir, const char* name, int slash )
+{
+    size_t dir_len = strlen( dir ), name_len = strlen( name );
+    char* path;
+
+    if ( ( path = malloc( dir_len + name_len + 2 ) ) == NULL )
+        return NULL;
+
+    memcpy( path, dir, dir_len );
+    memcpy( path + dir_len, name, name_len );
+
+    if ( slash )
+        path[dir_len + name_len++] = '/';
+
+    path[dir_len + name_len] = '\0';
+    return path;
+} /* end join_path() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: push_task                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          glob_tasks* tasks: list to add to.                       */
+/*          char* dir: directory to read, owned by the list after.   */
+/*          int comp: component to match in it.                      */
+/*                                                                   */
+/*********************************************************************/
+static int push_task( glob_tasks* tasks, char* dir, int comp )
+{
+    glob_task* grown;
+
+    if ( tasks->n == tasks->size )
+    {
+        if ( ( grown = realloc( tasks->items, ( tasks->size * 2 + 16 ) *
+                                sizeof(glob_task) ) ) == NULL )
+            return FAILURE;
+
+        tasks->items = grown;
+        tasks->size = tasks->size * 2 + 16;
+    }
+
+    tasks->items[tasks->n].dir = dir;
+    tasks->items[tasks->n++].comp = comp;
+    return SUCCESS;
+} /* end push_task() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: push_match                                    */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          glob_list* list: list to add to.                         */
+/*          char* path: path to add, owned by the list after.        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns FAILURE, leaving path to the caller, if out of   */
+/*          memory. A NULL path is ignored.                          */
+/*                                                                   */
+/*********************************************************************/
+static int push_match( glob_list* list, char* path )
+{
+    char** grown;
+
+    if ( path == NULL )
+        return SUCCESS;
+
+    if ( list->n == list->size )
+    {
+        if ( ( grown = realloc( list->items, ( list->size * 2 + 16 ) *
+                                sizeof(char*) ) ) == NULL )
+            return FAILURE;
+
+        list->items = grown;
+        list->size = list->size * 2 + 16;
+    }
+
+    list->items[list->n++] = path;
+    return SUCCESS;
+} /* end push_match() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: compare_paths                                 */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const void* a: pointer to a char*.                       */
+/*          const void* b: pointer to a char*.                       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          qsort() order for matches: byte order, as in the C       */
+/*          locale.                                                  */
+/*                                                                   */
+/*********************************************************************/
+static int compare_paths( const void* a, const void* b )
+{
+    return strcmp( *(char* const*) a, *(char* const*) b );
+} /* end compare_paths() */
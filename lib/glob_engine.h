@@ -0,0 +1,132 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: glob_engine.h                               */
+/*          Description:                                             */
+/*              This module expands *, ?, [...] and ** in words.     */
+/*              A pattern is compiled once into one matcher per      */
+/*              path component, directories are read with large      */
+/*              getdents64 calls, and d_type saves a stat per entry. */
+/*              Walks under ** are shared between worker threads.    */
+/*              Matches come back sorted.                            */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef GLOB_ENGINE_H
+#define GLOB_ENGINE_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define GLOB_DENTS_SIZE ( 64 * 1024 )
+#define GLOB_MAX_THREADS 8
+#define GLOB_SET_BYTES 32
+
+/* how a path component is matched, cheapest first */
+typedef enum glob_kind_t
+{
+    GLOB_LITERAL,       /* no wildcards, no directory read needed */
+    GLOB_ALL,           /* "*" */
+    GLOB_PREFIX,        /* "abc*" */
+    GLOB_SUFFIX,        /* "*.c" */
+    GLOB_GENERIC,       /* anything else, run as ops */
+    GLOB_RECURSE        /* "**", zero or more directories */
+} glob_kind;
+
+/* one step of a generic matcher */
+typedef enum glob_op_kind_t
+{
+    OP_CHAR,
+    OP_ANY,
+    OP_STAR,
+    OP_SET
+} glob_op_kind;
+
+typedef struct glob_op_t
+{
+    glob_op_kind    kind;
+    unsigned char   c;
+    unsigned char   set[GLOB_SET_BYTES];
+} glob_op;
+
+/* a compiled path component */
+typedef struct glob_component_t
+{
+    glob_kind   kind;
+    char*       text;
+    size_t      len;
+    int         dot_ok;
+    glob_op*    ops;
+    int         n_ops;
+} glob_component;
+
+/* a compiled pattern */
+typedef struct glob_pattern_t
+{
+    char*               base;
+    glob_component*     comps;
+    int                 n_comps;
+    int                 dirs_only;
+    int                 recursive;
+} glob_pattern;
+
+/* a directory still to be read, and the component to match in it */
+typedef struct glob_task_t
+{
+    char*   dir;
+    int     comp;
+} glob_task;
+
+/* growable lists, filled without a realloc per item */
+typedef struct glob_tasks_t
+{
+    glob_task*  items;
+    int         n;
+    int         size;
+} glob_tasks;
+
+typedef struct glob_list_t
+{
+    char**  items;
+    int     n;
+    int     size;
+} glob_list;
+
+/* state shared by the threads walking one pattern */
+typedef struct glob_walk_t
+{
+    const glob_pattern* gp;
+    pthread_mutex_t     lock;
+    pthread_cond_t      wake;
+    glob_tasks          tasks;
+    int                 pending;
+    glob_list           matches;
+    int                 failed;
+} glob_walk;
+
+/* function prototypes */
+int     has_glob_meta( const char* word );
+int     compile_glob( const char* pattern, glob_pattern* gp );
+int     run_glob( const glob_pattern* gp, char*** matches, int* n_matches );
+void    free_glob( glob_pattern* gp );
+int     expand_glob( const char* word, char*** matches, int* n_matches );
+void    free_matches( char** matches, int n_matches );
+
+#endif
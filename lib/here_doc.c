@@ -0,0 +1,181 @@
+#include "here_doc.h"
+
+/* local prototypes */
+static int  write_all( int, const char*, size_t );
+static int  pipe_fd_for( const char*, size_t );
+static int  memfd_for( const char*, size_t );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: here_doc_fd                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* data: text to feed to a command.             */
+/*          size_t len: number of bytes in data.                     */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns a close-on-exec descriptor that reads back data  */
+/*          from the start, or -1 on failure. Small payloads are     */
+/*          written into a pipe by the shell itself. Anything        */
+/*          bigger goes into a sealed memfd, rewound to offset 0,    */
+/*          so no helper process and no temporary file is needed.    */
+/*                                                                   */
+/*********************************************************************/
+int here_doc_fd( const char* data, size_t len )
+{
+    int fd;
+
+    if ( len <= HERE_DOC_PIPE_MAX && ( fd = pipe_fd_for( data, len ) ) != -1 )
+        return fd;
+
+    return memfd_for( data, len );
+} /* end here_doc_fd() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: append_text                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** buf: buffer to append to, grown as needed.        */
+/*          size_t* len: bytes used in buf.                          */
+/*          size_t* cap: bytes allocated for buf.                    */
+/*          const char* text: bytes to append.                       */
+/*          size_t n: number of bytes in text.                       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          appends text to buf, doubling the allocation when it     */
+/*          runs out so long documents aren't copied line by line.   */
+/*          buf is always NUL terminated.                            */
+/*                                                                   */
+/*********************************************************************/
+int append_text( char** buf, size_t* len, size_t* cap, const char* text,
+                 size_t n )
+{
+    char* grown;
+    size_t new_cap = ( *cap == 0 ? 256 : *cap );
+
+    while ( *len + n + 1 > new_cap )
+        new_cap *= 2;
+
+    if ( new_cap != *cap )
+    {
+        if ( ( grown = (char*) realloc( *buf, new_cap ) ) == NULL )
+            return FAILURE;
+
+        *buf = grown;
+        *cap = new_cap;
+    }
+
+    memcpy( *buf + *len, text, n );
+    *len += n;
+    (*buf)[*len] = '\0';
+
+    return SUCCESS;
+} /* end append_text() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: write_all                                     */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int fd: descriptor to write to.                          */
+/*          const char* data: bytes to write.                        */
+/*          size_t len: number of bytes in data.                     */
+/*                                                                   */
+/*********************************************************************/
+static int write_all( int fd, const char* data, size_t len )
+{
+    ssize_t n;
+
+    while ( len > 0 )
+    {
+        if ( ( n = write( fd, data, len ) ) == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            return FAILURE;
+        }
+
+        data += n;
+        len -= (size_t) n;
+    }
+
+    return SUCCESS;
+} /* end write_all() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: pipe_fd_for                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* data: text to buffer.                        */
+/*          size_t len: number of bytes in data, at most PIPE_BUF.   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          writes data into a fresh pipe and returns its read end   */
+/*          with the write end already closed.                       */
+/*                                                                   */
+/*********************************************************************/
+static int pipe_fd_for( const char* data, size_t len )
+{
+    int pipe_fd[2];
+
+    if ( pipe2( pipe_fd, O_CLOEXEC ) == -1 )
+        return -1;
+
+    if ( write_all( pipe_fd[1], data, len ) == FAILURE )
+    {
+        close( pipe_fd[0] );
+        close( pipe_fd[1] );
+        return -1;
+    }
+
+    close( pipe_fd[1] );
+    return pipe_fd[0];
+} /* end pipe_fd_for() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: memfd_for                                     */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* data: text to store.                         */
+/*          size_t len: number of bytes in data.                     */
+/*                                                                   */
+/*      Description:                                                 */
+/*          copies data into an anonymous in-memory file, seals it   */
+/*          against any change and rewinds it.                       */
+/*                                                                   */
+/*********************************************************************/
+static int memfd_for( const char* data, size_t len )
+{
+    int fd;
+
+    if ( ( fd = memfd_create( HERE_DOC_NAME,
+                              MFD_CLOEXEC | MFD_ALLOW_SEALING ) ) == -1 )
+    {
+        fprintf( stderr, "Error: Calling memfd_create() failed.\n" );
+        return -1;
+    }
+
+    if ( write_all( fd, data, len ) == FAILURE )
+    {
+        fprintf( stderr, "Error: Could not write here-document.\n" );
+        close( fd );
+        return -1;
+    }
+
+    /* the reader can rely on the contents never changing */
+    fcntl( fd, F_ADD_SEALS,
+           F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL );
+
+    lseek( fd, 0, SEEK_SET );
+
+    return fd;
+} /* end memfd_for() */
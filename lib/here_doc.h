@@ -0,0 +1,41 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: here_doc.h                                  */
+/*          Description:                                             */
+/*              This module provides functions to turn inline text   */
+/*              (here-documents and here-strings) into a readable    */
+/*              descriptor without touching the disk.                */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef HERE_DOC_H
+#define HERE_DOC_H
+
+/* for memfd_create() and pipe2() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define HERE_DOC_NAME "jshell-heredoc"
+
+/* payloads this small always fit in an empty pipe without blocking */
+#define HERE_DOC_PIPE_MAX PIPE_BUF
+
+/* function prototypes */
+int     here_doc_fd( const char* data, size_t len );
+int     append_text( char** buf, size_t* len, size_t* cap,
+                     const char* text, size_t n );
+
+#endif
@@ -0,0 +1,328 @@
+#include "instrument.h"
+
+/* globals */
+int             instrument_enabled = 0;
+struct timespec line_start;
+
+static phase_hist   hists[N_PHASES];
+
+static const char*  phase_names[N_PHASES] =
+{
+    "parse",
+    "alias",
+    "env",
+    "glob",
+    "path",
+    "spawn",
+    "dispatch",
+    "first_byte"
+};
+
+/* local prototypes */
+static int          bucket_index( uint64_t );
+static uint64_t     bucket_upper( int );
+static uint64_t     percentile( const phase_hist*, double );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: init_instrument                               */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          turns instrumentation on if $JSHELL_STATS or             */
+/*          $JSHELL_STATS_FILE is set. It can also be switched at    */
+/*          runtime with "stats on" / "stats off".                   */
+/*                                                                   */
+/*********************************************************************/
+void init_instrument( void )
+{
+    reset_instrument();
+
+    if ( getenv( STATS_ENV ) != NULL || getenv( STATS_FILE_ENV ) != NULL )
+        instrument_enabled = 1;
+} /* end init_instrument() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: record_phase                                  */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          phase p: phase being measured.                           */
+/*          const struct timespec* start: when the phase began.      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          adds the time elapsed since start to p's histogram.      */
+/*          Use STAT_STOP() rather than calling this directly.       */
+/*                                                                   */
+/*********************************************************************/
+void record_phase( phase p, const struct timespec* start )
+{
+    struct timespec now;
+    phase_hist* h = &hists[p];
+    uint64_t ns;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    ns = (uint64_t)( now.tv_sec - start->tv_sec ) * 1000000000ULL +
+         (uint64_t) now.tv_nsec - (uint64_t) start->tv_nsec;
+
+    if ( h->count == 0 || ns < h->min )
+        h->min = ns;
+
+    if ( ns > h->max )
+        h->max = ns;
+
+    h->count++;
+    h->total += ns;
+    h->buckets[bucket_index( ns )]++;
+} /* end record_phase() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: record_dispatch                               */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          records the time from readline() returning to the        */
+/*          line's first child being spawned. Only the first spawn   */
+/*          of each line counts.                                     */
+/*                                                                   */
+/*********************************************************************/
+void record_dispatch( void )
+{
+    if ( !instrument_enabled || line_start.tv_sec == 0 )
+        return;
+
+    record_phase( PHASE_DISPATCH, &line_start );
+    line_start.tv_sec = 0;
+} /* end record_dispatch() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: reset_instrument                              */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*********************************************************************/
+void reset_instrument( void )
+{
+    memset( hists, 0, sizeof(hists) );
+    line_start.tv_sec = 0;
+} /* end reset_instrument() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: print_instrument                              */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          FILE* fp: stream to print to.                            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          prints count, mean, p50, p99 and max per phase in        */
+/*          microseconds.                                            */
+/*                                                                   */
+/*********************************************************************/
+void print_instrument( FILE* fp )
+{
+    if ( !instrument_enabled )
+        fprintf( fp, "Instrumentation is off, turn it on with \"stats on\".\n" );
+
+    fprintf( fp, "%-12s %10s %12s %12s %12s %12s\n", "phase", "count",
+             "mean(us)", "p50(us)", "p99(us)", "max(us)" );
+
+    for ( int i = 0; i < N_PHASES; i++ )
+    {
+        const phase_hist* h = &hists[i];
+
+        if ( h->count == 0 )
+        {
+            fprintf( fp, "%-12s %10d %12s %12s %12s %12s\n", phase_names[i],
+                     0, "-", "-", "-", "-" );
+            continue;
+        }
+
+        fprintf( fp, "%-12s %10llu %12.2f %12.2f %12.2f %12.2f\n",
+                 phase_names[i], (unsigned long long) h->count,
+                 (double) h->total / (double) h->count / 1e3,
+                 (double) percentile( h, 0.50 ) / 1e3,
+                 (double) percentile( h, 0.99 ) / 1e3,
+                 (double) h->max / 1e3 );
+    }
+} /* end print_instrument() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: dump_instrument_json                          */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* path: file to write.                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          writes every phase, including its non-empty buckets, as  */
+/*          JSON. Times are in nanoseconds.                          */
+/*                                                                   */
+/*********************************************************************/
+int dump_instrument_json( const char* path )
+{
+    FILE* fp;
+    int first;
+
+    if ( ( fp = fopen( path, "w" ) ) == NULL )
+    {
+        fprintf( stderr, "Error. Could not open %s\n", path );
+        return FAILURE;
+    }
+
+    fprintf( fp, "{\n  \"unit\": \"ns\",\n  \"phases\": {\n" );
+
+    for ( int i = 0; i < N_PHASES; i++ )
+    {
+        const phase_hist* h = &hists[i];
+
+        fprintf( fp, "    \"%s\": {\"count\": %llu, \"total\": %llu, "
+                     "\"min\": %llu, \"max\": %llu, \"p50\": %llu, "
+                     "\"p99\": %llu, \"buckets\": [",
+                 phase_names[i], (unsigned long long) h->count,
+                 (unsigned long long) h->total,
+                 (unsigned long long) h->min, (unsigned long long) h->max,
+                 (unsigned long long) percentile( h, 0.50 ),
+                 (unsigned long long) percentile( h, 0.99 ) );
+
+        /* [upper bound, count] pairs for buckets that were hit */
+        first = 1;
+        for ( int b = 0; b < HIST_BUCKETS; b++ )
+        {
+            if ( h->buckets[b] == 0 )
+                continue;
+
+            fprintf( fp, "%s[%llu, %u]", first ? "" : ", ",
+                     (unsigned long long) bucket_upper( b ), h->buckets[b] );
+            first = 0;
+        }
+
+        fprintf( fp, "]}%s\n", i == N_PHASES - 1 ? "" : "," );
+    }
+
+    fprintf( fp, "  }\n}\n" );
+    fclose( fp );
+
+    return SUCCESS;
+} /* end dump_instrument_json() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: finish_instrument                             */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          called on exit, writes $JSHELL_STATS_FILE if it is set.  */
+/*                                                                   */
+/*********************************************************************/
+int finish_instrument( void )
+{
+    const char* path = getenv( STATS_FILE_ENV );
+
+    if ( path == NULL || *path == '\0' )
+        return SUCCESS;
+
+    return dump_instrument_json( path );
+} /* end finish_instrument() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: bucket_index                                  */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          uint64_t v: value to place.                              */
+/*                                                                   */
+/*      Description:                                                 */
+/*          log-linear bucketing: values below 2^HIST_SUB_BITS get   */
+/*          their own bucket, larger values are split by their top   */
+/*          bit and the HIST_SUB_BITS bits below it, which keeps     */
+/*          the error of any bucket under 1/2^HIST_SUB_BITS.         */
+/*                                                                   */
+/*********************************************************************/
+static int bucket_index( uint64_t v )
+{
+    int msb;
+
+    if ( v < ( 1u << HIST_SUB_BITS ) )
+        return (int) v;
+
+    msb = 63 - __builtin_clzll( v );
+
+    return ( ( msb - HIST_SUB_BITS + 1 ) << HIST_SUB_BITS ) +
+           (int)( ( v >> ( msb - HIST_SUB_BITS ) ) &
+                  ( ( 1u << HIST_SUB_BITS ) - 1 ) );
+} /* end bucket_index() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: bucket_upper                                  */
+/*      Return type:   uint64_t                                      */
+/*      Parameter(s):                                                */
+/*          int idx: bucket index.                                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          largest value that falls into bucket idx.                */
+/*                                                                   */
+/*********************************************************************/
+static uint64_t bucket_upper( int idx )
+{
+    int group = idx >> HIST_SUB_BITS;
+    int sub = idx & ( ( 1 << HIST_SUB_BITS ) - 1 );
+    int msb;
+
+    if ( group == 0 )
+        return (uint64_t) idx;
+
+    msb = group + HIST_SUB_BITS - 1;
+
+    return ( 1ULL << msb ) + ( (uint64_t)( sub + 1 ) << ( msb - HIST_SUB_BITS ) )
+           - 1;
+} /* end bucket_upper() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: percentile                                    */
+/*      Return type:   uint64_t                                      */
+/*      Parameter(s):                                                */
+/*          const phase_hist* h: histogram to read.                  */
+/*          double q: quantile between 0 and 1.                      */
+/*                                                                   */
+/*********************************************************************/
+static uint64_t percentile( const phase_hist* h, double q )
+{
+    uint64_t rank, seen = 0;
+
+    if ( h->count == 0 )
+        return 0;
+
+    /* nearest-rank: the smallest rank covering q of the samples */
+    rank = (uint64_t)( q * (double) h->count );
+    if ( (double) rank < q * (double) h->count || rank == 0 )
+        rank++;
+
+    for ( int b = 0; b < HIST_BUCKETS; b++ )
+    {
+        seen += h->buckets[b];
+
+        /* never report past the largest value actually seen */
+        if ( seen >= rank )
+            return bucket_upper( b ) < h->max ? bucket_upper( b ) : h->max;
+    }
+
+    return h->max;
+} /* end percentile() */
@@ -0,0 +1,76 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: instrument.h                                */
+/*          Description:                                             */
+/*              This module provides counters and latency            */
+/*              histograms for the phases the shell goes through     */
+/*              between reading a line and running it.               */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define STATS_ENV "JSHELL_STATS"
+#define STATS_FILE_ENV "JSHELL_STATS_FILE"
+
+/* each power of two is split into 2^HIST_SUB_BITS linear buckets */
+#define HIST_SUB_BITS 3
+#define HIST_BUCKETS ( 64 << HIST_SUB_BITS )
+
+/* timing helpers, a single predictable branch when disabled */
+#define STAT_START( ts ) \
+    do { if ( instrument_enabled ) clock_gettime( CLOCK_MONOTONIC, &(ts) ); } \
+    while ( 0 )
+
+#define STAT_STOP( phase, ts ) \
+    do { if ( instrument_enabled ) record_phase( (phase), &(ts) ); } \
+    while ( 0 )
+
+/* phases of handling one line */
+typedef enum phase_t
+{
+    PHASE_PARSE = 0,
+    PHASE_ALIAS,
+    PHASE_ENV,
+    PHASE_GLOB,
+    PHASE_PATH,
+    PHASE_SPAWN,
+    PHASE_DISPATCH,
+    PHASE_FIRST_BYTE,
+    N_PHASES
+} phase;
+
+/* latency histogram for one phase, values in nanoseconds */
+typedef struct phase_hist_t
+{
+    uint64_t    count;
+    uint64_t    total;
+    uint64_t    min;
+    uint64_t    max;
+    uint32_t    buckets[HIST_BUCKETS];
+} phase_hist;
+
+/* globals */
+extern int              instrument_enabled;
+extern struct timespec  line_start;
+
+/* function prototypes */
+void    init_instrument( void );
+void    record_phase( phase, const struct timespec* );
+void    record_dispatch( void );
+void    reset_instrument( void );
+void    print_instrument( FILE* );
+int     dump_instrument_json( const char* );
+int     finish_instrument( void );
+
+#endif
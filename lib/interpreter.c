@@ -0,0 +1,2807 @@
+#include "interpreter.h"
+#include "./shell_options.h"
+#include "./jshell.h"
+
+/* keywords that close a construct, never the start of a command */
+static const char* closers[] = { "then", "elif", "else", "fi", "do", "done",
+                                 "esac", "}", NULL };
+
+/* the calling thread's shell's state (see jshell.h): how the tree is
+ * being left, set by break, continue, return and exit, the functions
+ * defined, and bodies replaced while a call was running */
+#define unwinding       ( jshell->interp.unwinding )
+#define unwind_levels   ( jshell->interp.unwind_levels )
+#define exit_status     ( jshell->interp.exit_status )
+#define loop_depth      ( jshell->interp.loop_depth )
+#define functions       ( jshell->interp.functions )
+#define n_functions     ( jshell->interp.n_functions )
+#define functions_cap   ( jshell->interp.functions_cap )
+#define retired         ( jshell->interp.retired )
+#define n_retired       ( jshell->interp.n_retired )
+#define call_depth      ( jshell->interp.call_depth )
+#define substituter     ( jshell->interp.substituter )
+#define reader          ( jshell->interp.reader )
+#define pending_docs    ( jshell->interp.pending_docs )
+#define n_pending_docs  ( jshell->interp.n_pending_docs )
+
+/* local prototypes */
+static const char*  peek( parser*, int );
+static int          pull_line( parser* );
+static int          is_word( const char*, const char* );
+static int          at_end( parser*, const char** );
+static void         expect( parser*, const char* );
+static node*        new_node( parser*, node_kind );
+static node*        parse_list( parser*, const char** );
+static node*        parse_statement( parser* );
+static node*        parse_command( parser* );
+static node*        parse_if( parser* );
+static node*        parse_loop( parser* );
+static node*        parse_for( parser* );
+static node*        parse_case( parser* );
+static node*        parse_function( parser* );
+static node*        parse_arith( parser* );
+static int          take_arith( parser*, node* );
+static int          arith_end( char**, int, int );
+static arith_prog*  compile_tokens( char**, int, int );
+static int          add_arith( node*, arith_prog* );
+static char**       arith_view( node*, int );
+static int          take_words( parser*, node*, const char* );
+static int          take_here_doc( parser*, node*, const char* );
+static int          run_list( node*, command_runner );
+static int          run_node( node*, command_runner );
+static int          run_loop( node*, command_runner );
+static int          run_for( node*, command_runner );
+static int          run_for_word( node*, const char*, command_runner,
+                                  int* );
+static int          run_case( node*, command_runner );
+static int          run_command( node*, command_runner );
+static int          run_call( node*, command_runner );
+static int          is_simple( char**, int );
+static int          has_empty_stage( char**, int );
+static int          has_operator( char**, int );
+static int          needs_expansion( char**, int );
+static char**       expand_args( node*, char**, int, int* );
+static int          add_arg( char***, int*, int*, const char* );
+static int          has_substitution( char**, int );
+static char**       substitute_copy( node*, int, int* );
+static void         free_copy( char**, int );
+static char*        join_words( char**, int );
+static int          expand_argv( node*, char**, int );
+static int          grow_argv( node*, int );
+static int          run_builtin( node*, int, int* );
+static int          is_assignment( node* );
+static int          run_assignment( node* );
+static int          run_local( char**, int );
+static node*        clone_tree( node* );
+static void         define_function( node* );
+static function*    find_function( const char* );
+static int          call_function( char**, int, command_runner );
+static int          set_flow( flow, int, int );
+static int          loop_stops( void );
+static int          run_test( char**, int );
+static int          eval_test( const char**, int );
+static int          test_number( const char*, long long* );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_line                                    */
+/*      Return type:   node*                                         */
+/*      Parameter(s):                                                */
+/*          char** words: a line split by parse_string(), copied.    */
+/*          int n_words: how many words.                             */
+/*          line_source more: gives the lines a construct left open  */
+/*                            at the end of words needs.             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the line's statements, or NULL on a syntax       */
+/*          error, which has been reported. A line with nothing to   */
+/*          run also gives NULL.                                     */
+/*                                                                   */
+/*********************************************************************/
+node* parse_line( char** words, int n_words, line_source more )
+{
+    parser p = { NULL, 0, 0, 0, more, 0, 0 };
+    node* tree;
+
+    if ( ( p.toks = malloc( ( n_words + TOKENS_SIZE ) * sizeof(char*) ) )
+         == NULL )
+        return NULL;
+
+    p.cap = n_words + TOKENS_SIZE;
+
+    for ( ; p.n_toks < n_words; p.n_toks++ )
+        if ( ( p.toks[p.n_toks] = strdup( words[p.n_toks] ) ) == NULL )
+            p.error = T;
+
+    tree = ( p.error ? NULL : parse_list( &p, NULL ) );
+
+    if ( !p.error && p.pos < p.n_toks )
+    {
+        fprintf( stderr, "Error: Syntax error near \"%s\".\n",
+                 p.toks[p.pos] );
+        p.error = T;
+    }
+
+    for ( int i = 0; i < p.n_toks; i++ )
+        free( p.toks[i] );
+
+    free( p.toks );
+
+    if ( p.error )
+    {
+        free_tree( tree );
+        set_last_status( STATUS_SYNTAX );
+        return NULL;
+    }
+
+    return tree;
+} /* end parse_line() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_tree                                      */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          node* tree: statements from parse_line().                */
+/*          command_runner runner: runs simple commands.             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs tree and returns the last status. An exit inside    */
+/*          it is left for interp_flow() to report.                  */
+/*                                                                   */
+/*********************************************************************/
+int run_tree( node* tree, command_runner runner )
+{
+    return run_list( tree, runner );
+} /* end run_tree() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_compound                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const node* tree: statements from parse_line().          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T unless tree is one simple command.                     */
+/*                                                                   */
+/*********************************************************************/
+int is_compound( const node* tree )
+{
+    return ( tree != NULL && ( tree->kind != NODE_CMD || tree->next != NULL )
+             ? T : F );
+} /* end is_compound() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: interp_flow                                   */
+/*      Return type:   flow                                          */
+/*      Parameter(s):                                                */
+/*          int* status: set to the status exit was given.           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          FLOW_EXIT if the last tree ran exit, which the shell     */
+/*          should now do. The request is cleared.                   */
+/*                                                                   */
+/*********************************************************************/
+flow interp_flow( int* status )
+{
+    flow left = unwinding;
+
+    *status = exit_status;
+    unwinding = FLOW_NONE;
+    unwind_levels = 0;
+
+    return ( left == FLOW_EXIT ? FLOW_EXIT : FLOW_NONE );
+} /* end interp_flow() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: free_tree                                     */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          node* tree: statements from parse_line(), may be NULL.   */
+/*                                                                   */
+/*********************************************************************/
+void free_tree( node* tree )
+{
+    node* next;
+
+    for ( ; tree != NULL; tree = next )
+    {
+        next = tree->next;
+
+        for ( int i = 0; i < tree->n_words; i++ )
+            free( tree->words[i] );
+
+        for ( int i = 0; i < tree->n_arith; i++ )
+            arith_free( tree->arith[i] );
+
+        for ( int i = 0; i < tree->n_here_docs; i++ )
+            free( tree->here_docs[i] );
+
+        free( tree->words );
+        free( tree->here_docs );
+        free( tree->argv );
+        free( tree->arith );
+        free( tree->name );
+        free_tree( tree->cond );
+        free_tree( tree->body );
+        free_tree( tree->orelse );
+        free( tree );
+    }
+} /* end free_tree() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: free_functions                                */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*********************************************************************/
+void free_functions( void )
+{
+    for ( int i = 0; i < n_functions; i++ )
+    {
+        free( functions[i].name );
+        free_tree( functions[i].body );
+    }
+
+    for ( int i = 0; i < n_retired; i++ )
+        free_tree( retired[i] );
+
+    free( functions );
+    free( retired );
+
+    functions = NULL;
+    retired = NULL;
+    n_functions = functions_cap = n_retired = 0;
+} /* end free_functions() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: set_substituter                               */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          word_substituter fn: runs $(cmd) and `cmd` for the       */
+/*                               words the interpreter expands       */
+/*                               itself, NULL to leave them as they  */
+/*                               are.                                */
+/*                                                                   */
+/*      Description:                                                 */
+/*          for loop words, case subjects and assignments never go   */
+/*          through the shell's own expansion, so it lends the       */
+/*          interpreter the part of it they need.                    */
+/*                                                                   */
+/*********************************************************************/
+void set_substituter( word_substituter fn )
+{
+    substituter = fn;
+} /* end set_substituter() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: set_text_source                               */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          text_source fn: reads the lines of a here-document's     */
+/*                          body, NULL to leave them for the shell   */
+/*                          to read when the command runs.           */
+/*                                                                   */
+/*********************************************************************/
+void set_text_source( text_source fn )
+{
+    reader = fn;
+} /* end set_text_source() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: here_doc_text                                 */
+/*      Return type:   const char*                                   */
+/*      Parameter(s):                                                */
+/*          int k: which of the command's "<<" to look up.           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the body of the k-th here-document of the command the    */
+/*          runner was handed, as read when it was parsed. NULL if   */
+/*          it was not, and the shell must read it itself.           */
+/*                                                                   */
+/*********************************************************************/
+const char* here_doc_text( int k )
+{
+    return ( k < n_pending_docs ? pending_docs[k] : NULL );
+} /* end here_doc_text() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: peek                                          */
+/*      Return type:   static const char*                            */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens.                                   */
+/*          int offset: how far past the current token to look.      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the token, reading more lines if a construct is  */
+/*          still open, or NULL at the end.                          */
+/*                                                                   */
+/*********************************************************************/
+static const char* peek( parser* p, int offset )
+{
+    while ( p->pos + offset >= p->n_toks )
+        if ( p->error || p->depth == 0 || pull_line( p ) == FAILURE )
+            return NULL;
+
+    return p->toks[p->pos + offset];
+} /* end peek() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: pull_line                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens.                                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          appends the next line's words, after a ";" unless the    */
+/*          last line ended with one.                                */
+/*                                                                   */
+/*********************************************************************/
+static int pull_line( parser* p )
+{
+    char** words;
+    char** grown;
+    int n_words;
+
+    if ( p->more == NULL || p->more( &words, &n_words ) == FAILURE )
+    {
+        fprintf( stderr, "Error: Unexpected end of input.\n" );
+        p->error = T;
+        return FAILURE;
+    }
+
+    if ( p->n_toks + n_words + 1 > p->cap )
+    {
+        if ( ( grown = realloc( p->toks, ( p->n_toks + n_words + 1 +
+                                           TOKENS_SIZE ) * sizeof(char*) ) )
+             == NULL )
+            p->error = T;
+        else
+        {
+            p->toks = grown;
+            p->cap = p->n_toks + n_words + 1 + TOKENS_SIZE;
+        }
+    }
+
+    /* words already taken into a node are NULL, never a ";" */
+    if ( !p->error && ( p->n_toks == 0 || p->toks[p->n_toks - 1] == NULL ||
+                        strcmp( p->toks[p->n_toks - 1], ";" ) != 0 ) &&
+         ( p->toks[p->n_toks] = strdup( ";" ) ) != NULL )
+        p->n_toks++;
+
+    for ( int i = 0; i < n_words; i++ )
+    {
+        if ( p->error )
+            free( words[i] );
+        else
+            p->toks[p->n_toks++] = words[i];
+    }
+
+    free( words );
+    return ( p->error ? FAILURE : SUCCESS );
+} /* end pull_line() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_word                                       */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* tok: token, may be NULL.                     */
+/*          const char* word: what it should be.                     */
+/*                                                                   */
+/*********************************************************************/
+static int is_word( const char* tok, const char* word )
+{
+    return ( tok != NULL && strcmp( tok, word ) == 0 );
+} /* end is_word() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: at_end                                        */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens.                                   */
+/*          const char** ends: NULL terminated keywords that end     */
+/*                             the list, ";;" meaning two ";".       */
+/*                                                                   */
+/*********************************************************************/
+static int at_end( parser* p, const char** ends )
+{
+    const char* tok = peek( p, 0 );
+
+    for ( int i = 0; ends != NULL && ends[i] != NULL; i++ )
+    {
+        if ( strcmp( ends[i], ";;" ) == 0 )
+        {
+            if ( is_word( tok, ";" ) && is_word( peek( p, 1 ), ";" ) )
+                return T;
+        }
+        else if ( is_word( tok, ends[i] ) )
+            return T;
+    }
+
+    return F;
+} /* end at_end() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: expect                                        */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens.                                   */
+/*          const char* word: keyword that must come next.           */
+/*                                                                   */
+/*********************************************************************/
+static void expect( parser* p, const char* word )
+{
+    const char* tok;
+
+    if ( p->error )
+        return;
+
+    if ( is_word( tok = peek( p, 0 ), word ) )
+    {
+        p->pos++;
+        return;
+    }
+
+    if ( !p->error )
+        fprintf( stderr, "Error: Expected \"%s\" near \"%s\".\n", word,
+                 tok == NULL ? "end of line" : tok );
+
+    p->error = T;
+} /* end expect() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: new_node                                      */
+/*      Return type:   static node*                                  */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens, error set on failure.             */
+/*          node_kind kind: what the node is.                        */
+/*                                                                   */
+/*********************************************************************/
+static node* new_node( parser* p, node_kind kind )
+{
+    node* n = calloc( 1, sizeof(node) );
+
+    if ( n == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory parsing the line.\n" );
+        p->error = T;
+        return NULL;
+    }
+
+    n->kind = kind;
+    return n;
+} /* end new_node() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_list                                    */
+/*      Return type:   static node*                                  */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens.                                   */
+/*          const char** ends: keywords that end the list, NULL for  */
+/*                             the whole line.                       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          parses statements separated by ";" up to one of ends,    */
+/*          which is left for the caller.                            */
+/*                                                                   */
+/*********************************************************************/
+static node* parse_list( parser* p, const char** ends )
+{
+    node *head = NULL, **tail = &head;
+    const char* tok;
+
+    while ( !p->error && ( tok = peek( p, 0 ) ) != NULL && !at_end( p, ends ) )
+    {
+        if ( strcmp( tok, ";" ) == 0 )
+        {
+            p->pos++;
+            continue;
+        }
+
+        for ( int i = 0; closers[i] != NULL; i++ )
+        {
+            if ( strcmp( tok, closers[i] ) == 0 )
+            {
+                fprintf( stderr, "Error: Unexpected \"%s\".\n", tok );
+                p->error = T;
+                return head;
+            }
+        }
+
+        if ( ( *tail = parse_statement( p ) ) != NULL )
+            tail = &(*tail)->next;
+    }
+
+    return head;
+} /* end parse_list() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_statement                               */
+/*      Return type:   static node*                                  */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens, at the start of a command.        */
+/*                                                                   */
+/*********************************************************************/
+static node* parse_statement( parser* p )
+{
+    const char* tok = p->toks[p->pos];
+    node* n;
+
+    /* looked at before depth goes up, so a command ending the line
+       does not make peek() read another */
+    if ( is_var_name( tok ) && is_word( peek( p, 1 ), "(" ) &&
+         is_word( peek( p, 2 ), ")" ) )
+    {
+        p->depth++;
+        n = parse_function( p );
+        p->depth--;
+        return n;
+    }
+
+    if ( strcmp( tok, "(" ) == 0 && is_word( peek( p, 1 ), "(" ) )
+        return parse_arith( p );
+
+    p->depth++;
+
+    if ( strcmp( tok, "if" ) == 0 )
+        n = parse_if( p );
+    else if ( strcmp( tok, "while" ) == 0 || strcmp( tok, "until" ) == 0 )
+        n = parse_loop( p );
+    else if ( strcmp( tok, "for" ) == 0 )
+        n = parse_for( p );
+    else if ( strcmp( tok, "case" ) == 0 )
+        n = parse_case( p );
+    else
+    {
+        p->depth--;
+        return parse_command( p );
+    }
+
+    p->depth--;
+    return n;
+} /* end parse_statement() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_command                                 */
+/*      Return type:   static node*                                  */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens, at the start of a command.        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          a simple command runs to the next ";" or the end of the  */
+/*          line. Its $(( ))s are compiled now, and commands that    */
+/*          may be builtins or functions get their argv buffer, so   */
+/*          running them never allocates. A pipeline with an empty   */
+/*          stage is a syntax error, so none of it is started.       */
+/*                                                                   */
+/*********************************************************************/
+static node* parse_command( parser* p )
+{
+    node* n = new_node( p, NODE_CMD );
+
+    if ( n == NULL || take_words( p, n, ";" ) == FAILURE ||
+         take_arith( p, n ) == FAILURE )
+    {
+        free_tree( n );
+        return NULL;
+    }
+
+    for ( int i = 0; i < n->n_words; i++ )
+        if ( strcmp( n->words[i], "|" ) == 0 )
+            n->n_pipes++;
+
+    if ( has_empty_stage( n->words, n->n_words ) )
+    {
+        fprintf( stderr, "Error: Syntax error near \"|\".\n" );
+        p->error = T;
+        free_tree( n );
+        return NULL;
+    }
+
+    n->plain = is_simple( n->words, n->n_words );
+
+    if ( ( n->plain || n->n_arith > 0 ) &&
+         grow_argv( n, n->n_words + 1 ) == FAILURE )
+    {
+        p->error = T;
+        free_tree( n );
+        return NULL;
+    }
+
+    return n;
+} /* end parse_command() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_if                                      */
+/*      Return type:   static node*                                  */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens, at "if" or "elif".                */
+/*                                                                   */
+/*********************************************************************/
+static node* parse_if( parser* p )
+{
+    static const char* then_end[] = { "then", NULL };
+    static const char* body_end[] = { "elif", "else", "fi", NULL };
+    static const char* else_end[] = { "fi", NULL };
+    node* n = new_node( p, NODE_IF );
+
+    if ( n == NULL )
+        return NULL;
+
+    p->pos++;
+    n->cond = parse_list( p, then_end );
+    expect( p, "then" );
+    n->body = parse_list( p, body_end );
+
+    if ( p->error )
+        return n;
+
+    /* an elif is an if of its own, and takes the "fi" with it */
+    if ( is_word( peek( p, 0 ), "elif" ) )
+        n->orelse = parse_if( p );
+    else
+    {
+        if ( is_word( peek( p, 0 ), "else" ) )
+        {
+            p->pos++;
+            n->orelse = parse_list( p, else_end );
+        }
+
+        expect( p, "fi" );
+    }
+
+    return n;
+} /* end parse_if() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_loop                                    */
+/*      Return type:   static node*                                  */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens, at "while" or "until".            */
+/*                                                                   */
+/*********************************************************************/
+static node* parse_loop( parser* p )
+{
+    static const char* cond_end[] = { "do", NULL };
+    static const char* body_end[] = { "done", NULL };
+    node* n = new_node( p, strcmp( p->toks[p->pos], "while" ) == 0 ?
+                           NODE_WHILE : NODE_UNTIL );
+
+    if ( n == NULL )
+        return NULL;
+
+    p->pos++;
+    n->cond = parse_list( p, cond_end );
+    expect( p, "do" );
+    n->body = parse_list( p, body_end );
+    expect( p, "done" );
+
+    return n;
+} /* end parse_loop() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_for                                     */
+/*      Return type:   static node*                                  */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens, at "for".                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          for NAME in WORDS; do LIST; done. The words are kept as  */
+/*          written and expanded when the loop runs. With no "in     */
+/*          WORDS" the loop walks "$@".                              */
+/*                                                                   */
+/*********************************************************************/
+static node* parse_for( parser* p )
+{
+    static const char* body_end[] = { "done", NULL };
+    node* n = new_node( p, NODE_FOR );
+    const char* tok;
+
+    if ( n == NULL )
+        return NULL;
+
+    p->pos++;
+
+    if ( ( tok = peek( p, 0 ) ) == NULL || !is_var_name( tok ) )
+    {
+        if ( !p->error )
+            fprintf( stderr, "Error: Bad variable name in for.\n" );
+        p->error = T;
+        return n;
+    }
+
+    if ( ( n->name = strdup( tok ) ) == NULL )
+        p->error = T;
+
+    p->pos++;
+
+    if ( !is_word( peek( p, 0 ), "in" ) )
+    {
+        if ( ( n->words = calloc( 3, sizeof(char*) ) ) == NULL ||
+             ( n->words[0] = strdup( "$" ) ) == NULL ||
+             ( n->words[1] = strdup( "@" ) ) == NULL )
+            p->error = T;
+
+        n->n_words = ( n->words != NULL ? 2 : 0 );
+    }
+    else
+    {
+        p->pos++;
+
+        if ( take_words( p, n, ";" ) == FAILURE ||
+             take_arith( p, n ) == FAILURE )
+            return n;
+    }
+
+    while ( is_word( peek( p, 0 ), ";" ) )
+        p->pos++;
+
+    expect( p, "do" );
+    n->body = parse_list( p, body_end );
+    expect( p, "done" );
+
+    return n;
+} /* end parse_for() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_case                                    */
+/*      Return type:   static node*                                  */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens, at "case".                        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          case WORD in [(]PATTERN[|PATTERN]...) LIST ;; ... esac.  */
+/*          Each arm is a NODE_ARM chained from body.                */
+/*                                                                   */
+/*********************************************************************/
+static node* parse_case( parser* p )
+{
+    static const char* arm_end[] = { ";;", "esac", NULL };
+    node* n = new_node( p, NODE_CASE );
+    node **tail, *arm;
+    const char* tok;
+
+    if ( n == NULL )
+        return NULL;
+
+    p->pos++;
+
+    if ( take_words( p, n, "in" ) == FAILURE ||
+         take_arith( p, n ) == FAILURE || n->n_words == 0 )
+    {
+        if ( !p->error )
+            fprintf( stderr, "Error: Missing word in case.\n" );
+        p->error = T;
+        return n;
+    }
+
+    expect( p, "in" );
+
+    for ( tail = &n->body; !p->error; tail = &arm->next )
+    {
+        while ( is_word( tok = peek( p, 0 ), ";" ) )
+            p->pos++;
+
+        if ( is_word( tok, "esac" ) )
+        {
+            p->pos++;
+            break;
+        }
+
+        if ( is_word( tok, "(" ) )
+            p->pos++;
+
+        if ( ( *tail = arm = new_node( p, NODE_ARM ) ) == NULL )
+            break;
+
+        /* the patterns, with the "|" between them dropped */
+        if ( take_words( p, arm, ")" ) == FAILURE )
+            break;
+
+        expect( p, ")" );
+        arm->cond = parse_list( p, arm_end );
+
+        if ( !p->error && !is_word( peek( p, 0 ), "esac" ) )
+            p->pos += 2;
+    }
+
+    return n;
+} /* end parse_case() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_function                                */
+/*      Return type:   static node*                                  */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens, at "name ( )".                    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          name() { LIST }. The "{" may be on the next line.        */
+/*                                                                   */
+/*********************************************************************/
+static node* parse_function( parser* p )
+{
+    static const char* body_end[] = { "}", NULL };
+    node* n = new_node( p, NODE_FUNC );
+
+    if ( n == NULL )
+        return NULL;
+
+    if ( ( n->name = strdup( p->toks[p->pos] ) ) == NULL )
+        p->error = T;
+
+    p->pos += 3;
+
+    while ( is_word( peek( p, 0 ), ";" ) )
+        p->pos++;
+
+    expect( p, "{" );
+    n->body = parse_list( p, body_end );
+    expect( p, "}" );
+
+    return n;
+} /* end parse_function() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_arith                                   */
+/*      Return type:   static node*                                  */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens, at "( (".                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          (( EXPR )), true if EXPR is not 0. The expression must   */
+/*          end on the line it starts on.                            */
+/*                                                                   */
+/*********************************************************************/
+static node* parse_arith( parser* p )
+{
+    node* n = new_node( p, NODE_ARITH );
+    int end = arith_end( p->toks, p->pos + 2, p->n_toks );
+
+    if ( n == NULL )
+        return NULL;
+
+    if ( end < 0 )
+    {
+        fprintf( stderr, "Error: Missing \"))\".\n" );
+        p->error = T;
+        return n;
+    }
+
+    if ( add_arith( n, compile_tokens( p->toks, p->pos + 2, end ) ) < 0 )
+        p->error = T;
+
+    p->pos = end + 2;
+    return n;
+} /* end parse_arith() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: take_arith                                    */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens, error set on failure.             */
+/*          node* n: has its words.                                  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          compiles each "$ ( ( EXPR ) )" in n->words into n->arith */
+/*          and puts a single marker word, ARITH_MARKER and the      */
+/*          index, in its place.                                     */
+/*                                                                   */
+/*********************************************************************/
+static int take_arith( parser* p, node* n )
+{
+    int end, index;
+
+    for ( int i = 0; i + 2 < n->n_words; i++ )
+    {
+        if ( strcmp( n->words[i], "$" ) != 0 ||
+             strcmp( n->words[i + 1], "(" ) != 0 ||
+             strcmp( n->words[i + 2], "(" ) != 0 )
+            continue;
+
+        if ( ( end = arith_end( n->words, i + 3, n->n_words ) ) < 0 )
+        {
+            fprintf( stderr, "Error: Missing \"))\".\n" );
+            p->error = T;
+            return FAILURE;
+        }
+
+        if ( ( index = add_arith( n, compile_tokens( n->words, i + 3, end ) ) )
+             < 0 )
+        {
+            p->error = T;
+            return FAILURE;
+        }
+
+        for ( int k = i; k <= end + 1; k++ )
+            free( n->words[k] );
+
+        if ( ( n->words[i] = malloc( ARITH_WORD_SIZE ) ) == NULL )
+        {
+            n->n_words = i;
+            p->error = T;
+            return FAILURE;
+        }
+
+        snprintf( n->words[i], ARITH_WORD_SIZE, "%c%d", ARITH_MARKER,
+                  index );
+
+        memmove( &n->words[i + 1], &n->words[end + 2],
+                 ( n->n_words - end - 1 ) * sizeof(char*) );
+        n->n_words -= end + 1 - i;
+    }
+
+    return SUCCESS;
+} /* end take_arith() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: arith_end                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char** toks: words, taken ones NULL.                     */
+/*          int from: first word of the expression.                  */
+/*          int n_toks: how many words.                              */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the index of the first ")" of the "))" that      */
+/*          closes the expression, or -1.                            */
+/*                                                                   */
+/*********************************************************************/
+static int arith_end( char** toks, int from, int n_toks )
+{
+    int depth = 0;
+
+    for ( int i = from; i < n_toks && toks[i] != NULL; i++ )
+    {
+        if ( strcmp( toks[i], "(" ) == 0 )
+            depth++;
+        else if ( strcmp( toks[i], ")" ) == 0 && depth > 0 )
+            depth--;
+        else if ( strcmp( toks[i], ")" ) == 0 )
+            return ( i + 1 < n_toks && is_word( toks[i + 1], ")" ) ? i : -1 );
+    }
+
+    return -1;
+} /* end arith_end() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: compile_tokens                                */
+/*      Return type:   static arith_prog*                            */
+/*      Parameter(s):                                                */
+/*          char** toks: words.                                      */
+/*          int from: first word of the expression.                  */
+/*          int to: the word after its last.                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          joins the words again with spaces, except around the     */
+/*          "$", "<", ">", "&", "|", "=" and "!" the lexer split     */
+/*          off, so "$x", "<=" and "&&" come back whole.             */
+/*                                                                   */
+/*********************************************************************/
+static arith_prog* compile_tokens( char** toks, int from, int to )
+{
+    const char* glued = "$<>&|=!";
+    size_t size = 1;
+    arith_prog* prog;
+    char* source;
+
+    for ( int i = from; i < to; i++ )
+        size += strlen( toks[i] ) + 1;
+
+    if ( ( source = malloc( size ) ) == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory compiling arithmetic.\n" );
+        return NULL;
+    }
+
+    source[0] = '\0';
+
+    for ( int i = from; i < to; i++ )
+    {
+        if ( i > from && strspn( toks[i], glued ) != strlen( toks[i] ) &&
+             strspn( toks[i - 1], glued ) != strlen( toks[i - 1] ) )
+            strcat( source, " " );
+
+        strcat( source, toks[i] );
+    }
+
+    prog = arith_compile( source );
+    free( source );
+
+    return prog;
+} /* end compile_tokens() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: add_arith                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: gets the expression.                            */
+/*          arith_prog* prog: compiled expression, NULL if that      */
+/*                            failed.                                */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns prog's index in n->arith, or -1.                 */
+/*                                                                   */
+/*********************************************************************/
+static int add_arith( node* n, arith_prog* prog )
+{
+    arith_prog** grown;
+
+    if ( prog == NULL )
+        return -1;
+
+    if ( ( grown = realloc( n->arith, ( n->n_arith + 1 ) *
+                                      sizeof(arith_prog*) ) ) == NULL )
+    {
+        arith_free( prog );
+        return -1;
+    }
+
+    n->arith = grown;
+    n->arith[n->n_arith] = prog;
+
+    return n->n_arith++;
+} /* end add_arith() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: take_words                                    */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens.                                   */
+/*          node* n: gets the words.                                 */
+/*          const char* stop: token that ends them, which is left.   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          moves tokens into n->words up to stop or the end of the  */
+/*          tokens read so far. A stop or ";" inside $( ), <( ),     */
+/*          >( ) or backticks belongs to that command and is taken   */
+/*          with the rest. Inside a case pattern "|" is dropped.     */
+/*                                                                   */
+/*********************************************************************/
+static int take_words( parser* p, node* n, const char* stop )
+{
+    int end = p->pos, k = 0, depth = 0, quoted = F;
+    const char* tok;
+
+    for ( ; end < p->n_toks; end++ )
+    {
+        tok = p->toks[end];
+
+        if ( depth == 0 && !quoted &&
+             ( strcmp( tok, stop ) == 0 || strcmp( tok, ";" ) == 0 ) )
+            break;
+
+        if ( strcmp( tok, "`" ) == 0 )
+            quoted = !quoted;
+        else if ( strcmp( tok, "(" ) == 0 || strcmp( tok, "<(" ) == 0 ||
+                  strcmp( tok, ">(" ) == 0 )
+            depth++;
+        else if ( strcmp( tok, ")" ) == 0 && depth > 0 )
+            depth--;
+    }
+
+    if ( ( n->words = malloc( ( end - p->pos + 1 ) * sizeof(char*) ) )
+         == NULL )
+    {
+        p->error = T;
+        return FAILURE;
+    }
+
+    for ( ; p->pos < end; p->pos++ )
+    {
+        if ( n->kind == NODE_ARM && strcmp( p->toks[p->pos], "|" ) == 0 )
+        {
+            free( p->toks[p->pos] );
+        }
+        else
+            n->words[k++] = p->toks[p->pos];
+
+        p->toks[p->pos] = NULL;
+    }
+
+    n->words[k] = NULL;
+    n->n_words = k;
+
+    /* the body follows this line, before the parser reads on */
+    for ( int i = 0, depth = 0, quoted = F; i + 1 < k; i++ )
+    {
+        if ( strcmp( n->words[i], "`" ) == 0 )
+            quoted = !quoted;
+        else if ( strcmp( n->words[i], "(" ) == 0 )
+            depth++;
+        else if ( strcmp( n->words[i], ")" ) == 0 && depth > 0 )
+            depth--;
+        else if ( depth == 0 && !quoted && reader != NULL &&
+                  strcmp( n->words[i], "<<" ) == 0 &&
+                  take_here_doc( p, n, n->words[i + 1] ) == FAILURE )
+            return FAILURE;
+    }
+
+    return SUCCESS;
+} /* end take_words() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: take_here_doc                                 */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          parser* p: the tokens.                                   */
+/*          node* n: the command the here-document belongs to.       */
+/*          const char* delim: the line that ends it.                */
+/*                                                                   */
+/*      Description:                                                 */
+/*          reads lines up to delim, or the end of input, and adds   */
+/*          them to n->here_docs, each ending in a newline.          */
+/*                                                                   */
+/*********************************************************************/
+static int take_here_doc( parser* p, node* n, const char* delim )
+{
+    char* body = NULL;
+    char* line;
+    char* grown;
+    char** docs;
+    size_t len = 0, add;
+    int failed = F;
+
+    /* out of memory, the body is still read, so input stays in step */
+    while ( ( line = reader( "> " ) ) != NULL && strcmp( line, delim ) != 0 )
+    {
+        add = strlen( line );
+
+        if ( failed || ( grown = realloc( body, len + add + 2 ) ) == NULL )
+            failed = T;
+        else
+        {
+            body = grown;
+            memcpy( body + len, line, add );
+            len += add;
+            body[len++] = '\n';
+            body[len] = '\0';
+        }
+
+        free( line );
+    }
+
+    free( line );
+
+    if ( !failed && body == NULL && ( body = strdup( "" ) ) == NULL )
+        failed = T;
+
+    if ( failed || ( docs = realloc( n->here_docs,
+                     ( n->n_here_docs + 1 ) * sizeof(char*) ) ) == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory reading a here-document.\n" );
+        free( body );
+        p->error = T;
+        return FAILURE;
+    }
+
+    n->here_docs = docs;
+    n->here_docs[n->n_here_docs++] = body;
+
+    return SUCCESS;
+} /* end take_here_doc() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_list                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: first of a list of statements.                  */
+/*          command_runner runner: runs simple commands.             */
+/*                                                                   */
+/*********************************************************************/
+static int run_list( node* n, command_runner runner )
+{
+    int status = last_status();
+
+    for ( ; n != NULL && unwinding == FLOW_NONE; n = n->next )
+        status = run_node( n, runner );
+
+    return status;
+} /* end run_list() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_node                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: one statement.                                  */
+/*          command_runner runner: runs simple commands.             */
+/*                                                                   */
+/*********************************************************************/
+static int run_node( node* n, command_runner runner )
+{
+    int64_t value;
+    int status = 0;
+
+    switch ( n->kind )
+    {
+        case NODE_CMD:
+            status = run_command( n, runner );
+            set_last_status( status );
+
+            /* a ^C that killed a command stops every loop, as in bash */
+            if ( status == 128 + SIGINT && loop_depth > 0 )
+                set_flow( FLOW_BREAK, loop_depth, status );
+            break;
+
+        case NODE_IF:
+            status = run_list( n->cond, runner );
+
+            if ( unwinding != FLOW_NONE )
+                break;
+
+            if ( status == 0 )
+                status = run_list( n->body, runner );
+            else if ( n->orelse != NULL )
+                status = run_list( n->orelse, runner );
+            else
+                status = 0;
+            break;
+
+        case NODE_WHILE:
+        case NODE_UNTIL:
+            status = run_loop( n, runner );
+            break;
+
+        case NODE_FOR:
+            status = run_for( n, runner );
+            break;
+
+        case NODE_CASE:
+            status = run_case( n, runner );
+            break;
+
+        case NODE_FUNC:
+            define_function( n );
+            break;
+
+        case NODE_ARITH:
+            status = ( arith_eval( n->arith[0], &value ) == SUCCESS &&
+                       value != 0 ? 0 : 1 );
+            break;
+
+        default:
+            break;
+    }
+
+    set_last_status( status );
+    return status;
+} /* end run_node() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_loop                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: a while or until loop.                          */
+/*          command_runner runner: runs simple commands.             */
+/*                                                                   */
+/*********************************************************************/
+static int run_loop( node* n, command_runner runner )
+{
+    int status = 0, test;
+
+    loop_depth++;
+
+    for ( ;; )
+    {
+        test = run_list( n->cond, runner );
+
+        if ( loop_stops() || ( test == 0 ) != ( n->kind == NODE_WHILE ) )
+            break;
+
+        status = run_list( n->body, runner );
+
+        if ( loop_stops() )
+            break;
+    }
+
+    loop_depth--;
+    return status;
+} /* end run_loop() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_for                                       */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: a for loop.                                     */
+/*          command_runner runner: runs simple commands.             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs the body once per word. $name gives its value,      */
+/*          {a,b} and {1..N} are taken from a brace generator one    */
+/*          at a time, so {1..10000000} takes no more memory than    */
+/*          {1..3}, and patterns are expanded to the paths they      */
+/*          match. $(cmd) and `cmd` are run once, up front.          */
+/*                                                                   */
+/*********************************************************************/
+static int run_for( node* n, command_runner runner )
+{
+    char** words = n->words;
+    char** copy = NULL;
+    const char* word;
+    brace_gen* gen;
+    char** matches;
+    char** args;
+    int n_words = n->n_words, n_matches, n_args, status = 0, stop = F;
+
+    /* run once, before the first time round */
+    if ( has_substitution( words, n_words ) &&
+         ( words = copy = substitute_copy( n, 0, &n_words ) ) == NULL )
+        return 1;
+
+    loop_depth++;
+
+    for ( int i = 0; i < n_words && !stop; i++ )
+    {
+        word = words[i];
+
+        if ( strcmp( word, "$" ) == 0 && i + 1 < n_words &&
+             strcmp( words[i + 1], "@" ) == 0 )
+        {
+            /* taken now, as the body may shift */
+            args = positional_args( &n_args );
+            i++;
+
+            for ( int a = 0; a < n_args && !stop; a++ )
+                status = run_for_word( n, args[a], runner, &stop );
+        }
+        else if ( strcmp( word, "$" ) == 0 && i + 1 < n_words )
+        {
+            if ( ( word = var_get( words[++i] ) ) != NULL )
+                status = run_for_word( n, word, runner, &stop );
+        }
+        else if ( word[0] == ARITH_MARKER )
+        {
+            if ( ( word = arith_string( n->arith[atoi( word + 1 )] ) )
+                 == NULL )
+            {
+                status = 1;
+                break;
+            }
+
+            status = run_for_word( n, word, runner, &stop );
+        }
+        else if ( ( gen = brace_compile( word ) ) != NULL )
+        {
+            while ( !stop && brace_next( gen, &word ) == SUCCESS )
+                status = run_for_word( n, word, runner, &stop );
+
+            brace_free( gen );
+        }
+        else if ( OPTION( OPT_GLOB ) && has_glob_meta( word ) == SUCCESS &&
+                  expand_glob( word, &matches, &n_matches ) == SUCCESS &&
+                  n_matches > 0 )
+        {
+            for ( int m = 0; m < n_matches && !stop; m++ )
+                status = run_for_word( n, matches[m], runner, &stop );
+
+            free_matches( matches, n_matches );
+        }
+        else
+            status = run_for_word( n, word, runner, &stop );
+    }
+
+    loop_depth--;
+    free_copy( copy, n_words );
+
+    return status;
+} /* end run_for() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_for_word                                  */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: a for loop.                                     */
+/*          const char* word: the value for this time round.         */
+/*          command_runner runner: runs simple commands.             */
+/*          int* stop: set to T if the loop must stop.               */
+/*                                                                   */
+/*********************************************************************/
+static int run_for_word( node* n, const char* word, command_runner runner,
+                         int* stop )
+{
+    int status;
+
+    if ( var_set( n->name, word ) == FAILURE )
+    {
+        *stop = T;
+        return 1;
+    }
+
+    status = run_list( n->body, runner );
+    *stop = loop_stops();
+
+    return status;
+} /* end run_for_word() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_case                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: a case statement.                               */
+/*          command_runner runner: runs simple commands.             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs the first arm with a pattern that matches the word, */
+/*          patterns being globs as fnmatch(3) sees them. What       */
+/*          $(cmd) prints is matched as a whole, words joined by     */
+/*          spaces.                                                  */
+/*                                                                   */
+/*********************************************************************/
+static int run_case( node* n, command_runner runner )
+{
+    const char* subject = n->words[0];
+    const char* pattern;
+    char* joined = NULL;
+    char** copy;
+    int count, status = 0;
+
+    if ( has_substitution( n->words, n->n_words ) )
+    {
+        /* the output is one word, as it would be quoted */
+        if ( ( copy = substitute_copy( n, 0, &count ) ) == NULL )
+            return 1;
+
+        joined = join_words( copy, count );
+        free_copy( copy, count );
+
+        if ( ( subject = joined ) == NULL )
+            return 1;
+    }
+    else if ( strcmp( subject, "$" ) == 0 && n->n_words > 1 &&
+              ( subject = var_get( n->words[1] ) ) == NULL )
+        subject = "";
+
+    if ( subject[0] == ARITH_MARKER &&
+         ( subject = arith_string( n->arith[atoi( subject + 1 )] ) )
+         == NULL )
+        return 1;
+
+    for ( node* arm = n->body; arm != NULL; arm = arm->next )
+    {
+        for ( int i = 0; i < arm->n_words; i++ )
+        {
+            pattern = arm->words[i];
+
+            if ( strcmp( pattern, "$" ) == 0 && i + 1 < arm->n_words &&
+                 ( pattern = var_get( arm->words[++i] ) ) == NULL )
+                pattern = "";
+
+            if ( fnmatch( pattern, subject, 0 ) == 0 )
+            {
+                status = run_list( arm->cond, runner );
+                free( joined );
+                return status;
+            }
+        }
+    }
+
+    free( joined );
+    return status;
+} /* end run_case() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_command                                   */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: a simple command.                               */
+/*          command_runner runner: runs it if it is not a function   */
+/*                                 or a builtin.                     */
+/*                                                                   */
+/*      Description:                                                 */
+/*          functions are looked up first, so one may stand in for   */
+/*          a builtin, as in bash, though not for name = value.      */
+/*          Each $(( )) is evaluated once. The shell takes the       */
+/*          command's here-documents from here_doc_text().           */
+/*                                                                   */
+/*********************************************************************/
+static int run_command( node* n, command_runner runner )
+{
+    char** saved_docs = pending_docs;
+    char** argv = n->words;
+    int argc, status, n_saved_docs = n_pending_docs;
+
+    if ( n->n_words > 0 && find_function( n->words[0] ) != NULL &&
+         !has_operator( n->words + 1, n->n_words - 1 ) )
+        return run_call( n, runner );
+
+    if ( is_assignment( n ) )
+        return run_assignment( n );
+
+    if ( n->plain )
+    {
+        if ( ( argc = expand_argv( n, n->words, n->n_words ) ) <= 0 )
+            return ( argc < 0 ? 1 : 0 );
+
+        if ( find_function( n->argv[0] ) != NULL )
+            return call_function( n->argv, argc, runner );
+
+        if ( run_builtin( n, argc, &status ) )
+            return status;
+    }
+
+    /* expand_argv() has already worked out a plain command's $(( )) */
+    if ( n->n_arith > 0 && ( argv = arith_view( n, n->plain ) ) == NULL )
+        return 1;
+
+    /* put back after, as a $(cmd) in the words runs commands too */
+    pending_docs = n->here_docs;
+    n_pending_docs = n->n_here_docs;
+
+    status = runner( argv, n->n_words, n->n_pipes );
+
+    pending_docs = saved_docs;
+    n_pending_docs = n_saved_docs;
+
+    return status;
+} /* end run_command() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_call                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: a command whose first word names a function.    */
+/*          command_runner runner: runs simple commands.             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          expands the arguments as a command's words are, $(cmd),  */
+/*          $name, $@ and $(( )), then braces and patterns, and      */
+/*          calls the function with them. Arguments with no braces   */
+/*          or patterns are passed from the node's buffer, without   */
+/*          allocating.                                              */
+/*                                                                   */
+/*********************************************************************/
+static int run_call( node* n, command_runner runner )
+{
+    char** words = n->words;
+    char** copy = NULL;
+    char** args;
+    int n_words = n->n_words, argc, n_args, status = 1;
+
+    if ( n->plain && !needs_expansion( words, n_words ) )
+    {
+        if ( ( argc = expand_argv( n, words, n_words ) ) <= 0 )
+            return ( argc < 0 ? 1 : 0 );
+
+        return call_function( n->argv, argc, runner );
+    }
+
+    if ( has_substitution( words, n_words ) &&
+         ( words = copy = substitute_copy( n, 0, &n_words ) ) == NULL )
+        return 1;
+
+    if ( ( args = expand_args( n, words, n_words, &n_args ) ) != NULL )
+    {
+        status = call_function( args, n_args, runner );
+        free_copy( args, n_args );
+    }
+
+    free_copy( copy, n_words );
+    return status;
+} /* end run_call() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_simple                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char** words: a simple command.                          */
+/*          int n_words: how many words.                             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T for a command that could run in place, as a builtin    */
+/*          or a function: one with no pipes, redirections or        */
+/*          substitutions. name=value runs in place whatever its     */
+/*          value holds, see is_assignment().                        */
+/*                                                                   */
+/*********************************************************************/
+static int is_simple( char** words, int n_words )
+{
+    if ( n_words == 0 )
+        return F;
+
+    for ( int i = 0; i < n_words; i++ )
+        if ( strchr( "|<>&()`", words[i][0] ) != NULL &&
+             words[i][1] == '\0' )
+            return F;
+
+    return T;
+} /* end is_simple() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: has_empty_stage                               */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char** words: a simple command.                          */
+/*          int n_words: how many words.                             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T if a "|" outside $( ), <( ), >( ) and backticks starts */
+/*          or ends the command or follows another: "a |", "| b" or  */
+/*          "a | | b".                                               */
+/*                                                                   */
+/*********************************************************************/
+static int has_empty_stage( char** words, int n_words )
+{
+    int depth = 0, quoted = F, empty = T;
+
+    for ( int i = 0; i < n_words; i++ )
+    {
+        if ( strcmp( words[i], "`" ) == 0 )
+            quoted = !quoted;
+        else if ( strcmp( words[i], "(" ) == 0 ||
+                  strcmp( words[i], "<(" ) == 0 ||
+                  strcmp( words[i], ">(" ) == 0 )
+            depth++;
+        else if ( strcmp( words[i], ")" ) == 0 && depth > 0 )
+            depth--;
+        else if ( depth == 0 && !quoted && strcmp( words[i], "|" ) == 0 )
+        {
+            if ( empty )
+                return T;
+
+            empty = T;
+            continue;
+        }
+
+        empty = F;
+    }
+
+    return ( empty && n_words > 0 );
+} /* end has_empty_stage() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: has_operator                                  */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char** words: part of a simple command.                  */
+/*          int n_words: how many words.                             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T if a pipe, redirection or "&" is among the words,      */
+/*          outside $( ) and backticks.                              */
+/*                                                                   */
+/*********************************************************************/
+static int has_operator( char** words, int n_words )
+{
+    int depth = 0, quoted = F;
+
+    for ( int i = 0; i < n_words; i++ )
+    {
+        if ( strcmp( words[i], "`" ) == 0 )
+            quoted = !quoted;
+        else if ( strcmp( words[i], "(" ) == 0 )
+            depth++;
+        else if ( strcmp( words[i], ")" ) == 0 && depth > 0 )
+            depth--;
+        else if ( depth == 0 && !quoted &&
+                  strchr( "|<>&", words[i][0] ) != NULL )
+            return T;
+    }
+
+    return F;
+} /* end has_operator() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: needs_expansion                               */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char** words: a simple command.                          */
+/*          int n_words: how many words.                             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T if a word, other than a "$ name", has braces to        */
+/*          expand or a pattern to match.                            */
+/*                                                                   */
+/*********************************************************************/
+static int needs_expansion( char** words, int n_words )
+{
+    for ( int i = 0; i < n_words; i++ )
+    {
+        if ( strcmp( words[i], "$" ) == 0 )
+            i++;
+        else if ( has_braces( words[i] ) == SUCCESS ||
+                  ( OPTION( OPT_GLOB ) &&
+                    has_glob_meta( words[i] ) == SUCCESS ) )
+            return T;
+    }
+
+    return F;
+} /* end needs_expansion() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: expand_args                                   */
+/*      Return type:   static char**                                 */
+/*      Parameter(s):                                                */
+/*          node* n: the command the words belong to.                */
+/*          char** words: its words, $(cmd)s already substituted.    */
+/*          int n_words: how many words.                             */
+/*          int* count: set to the number of arguments.              */
+/*                                                                   */
+/*      Description:                                                 */
+/*          expands the words as a for loop's are, into a copy to    */
+/*          free with free_copy(). NULL if something failed.         */
+/*                                                                   */
+/*********************************************************************/
+static char** expand_args( node* n, char** words, int n_words, int* count )
+{
+    const char* word;
+    brace_gen* gen;
+    char** matches;
+    char** args = NULL;
+    char** params;
+    int n_args = 0, cap = 0, n_params, n_matches, ok = SUCCESS;
+
+    for ( int i = 0; i < n_words && ok == SUCCESS; i++ )
+    {
+        word = words[i];
+
+        if ( strcmp( word, "$" ) == 0 && i + 1 < n_words &&
+             strcmp( words[i + 1], "@" ) == 0 )
+        {
+            params = positional_args( &n_params );
+            i++;
+
+            for ( int a = 0; a < n_params && ok == SUCCESS; a++ )
+                ok = add_arg( &args, &n_args, &cap, params[a] );
+        }
+        else if ( strcmp( word, "$" ) == 0 && i + 1 < n_words )
+        {
+            if ( ( word = var_get( words[++i] ) ) != NULL )
+                ok = add_arg( &args, &n_args, &cap, word );
+        }
+        else if ( word[0] == ARITH_MARKER )
+        {
+            if ( ( word = arith_string( n->arith[atoi( word + 1 )] ) )
+                 == NULL )
+                ok = FAILURE;
+            else
+                ok = add_arg( &args, &n_args, &cap, word );
+        }
+        else if ( has_braces( word ) == SUCCESS &&
+                  ( gen = brace_compile( word ) ) != NULL )
+        {
+            while ( ok == SUCCESS && brace_next( gen, &word ) == SUCCESS )
+                ok = add_arg( &args, &n_args, &cap, word );
+
+            brace_free( gen );
+        }
+        else if ( OPTION( OPT_GLOB ) && has_glob_meta( word ) == SUCCESS &&
+                  expand_glob( word, &matches, &n_matches ) == SUCCESS &&
+                  n_matches > 0 )
+        {
+            for ( int m = 0; m < n_matches && ok == SUCCESS; m++ )
+                ok = add_arg( &args, &n_args, &cap, matches[m] );
+
+            free_matches( matches, n_matches );
+        }
+        else
+            ok = add_arg( &args, &n_args, &cap, word );
+    }
+
+    if ( ok == FAILURE || args == NULL )
+    {
+        free_copy( args, n_args );
+        return NULL;
+    }
+
+    *count = n_args;
+    return args;
+} /* end expand_args() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: add_arg                                       */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char*** args: the arguments so far, grown as needed.     */
+/*          int* n_args: how many there are.                         */
+/*          int* cap: how many args has room for.                    */
+/*          const char* word: copied onto the end.                   */
+/*                                                                   */
+/*********************************************************************/
+static int add_arg( char*** args, int* n_args, int* cap, const char* word )
+{
+    char** grown;
+
+    if ( *n_args + 1 >= *cap )
+    {
+        if ( ( grown = realloc( *args, ( *cap * 2 + 8 ) * sizeof(char*) ) )
+             == NULL )
+        {
+            fprintf( stderr, "Error: Out of memory expanding arguments.\n" );
+            return FAILURE;
+        }
+
+        *args = grown;
+        *cap = *cap * 2 + 8;
+    }
+
+    if ( ( (*args)[*n_args] = strdup( word ) ) == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory expanding arguments.\n" );
+        return FAILURE;
+    }
+
+    (*args)[++*n_args] = NULL;
+    return SUCCESS;
+} /* end add_arg() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: has_substitution                              */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char** words: words of a node.                           */
+/*          int n_words: how many.                                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T if there is a $(cmd) or `cmd` among them.              */
+/*                                                                   */
+/*********************************************************************/
+static int has_substitution( char** words, int n_words )
+{
+    for ( int i = 0; i < n_words; i++ )
+        if ( strcmp( words[i], "`" ) == 0 ||
+             ( strcmp( words[i], "$" ) == 0 && i + 1 < n_words &&
+               strcmp( words[i + 1], "(" ) == 0 ) )
+            return T;
+
+    return F;
+} /* end has_substitution() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: substitute_copy                               */
+/*      Return type:   static char**                                 */
+/*      Parameter(s):                                                */
+/*          node* n: the node whose words to copy.                   */
+/*          int from: the first word to copy.                        */
+/*          int* count: set to the number of words in the copy.      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          copies the words, each $(( )) evaluated, and has the     */
+/*          shell replace each $(cmd) and `cmd` with what it         */
+/*          prints. "$ name" pairs outside them are left for the     */
+/*          caller. Free the copy with free_copy(); NULL if          */
+/*          something failed.                                        */
+/*                                                                   */
+/*********************************************************************/
+static char** substitute_copy( node* n, int from, int* count )
+{
+    const char* word;
+    char** copy;
+    int n_copy = 0;
+
+    if ( ( copy = malloc( ( n->n_words - from + 1 ) * sizeof(char*) ) )
+         == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory expanding arguments.\n" );
+        return NULL;
+    }
+
+    for ( int i = from; i < n->n_words; i++ )
+    {
+        word = n->words[i];
+
+        if ( word[0] == ARITH_MARKER &&
+             ( word = arith_string( n->arith[atoi( word + 1 )] ) ) == NULL )
+            break;
+
+        if ( ( copy[n_copy] = strdup( word ) ) == NULL )
+            break;
+
+        n_copy++;
+    }
+
+    copy[n_copy] = NULL;
+
+    if ( n_copy < n->n_words - from ||
+         ( substituter != NULL &&
+           substituter( &copy, &n_copy ) == FAILURE ) )
+    {
+        free_copy( copy, n_copy );
+        return NULL;
+    }
+
+    *count = n_copy;
+    return copy;
+} /* end substitute_copy() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: free_copy                                     */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          char** copy: from substitute_copy(), may be NULL.        */
+/*          int count: how many words it has.                        */
+/*                                                                   */
+/*********************************************************************/
+static void free_copy( char** copy, int count )
+{
+    if ( copy == NULL )
+        return;
+
+    for ( int i = 0; i < count; i++ )
+        free( copy[i] );
+
+    free( copy );
+} /* end free_copy() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: join_words                                    */
+/*      Return type:   static char*                                  */
+/*      Parameter(s):                                                */
+/*          char** words: the words to join.                         */
+/*          int n_words: how many.                                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns them in one malloc'd string, separated by        */
+/*          spaces, or NULL if out of memory.                        */
+/*                                                                   */
+/*********************************************************************/
+static char* join_words( char** words, int n_words )
+{
+    size_t len = 1, at = 0;
+    char* joined;
+
+    for ( int i = 0; i < n_words; i++ )
+        len += strlen( words[i] ) + 1;
+
+    if ( ( joined = malloc( len ) ) == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory expanding arguments.\n" );
+        return NULL;
+    }
+
+    joined[0] = '\0';
+
+    for ( int i = 0; i < n_words; i++ )
+    {
+        if ( i > 0 )
+            joined[at++] = ' ';
+
+        strcpy( joined + at, words[i] );
+        at += strlen( words[i] );
+    }
+
+    return joined;
+} /* end join_words() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: expand_argv                                   */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: a simple command.                               */
+/*          char** words: its words, or a substitute_copy() of       */
+/*                        them.                                      */
+/*          int n_words: how many.                                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          points n->argv at the words, "$ name" pairs replaced by  */
+/*          the variable's value; an unset variable is dropped and   */
+/*          "$@" gives every positional parameter. $(( )) is         */
+/*          evaluated. Returns the number of words, -1 if an         */
+/*          expression failed.                                       */
+/*                                                                   */
+/*********************************************************************/
+static int expand_argv( node* n, char** words, int n_words )
+{
+    const char* value;
+    char** args;
+    int argc = 0, n_args;
+
+    /* the buffer only grows, so a loop stops allocating */
+    if ( grow_argv( n, n_words + 1 ) == FAILURE )
+        return -1;
+
+    for ( int i = 0; i < n_words; i++ )
+    {
+        if ( strcmp( words[i], "$" ) == 0 && i + 1 < n_words &&
+             strcmp( words[i + 1], "@" ) == 0 )
+        {
+            args = positional_args( &n_args );
+            i++;
+
+            if ( grow_argv( n, argc + n_args + n_words - i ) == FAILURE )
+                continue;
+
+            for ( int a = 0; a < n_args; a++ )
+                n->argv[argc++] = args[a];
+        }
+        else if ( strcmp( words[i], "$" ) == 0 && i + 1 < n_words )
+        {
+            if ( ( value = var_get( words[++i] ) ) != NULL )
+                n->argv[argc++] = (char*) value;
+        }
+        else if ( words[i][0] == ARITH_MARKER )
+        {
+            if ( ( value = arith_string( n->arith[atoi( words[i] + 1 )] ) )
+                 == NULL )
+                return -1;
+
+            n->argv[argc++] = (char*) value;
+        }
+        else
+            n->argv[argc++] = words[i];
+    }
+
+    n->argv[argc] = NULL;
+    return argc;
+} /* end expand_argv() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: arith_view                                    */
+/*      Return type:   static char**                                 */
+/*      Parameter(s):                                                */
+/*          node* n: a command with $(( )) in it.                    */
+/*          int done: T if they have been evaluated already.         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          points n->argv at the words with each $(( )) replaced    */
+/*          by its value, for the shell to expand the rest. NULL if  */
+/*          an expression failed.                                    */
+/*                                                                   */
+/*********************************************************************/
+static char** arith_view( node* n, int done )
+{
+    arith_prog* prog;
+
+    for ( int i = 0; i < n->n_words; i++ )
+    {
+        n->argv[i] = n->words[i];
+
+        if ( n->words[i][0] != ARITH_MARKER )
+            continue;
+
+        prog = n->arith[atoi( n->words[i] + 1 )];
+
+        if ( done )
+            n->argv[i] = prog->text;
+        else if ( ( n->argv[i] = (char*) arith_string( prog ) ) == NULL )
+            return NULL;
+    }
+
+    n->argv[n->n_words] = NULL;
+    return n->argv;
+} /* end arith_view() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: grow_argv                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: a simple command.                               */
+/*          int need: slots n->argv must have, its NULL included.    */
+/*                                                                   */
+/*********************************************************************/
+static int grow_argv( node* n, int need )
+{
+    char** grown;
+
+    if ( need <= n->argv_cap )
+        return SUCCESS;
+
+    if ( ( grown = realloc( n->argv, need * sizeof(char*) ) ) == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory expanding arguments.\n" );
+        return FAILURE;
+    }
+
+    n->argv = grown;
+    n->argv_cap = need;
+
+    return SUCCESS;
+} /* end grow_argv() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_builtin                                   */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: a simple command, expanded into n->argv.        */
+/*          int argc: words in n->argv.                              */
+/*          int* status: set to the builtin's exit status.           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          F if n is not a builtin, which the shell must run.       */
+/*                                                                   */
+/*********************************************************************/
+static int run_builtin( node* n, int argc, int* status )
+{
+    char** argv = n->argv;
+    const char* name = argv[0];
+    int count = ( argc > 1 ? atoi( argv[1] ) : -1 );
+
+    if ( strcmp( name, "true" ) == 0 || strcmp( name, ":" ) == 0 )
+        *status = 0;
+    else if ( strcmp( name, "false" ) == 0 )
+        *status = 1;
+    else if ( strcmp( name, "test" ) == 0 || strcmp( name, "[" ) == 0 )
+        *status = run_test( argv, argc );
+    else if ( strcmp( name, "local" ) == 0 )
+        *status = run_local( argv, argc );
+    else if ( strcmp( name, "shift" ) == 0 )
+        *status = ( shift_args( count >= 0 ? count : 1 ) == SUCCESS ? 0 : 1 );
+    else if ( strcmp( name, "exit" ) == 0 )
+        *status = set_flow( FLOW_EXIT, 0, count >= 0 ? count & 0xFF :
+                                                       last_status() );
+    else if ( strcmp( name, "return" ) == 0 )
+    {
+        if ( call_depth == 0 )
+        {
+            fprintf( stderr, "Error: return only works inside a function.\n" );
+            *status = 1;
+        }
+        else
+            *status = set_flow( FLOW_RETURN, 0, count >= 0 ? count & 0xFF :
+                                                             last_status() );
+    }
+    else if ( strcmp( name, "break" ) == 0 ||
+              strcmp( name, "continue" ) == 0 )
+    {
+        *status = 0;
+
+        if ( loop_depth == 0 )
+            fprintf( stderr, "Error: %s only works inside a loop.\n", name );
+        else
+        {
+            if ( count < 1 )
+                count = 1;
+
+            set_flow( name[0] == 'b' ? FLOW_BREAK : FLOW_CONTINUE,
+                      count > loop_depth ? loop_depth : count, 0 );
+        }
+    }
+    else
+        return F;
+
+    return T;
+} /* end run_builtin() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_assignment                                 */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: a simple command.                               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T for name = value, whatever words the value has, as     */
+/*          long as no pipe or redirection follows outside a $(cmd)  */
+/*          or `cmd`.                                                */
+/*                                                                   */
+/*********************************************************************/
+static int is_assignment( node* n )
+{
+    return ( n->n_words >= 2 && strcmp( n->words[1], "=" ) == 0 &&
+             is_var_name( n->words[0] ) &&
+             !has_operator( n->words + 2, n->n_words - 2 ) );
+} /* end is_assignment() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_assignment                                */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          node* n: name = value, as is_assignment() saw it.        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          sets name to the value's words, expanded as arguments    */
+/*          are and joined by spaces, but never matched against      */
+/*          paths: z = *.c keeps the pattern. A one word value is    */
+/*          set straight from the node's buffer, without allocating. */
+/*                                                                   */
+/*********************************************************************/
+static int run_assignment( node* n )
+{
+    char** words = n->words + 2;
+    char** copy = NULL;
+    char* joined = NULL;
+    int n_words = n->n_words - 2, argc, status = 1;
+
+    if ( has_substitution( words, n_words ) &&
+         ( words = copy = substitute_copy( n, 2, &n_words ) ) == NULL )
+        return 1;
+
+    if ( ( argc = expand_argv( n, words, n_words ) ) >= 0 &&
+         ( argc <= 1 || ( joined = join_words( n->argv, argc ) ) != NULL ) )
+        status = ( var_set( n->words[0], joined != NULL ? joined :
+                            argc == 1 ? n->argv[0] : "" ) == SUCCESS ? 0 : 1 );
+
+    free( joined );
+    free_copy( copy, n_words );
+
+    return status;
+} /* end run_assignment() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_local                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char** argv: "local name [= value] ...".                 */
+/*          int argc: number of words.                               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          hides each name until the function returns, setting it   */
+/*          if a value follows.                                      */
+/*                                                                   */
+/*********************************************************************/
+static int run_local( char** argv, int argc )
+{
+    int status = 0;
+
+    if ( call_depth == 0 )
+    {
+        fprintf( stderr, "Error: local only works inside a function.\n" );
+        return 1;
+    }
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( var_local( argv[i] ) == FAILURE )
+            status = 1;
+        else if ( i + 1 < argc && strcmp( argv[i + 1], "=" ) == 0 &&
+                  var_set( argv[i], i + 2 < argc ? argv[i + 2] : "" )
+                  == FAILURE )
+            status = 1;
+
+        if ( i + 1 < argc && strcmp( argv[i + 1], "=" ) == 0 )
+            i += 2;
+    }
+
+    return status;
+} /* end run_local() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: clone_tree                                    */
+/*      Return type:   static node*                                  */
+/*      Parameter(s):                                                */
+/*          node* tree: statements to copy, may be NULL.             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          a deep copy, or NULL if memory ran out.                  */
+/*                                                                   */
+/*********************************************************************/
+static node* clone_tree( node* tree )
+{
+    node *head = NULL, **tail = &head, *n;
+    int failed = F;
+
+    for ( ; tree != NULL && !failed; tree = tree->next )
+    {
+        if ( ( *tail = n = calloc( 1, sizeof(node) ) ) == NULL )
+        {
+            failed = T;
+            break;
+        }
+
+        tail = &n->next;
+        n->kind = tree->kind;
+        n->n_pipes = tree->n_pipes;
+        n->plain = tree->plain;
+
+        for ( int i = 0; i < tree->n_arith && !failed; i++ )
+            if ( add_arith( n, arith_compile( tree->arith[i]->source ) ) < 0 )
+                failed = T;
+
+        if ( tree->words != NULL &&
+             ( n->words = calloc( tree->n_words + 1, sizeof(char*) ) ) == NULL )
+            failed = T;
+
+        for ( ; !failed && n->n_words < tree->n_words; n->n_words++ )
+            if ( ( n->words[n->n_words] = strdup( tree->words[n->n_words] ) )
+                 == NULL )
+                failed = T;
+
+        if ( tree->here_docs != NULL &&
+             ( n->here_docs = calloc( tree->n_here_docs, sizeof(char*) ) )
+             == NULL )
+            failed = T;
+
+        for ( ; !failed && n->n_here_docs < tree->n_here_docs;
+              n->n_here_docs++ )
+            if ( ( n->here_docs[n->n_here_docs] =
+                   strdup( tree->here_docs[n->n_here_docs] ) ) == NULL )
+                failed = T;
+
+        if ( tree->argv != NULL && grow_argv( n, tree->argv_cap ) == FAILURE )
+            failed = T;
+
+        if ( tree->name != NULL && ( n->name = strdup( tree->name ) ) == NULL )
+            failed = T;
+
+        if ( ( tree->cond != NULL &&
+               ( n->cond = clone_tree( tree->cond ) ) == NULL ) ||
+             ( tree->body != NULL &&
+               ( n->body = clone_tree( tree->body ) ) == NULL ) ||
+             ( tree->orelse != NULL &&
+               ( n->orelse = clone_tree( tree->orelse ) ) == NULL ) )
+            failed = T;
+    }
+
+    if ( failed )
+    {
+        free_tree( head );
+        return NULL;
+    }
+
+    return head;
+} /* end clone_tree() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: define_function                               */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          node* n: a function definition.                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the function gets its own copy of the body, as the line  */
+/*          that defined it is freed once it has run. A body that    */
+/*          is replaced while a call may still be running it is      */
+/*          kept until the outermost call returns.                   */
+/*                                                                   */
+/*********************************************************************/
+static void define_function( node* n )
+{
+    function* fn = find_function( n->name );
+    function* grown;
+    node** more;
+    node* body;
+
+    if ( ( body = clone_tree( n->body ) ) == NULL && n->body != NULL )
+    {
+        fprintf( stderr, "Error: Out of memory defining %s.\n", n->name );
+        return;
+    }
+
+    if ( fn != NULL )
+    {
+        if ( call_depth == 0 )
+            free_tree( fn->body );
+        else if ( ( more = realloc( retired, ( n_retired + 1 ) *
+                                             sizeof(node*) ) ) != NULL )
+        {
+            retired = more;
+            retired[n_retired++] = fn->body;
+        }
+
+        fn->body = body;
+        return;
+    }
+
+    if ( n_functions == functions_cap )
+    {
+        if ( ( grown = realloc( functions, ( functions_cap + FUNCS_SIZE ) *
+                                           sizeof(function) ) ) == NULL )
+        {
+            fprintf( stderr, "Error: Out of memory defining %s.\n", n->name );
+            free_tree( body );
+            return;
+        }
+
+        functions = grown;
+        functions_cap += FUNCS_SIZE;
+    }
+
+    if ( ( functions[n_functions].name = strdup( n->name ) ) == NULL )
+    {
+        free_tree( body );
+        return;
+    }
+
+    functions[n_functions++].body = body;
+} /* end define_function() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: find_function                                 */
+/*      Return type:   static function*                              */
+/*      Parameter(s):                                                */
+/*          const char* name: command name.                          */
+/*                                                                   */
+/*********************************************************************/
+static function* find_function( const char* name )
+{
+    for ( int i = 0; i < n_functions; i++ )
+        if ( strcmp( functions[i].name, name ) == 0 )
+            return &functions[i];
+
+    return NULL;
+} /* end find_function() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: call_function                                 */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char** argv: the function's name and its arguments.      */
+/*          int argc: number of words.                               */
+/*          command_runner runner: runs simple commands.             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs the body in this process. The arguments are copied  */
+/*          into a buffer on the stack, as argv may point at         */
+/*          variables the body changes, and only a long list of      */
+/*          them is put on the heap. Loops outside the function      */
+/*          can't be broken from inside it.                          */
+/*                                                                   */
+/*********************************************************************/
+static int call_function( char** argv, int argc, command_runner runner )
+{
+    char* buffer[FRAME_ARGS_SIZE / sizeof(char*)];
+    char** args = buffer;
+    node* body = find_function( argv[0] )->body;
+    size_t size = argc * sizeof(char*), used;
+    int status, outer_loops = loop_depth;
+    var_frame frame;
+
+    if ( call_depth == FUNC_MAX_DEPTH )
+    {
+        fprintf( stderr, "Error: %s: functions nested over %d deep.\n",
+                 argv[0], FUNC_MAX_DEPTH );
+        return 1;
+    }
+
+    for ( int i = 1; i < argc; i++ )
+        size += strlen( argv[i] ) + 1;
+
+    if ( size > sizeof(buffer) && ( args = malloc( size ) ) == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory calling %s.\n", argv[0] );
+        return 1;
+    }
+
+    used = argc * sizeof(char*);
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        args[i - 1] = strcpy( (char*) args + used, argv[i] );
+        used += strlen( argv[i] ) + 1;
+    }
+
+    args[argc - 1] = NULL;
+    push_frame( &frame, args, argc - 1 );
+    call_depth++;
+    loop_depth = 0;
+
+    status = run_list( body, runner );
+
+    loop_depth = outer_loops;
+    call_depth--;
+    pop_frame();
+
+    if ( args != buffer )
+        free( args );
+
+    if ( unwinding == FLOW_RETURN )
+    {
+        unwinding = FLOW_NONE;
+        status = exit_status;
+    }
+
+    if ( call_depth == 0 )
+    {
+        for ( ; n_retired > 0; n_retired-- )
+            free_tree( retired[n_retired - 1] );
+    }
+
+    return status;
+} /* end call_function() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: set_flow                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          flow how: break, continue, return or exit.               */
+/*          int levels: loops it applies to.                         */
+/*          int status: status to return.                            */
+/*                                                                   */
+/*********************************************************************/
+static int set_flow( flow how, int levels, int status )
+{
+    unwinding = how;
+    unwind_levels = levels;
+
+    if ( how == FLOW_EXIT || how == FLOW_RETURN )
+        exit_status = status;
+
+    return status;
+} /* end set_flow() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: loop_stops                                    */
+/*      Return type:   static int                                    */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          called by a loop after its body or condition: T if it    */
+/*          must stop. A break or continue meant for this loop is    */
+/*          used up; one meant for an outer loop stops this one and  */
+/*          counts down.                                             */
+/*                                                                   */
+/*********************************************************************/
+static int loop_stops( void )
+{
+    int stop;
+
+    if ( unwinding == FLOW_NONE )
+        return F;
+
+    if ( unwinding == FLOW_EXIT || unwinding == FLOW_RETURN ||
+         --unwind_levels > 0 )
+        return T;
+
+    stop = ( unwinding == FLOW_BREAK );
+    unwinding = FLOW_NONE;
+
+    return stop;
+} /* end loop_stops() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_test                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char** argv: "test ..." or "[ ... ]".                    */
+/*          int argc: number of words.                               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          0 if the test holds, 1 if not, 2 if it can't be read.    */
+/*          The lexer splits "!=" and "==", so they are joined       */
+/*          again first.                                             */
+/*                                                                   */
+/*********************************************************************/
+static int run_test( char** argv, int argc )
+{
+    const char* args[TEST_MAX_ARGS];
+    int n = 0;
+
+    if ( strcmp( argv[0], "[" ) == 0 && strcmp( argv[--argc], "]" ) != 0 )
+    {
+        fprintf( stderr, "Error: Missing \"]\".\n" );
+        return STATUS_SYNTAX;
+    }
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( n == TEST_MAX_ARGS )
+        {
+            fprintf( stderr, "Error: Too many arguments to test.\n" );
+            return STATUS_SYNTAX;
+        }
+
+        if ( ( strcmp( argv[i], "!" ) == 0 || strcmp( argv[i], "=" ) == 0 )
+             && i + 1 < argc && strcmp( argv[i + 1], "=" ) == 0 && n > 0 )
+        {
+            args[n++] = ( argv[i][0] == '!' ? "!=" : "=" );
+            i++;
+        }
+        else
+            args[n++] = argv[i];
+    }
+
+    return eval_test( args, n );
+} /* end run_test() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: eval_test                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char** args: the test, without "test" or "[ ]".    */
+/*          int n: how many words.                                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          "! test", "string", "-n s", "-z s", "-e/-f/-d/-r/-w/-x/  */
+/*          -s/-L path", "a = b", "a != b" and "a -eq/-ne/-lt/-le/   */
+/*          -gt/-ge b".                                              */
+/*                                                                   */
+/*********************************************************************/
+static int eval_test( const char** args, int n )
+{
+    struct stat st;
+    long long a, b;
+    const char* op;
+    int status;
+
+    if ( n >= 2 && strcmp( args[0], "!" ) == 0 )
+    {
+        status = eval_test( args + 1, n - 1 );
+        return ( status == STATUS_SYNTAX ? status : !status );
+    }
+
+    if ( n == 0 )
+        return 1;
+
+    if ( n == 1 )
+        return ( args[0][0] != '\0' ? 0 : 1 );
+
+    if ( n == 2 )
+    {
+        op = args[0];
+
+        if ( strcmp( op, "-n" ) == 0 )
+            return ( args[1][0] != '\0' ? 0 : 1 );
+        if ( strcmp( op, "-z" ) == 0 )
+            return ( args[1][0] == '\0' ? 0 : 1 );
+        if ( strcmp( op, "-r" ) == 0 )
+            return ( access( args[1], R_OK ) == 0 ? 0 : 1 );
+        if ( strcmp( op, "-w" ) == 0 )
+            return ( access( args[1], W_OK ) == 0 ? 0 : 1 );
+        if ( strcmp( op, "-x" ) == 0 )
+            return ( access( args[1], X_OK ) == 0 ? 0 : 1 );
+        if ( strcmp( op, "-L" ) == 0 || strcmp( op, "-h" ) == 0 )
+            return ( lstat( args[1], &st ) == 0 && S_ISLNK( st.st_mode ) ?
+                     0 : 1 );
+
+        if ( strlen( op ) == 2 && op[0] == '-' && strchr( "efds", op[1] ) )
+        {
+            if ( stat( args[1], &st ) != 0 )
+                return 1;
+
+            return ( op[1] == 'e' || ( op[1] == 'f' && S_ISREG( st.st_mode ) )
+                     || ( op[1] == 'd' && S_ISDIR( st.st_mode ) ) ||
+                     ( op[1] == 's' && st.st_size > 0 ) ? 0 : 1 );
+        }
+    }
+    else if ( n == 3 )
+    {
+        op = args[1];
+
+        if ( strcmp( op, "=" ) == 0 )
+            return ( strcmp( args[0], args[2] ) == 0 ? 0 : 1 );
+        if ( strcmp( op, "!=" ) == 0 )
+            return ( strcmp( args[0], args[2] ) != 0 ? 0 : 1 );
+
+        if ( op[0] == '-' && strlen( op ) == 3 )
+        {
+            if ( !test_number( args[0], &a ) || !test_number( args[2], &b ) )
+                return STATUS_SYNTAX;
+
+            if ( strcmp( op, "-eq" ) == 0 ) return ( a == b ? 0 : 1 );
+            if ( strcmp( op, "-ne" ) == 0 ) return ( a != b ? 0 : 1 );
+            if ( strcmp( op, "-lt" ) == 0 ) return ( a < b ? 0 : 1 );
+            if ( strcmp( op, "-le" ) == 0 ) return ( a <= b ? 0 : 1 );
+            if ( strcmp( op, "-gt" ) == 0 ) return ( a > b ? 0 : 1 );
+            if ( strcmp( op, "-ge" ) == 0 ) return ( a >= b ? 0 : 1 );
+        }
+    }
+
+    fprintf( stderr, "Error: test: cannot read \"%s\".\n", args[0] );
+    return STATUS_SYNTAX;
+} /* end eval_test() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: test_number                                   */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* text: an operand of -eq and the like.        */
+/*          long long* value: set to its value.                      */
+/*                                                                   */
+/*********************************************************************/
+static int test_number( const char* text, long long* value )
+{
+    char* end;
+
+    *value = strtoll( text, &end, 10 );
+
+    if ( end == text || *end != '\0' )
+    {
+        fprintf( stderr, "Error: test: %s is not a number.\n", text );
+        return F;
+    }
+
+    return T;
+} /* end test_number() */
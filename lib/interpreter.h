@@ -0,0 +1,158 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: interpreter.h                               */
+/*          Description:                                             */
+/*              This module parses a line, and the lines an open     */
+/*              if, while, until, for or case needs after it, into   */
+/*              a tree that is then walked. Loop bodies are parsed   */
+/*              once however often they run. Simple commands are     */
+/*              handed back to the shell to expand and spawn, apart  */
+/*              from true, false, :, test, [, break, continue, exit  */
+/*              and name=value, which run in place from a buffer     */
+/*              kept on their node, so they never allocate.          */
+/*              "name() { list }" keeps a copy of the list's tree,   */
+/*              and calling name runs it in this process, with its   */
+/*              arguments as $1..$N and its locals in a frame on     */
+/*              the C stack. $(( )) and (( )) are compiled when      */
+/*              the line is parsed, not each time they run, and      */
+/*              here-document bodies are read with the line that     */
+/*              opens them, so one inside a loop is read only once.  */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fnmatch.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "./string_module.h"
+#include "./variables.h"
+#include "./brace_expand.h"
+#include "./glob_engine.h"
+#include "./arith.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define TOKENS_SIZE 64
+#define STATUS_SYNTAX 2
+#define TEST_MAX_ARGS 16
+#define FUNCS_SIZE 16
+#define FUNC_MAX_DEPTH 1000
+#define FRAME_ARGS_SIZE 512
+#define ARITH_WORD_SIZE 16
+
+/* what a node of the tree is */
+typedef enum node_kind_t
+{
+    NODE_CMD,           /* words, as parse_string() split them */
+    NODE_IF,            /* cond, body, orelse (an elif is a nested if) */
+    NODE_WHILE,         /* cond, body */
+    NODE_UNTIL,         /* cond, body */
+    NODE_FOR,           /* name, words, body */
+    NODE_CASE,          /* words[0] is the subject, arms are body */
+    NODE_ARM,           /* words are the patterns, cond the commands */
+    NODE_FUNC,          /* name, body: name() { body } */
+    NODE_ARITH          /* (( expression )), compiled in arith[0] */
+} node_kind;
+
+/* one node; statements in a list are chained through next */
+typedef struct node_t
+{
+    node_kind       kind;
+    char**          words;
+    int             n_words;
+    int             n_pipes;
+    char**          argv;
+    int             argv_cap;
+    int             plain;
+    arith_prog**    arith;
+    int             n_arith;
+    char**          here_docs;
+    int             n_here_docs;
+    char*           name;
+    struct node_t*  cond;
+    struct node_t*  body;
+    struct node_t*  orelse;
+    struct node_t*  next;
+} node;
+
+/* how a loop or the whole line is being left */
+typedef enum flow_t
+{
+    FLOW_NONE,
+    FLOW_BREAK,
+    FLOW_CONTINUE,
+    FLOW_RETURN,
+    FLOW_EXIT
+} flow;
+
+/* hands out the words of the next line, FAILURE at end of input */
+typedef int (*line_source)( char*** words, int* n_words );
+
+/* runs one simple command and returns its exit status */
+typedef int (*command_runner)( char** words, int n_words, int n_pipes );
+
+/* puts what each $(cmd) and `cmd` prints in their place, in an array
+   of malloc'd words the shell may grow; FAILURE if one could not run */
+typedef int (*word_substituter)( char*** words, int* n_words );
+
+/* reads one line of raw input, malloc'd, NULL at end of input */
+typedef char* (*text_source)( const char* prompt );
+
+/* a shell function, with its own copy of the body */
+typedef struct function_t
+{
+    char*           name;
+    node*           body;
+} function;
+
+/* the tokens being parsed, more lines appended as needed */
+typedef struct parser_t
+{
+    char**          toks;
+    int             n_toks;
+    int             cap;
+    int             pos;
+    line_source     more;
+    int             error;
+    int             depth;
+} parser;
+
+/* one shell's functions, and how its tree is being left */
+typedef struct interp_state_t
+{
+    flow            unwinding;
+    int             unwind_levels;
+    int             exit_status;
+    int             loop_depth;
+    function*       functions;
+    int             n_functions;
+    int             functions_cap;
+    node**          retired;
+    int             n_retired;
+    int             call_depth;
+    word_substituter substituter;
+    text_source     reader;
+    char**          pending_docs;
+    int             n_pending_docs;
+} interp_state;
+
+/* function prototypes */
+node*   parse_line( char** words, int n_words, line_source more );
+int     run_tree( node* tree, command_runner runner );
+int     is_compound( const node* tree );
+flow    interp_flow( int* status );
+void    free_tree( node* tree );
+void    free_functions( void );
+void    set_substituter( word_substituter fn );
+void    set_text_source( text_source fn );
+const char* here_doc_text( int k );
+
+#endif
@@ -0,0 +1,600 @@
+#include "job_mux.h"
+
+/* globals, slots with a job_id of 0 are free */
+static mux_stream       streams[MUX_MAX_STREAMS];
+static int              n_open = 0;
+static int              epoll_fd = -1;
+static pid_t            mux_pid = 0;
+static pthread_mutex_t  mux_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   mux_closed = PTHREAD_COND_INITIALIZER;
+
+/* only the loop's thread touches these */
+static mux_batch        batches[2];
+static char             data[MUX_READ_SIZE];
+
+/* local prototypes */
+static int      start_mux( void );
+static void*    mux_loop( void* );
+static int      add_stream( int, int, int );
+static int      read_stream( mux_stream* );
+static void     add_lines( mux_stream*, const char*, size_t );
+static void     add_line( mux_stream*, const char*, size_t );
+static int      reserve( mux_batch*, size_t );
+static void     flush_batch( mux_batch*, int );
+static void     close_stream( mux_stream* );
+static int      count_streams( int );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: open_job_pipes                                */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          job_pipes* pipes: filled in with the job's stdout and    */
+/*                            stderr pipes.                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          makes the pipes for a job about to start, sized like     */
+/*          pipeline pipes. Returns FAILURE, and the job should      */
+/*          write to the terminal as usual, if they can't be made    */
+/*          or the loop can't take two more streams.                 */
+/*                                                                   */
+/*********************************************************************/
+int open_job_pipes( job_pipes* pipes )
+{
+    int full;
+
+    if ( start_mux() == FAILURE )
+        return FAILURE;
+
+    pthread_mutex_lock( &mux_lock );
+    full = ( n_open + 2 > MUX_MAX_STREAMS );
+    pthread_mutex_unlock( &mux_lock );
+
+    if ( full || pipe2( pipes->out, O_CLOEXEC ) == -1 )
+        return FAILURE;
+
+    if ( pipe2( pipes->err, O_CLOEXEC ) == -1 )
+    {
+        close( pipes->out[READ_END] );
+        close( pipes->out[WRITE_END] );
+        return FAILURE;
+    }
+
+    /* the loop reads whatever is there, the job blocks as usual */
+    fcntl( pipes->out[READ_END], F_SETFL, O_NONBLOCK );
+    fcntl( pipes->err[READ_END], F_SETFL, O_NONBLOCK );
+    size_pipe( pipes->out[WRITE_END] );
+    size_pipe( pipes->err[WRITE_END] );
+
+    return SUCCESS;
+} /* end open_job_pipes() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: close_job_writers                             */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          job_pipes* pipes: pipes of a job that has been forked.   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          closes the shell's write ends, so the loop sees the end  */
+/*          of the output when the job's last writer exits.          */
+/*                                                                   */
+/*********************************************************************/
+void close_job_writers( job_pipes* pipes )
+{
+    close( pipes->out[WRITE_END] );
+    close( pipes->err[WRITE_END] );
+    pipes->out[WRITE_END] = -1;
+    pipes->err[WRITE_END] = -1;
+} /* end close_job_writers() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: mux_job_output                                */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int job_id: the job's id, 0 if it didn't start.          */
+/*          job_pipes* pipes: its pipes, write ends closed.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          hands the read ends to the loop, or closes them when     */
+/*          there is no job. Returns FAILURE if they were closed.    */
+/*                                                                   */
+/*********************************************************************/
+int mux_job_output( int job_id, job_pipes* pipes )
+{
+    int status = FAILURE;
+
+    if ( job_id != 0 &&
+         add_stream( pipes->out[READ_END], job_id, F ) == SUCCESS )
+        status = SUCCESS;
+    else
+        close( pipes->out[READ_END] );
+
+    if ( job_id != 0 &&
+         add_stream( pipes->err[READ_END], job_id, T ) == SUCCESS )
+        return status;
+
+    close( pipes->err[READ_END] );
+    return FAILURE;
+} /* end mux_job_output() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: wait_job_output                               */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          int job_id: job whose output to wait for, 0 for all.     */
+/*                                                                   */
+/*      Description:                                                 */
+/*          called once the job has exited, so its last lines come   */
+/*          out before the prompt. Gives up after MUX_SETTLE_MS, as  */
+/*          something the job left running may hold its pipes.       */
+/*                                                                   */
+/*********************************************************************/
+void wait_job_output( int job_id )
+{
+    struct timespec deadline;
+
+    if ( mux_pid != getpid() )
+        return;
+
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_sec += MUX_SETTLE_MS / 1000;
+    deadline.tv_nsec += ( MUX_SETTLE_MS % 1000 ) * 1000000L;
+
+    if ( deadline.tv_nsec >= 1000000000L )
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock( &mux_lock );
+
+    while ( count_streams( job_id ) > 0 )
+        if ( pthread_cond_timedwait( &mux_closed, &mux_lock, &deadline )
+             == ETIMEDOUT )
+            break;
+
+    pthread_mutex_unlock( &mux_lock );
+} /* end wait_job_output() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: reset_job_mux                                 */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          called in a forked copy of the shell, which has no loop  */
+/*          thread. It drops its copies of the pipes and starts its  */
+/*          own loop if it runs jobs of its own.                     */
+/*                                                                   */
+/*********************************************************************/
+void reset_job_mux( void )
+{
+    if ( mux_pid == 0 )
+        return;
+
+    /* the thread may have held these when the fork happened */
+    pthread_mutex_init( &mux_lock, NULL );
+    pthread_cond_init( &mux_closed, NULL );
+
+    close( epoll_fd );
+    epoll_fd = -1;
+
+    for ( int i = 0; i < MUX_MAX_STREAMS; i++ )
+    {
+        if ( streams[i].job_id != 0 )
+            close( streams[i].fd );
+
+        free( streams[i].partial );
+        memset( &streams[i], 0, sizeof(mux_stream) );
+    }
+
+    for ( int i = 0; i < 2; i++ )
+    {
+        free( batches[i].buf );
+        memset( &batches[i], 0, sizeof(mux_batch) );
+    }
+
+    n_open = 0;
+    mux_pid = 0;
+} /* end reset_job_mux() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: start_mux                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          starts the loop's thread the first time a job needs it.  */
+/*          The thread blocks every signal, so SIGCHLD still only    */
+/*          reaches the supervisor's signalfd and ctrl-c the shell.  */
+/*                                                                   */
+/*********************************************************************/
+static int start_mux( void )
+{
+    sigset_t all, saved;
+    pthread_t thread;
+    int started;
+
+    if ( mux_pid == getpid() )
+        return SUCCESS;
+
+    if ( ( epoll_fd = epoll_create1( EPOLL_CLOEXEC ) ) == -1 )
+        return FAILURE;
+
+    sigfillset( &all );
+    pthread_sigmask( SIG_BLOCK, &all, &saved );
+    started = ( pthread_create( &thread, NULL, mux_loop, NULL ) == 0 );
+    pthread_sigmask( SIG_SETMASK, &saved, NULL );
+
+    if ( !started )
+    {
+        close( epoll_fd );
+        epoll_fd = -1;
+        return FAILURE;
+    }
+
+    pthread_detach( thread );
+    mux_pid = getpid();
+
+    return SUCCESS;
+} /* end start_mux() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: mux_loop                                      */
+/*      Return type:   static void*                                  */
+/*      Parameter(s):                                                */
+/*          void* arg: unused.                                       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the loop's thread. Everything read in one wakeup is      */
+/*          written with one write() per destination, and streams    */
+/*          that ended are only let go after that, so a waiter       */
+/*          never returns ahead of a job's last lines.               */
+/*                                                                   */
+/*********************************************************************/
+static void* mux_loop( void* arg )
+{
+    struct epoll_event events[MUX_MAX_EVENTS];
+    mux_stream* ended[MUX_MAX_EVENTS];
+    int n, n_ended;
+
+    while ( 1 )
+    {
+        if ( ( n = epoll_wait( epoll_fd, events, MUX_MAX_EVENTS, -1 ) )
+             == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+            return NULL;
+        }
+
+        n_ended = 0;
+
+        for ( int i = 0; i < n; i++ )
+            if ( read_stream( &streams[events[i].data.u32] ) == FAILURE )
+                ended[n_ended++] = &streams[events[i].data.u32];
+
+        flush_batch( &batches[F], STDOUT_FILENO );
+        flush_batch( &batches[T], STDERR_FILENO );
+
+        for ( int i = 0; i < n_ended; i++ )
+            close_stream( ended[i] );
+    }
+} /* end mux_loop() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: add_stream                                    */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          int fd: read end of a job's pipe.                        */
+/*          int job_id: the job.                                     */
+/*          int err: T if it is the job's stderr.                    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          puts fd in a free slot and in the loop. Returns FAILURE  */
+/*          if there is no room.                                     */
+/*                                                                   */
+/*********************************************************************/
+static int add_stream( int fd, int job_id, int err )
+{
+    struct epoll_event ev;
+    int slot = -1;
+
+    pthread_mutex_lock( &mux_lock );
+
+    for ( int i = 0; i < MUX_MAX_STREAMS && slot == -1; i++ )
+        if ( streams[i].job_id == 0 )
+            slot = i;
+
+    if ( slot != -1 )
+    {
+        streams[slot].fd = fd;
+        streams[slot].job_id = job_id;
+        streams[slot].err = err;
+        streams[slot].prefix_len = (size_t) snprintf( streams[slot].prefix,
+                                     MUX_PREFIX_SIZE, "[%d] ", job_id );
+        n_open++;
+    }
+
+    pthread_mutex_unlock( &mux_lock );
+
+    if ( slot == -1 )
+        return FAILURE;
+
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint32_t) slot;
+
+    if ( epoll_ctl( epoll_fd, EPOLL_CTL_ADD, fd, &ev ) == -1 )
+    {
+        pthread_mutex_lock( &mux_lock );
+        streams[slot].job_id = 0;
+        n_open--;
+        pthread_mutex_unlock( &mux_lock );
+        return FAILURE;
+    }
+
+    return SUCCESS;
+} /* end add_stream() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: read_stream                                   */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          mux_stream* s: a stream the loop says is ready.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          adds the complete lines that came in to the batch.       */
+/*          Returns FAILURE at the end of the stream, when a last    */
+/*          line without a newline is added as if it had one.        */
+/*                                                                   */
+/*********************************************************************/
+static int read_stream( mux_stream* s )
+{
+    ssize_t n = read( s->fd, data, sizeof(data) );
+
+    if ( n > 0 )
+    {
+        add_lines( s, data, (size_t) n );
+        return SUCCESS;
+    }
+
+    if ( n == -1 && ( errno == EAGAIN || errno == EINTR ) )
+        return SUCCESS;
+
+    if ( s->len > 0 && reserve( &batches[s->err ? T : F],
+                                s->prefix_len + s->len + 1 ) == SUCCESS )
+        add_line( s, "", 0 );
+
+    return FAILURE;
+} /* end read_stream() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: add_lines                                     */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          mux_stream* s: where the bytes came from.                */
+/*          const char* text: the bytes.                             */
+/*          size_t n: how many.                                      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          an unfinished last line is kept for the next read, up    */
+/*          to MUX_LINE_MAX; a longer one goes out in pieces. Room   */
+/*          for every line text could hold is made first, so the     */
+/*          lines are copied without checks.                         */
+/*                                                                   */
+/*********************************************************************/
+static void add_lines( mux_stream* s, const char* text, size_t n )
+{
+    const char* end;
+    char* grown;
+    size_t cap;
+
+    if ( reserve( &batches[s->err ? T : F],
+                  s->len + n + ( n + 1 ) * ( s->prefix_len + 1 ) )
+         == FAILURE )
+        return;
+
+    while ( ( end = memchr( text, '\n', n ) ) != NULL )
+    {
+        add_line( s, text, (size_t) ( end - text ) );
+        n -= (size_t) ( end - text ) + 1;
+        text = end + 1;
+    }
+
+    if ( n == 0 )
+        return;
+
+    if ( s->len + n > s->cap && s->len + n <= MUX_LINE_MAX )
+    {
+        for ( cap = ( s->cap == 0 ? 256 : s->cap ); cap < s->len + n; )
+            cap *= 2;
+
+        if ( ( grown = realloc( s->partial, cap ) ) != NULL )
+        {
+            s->partial = grown;
+            s->cap = cap;
+        }
+    }
+
+    if ( s->len + n > s->cap )
+    {
+        add_line( s, text, n );
+        return;
+    }
+
+    memcpy( s->partial + s->len, text, n );
+    s->len += n;
+} /* end add_lines() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: add_line                                      */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          mux_stream* s: where the line came from.                 */
+/*          const char* text: the end of the line, after what s      */
+/*                            kept from earlier reads.               */
+/*          size_t n: its length, without the newline.               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the caller has made room with reserve().                 */
+/*                                                                   */
+/*********************************************************************/
+static void add_line( mux_stream* s, const char* text, size_t n )
+{
+    mux_batch* batch = &batches[s->err ? T : F];
+    char* pos = batch->buf + batch->len;
+
+    memcpy( pos, s->prefix, s->prefix_len );
+    pos += s->prefix_len;
+    memcpy( pos, s->partial, s->len );
+    pos += s->len;
+    memcpy( pos, text, n );
+    pos[n] = '\n';
+
+    batch->len += s->prefix_len + s->len + n + 1;
+    s->len = 0;
+} /* end add_line() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: reserve                                       */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          mux_batch* batch: output about to be added to.           */
+/*          size_t n: most bytes that will be added.                 */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns FAILURE if memory ran out, and the bytes are     */
+/*          dropped.                                                 */
+/*                                                                   */
+/*********************************************************************/
+static int reserve( mux_batch* batch, size_t n )
+{
+    char* grown;
+    size_t cap;
+
+    if ( batch->len + n <= batch->cap )
+        return SUCCESS;
+
+    for ( cap = ( batch->cap == 0 ? MUX_READ_SIZE : batch->cap );
+          cap < batch->len + n; )
+        cap *= 2;
+
+    if ( ( grown = realloc( batch->buf, cap ) ) == NULL )
+        return FAILURE;
+
+    batch->buf = grown;
+    batch->cap = cap;
+
+    return SUCCESS;
+} /* end reserve() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: flush_batch                                   */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          mux_batch* batch: whole lines to write.                  */
+/*          int fd: where to.                                        */
+/*                                                                   */
+/*********************************************************************/
+static void flush_batch( mux_batch* batch, int fd )
+{
+    size_t done = 0;
+    ssize_t n;
+
+    while ( done < batch->len )
+    {
+        n = write( fd, batch->buf + done, batch->len - done );
+
+        if ( n == -1 && errno == EINTR )
+            continue;
+
+        if ( n <= 0 )
+            break;
+
+        done += (size_t) n;
+    }
+
+    batch->len = 0;
+} /* end flush_batch() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: close_stream                                  */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          mux_stream* s: a stream that has ended.                  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          takes s out of the loop first, since forked subshells    */
+/*          may still have a copy of the descriptor, then frees the  */
+/*          slot and wakes wait_job_output().                        */
+/*                                                                   */
+/*********************************************************************/
+static void close_stream( mux_stream* s )
+{
+    epoll_ctl( epoll_fd, EPOLL_CTL_DEL, s->fd, NULL );
+    close( s->fd );
+
+    free( s->partial );
+    s->partial = NULL;
+    s->len = 0;
+    s->cap = 0;
+
+    pthread_mutex_lock( &mux_lock );
+    s->job_id = 0;
+    n_open--;
+    pthread_cond_broadcast( &mux_closed );
+    pthread_mutex_unlock( &mux_lock );
+} /* end close_stream() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: count_streams                                 */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          int job_id: job to count, 0 for all.                     */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns how many of its streams are open. The caller     */
+/*          holds mux_lock.                                          */
+/*                                                                   */
+/*********************************************************************/
+static int count_streams( int job_id )
+{
+    int count = 0;
+
+    for ( int i = 0; i < MUX_MAX_STREAMS; i++ )
+        if ( streams[i].job_id != 0 &&
+             ( job_id == 0 || streams[i].job_id == job_id ) )
+            count++;
+
+    return count;
+} /* end count_streams() */
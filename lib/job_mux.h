@@ -0,0 +1,80 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: job_mux.h                                   */
+/*          Description:                                             */
+/*              This module provides "set -o jobmux". Background     */
+/*              jobs then write to pipes the shell owns instead of   */
+/*              the terminal. A thread running an epoll loop reads   */
+/*              them, puts complete lines together and writes them   */
+/*              out as "[job-id] line", every line that came in      */
+/*              together going out in one write(), so jobs never     */
+/*              split each other's lines.                            */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef JOB_MUX_H
+#define JOB_MUX_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include "./string_module.h"
+#include "./execution.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define MUX_MAX_STREAMS 128
+#define MUX_MAX_EVENTS 32
+#define MUX_READ_SIZE 65536
+#define MUX_LINE_MAX 65536
+#define MUX_PREFIX_SIZE 16
+#define MUX_SETTLE_MS 500
+
+/* one job's stdout or stderr */
+typedef struct mux_stream_t
+{
+    int     fd;
+    int     job_id;
+    int     err;
+    char    prefix[MUX_PREFIX_SIZE];
+    size_t  prefix_len;
+    char*   partial;
+    size_t  len;
+    size_t  cap;
+} mux_stream;
+
+/* output waiting to be written, one per destination */
+typedef struct mux_batch_t
+{
+    char*   buf;
+    size_t  len;
+    size_t  cap;
+} mux_batch;
+
+/* a job's pipes while it is being started */
+typedef struct job_pipes_t
+{
+    int     out[2];
+    int     err[2];
+} job_pipes;
+
+/* function prototypes */
+int     open_job_pipes( job_pipes* pipes );
+void    close_job_writers( job_pipes* pipes );
+int     mux_job_output( int job_id, job_pipes* pipes );
+void    wait_job_output( int job_id );
+void    reset_job_mux( void );
+
+#endif
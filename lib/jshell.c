@@ -0,0 +1,165 @@
+#include "jshell.h"
+
+/* the shell of threads that have not picked one, the program's own */
+static jshell_ctx   default_ctx = { .variables = { .status_text = "0" } };
+
+__thread jshell_ctx* jshell = &default_ctx;
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: jshell_new                                    */
+/*      Return type:   jshell_ctx*                                   */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns a shell with no variables, functions, aliases    */
+/*          or history, or NULL if memory ran out.                   */
+/*                                                                   */
+/*********************************************************************/
+jshell_ctx* jshell_new( void )
+{
+    jshell_ctx* ctx = calloc( 1, sizeof(jshell_ctx) );
+
+    if ( ctx == NULL )
+        return NULL;
+
+    strcpy( ctx->variables.status_text, "0" );
+    ctx->interp.unwinding = FLOW_NONE;
+
+    return ctx;
+} /* end jshell_new() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: jshell_free                                   */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          jshell_ctx* ctx: shell to free, from jshell_new().       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          frees everything ctx holds, and ctx. A thread using it   */
+/*          goes back to the default shell.                          */
+/*                                                                   */
+/*********************************************************************/
+void jshell_free( jshell_ctx* ctx )
+{
+    jshell_ctx* outer = jshell_use( ctx );
+
+    free_functions();
+    free_vars();
+    free_aliases();
+    free_history();
+
+    for ( int i = 0; i < ctx->n_cmds; i++ )
+        free( ctx->cmds[i] );
+
+    free( ctx->cmds );
+    ctx->cmds = NULL;
+    ctx->n_cmds = 0;
+
+    jshell_use( outer == ctx ? NULL : outer );
+
+    if ( ctx != &default_ctx )
+        free( ctx );
+} /* end jshell_free() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: jshell_use                                    */
+/*      Return type:   jshell_ctx*                                   */
+/*      Parameter(s):                                                */
+/*          jshell_ctx* ctx: shell for this thread, NULL for the     */
+/*                           default one.                            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          makes ctx the calling thread's shell and returns the     */
+/*          one it had, to be put back. A shell must only be used    */
+/*          by one thread at a time.                                 */
+/*                                                                   */
+/*********************************************************************/
+jshell_ctx* jshell_use( jshell_ctx* ctx )
+{
+    jshell_ctx* outer = jshell;
+
+    jshell = ( ctx != NULL ? ctx : &default_ctx );
+    return outer;
+} /* end jshell_use() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: jshell_parse                                  */
+/*      Return type:   node*                                         */
+/*      Parameter(s):                                                */
+/*          jshell_ctx* ctx: shell to parse for.                     */
+/*          const char* line: one line of input.                     */
+/*          line_source more: gives the lines a construct left open  */
+/*                            needs, may be NULL.                    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          splits and parses line into a tree for jshell_run() or   */
+/*          run_tree(), NULL if there is nothing to run or it had a  */
+/*          syntax error.                                            */
+/*                                                                   */
+/*********************************************************************/
+node* jshell_parse( jshell_ctx* ctx, const char* line, line_source more )
+{
+    jshell_ctx* outer = jshell_use( ctx );
+    char** words = NULL;
+    int n_words = 0, n_pipes = 0;
+    char* copy = strdup( line );
+    node* tree = NULL;
+
+    if ( copy != NULL )
+    {
+        parse_string( copy, &words, &n_words, &n_pipes );
+        tree = parse_line( words, n_words, more );
+    }
+
+    for ( int i = 0; i < n_words; i++ )
+        free( words[i] );
+
+    free( words );
+    free( copy );
+    jshell_use( outer );
+
+    return tree;
+} /* end jshell_parse() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: jshell_run                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          jshell_ctx* ctx: shell to run the line in.               */
+/*          const char* line: one complete line.                     */
+/*          command_runner runner: runs the simple commands that     */
+/*                                 are not builtins or functions.    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          parses and runs line, returning its status. An exit in   */
+/*          it stops the line, and its status is the one returned.   */
+/*                                                                   */
+/*********************************************************************/
+int jshell_run( jshell_ctx* ctx, const char* line, command_runner runner )
+{
+    jshell_ctx* outer = jshell_use( ctx );
+    node* tree = jshell_parse( ctx, line, NULL );
+    int status = last_status(), exit_status;
+
+    if ( tree != NULL )
+        status = run_tree( tree, runner );
+
+    if ( interp_flow( &exit_status ) == FLOW_EXIT )
+        status = exit_status;
+
+    set_last_status( status );
+    free_tree( tree );
+    jshell_use( outer );
+
+    return status;
+} /* end jshell_run() */
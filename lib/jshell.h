@@ -0,0 +1,55 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: jshell.h                                    */
+/*          Description:                                             */
+/*              This module is the shell as a library. A jshell_ctx  */
+/*              holds what one shell has: the words of the line it   */
+/*              is running, its variables, functions, aliases and    */
+/*              history. Each thread has a current context, which    */
+/*              the other modules keep their state in, so separate   */
+/*              threads can run separate shells. A thread that has   */
+/*              not called jshell_use() shares the default one.      */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef JSHELL_H
+#define JSHELL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./string_module.h"
+#include "./alias.h"
+#include "./command_history.h"
+#include "./variables.h"
+#include "./interpreter.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+
+/* one shell */
+typedef struct jshell_ctx_t
+{
+    char**          cmds;
+    int             n_cmds;
+    int             n_pipes;
+    alias_state     aliases;
+    history_state   history_log;
+    var_state       variables;
+    interp_state    interp;
+} jshell_ctx;
+
+/* the calling thread's current shell, never NULL */
+extern __thread jshell_ctx* jshell;
+
+/* function prototypes */
+jshell_ctx* jshell_new( void );
+void        jshell_free( jshell_ctx* ctx );
+jshell_ctx* jshell_use( jshell_ctx* ctx );
+node*       jshell_parse( jshell_ctx* ctx, const char* line,
+                          line_source more );
+int         jshell_run( jshell_ctx* ctx, const char* line,
+                        command_runner runner );
+
+#endif
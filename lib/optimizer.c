@@ -0,0 +1,201 @@
+#include "optimizer.h"
+
+/* local prototypes */
+static int  find_stages( char**, int, int* );
+static int  is_plain_cat( char**, int, int );
+static int  drop_middle_cats( char***, int*, int* );
+static int  cat_to_redirect( char***, int*, int* );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: optimize_pipeline                             */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char*** cmds: parsed command line, rewritten in place.   */
+/*          int* n_cmds: number of strings in cmds.                  */
+/*          int* n_pipes: number of pipes in cmds.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          rewrites "cat FILE | cmd ..." into "cmd < FILE ..." and  */
+/*          drops bare "cat" stages from the middle of a pipeline.   */
+/*          Each one saves a process and a copy of the data through  */
+/*          a pipe. A rewrite is only made when the result behaves   */
+/*          the same: FILE must be a readable regular file and the   */
+/*          second stage must not read from a file already. With     */
+/*          "set -o trace" every rewrite is reported on stderr.      */
+/*          Returns the number of rewrites made.                     */
+/*                                                                   */
+/*********************************************************************/
+int optimize_pipeline( char*** cmds, int* n_cmds, int* n_pipes )
+{
+    int n_rewrites;
+
+    if ( *n_pipes == 0 || *n_pipes >= MAX_STAGES )
+        return 0;
+
+    n_rewrites = drop_middle_cats( cmds, n_cmds, n_pipes );
+    n_rewrites += cat_to_redirect( cmds, n_cmds, n_pipes );
+
+    return n_rewrites;
+} /* end optimize_pipeline() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: find_stages                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** cmds: parsed command line.                        */
+/*          int n_cmds: number of strings in cmds.                   */
+/*          int* starts: receives the index each stage starts at,    */
+/*                       plus one past the end of the last stage.    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the number of stages. Stage i is the words from  */
+/*          starts[i] up to (not including) starts[i + 1] - 1.       */
+/*                                                                   */
+/*********************************************************************/
+static int find_stages( char** cmds, int n_cmds, int* starts )
+{
+    int n = 0;
+
+    starts[n++] = 0;
+
+    for ( int i = 0; i < n_cmds && n < MAX_STAGES; i++ )
+        if ( strcmp( cmds[i], "|" ) == 0 )
+            starts[n++] = i + 1;
+
+    /* as if there were a pipe after the last word */
+    starts[n] = n_cmds + 1;
+
+    return n;
+} /* end find_stages() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_plain_cat                                  */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** cmds: parsed command line.                        */
+/*          int start: first word of the stage.                      */
+/*          int n_words: number of words in the stage.               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T if the stage is "cat" with no options, no files and    */
+/*          no redirection, which copies stdin to stdout unchanged.  */
+/*                                                                   */
+/*********************************************************************/
+static int is_plain_cat( char** cmds, int start, int n_words )
+{
+    return ( n_words == 1 && strcmp( cmds[start], "cat" ) == 0 );
+} /* end is_plain_cat() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: drop_middle_cats                              */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char*** cmds: parsed command line.                       */
+/*          int* n_cmds: number of strings in cmds.                  */
+/*          int* n_pipes: number of pipes in cmds.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          "a | cat | b" becomes "a | b". Only middle stages go:    */
+/*          a leading cat would hand b the terminal instead of a     */
+/*          pipe and a trailing one does the same to a, and some     */
+/*          programs change their output when that happens.          */
+/*                                                                   */
+/*********************************************************************/
+static int drop_middle_cats( char*** cmds, int* n_cmds, int* n_pipes )
+{
+    int starts[MAX_STAGES + 1];
+    int n_stages, n_dropped = 0;
+
+    n_stages = find_stages( *cmds, *n_cmds, starts );
+
+    /* walk backwards so earlier stage positions stay valid */
+    for ( int i = n_stages - 2; i > 0; i-- )
+    {
+        if ( !is_plain_cat( *cmds, starts[i], starts[i + 1] - starts[i] - 1 ) )
+            continue;
+
+        /* remove "cat |" */
+        if ( splice_strings( cmds, n_cmds, starts[i], 2, NULL, 0 ) == FAILURE )
+            break;
+
+        (*n_pipes)--;
+        n_dropped++;
+
+        if ( OPTION( OPT_TRACE ) )
+            fprintf( stderr, "+ optimize: dropped cat from stage %d\n",
+                     i + 1 );
+    }
+
+    return n_dropped;
+} /* end drop_middle_cats() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: cat_to_redirect                               */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char*** cmds: parsed command line.                       */
+/*          int* n_cmds: number of strings in cmds.                  */
+/*          int* n_pipes: number of pipes in cmds.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          "cat FILE | cmd args | ..." becomes                      */
+/*          "cmd args < FILE | ...", so cmd reads the file itself.   */
+/*                                                                   */
+/*********************************************************************/
+static int cat_to_redirect( char*** cmds, int* n_cmds, int* n_pipes )
+{
+    int starts[MAX_STAGES + 1];
+    char* redirect[2];
+    char* file;
+    struct stat sb;
+    int end;
+
+    find_stages( *cmds, *n_cmds, starts );
+
+    /* the first stage must be exactly "cat FILE" */
+    if ( starts[1] != 3 || strcmp( (*cmds)[0], "cat" ) != 0 )
+        return 0;
+
+    /* and there must be a command after it to take the file */
+    if ( starts[2] - starts[1] <= 1 )
+        return 0;
+
+    file = (*cmds)[1];
+
+    if ( file[0] == '-' || stat( file, &sb ) != 0 || !S_ISREG( sb.st_mode ) ||
+         access( file, R_OK ) != 0 )
+        return 0;
+
+    /* the second stage may not redirect its input already */
+    for ( int i = starts[1]; i < starts[2] - 1; i++ )
+        if ( strcmp( (*cmds)[i], "<" ) == 0 || strcmp( (*cmds)[i], "<<" ) == 0 ||
+             strcmp( (*cmds)[i], "<<<" ) == 0 )
+            return 0;
+
+    if ( OPTION( OPT_TRACE ) )
+        fprintf( stderr, "+ optimize: cat %s | %s -> %s < %s\n", file,
+                 (*cmds)[3], (*cmds)[3], file );
+
+    /* "<" FILE goes at the end of what becomes the first stage */
+    end = starts[2] - 1;
+    redirect[0] = "<";
+    redirect[1] = file;
+
+    if ( splice_strings( cmds, n_cmds, end, 0, redirect, 2 ) == FAILURE ||
+         splice_strings( cmds, n_cmds, 0, 3, NULL, 0 ) == FAILURE )
+        return 0;
+
+    (*n_pipes)--;
+
+    return 1;
+} /* end cat_to_redirect() */
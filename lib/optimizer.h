@@ -0,0 +1,30 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: optimizer.h                                 */
+/*          Description:                                             */
+/*              This module provides a peephole pass over a parsed   */
+/*              pipeline that removes stages which only copy their   */
+/*              input, such as "cat FILE | cmd".                     */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "./string_module.h"
+#include "./shell_options.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define MAX_STAGES 256
+
+/* function prototypes */
+int     optimize_pipeline( char*** cmds, int* n_cmds, int* n_pipes );
+
+#endif
@@ -0,0 +1,662 @@
+#include "parallel.h"
+
+/* globals */
+
+/* scheduler state for one run of the builtin */
+static job_slot     slots[PARALLEL_MAX_SLOTS];
+static job_output** finished = NULL;
+static int          n_finished = 0;
+static long         next_emit = 0;
+
+/* local prototypes */
+static int      is_separator( char**, int, int, int* );
+static char*    next_input( char**, int, int*, FILE* );
+static char**   build_job_argv( char**, int, const char* );
+static int      start_job( job_slot*, char**, int, char*, long, int );
+static void     drain_job( job_slot* );
+static void     finish_job( job_slot*, int );
+static void     emit_output( job_output* );
+static void     hold_output( job_output* );
+static void     flush_held( void );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_parallel_builtin                           */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: NULL terminated argv of a program.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T if prog is the parallel builtin. It runs as a forked   */
+/*          stage like cat and tee, so it can read a pipe or a       */
+/*          redirected file and its output can be piped on.          */
+/*                                                                   */
+/*********************************************************************/
+int is_parallel_builtin( char** prog )
+{
+    return ( prog[0] != NULL && strcmp( prog[0], "parallel" ) == 0 );
+} /* end is_parallel_builtin() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_parallel                                  */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** args: the parsed parallel command line.           */
+/*          int n_args: number of strings in args.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs "parallel [-j N] [-k] cmd ... ::: inputs ..." by    */
+/*          keeping up to N children alive at once. Inputs come      */
+/*          after the ::: separator, or one per line on stdin when   */
+/*          there is no separator. Every free slot takes the next    */
+/*          pending input as soon as the supervisor reports its      */
+/*          child gone. Each job's stdout is captured and printed    */
+/*          in one piece when it finishes; -k prints them in input   */
+/*          order instead of completion order. Called in a forked    */
+/*          child by exec_builtin(). Returns FAILURE if any job      */
+/*          failed.                                                  */
+/*                                                                   */
+/*********************************************************************/
+int run_parallel( char** args, int n_args )
+{
+    int max_jobs = (int) sysconf( _SC_NPROCESSORS_ONLN );
+    int ordered = F, failed = F;
+    int cmd_start = 1, cmd_len = 0, input_pos = -1;
+    int sep_len = 0, running = 0;
+    int i, n_fds;
+    long seq = 0;
+    char* input;
+    FILE* source = NULL;
+    int job_stdin = STDIN_FILENO;
+    struct pollfd fds[PARALLEL_MAX_SLOTS + 1];
+
+    /* read options */
+    while ( cmd_start < n_args && args[cmd_start][0] == '-' )
+    {
+        if ( strcmp( args[cmd_start], "-j" ) == 0 && cmd_start + 1 < n_args )
+        {
+            max_jobs = atoi( args[++cmd_start] );
+        }
+        else if ( strcmp( args[cmd_start], "-k" ) == 0 )
+            ordered = T;
+        else
+            break;
+
+        cmd_start++;
+    }
+
+    if ( max_jobs < 1 )
+        max_jobs = 1;
+
+    if ( max_jobs > PARALLEL_MAX_SLOTS )
+        max_jobs = PARALLEL_MAX_SLOTS;
+
+    /* find the command and where the inputs begin */
+    for ( i = cmd_start; i < n_args; i++ )
+    {
+        if ( is_separator( args, n_args, i, &sep_len ) == SUCCESS )
+        {
+            input_pos = i + sep_len;
+            break;
+        }
+    }
+
+    cmd_len = ( input_pos == -1 ? n_args : i ) - cmd_start;
+
+    if ( cmd_len <= 0 )
+    {
+        fprintf( stderr, "usage: parallel [-j N] [-k] cmd ... ::: args ...\n" );
+        return FAILURE;
+    }
+
+    /* no separator means inputs are read from stdin */
+    if ( input_pos == -1 )
+    {
+        source = stdin;
+
+        if ( ( job_stdin = open( "/dev/null", O_RDONLY ) ) == -1 )
+            job_stdin = STDIN_FILENO;
+    }
+
+    for ( i = 0; i < max_jobs; i++ )
+    {
+        slots[i].pid = 0;
+        slots[i].fd = -1;
+    }
+
+    n_finished = 0;
+    next_emit = 0;
+    fflush( stdout );
+
+    while ( 1 )
+    {
+        /* refill every free slot */
+        for ( i = 0; i < max_jobs; i++ )
+        {
+            if ( slots[i].pid != 0 )
+                continue;
+
+            if ( ( input = next_input( args, n_args, &input_pos, source ) )
+                    == NULL )
+                break;
+
+            /* a job that never started has no output to wait for */
+            if ( start_job( &slots[i], &args[cmd_start], cmd_len, input,
+                            seq, job_stdin ) == SUCCESS )
+            {
+                running++;
+                seq++;
+            }
+            else
+            {
+                /* give the slot the next input rather than stop here */
+                failed = T;
+                i--;
+            }
+
+            free( input );
+        }
+
+        if ( running == 0 )
+            break;
+
+        /* collect descriptors that still have output coming */
+        n_fds = 0;
+        for ( i = 0; i < max_jobs; i++ )
+        {
+            if ( slots[i].pid != 0 && slots[i].fd != -1 )
+            {
+                fds[n_fds].fd = slots[i].fd;
+                fds[n_fds].events = POLLIN;
+                fds[n_fds].revents = 0;
+                n_fds++;
+            }
+        }
+
+        /* the supervisor's descriptor turns readable when a child exits */
+        if ( supervisor_fd() != -1 )
+        {
+            fds[n_fds].fd = supervisor_fd();
+            fds[n_fds].events = POLLIN;
+            fds[n_fds].revents = 0;
+            n_fds++;
+        }
+
+        /* sleep until output arrives or a child exits */
+        if ( poll( fds, (nfds_t) n_fds,
+                   supervisor_fd() != -1 ? -1 : PARALLEL_POLL_MS ) == -1 &&
+             errno != EINTR )
+        {
+            fprintf( stderr, "Error: parallel could not poll jobs.\n" );
+            break;
+        }
+
+        supervisor_dispatch( 0 );
+
+        for ( i = 0; i < max_jobs; i++ )
+        {
+            if ( slots[i].pid == 0 )
+                continue;
+
+            drain_job( &slots[i] );
+
+            if ( !slots[i].exited &&
+                 reap_child( slots[i].pid, &slots[i].status, WNOHANG )
+                    == slots[i].pid )
+                slots[i].exited = T;
+
+            /* a slot is free once the child is gone and its pipe is dry */
+            if ( slots[i].exited && slots[i].fd == -1 )
+            {
+                if ( !WIFEXITED( slots[i].status ) ||
+                     WEXITSTATUS( slots[i].status ) != 0 )
+                    failed = T;
+
+                finish_job( &slots[i], ordered );
+                running--;
+            }
+        }
+    }
+
+    if ( job_stdin != STDIN_FILENO )
+        close( job_stdin );
+
+    if ( source != NULL )
+        clearerr( source );
+
+    flush_held();
+
+    /* the job statuses were folded in as they were reaped */
+    last_run.status = ( failed ? 1 : 0 );
+
+    return ( failed ? FAILURE : SUCCESS );
+} /* end run_parallel() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_separator                                  */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** args: parsed command line.                        */
+/*          int n_args: number of strings in args.                   */
+/*          int pos: index to test.                                  */
+/*          int* len: set to the number of tokens the separator      */
+/*                    spans.                                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the parser splits ':' into its own token, so ":::"       */
+/*          shows up as three ":" tokens in a row.                   */
+/*                                                                   */
+/*********************************************************************/
+static int is_separator( char** args, int n_args, int pos, int* len )
+{
+    if ( strcmp( args[pos], PARALLEL_SEPARATOR ) == 0 )
+    {
+        *len = 1;
+        return SUCCESS;
+    }
+
+    if ( pos + 2 < n_args &&
+         strcmp( args[pos], ":" ) == 0 &&
+         strcmp( args[pos + 1], ":" ) == 0 &&
+         strcmp( args[pos + 2], ":" ) == 0
+       )
+    {
+        *len = 3;
+        return SUCCESS;
+    }
+
+    return FAILURE;
+} /* end is_separator() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: next_input                                    */
+/*      Return type:   char*                                         */
+/*      Parameter(s):                                                */
+/*          char** args: parsed command line.                        */
+/*          int n_args: number of strings in args.                   */
+/*          int* pos: position of the next input in args.            */
+/*          FILE* source: stream to read inputs from, or NULL.       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns a newly allocated copy of the next input, or     */
+/*          NULL when the inputs are exhausted. Inputs read from a   */
+/*          stream are pulled one line at a time so huge lists are   */
+/*          never held in memory.                                    */
+/*                                                                   */
+/*********************************************************************/
+static char* next_input( char** args, int n_args, int* pos, FILE* source )
+{
+    char* line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+
+    if ( source == NULL )
+    {
+        if ( *pos >= n_args )
+            return NULL;
+
+        return strdup( args[(*pos)++] );
+    }
+
+    while ( ( len = getline( &line, &cap, source ) ) != -1 )
+    {
+        /* strip newline, skip blank lines */
+        if ( len > 0 && line[len - 1] == '\n' )
+            line[--len] = '\0';
+
+        if ( len > 0 )
+            return line;
+    }
+
+    free( line );
+    return NULL;
+} /* end next_input() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: build_job_argv                                */
+/*      Return type:   char**                                        */
+/*      Parameter(s):                                                */
+/*          char** cmd: command template.                            */
+/*          int cmd_len: number of strings in cmd.                   */
+/*          const char* input: input for this job.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          builds the argv of a job. Every "{}" in the template is  */
+/*          replaced with the input, however many a word holds;      */
+/*          without one the input is appended as the last argument.  */
+/*          Strings that contain a placeholder are newly allocated,  */
+/*          all others point into the template.                      */
+/*                                                                   */
+/*********************************************************************/
+static char** build_job_argv( char** cmd, int cmd_len, const char* input )
+{
+    size_t mark_len = strlen( PARALLEL_PLACEHOLDER );
+    size_t input_len = strlen( input );
+    size_t n_marks, size;
+    char** argv;
+    const char* from;
+    const char* mark;
+    char* to;
+    int i, placed = F;
+
+    if ( ( argv = (char**) malloc( ( cmd_len + 2 ) * sizeof(char*) ) )
+            == NULL )
+        return NULL;
+
+    for ( i = 0; i < cmd_len; i++ )
+    {
+        argv[i] = cmd[i];
+
+        n_marks = 0;
+        for ( mark = strstr( cmd[i], PARALLEL_PLACEHOLDER ); mark != NULL;
+              mark = strstr( mark + mark_len, PARALLEL_PLACEHOLDER ) )
+            n_marks++;
+
+        if ( n_marks == 0 )
+            continue;
+
+        size = strlen( cmd[i] ) - n_marks * mark_len +
+               n_marks * input_len + 1;
+
+        if ( ( argv[i] = (char*) malloc( size ) ) == NULL )
+            return NULL;
+
+        /* copy the text between placeholders, the input for each */
+        from = cmd[i];
+        to = argv[i];
+
+        while ( ( mark = strstr( from, PARALLEL_PLACEHOLDER ) ) != NULL )
+        {
+            memcpy( to, from, (size_t)( mark - from ) );
+            to += mark - from;
+            memcpy( to, input, input_len );
+            to += input_len;
+            from = mark + mark_len;
+        }
+
+        strcpy( to, from );
+        placed = T;
+    }
+
+    argv[i++] = ( placed ? NULL : (char*) input );
+    argv[i] = NULL;
+
+    return argv;
+} /* end build_job_argv() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: start_job                                     */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          job_slot* slot: free slot to run the job in.             */
+/*          char** cmd: command template.                            */
+/*          int cmd_len: number of strings in cmd.                   */
+/*          char* input: input for this job.                         */
+/*          long seq: position of the input, used by -k.             */
+/*          int fd_in: descriptor to use as the job's stdin.         */
+/*                                                                   */
+/*********************************************************************/
+static int start_job( job_slot* slot, char** cmd, int cmd_len, char* input,
+                      long seq, int fd_in )
+{
+    int pipe_fd[2];
+    char** argv;
+
+    if ( ( argv = build_job_argv( cmd, cmd_len, input ) ) == NULL )
+    {
+        fprintf( stderr, "Error allocating memory for parallel job.\n" );
+        return FAILURE;
+    }
+
+    /* the shell keeps the read end, children must not inherit it */
+    if ( pipe2( pipe_fd, O_CLOEXEC ) == -1 )
+    {
+        fprintf( stderr, "Error: Calling pipe() failed.\n" );
+        free( argv );
+        return FAILURE;
+    }
+
+    slot->pid = spawn_process( fd_in, pipe_fd[WRITE_END], argv );
+    close( pipe_fd[WRITE_END] );
+
+    /* free any strings that had a placeholder substituted */
+    for ( int i = 0; i < cmd_len; i++ )
+        if ( argv[i] != cmd[i] )
+            free( argv[i] );
+
+    free( argv );
+
+    if ( slot->pid == -1 )
+    {
+        slot->pid = 0;
+        close( pipe_fd[READ_END] );
+        return FAILURE;
+    }
+
+    slot->fd = pipe_fd[READ_END];
+    slot->exited = F;
+    slot->status = 0;
+    slot->out.seq = seq;
+    slot->out.buf = NULL;
+    slot->out.len = 0;
+    slot->out.cap = 0;
+
+    return SUCCESS;
+} /* end start_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: drain_job                                     */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          job_slot* slot: running job.                             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          moves whatever is waiting in the job's pipe into its     */
+/*          output buffer so the child never blocks on a full pipe.  */
+/*          Closes the pipe on EOF.                                  */
+/*                                                                   */
+/*********************************************************************/
+static void drain_job( job_slot* slot )
+{
+    struct pollfd pfd;
+    ssize_t n;
+
+    if ( slot->fd == -1 )
+        return;
+
+    pfd.fd = slot->fd;
+    pfd.events = POLLIN;
+
+    while ( poll( &pfd, 1, 0 ) > 0 )
+    {
+        /* make room for the next read */
+        if ( slot->out.cap - slot->out.len < PARALLEL_READ_SIZE )
+        {
+            size_t cap = ( slot->out.cap == 0 ? PARALLEL_READ_SIZE
+                                              : slot->out.cap * 2 );
+            char* buf = (char*) realloc( slot->out.buf, cap );
+
+            if ( buf == NULL )
+            {
+                fprintf( stderr, "Error allocating memory for job output.\n" );
+                return;
+            }
+
+            slot->out.buf = buf;
+            slot->out.cap = cap;
+        }
+
+        n = read( slot->fd, slot->out.buf + slot->out.len,
+                  slot->out.cap - slot->out.len );
+
+        if ( n == -1 && errno == EINTR )
+            continue;
+
+        if ( n <= 0 )
+        {
+            close( slot->fd );
+            slot->fd = -1;
+            return;
+        }
+
+        slot->out.len += (size_t) n;
+    }
+} /* end drain_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: finish_job                                    */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          job_slot* slot: job that exited and hit EOF.             */
+/*          int ordered: T if output must be emitted in input order. */
+/*                                                                   */
+/*      Description:                                                 */
+/*          hands the job's output off for printing and frees the    */
+/*          slot for the next input.                                 */
+/*                                                                   */
+/*********************************************************************/
+static void finish_job( job_slot* slot, int ordered )
+{
+    job_output* out;
+
+    if ( !ordered )
+    {
+        emit_output( &slot->out );
+        free( slot->out.buf );
+    }
+    else if ( ( out = (job_output*) malloc( sizeof(job_output) ) ) != NULL )
+    {
+        *out = slot->out;
+        hold_output( out );
+    }
+
+    slot->pid = 0;
+    slot->fd = -1;
+} /* end finish_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: emit_output                                   */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          job_output* out: captured output of one job.             */
+/*                                                                   */
+/*********************************************************************/
+static void emit_output( job_output* out )
+{
+    size_t done = 0;
+    ssize_t n;
+
+    while ( done < out->len )
+    {
+        n = write( STDOUT_FILENO, out->buf + done, out->len - done );
+
+        if ( n == -1 && errno == EINTR )
+            continue;
+
+        if ( n <= 0 )
+            return;
+
+        done += (size_t) n;
+    }
+} /* end emit_output() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: hold_output                                   */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          job_output* out: captured output of one job.             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          keeps output finished out of order until every earlier   */
+/*          input has been printed, then flushes the ready run.      */
+/*                                                                   */
+/*********************************************************************/
+static void hold_output( job_output* out )
+{
+    job_output** grown;
+    int i, found;
+
+    if ( ( grown = (job_output**) realloc( finished,
+            ( n_finished + 1 ) * sizeof(job_output*) ) ) == NULL )
+    {
+        emit_output( out );
+        free( out->buf );
+        free( out );
+        return;
+    }
+
+    finished = grown;
+    finished[n_finished++] = out;
+
+    /* print everything that is now next in line */
+    do
+    {
+        found = F;
+        for ( i = 0; i < n_finished; i++ )
+        {
+            if ( finished[i]->seq != next_emit )
+                continue;
+
+            emit_output( finished[i] );
+            free( finished[i]->buf );
+            free( finished[i] );
+            finished[i] = finished[--n_finished];
+            next_emit++;
+            found = T;
+            break;
+        }
+    } while ( found );
+} /* end hold_output() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: flush_held                                    */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          prints, in input order, whatever -k output is still held */
+/*          once every job is done, so a gap in the sequence never   */
+/*          swallows later output, and frees it all.                 */
+/*                                                                   */
+/*********************************************************************/
+static void flush_held( void )
+{
+    int i, first;
+
+    while ( n_finished > 0 )
+    {
+        first = 0;
+        for ( i = 1; i < n_finished; i++ )
+            if ( finished[i]->seq < finished[first]->seq )
+                first = i;
+
+        emit_output( finished[first] );
+        free( finished[first]->buf );
+        free( finished[first] );
+        finished[first] = finished[--n_finished];
+    }
+
+    free( finished );
+    finished = NULL;
+} /* end flush_held() */
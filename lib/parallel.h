@@ -0,0 +1,64 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: parallel.h                                  */
+/*          Description:                                             */
+/*              This module provides the parallel builtin, which     */
+/*              runs one command over many inputs while keeping a    */
+/*              fixed number of job slots busy.                      */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/* for pipe2() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "string_module.h"
+#include "execution.h"
+#include "supervisor.h"
+
+/* macros */
+#define PARALLEL_SEPARATOR ":::"
+#define PARALLEL_PLACEHOLDER "{}"
+#define PARALLEL_MAX_SLOTS 256
+#define PARALLEL_READ_SIZE 65536
+#define PARALLEL_POLL_MS 50
+#define FAILURE 0
+#define SUCCESS 1
+
+/* output captured from a single job */
+typedef struct job_output_t
+{
+    long    seq;
+    char*   buf;
+    size_t  len;
+    size_t  cap;
+} job_output;
+
+/* one running job occupying a slot */
+typedef struct job_slot_t
+{
+    pid_t       pid;
+    int         fd;
+    int         exited;
+    int         status;
+    job_output  out;
+} job_slot;
+
+/* prototypes */
+int     is_parallel_builtin( char** prog );
+int     run_parallel( char** args, int n_args );
+
+#endif
@@ -0,0 +1,302 @@
+#include "pipe_meter.h"
+
+/* globals, the relays' descriptors while the pipeline starts */
+static __thread int meter_fds[METER_MAX_FDS];
+static __thread int n_meter_fds = 0;
+
+/* local prototypes */
+static void*    relay( void* );
+static double   now_sec( void );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: open_meter_edge                               */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          meter_edge* edge: the edge to set up.                    */
+/*          int fd_in: read end of the pipe the writer fills.        */
+/*          int fd_out: write end of the pipe the reader empties.    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          gives edge its descriptors, which it owns from here on.  */
+/*          Returns FAILURE, with both closed, if there are too      */
+/*          many edges.                                              */
+/*                                                                   */
+/*********************************************************************/
+int open_meter_edge( meter_edge* edge, int fd_in, int fd_out )
+{
+    memset( edge, 0, sizeof(meter_edge) );
+    edge->fd_in = fd_in;
+    edge->fd_out = fd_out;
+
+    if ( n_meter_fds + 2 > METER_MAX_FDS )
+    {
+        fprintf( stderr, "Error: Too many pipes to meter.\n" );
+        close( fd_in );
+        close( fd_out );
+        edge->fd_in = -1;
+        edge->fd_out = -1;
+        return FAILURE;
+    }
+
+    meter_fds[n_meter_fds++] = fd_in;
+    meter_fds[n_meter_fds++] = fd_out;
+
+    return SUCCESS;
+} /* end open_meter_edge() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: start_meter                                   */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          meter_edge* edges: the pipeline's edges.                 */
+/*          int n_edges: how many.                                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          starts a relay thread per edge, once every stage has     */
+/*          been forked so no stage inherits a thread's state. The   */
+/*          threads block every signal; a relay whose reader has     */
+/*          gone gets EPIPE rather than killing the shell.           */
+/*                                                                   */
+/*********************************************************************/
+void start_meter( meter_edge* edges, int n_edges )
+{
+    sigset_t all, saved;
+
+    sigfillset( &all );
+    pthread_sigmask( SIG_BLOCK, &all, &saved );
+
+    for ( int i = 0; i < n_edges; i++ )
+    {
+        if ( edges[i].fd_in == -1 )
+            continue;
+
+        edges[i].started = now_sec();
+
+        if ( pthread_create( &edges[i].thread, NULL, relay, &edges[i] ) == 0 )
+            edges[i].running = T;
+        else
+        {
+            /* the stages see EOF and EPIPE rather than hang */
+            fprintf( stderr, "Error: Could not start a pipe meter.\n" );
+            close( edges[i].fd_in );
+            close( edges[i].fd_out );
+            edges[i].finished = edges[i].started;
+        }
+    }
+
+    pthread_sigmask( SIG_SETMASK, &saved, NULL );
+    n_meter_fds = 0;
+} /* end start_meter() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: report_meter                                  */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          meter_edge* edges: the pipeline's edges.                 */
+/*          int n_edges: how many.                                   */
+/*          char names[][]: a short name for each stage, one more    */
+/*                          than there are edges.                    */
+/*          FILE* fp: where to print.                                */
+/*                                                                   */
+/*      Description:                                                 */
+/*          waits for the relays and prints, for each edge, the      */
+/*          bytes moved, MB/s over the edge's life and how much of   */
+/*          it the relay waited on the writer (it was slow to        */
+/*          produce) and on the reader (backpressure). A stage that  */
+/*          kept both neighbours waiting is named the bottleneck.    */
+/*                                                                   */
+/*********************************************************************/
+void report_meter( meter_edge* edges, int n_edges,
+                   char names[][METER_NAME_SIZE], FILE* fp )
+{
+    double first = 0, last = 0, life, score, worst = 0;
+    int n_sides, bottleneck = -1;
+
+    for ( int i = 0; i < n_edges; i++ )
+    {
+        if ( edges[i].running )
+            pthread_join( edges[i].thread, NULL );
+
+        edges[i].running = F;
+
+        if ( i == 0 || edges[i].started < first )
+            first = edges[i].started;
+
+        if ( edges[i].finished > last )
+            last = edges[i].finished;
+    }
+
+    fprintf( fp, "meter: %d stages, %.3f s\n", n_edges + 1, last - first );
+    fprintf( fp, "  %-30s %14s %10s %8s %8s\n", "edge", "bytes", "MB/s",
+             "writer", "reader" );
+
+    for ( int i = 0; i < n_edges; i++ )
+    {
+        if ( ( life = edges[i].finished - edges[i].started ) <= 0 )
+            life = 1e-9;
+
+        fprintf( fp, "  %-13s -> %-13s %14lld %10.1f %7.1f%% %7.1f%%\n",
+                 names[i], names[i + 1], edges[i].bytes,
+                 edges[i].bytes / life / 1e6,
+                 100 * edges[i].writer_wait / life,
+                 100 * edges[i].reader_wait / life );
+
+        edges[i].writer_wait /= life;
+        edges[i].reader_wait /= life;
+    }
+
+    /* stage i makes edge i-1 wait to write and edge i wait to read */
+    for ( int i = 0; i <= n_edges; i++ )
+    {
+        score = 0;
+        n_sides = 0;
+
+        if ( i > 0 )
+        {
+            score += edges[i - 1].reader_wait;
+            n_sides++;
+        }
+
+        if ( i < n_edges )
+        {
+            score += edges[i].writer_wait;
+            n_sides++;
+        }
+
+        if ( ( score /= n_sides ) > worst )
+        {
+            worst = score;
+            bottleneck = i;
+        }
+    }
+
+    if ( worst >= METER_BOTTLENECK )
+        fprintf( fp, "  bottleneck: stage %d (%s)\n", bottleneck + 1,
+                 names[bottleneck] );
+} /* end report_meter() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: close_meter_fds                               */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          called in a forked stage that runs a builtin instead of  */
+/*          exec'ing, where close-on-exec doesn't help. A relay's    */
+/*          write end left open there would keep the next stage      */
+/*          from ever seeing EOF.                                    */
+/*                                                                   */
+/*********************************************************************/
+void close_meter_fds( void )
+{
+    for ( int i = 0; i < n_meter_fds; i++ )
+        close( meter_fds[i] );
+
+    n_meter_fds = 0;
+} /* end close_meter_fds() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: relay                                         */
+/*      Return type:   static void*                                  */
+/*      Parameter(s):                                                */
+/*          void* arg: the meter_edge to run.                        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          splices pipe to pipe without blocking. When nothing      */
+/*          moves, the reader's pipe being full means waiting on     */
+/*          the reader, else it waits on the writer, and the time    */
+/*          is charged to that side. Ends at EOF, or when the reader */
+/*          has gone, closing both ends so the pipeline winds down   */
+/*          as it would without the meter.                           */
+/*                                                                   */
+/*********************************************************************/
+static void* relay( void* arg )
+{
+    meter_edge* edge = arg;
+    struct pollfd fds[2];
+    double since;
+    ssize_t n;
+    int reader;
+
+    fds[0].fd = edge->fd_in;
+    fds[1].fd = edge->fd_out;
+
+    while ( 1 )
+    {
+        n = splice( edge->fd_in, NULL, edge->fd_out, NULL, METER_CHUNK,
+                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+
+        if ( n > 0 )
+        {
+            edge->bytes += n;
+            continue;
+        }
+
+        if ( n == 0 || ( errno != EAGAIN && errno != EINTR ) )
+            break;
+
+        if ( errno == EINTR )
+            continue;
+
+        since = now_sec();
+
+        /* is there room on the reader's side? */
+        fds[1].events = POLLOUT;
+
+        if ( poll( &fds[1], 1, 0 ) == -1 || ( fds[1].revents & POLLERR ) )
+            break;
+
+        reader = !( fds[1].revents & POLLOUT );
+
+        /* waiting on the writer still notices the reader leaving */
+        fds[0].events = POLLIN;
+        fds[1].events = reader ? POLLOUT : 0;
+
+        if ( reader )
+            while ( poll( &fds[1], 1, -1 ) == -1 && errno == EINTR )
+                continue;
+        else
+            while ( poll( fds, 2, -1 ) == -1 && errno == EINTR )
+                continue;
+
+        if ( reader )
+            edge->reader_wait += now_sec() - since;
+        else
+            edge->writer_wait += now_sec() - since;
+
+        if ( fds[1].revents & POLLERR )
+            break;
+    }
+
+    close( edge->fd_in );
+    close( edge->fd_out );
+    edge->finished = now_sec();
+
+    return NULL;
+} /* end relay() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: now_sec                                       */
+/*      Return type:   static double                                 */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*********************************************************************/
+static double now_sec( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+} /* end now_sec() */
@@ -0,0 +1,70 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: pipe_meter.h                                */
+/*          Description:                                             */
+/*              This module provides the "meter" prefix and          */
+/*              "set -o meter". Every pipe of a metered pipeline is  */
+/*              cut in two and the shell relays between the halves   */
+/*              with splice(), so no data passes through user        */
+/*              space. Each relay counts bytes and the time it       */
+/*              spent waiting on the stage before it and on the      */
+/*              stage after it, and a report of throughput and       */
+/*              backpressure per edge is printed when the pipeline   */
+/*              exits.                                               */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef PIPE_METER_H
+#define PIPE_METER_H
+
+/* for splice() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "./string_module.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define METER_CHUNK ( 1 << 20 )
+#define METER_NAME_SIZE 16
+#define METER_MAX_FDS 128
+#define METER_PIPE_SIZE ( 1 << 20 )
+
+/* a stage is called the bottleneck if it kept its neighbours
+ * waiting this much of the time */
+#define METER_BOTTLENECK 0.5
+
+/* one relay between two stages */
+typedef struct meter_edge_t
+{
+    int         fd_in;
+    int         fd_out;
+    pthread_t   thread;
+    int         running;
+    long long   bytes;
+    double      started;
+    double      finished;
+    double      writer_wait;
+    double      reader_wait;
+} meter_edge;
+
+/* function prototypes */
+int     open_meter_edge( meter_edge* edge, int fd_in, int fd_out );
+void    start_meter( meter_edge* edges, int n_edges );
+void    report_meter( meter_edge* edges, int n_edges,
+                      char names[][METER_NAME_SIZE], FILE* fp );
+void    close_meter_fds( void );
+
+#endif
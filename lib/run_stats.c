@@ -0,0 +1,142 @@
+#include "run_stats.h"
+
+/* globals */
+run_stats   last_run;
+
+/* local prototypes */
+static double   timeval_to_sec( struct timeval );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: begin_run_stats                               */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          resets last_run and starts its wall clock. Call before   */
+/*          running a command line.                                  */
+/*                                                                   */
+/*********************************************************************/
+void begin_run_stats( void )
+{
+    memset( &last_run, 0, sizeof(last_run) );
+    clock_gettime( CLOCK_MONOTONIC, &last_run.start );
+} /* end begin_run_stats() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: end_run_stats                                 */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          stops the wall clock of last_run and marks it valid.     */
+/*                                                                   */
+/*********************************************************************/
+void end_run_stats( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    last_run.real = (double)( now.tv_sec - last_run.start.tv_sec ) +
+                    (double)( now.tv_nsec - last_run.start.tv_nsec ) / 1e9;
+    last_run.valid = SUCCESS;
+} /* end end_run_stats() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: reap_child                                    */
+/*      Return type:   pid_t                                         */
+/*      Parameter(s):                                                */
+/*          pid_t pid: child to reap.                                */
+/*          int* status: set to the wait status, may be NULL.        */
+/*          int options: options for wait4(), e.g. WNOHANG.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          waits for one specific child through the supervisor and  */
+/*          adds its resource usage to last_run. Only pid is         */
+/*          reaped, so other children (background jobs, parallel     */
+/*          slots) are left for whoever owns them. A child killed    */
+/*          by its timeout gets TIMEOUT_STATUS. Returns what wait4   */
+/*          would.                                                   */
+/*                                                                   */
+/*********************************************************************/
+pid_t reap_child( pid_t pid, int* status, int options )
+{
+    struct rusage usage;
+    int wstatus = 0, timed_out;
+    pid_t w;
+
+    w = wait_child( pid, &wstatus, &usage, options, &timed_out );
+
+    if ( w <= 0 )
+        return w;
+
+    /* sum times and switches, keep the largest resident set */
+    last_run.n_children++;
+    last_run.user += timeval_to_sec( usage.ru_utime );
+    last_run.sys += timeval_to_sec( usage.ru_stime );
+    last_run.vol_csw += usage.ru_nvcsw;
+    last_run.invol_csw += usage.ru_nivcsw;
+
+    if ( usage.ru_maxrss > last_run.max_rss )
+        last_run.max_rss = usage.ru_maxrss;
+
+    /* the status of a command line is that of its last child */
+    if ( timed_out )
+        last_run.status = TIMEOUT_STATUS;
+    else if ( WIFEXITED( wstatus ) )
+        last_run.status = WEXITSTATUS( wstatus );
+    else if ( WIFSIGNALED( wstatus ) )
+        last_run.status = 128 + WTERMSIG( wstatus );
+
+    if ( status != NULL )
+        *status = wstatus;
+
+    return w;
+} /* end reap_child() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: print_run_stats                               */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          FILE* fp: stream to print to.                            */
+/*          const run_stats* rs: stats to print.                     */
+/*                                                                   */
+/*********************************************************************/
+void print_run_stats( FILE* fp, const run_stats* rs )
+{
+    if ( !rs->valid )
+    {
+        fprintf( fp, "No command has been run yet.\n" );
+        return;
+    }
+
+    fprintf( fp, "real\t%.3fs\n", rs->real );
+    fprintf( fp, "user\t%.3fs\n", rs->user );
+    fprintf( fp, "sys\t%.3fs\n", rs->sys );
+    fprintf( fp, "maxrss\t%ld KB\n", rs->max_rss );
+    fprintf( fp, "csw\t%ld voluntary, %ld involuntary\n",
+             rs->vol_csw, rs->invol_csw );
+    fprintf( fp, "status\t%d (%d %s)\n", rs->status, rs->n_children,
+             rs->n_children == 1 ? "process" : "processes" );
+} /* end print_run_stats() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: timeval_to_sec                                */
+/*      Return type:   double                                        */
+/*      Parameter(s):                                                */
+/*          struct timeval tv: time to convert.                      */
+/*                                                                   */
+/*********************************************************************/
+static double timeval_to_sec( struct timeval tv )
+{
+    return (double) tv.tv_sec + (double) tv.tv_usec / 1e6;
+} /* end timeval_to_sec() */
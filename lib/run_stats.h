@@ -0,0 +1,53 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: run_stats.h                                 */
+/*          Description:                                             */
+/*              This module provides structures and functions to     */
+/*              reap child processes and record how much time and    */
+/*              memory each command line used.                       */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "./supervisor.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+
+/* resources used by one command line, summed over its children */
+typedef struct run_stats_t
+{
+    int             valid;
+    int             status;
+    int             n_children;
+    struct timespec start;
+    double          real;
+    double          user;
+    double          sys;
+    long            max_rss;
+    long            vol_csw;
+    long            invol_csw;
+} run_stats;
+
+/* globals */
+extern run_stats    last_run;
+
+/* function prototypes */
+void    begin_run_stats( void );
+void    end_run_stats( void );
+pid_t   reap_child( pid_t, int*, int );
+void    print_run_stats( FILE*, const run_stats* );
+
+#endif
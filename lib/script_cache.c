@@ -0,0 +1,606 @@
+#include "script_cache.h"
+
+/* local prototypes */
+static int  map_cache( const char*, uint64_t, script_image* );
+static int  set_views( script_image*, uint64_t );
+static int  compile_script( const char*, size_t, uint64_t, script_image* );
+static int  split_lines( const char*, size_t, script_builder* );
+static int  add_line( script_builder*, char* );
+static int  build_image( script_builder*, uint64_t, script_image* );
+static int  pool_add( script_builder*, const char*, uint64_t* );
+static int  token_add( script_builder*, uint64_t );
+static int  is_blank_line( const char* );
+static void save_cache( const char*, const script_image* );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: fnv1a                                         */
+/*      Return type:   uint64_t                                      */
+/*      Parameter(s):                                                */
+/*          const void* data: bytes to hash.                         */
+/*          size_t len: how many.                                    */
+/*          uint64_t hash: FNV_OFFSET, or a hash to continue.        */
+/*                                                                   */
+/*********************************************************************/
+uint64_t fnv1a( const void* data, size_t len, uint64_t hash )
+{
+    const unsigned char* byte = data;
+
+    for ( size_t i = 0; i < len; i++ )
+        hash = ( hash ^ byte[i] ) * FNV_PRIME;
+
+    return hash;
+} /* end fnv1a() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: load_script                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* path: the script.                            */
+/*          script_image* image: filled in with its lines.           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          maps path.jshc if it was made from this exact script by  */
+/*          a shell with the same LEXER_VERSION. Otherwise the       */
+/*          script is split into words line by line and the result   */
+/*          written to path.jshc for next time, if the directory     */
+/*          allows it.                                               */
+/*                                                                   */
+/*********************************************************************/
+int load_script( const char* path, script_image* image )
+{
+    char cache[PATH_MAX];
+    const char* source = "";
+    struct stat st;
+    uint64_t hash;
+    int fd, status;
+
+    memset( image, 0, sizeof(*image) );
+
+    if ( ( fd = open( path, O_RDONLY | O_CLOEXEC ) ) == -1 ||
+         fstat( fd, &st ) == -1 )
+    {
+        fprintf( stderr, "Error: Could not open %s: %s.\n", path,
+                 strerror( errno ) );
+        if ( fd != -1 )
+            close( fd );
+        return FAILURE;
+    }
+
+    if ( st.st_size > 0 && ( source = mmap( NULL, st.st_size, PROT_READ,
+                                            MAP_PRIVATE, fd, 0 ) )
+                           == MAP_FAILED )
+    {
+        fprintf( stderr, "Error: Could not read %s.\n", path );
+        close( fd );
+        return FAILURE;
+    }
+
+    close( fd );
+
+    /* the hash is all that is needed of the script if the cache is good */
+    hash = fnv1a( source, st.st_size, FNV_OFFSET );
+    snprintf( cache, sizeof(cache), "%s%s", path, SCRIPT_CACHE_SUFFIX );
+
+    if ( ( status = map_cache( cache, hash, image ) ) == FAILURE &&
+         ( status = compile_script( source, st.st_size, hash, image ) )
+         == SUCCESS )
+        save_cache( cache, image );
+
+    if ( st.st_size > 0 )
+        munmap( (void*) source, st.st_size );
+
+    return status;
+} /* end load_script() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: script_words                                  */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const script_image* image: a loaded script.              */
+/*          uint32_t line: which line.                               */
+/*          char*** cmds: set to a new array of the line's words.    */
+/*          int* n_cmds: set to how many.                            */
+/*          int* n_pipes: set to how many of them are "|".           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          gives the words parse_string() would have, each in its   */
+/*          own malloc()ed string so the line can be expanded and    */
+/*          freed as usual.                                          */
+/*                                                                   */
+/*********************************************************************/
+int script_words( const script_image* image, uint32_t line, char*** cmds,
+                  int* n_cmds, int* n_pipes )
+{
+    const script_line* sl = &image->lines[line];
+    uint64_t offset;
+
+    *cmds = NULL;
+    *n_cmds = 0;
+    *n_pipes = (int) sl->n_pipes;
+
+    if ( sl->n_tokens == 0 )
+        return SUCCESS;
+
+    if ( ( *cmds = malloc( ( sl->n_tokens + 1 ) * sizeof(char*) ) ) == NULL )
+        return FAILURE;
+
+    for ( uint32_t i = 0; i < sl->n_tokens; i++ )
+    {
+        offset = image->tokens[sl->first + i];
+
+        if ( offset >= image->header->pool_size ||
+             ( (*cmds)[i] = strdup( image->pool + offset ) ) == NULL )
+        {
+            for ( int j = 0; j < *n_cmds; j++ )
+                free( (*cmds)[j] );
+
+            free( *cmds );
+            *cmds = NULL;
+            *n_cmds = 0;
+            return FAILURE;
+        }
+
+        (*n_cmds)++;
+    }
+
+    (*cmds)[*n_cmds] = NULL;
+    return SUCCESS;
+} /* end script_words() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: script_text                                   */
+/*      Return type:   const char*                                   */
+/*      Parameter(s):                                                */
+/*          const script_image* image: a loaded script.              */
+/*          uint32_t line: which line.                               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the line as written, for here-documents.         */
+/*                                                                   */
+/*********************************************************************/
+const char* script_text( const script_image* image, uint32_t line )
+{
+    uint64_t offset = image->lines[line].text;
+
+    return ( offset < image->header->pool_size ? image->pool + offset : "" );
+} /* end script_text() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: free_script                                   */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          script_image* image: a script from load_script().        */
+/*                                                                   */
+/*********************************************************************/
+void free_script( script_image* image )
+{
+    if ( image->mapped )
+        munmap( image->data, image->size );
+    else
+        free( image->data );
+
+    memset( image, 0, sizeof(*image) );
+} /* end free_script() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: map_cache                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* cache: path of the .jshc file.               */
+/*          uint64_t hash: hash of the script it must be made from.  */
+/*          script_image* image: filled in from it.                  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          FAILURE if there is no usable cache.                     */
+/*                                                                   */
+/*********************************************************************/
+static int map_cache( const char* cache, uint64_t hash, script_image* image )
+{
+    struct stat st;
+    void* data;
+    int fd;
+
+    if ( ( fd = open( cache, O_RDONLY | O_CLOEXEC ) ) == -1 )
+        return FAILURE;
+
+    if ( fstat( fd, &st ) == -1 || st.st_size < (off_t) sizeof(script_header)
+         || ( data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 ) )
+            == MAP_FAILED )
+    {
+        close( fd );
+        return FAILURE;
+    }
+
+    close( fd );
+
+    image->data = data;
+    image->size = st.st_size;
+    image->mapped = 1;
+    image->cached = 1;
+
+    if ( set_views( image, hash ) == FAILURE )
+    {
+        free_script( image );
+        return FAILURE;
+    }
+
+    return SUCCESS;
+} /* end map_cache() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: set_views                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          script_image* image: data and size set to an image.      */
+/*          uint64_t hash: hash of the script it must be made from.  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          checks the header against the script, the lexer and      */
+/*          the image's size, then points the tables into it.        */
+/*                                                                   */
+/*********************************************************************/
+static int set_views( script_image* image, uint64_t hash )
+{
+    const script_header* header = image->data;
+    const char* base = image->data;
+    size_t tables;
+
+    if ( memcmp( header->magic, SCRIPT_CACHE_MAGIC, 4 ) != 0 ||
+         header->format != SCRIPT_CACHE_FORMAT ||
+         header->lexer_version != LEXER_VERSION ||
+         header->source_hash != hash )
+        return FAILURE;
+
+    tables = sizeof(script_header) + header->n_lines * sizeof(script_line) +
+             header->n_tokens * sizeof(uint64_t);
+
+    if ( header->pool_size == 0 || tables + header->pool_size != image->size
+         || base[image->size - 1] != '\0' )
+        return FAILURE;
+
+    image->header = header;
+    image->lines = (const script_line*) ( base + sizeof(script_header) );
+    image->tokens = (const uint64_t*) ( image->lines + header->n_lines );
+    image->pool = base + tables;
+
+    for ( uint32_t i = 0; i < header->n_lines; i++ )
+        if ( (uint64_t) image->lines[i].first + image->lines[i].n_tokens >
+             header->n_tokens )
+            return FAILURE;
+
+    return SUCCESS;
+} /* end set_views() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: compile_script                                */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* source: the script's text.                   */
+/*          size_t len: its length.                                  */
+/*          uint64_t hash: its hash.                                 */
+/*          script_image* image: set to the compiled image.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          splits each line with parse_string() and lays the words  */
+/*          out in one block, the same as a .jshc file holds.        */
+/*                                                                   */
+/*********************************************************************/
+static int compile_script( const char* source, size_t len, uint64_t hash,
+                           script_image* image )
+{
+    script_builder sb;
+    int status;
+
+    memset( &sb, 0, sizeof(sb) );
+
+    if ( ( status = split_lines( source, len, &sb ) ) == SUCCESS )
+        status = build_image( &sb, hash, image );
+
+    if ( status == FAILURE )
+        fprintf( stderr, "Error: Out of memory reading the script.\n" );
+
+    free( sb.lines );
+    free( sb.tokens );
+    free( sb.pool );
+
+    return status;
+} /* end compile_script() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: split_lines                                   */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* source: the script's text.                   */
+/*          size_t len: its length.                                  */
+/*          script_builder* sb: gets every line and its words.       */
+/*                                                                   */
+/*********************************************************************/
+static int split_lines( const char* source, size_t len, script_builder* sb )
+{
+    size_t start, end, n_lines = 0;
+    char* line;
+    int status = SUCCESS;
+
+    for ( size_t i = 0; i < len; i++ )
+        if ( source[i] == '\n' || i == len - 1 )
+            n_lines++;
+
+    if ( ( sb->lines = calloc( n_lines + 1, sizeof(script_line) ) ) == NULL ||
+         ( line = malloc( len + 1 ) ) == NULL )
+        return FAILURE;
+
+    for ( start = 0; start < len && status == SUCCESS; start = end + 1 )
+    {
+        for ( end = start; end < len && source[end] != '\n'; end++ )
+            ;
+
+        memcpy( line, source + start, end - start );
+        line[end - start] = '\0';
+
+        if ( end > start && line[end - start - 1] == '\r' )
+            line[end - start - 1] = '\0';
+
+        status = add_line( sb, line );
+    }
+
+    free( line );
+    return status;
+} /* end split_lines() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: add_line                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          script_builder* sb: the image being built.               */
+/*          char* line: one line of the script.                      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          keeps the line's text, then its words unless it is       */
+/*          blank or a comment.                                      */
+/*                                                                   */
+/*********************************************************************/
+static int add_line( script_builder* sb, char* line )
+{
+    script_line* sl = &sb->lines[sb->n_lines++];
+    char** cmds = NULL;
+    int n_cmds = 0, n_pipes = 0, status = SUCCESS;
+    uint64_t offset;
+
+    if ( pool_add( sb, line, &sl->text ) == FAILURE )
+        return FAILURE;
+
+    sl->first = sb->n_tokens;
+
+    if ( is_blank_line( line ) )
+        return SUCCESS;
+
+    parse_string( line, &cmds, &n_cmds, &n_pipes );
+
+    for ( int i = 0; i < n_cmds; i++ )
+    {
+        if ( status == SUCCESS &&
+             ( pool_add( sb, cmds[i], &offset ) == FAILURE ||
+               token_add( sb, offset ) == FAILURE ) )
+            status = FAILURE;
+
+        free( cmds[i] );
+    }
+
+    free( cmds );
+
+    sl->n_tokens = (uint32_t) n_cmds;
+    sl->n_pipes = (uint32_t) n_pipes;
+
+    return status;
+} /* end add_line() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: build_image                                   */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          script_builder* sb: every line and its words.            */
+/*          uint64_t hash: the script's hash.                        */
+/*          script_image* image: set to the image.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          lays out the header, line table, token table and pool    */
+/*          in one block.                                            */
+/*                                                                   */
+/*********************************************************************/
+static int build_image( script_builder* sb, uint64_t hash,
+                        script_image* image )
+{
+    script_header header = { SCRIPT_CACHE_MAGIC, SCRIPT_CACHE_FORMAT, 0,
+                             hash, 0, 0, 0 };
+    size_t lines_size = sb->n_lines * sizeof(script_line);
+    size_t tokens_size = sb->n_tokens * sizeof(uint64_t);
+    uint64_t offset;
+    char* data;
+
+    /* the pool always ends in a '\0', even for an empty script */
+    if ( pool_add( sb, "", &offset ) == FAILURE )
+        return FAILURE;
+
+    header.lexer_version = LEXER_VERSION;
+    header.n_lines = sb->n_lines;
+    header.n_tokens = sb->n_tokens;
+    header.pool_size = sb->pool_used;
+
+    image->size = sizeof(header) + lines_size + tokens_size + sb->pool_used;
+
+    if ( ( image->data = data = malloc( image->size ) ) == NULL )
+        return FAILURE;
+
+    /* a table nothing was added to was never allocated */
+    memcpy( data, &header, sizeof(header) );
+
+    if ( lines_size > 0 )
+        memcpy( data + sizeof(header), sb->lines, lines_size );
+
+    if ( tokens_size > 0 )
+        memcpy( data + sizeof(header) + lines_size, sb->tokens,
+                tokens_size );
+
+    if ( sb->pool_used > 0 )
+        memcpy( data + sizeof(header) + lines_size + tokens_size, sb->pool,
+                sb->pool_used );
+
+    return set_views( image, hash );
+} /* end build_image() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: pool_add                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          script_builder* sb: the image being built.               */
+/*          const char* text: string to add to its pool.             */
+/*          uint64_t* offset: set to where it went.                  */
+/*                                                                   */
+/*********************************************************************/
+static int pool_add( script_builder* sb, const char* text, uint64_t* offset )
+{
+    size_t len = strlen( text ) + 1, size;
+    char* grown;
+
+    if ( sb->pool_used + len > sb->pool_cap )
+    {
+        size = ( sb->pool_cap == 0 ? SCRIPT_POOL_SIZE : sb->pool_cap * 2 );
+
+        while ( size < sb->pool_used + len )
+            size *= 2;
+
+        if ( ( grown = realloc( sb->pool, size ) ) == NULL )
+            return FAILURE;
+
+        sb->pool = grown;
+        sb->pool_cap = size;
+    }
+
+    memcpy( sb->pool + sb->pool_used, text, len );
+    *offset = sb->pool_used;
+    sb->pool_used += len;
+
+    return SUCCESS;
+} /* end pool_add() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: token_add                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          script_builder* sb: the image being built.               */
+/*          uint64_t offset: a word's place in the pool.             */
+/*                                                                   */
+/*********************************************************************/
+static int token_add( script_builder* sb, uint64_t offset )
+{
+    uint32_t size;
+    uint64_t* grown;
+
+    if ( sb->n_tokens == sb->token_cap )
+    {
+        size = ( sb->token_cap == 0 ? SCRIPT_TOKEN_COUNT :
+                                      sb->token_cap * 2 );
+
+        if ( ( grown = realloc( sb->tokens, size * sizeof(uint64_t) ) )
+             == NULL )
+            return FAILURE;
+
+        sb->tokens = grown;
+        sb->token_cap = size;
+    }
+
+    sb->tokens[sb->n_tokens++] = offset;
+    return SUCCESS;
+} /* end token_add() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_blank_line                                 */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* line: a line of the script.                  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T for an empty line or a "#" comment, "#!" included.     */
+/*                                                                   */
+/*********************************************************************/
+static int is_blank_line( const char* line )
+{
+    while ( isspace( (unsigned char) *line ) )
+        line++;
+
+    return ( *line == '\0' || *line == '#' ? T : F );
+} /* end is_blank_line() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: save_cache                                    */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          const char* cache: path of the .jshc file.               */
+/*          const script_image* image: a compiled script.            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          writes the image to a temporary file and renames it      */
+/*          into place, so a run never maps a half written cache.    */
+/*          Failing to write it is not an error.                     */
+/*                                                                   */
+/*********************************************************************/
+static void save_cache( const char* cache, const script_image* image )
+{
+    char tmp[PATH_MAX];
+    const char* data = image->data;
+    size_t done = 0;
+    ssize_t n;
+    int fd;
+
+    if ( snprintf( tmp, sizeof(tmp), "%s.%d", cache, (int) getpid() )
+         >= (int) sizeof(tmp) ||
+         ( fd = open( tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644 ) )
+         == -1 )
+        return;
+
+    while ( done < image->size )
+    {
+        if ( ( n = write( fd, data + done, image->size - done ) ) == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+            break;
+        }
+
+        done += (size_t) n;
+    }
+
+    if ( close( fd ) == -1 || done != image->size ||
+         rename( tmp, cache ) == -1 )
+        unlink( tmp );
+} /* end save_cache() */
@@ -0,0 +1,101 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: script_cache.h                              */
+/*          Description:                                             */
+/*              This module compiles a script into an image of       */
+/*              already split lines and keeps it next to the script  */
+/*              as script.jshc. Later runs of an unchanged script    */
+/*              by a shell with the same LEXER_VERSION map the image */
+/*              and hand out each line's words without running the   */
+/*              lexer.                                               */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef SCRIPT_CACHE_H
+#define SCRIPT_CACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "./string_module.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define SCRIPT_CACHE_SUFFIX ".jshc"
+#define SCRIPT_CACHE_MAGIC "JSHC"
+#define SCRIPT_CACHE_FORMAT 2
+#define SCRIPT_POOL_SIZE 4096
+#define SCRIPT_TOKEN_COUNT 256
+
+/* 64 bit FNV-1a */
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+/* the start of a .jshc file, followed by the line table, the token
+ * table and the string pool */
+typedef struct script_header_t
+{
+    char        magic[4];
+    uint32_t    format;
+    uint64_t    lexer_version;
+    uint64_t    source_hash;
+    uint32_t    n_lines;
+    uint32_t    n_tokens;
+    uint64_t    pool_size;
+} script_header;
+
+/* one line of the script; comments and blank lines have no tokens */
+typedef struct script_line_t
+{
+    uint64_t    text;
+    uint32_t    first;
+    uint32_t    n_tokens;
+    uint32_t    n_pipes;
+    uint32_t    unused;
+} script_line;
+
+/* a loaded script and the line to run next */
+typedef struct script_image_t
+{
+    const script_header*    header;
+    const script_line*      lines;
+    const uint64_t*         tokens;
+    const char*             pool;
+    void*                   data;
+    size_t                  size;
+    int                     mapped;
+    int                     cached;
+    uint32_t                next;
+} script_image;
+
+/* the tables of an image while the script is being compiled */
+typedef struct script_builder_t
+{
+    script_line*    lines;
+    uint32_t        n_lines;
+    uint64_t*       tokens;
+    uint32_t        n_tokens;
+    uint32_t        token_cap;
+    char*           pool;
+    size_t          pool_used;
+    size_t          pool_cap;
+} script_builder;
+
+/* function prototypes */
+uint64_t    fnv1a( const void* data, size_t len, uint64_t hash );
+int         load_script( const char* path, script_image* image );
+int         script_words( const script_image* image, uint32_t line,
+                          char*** cmds, int* n_cmds, int* n_pipes );
+const char* script_text( const script_image* image, uint32_t line );
+void        free_script( script_image* image );
+
+#endif
@@ -0,0 +1,224 @@
+#include "shell_options.h"
+
+/* globals */
+int options[N_OPTIONS] =
+{
+    [OPT_ZEROCOPY] = 1,
+    [OPT_GLOB] = 1
+};
+
+long settings[N_SETTINGS];
+
+static const char* setting_names[N_SETTINGS] =
+{
+    "pipesize",
+    "batchjobs"
+};
+
+static const char* setting_help[N_SETTINGS] =
+{
+    "bytes of buffer in each pipeline pipe (K, M suffixes)",
+    "argbatch runs of one command to have going at once"
+};
+
+static const char* option_names[N_OPTIONS] =
+{
+    "optimize",
+    "trace",
+    "zerocopy",
+    "glob",
+    "argbatch",
+    "jobmux",
+    "meter"
+};
+
+static const char* option_help[N_OPTIONS] =
+{
+    "rewrite pipelines to use fewer processes",
+    "print commands and rewrites before running them",
+    "run cat and tee as builtins that copy in the kernel",
+    "expand *, ?, [...] and ** in words",
+    "split argument lists over ARG_MAX, run xargs as a builtin",
+    "prefix background job output lines with [job-id]",
+    "report throughput and backpressure of every pipeline"
+};
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: set_option                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* name: option to change.                      */
+/*          int on: non-zero to turn it on.                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns FAILURE if there is no option called name.       */
+/*                                                                   */
+/*********************************************************************/
+int set_option( const char* name, int on )
+{
+    for ( int i = 0; i < N_OPTIONS; i++ )
+    {
+        if ( strcmp( option_names[i], name ) == 0 )
+        {
+            options[i] = ( on != 0 );
+            return SUCCESS;
+        }
+    }
+
+    fprintf( stderr, "Error: No such option: %s\n", name );
+    return FAILURE;
+} /* end set_option() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: set_setting                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* name: setting to change.                     */
+/*          const char* value: new value, see parse_size().          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns FAILURE if there is no such setting or the       */
+/*          value is not a size.                                     */
+/*                                                                   */
+/*********************************************************************/
+int set_setting( const char* name, const char* value )
+{
+    long size;
+
+    for ( int i = 0; i < N_SETTINGS; i++ )
+    {
+        if ( strcmp( setting_names[i], name ) != 0 )
+            continue;
+
+        if ( ( size = parse_size( value ) ) < 0 )
+        {
+            fprintf( stderr, "Error: Bad value for %s: %s\n", name, value );
+            return FAILURE;
+        }
+
+        settings[i] = size;
+        return SUCCESS;
+    }
+
+    fprintf( stderr, "Error: No such setting: %s\n", name );
+    return FAILURE;
+} /* end set_setting() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_size                                    */
+/*      Return type:   long                                          */
+/*      Parameter(s):                                                */
+/*          const char* value: a number with an optional K, M or G   */
+/*                             suffix, in powers of 1024.            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the size in bytes, or -1 if value isn't one.     */
+/*                                                                   */
+/*********************************************************************/
+long parse_size( const char* value )
+{
+    char* end;
+    long size;
+
+    if ( value[0] < '0' || value[0] > '9' )
+        return -1;
+
+    size = strtol( value, &end, 10 );
+
+    switch ( *end )
+    {
+        case 'k': case 'K':
+            size <<= 10;
+            end++;
+            break;
+        case 'm': case 'M':
+            size <<= 20;
+            end++;
+            break;
+        case 'g': case 'G':
+            size <<= 30;
+            end++;
+            break;
+    }
+
+    return ( *end == '\0' ? size : -1 );
+} /* end parse_size() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: print_options                                 */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          FILE* fp: stream to print to.                            */
+/*                                                                   */
+/*********************************************************************/
+void print_options( FILE* fp )
+{
+    for ( int i = 0; i < N_OPTIONS; i++ )
+        fprintf( fp, "%-12s %-8s %s\n", option_names[i],
+                 options[i] ? "on" : "off", option_help[i] );
+
+    for ( int i = 0; i < N_SETTINGS; i++ )
+    {
+        if ( settings[i] == 0 )
+            fprintf( fp, "%-12s %-8s %s\n", setting_names[i], "default",
+                     setting_help[i] );
+        else
+            fprintf( fp, "%-12s %-8ld %s\n", setting_names[i], settings[i],
+                     setting_help[i] );
+    }
+} /* end print_options() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_set                                       */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** args: the parsed set command line.                */
+/*          int n_args: number of strings in args.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          "set -o" lists the options, "set -o name" turns one on,  */
+/*          "set +o name" turns it off and "set name=value" changes  */
+/*          a setting. The lexer hands "=" over as its own word.     */
+/*                                                                   */
+/*********************************************************************/
+int run_set( char** args, int n_args )
+{
+    int status = SUCCESS;
+
+    if ( n_args == 1 || ( n_args == 2 && strcmp( args[1], "-o" ) == 0 ) )
+    {
+        print_options( stdout );
+        return SUCCESS;
+    }
+
+    for ( int i = 1; i < n_args; i++ )
+    {
+        if ( i + 1 < n_args && strcmp( args[i], "-o" ) == 0 )
+            status &= set_option( args[++i], 1 );
+        else if ( i + 1 < n_args && strcmp( args[i], "+o" ) == 0 )
+            status &= set_option( args[++i], 0 );
+        else if ( i + 2 < n_args && strcmp( args[i + 1], "=" ) == 0 )
+        {
+            status &= set_setting( args[i], args[i + 2] );
+            i += 2;
+        }
+        else
+        {
+            fprintf( stderr, "usage: set [-o | +o] [option] | "
+                             "set name=value\n" );
+            return FAILURE;
+        }
+    }
+
+    return status;
+} /* end run_set() */
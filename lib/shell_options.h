@@ -0,0 +1,58 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: shell_options.h                             */
+/*          Description:                                             */
+/*              This module provides the on/off options changed      */
+/*              with "set -o name" and "set +o name", and the        */
+/*              numeric settings changed with "set name=value".      */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef SHELL_OPTIONS_H
+#define SHELL_OPTIONS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+
+/* every option the shell knows about */
+typedef enum shell_option_t
+{
+    OPT_OPTIMIZE,
+    OPT_TRACE,
+    OPT_ZEROCOPY,
+    OPT_GLOB,
+    OPT_ARGBATCH,
+    OPT_JOBMUX,
+    OPT_METER,
+    N_OPTIONS
+} shell_option;
+
+/* every numeric setting, 0 means the system default */
+typedef enum shell_setting_t
+{
+    SET_PIPESIZE,
+    SET_BATCHJOBS,
+    N_SETTINGS
+} shell_setting;
+
+/* globals */
+extern int options[N_OPTIONS];
+extern long settings[N_SETTINGS];
+
+/* cheap enough to test on every command */
+#define OPTION( opt ) ( options[(opt)] )
+#define SETTING( set ) ( settings[(set)] )
+
+/* function prototypes */
+int     set_option( const char* name, int on );
+int     set_setting( const char* name, const char* value );
+long    parse_size( const char* value );
+void    print_options( FILE* fp );
+int     run_set( char** args, int n_args );
+
+#endif
@@ -0,0 +1,549 @@
+#include "spawn_server.h"
+#include "./execution.h"
+
+/* globals */
+static int      server_fd = -1;
+static pid_t    server_pid = 0;
+static int      attached = 0;
+static char     msg[SPAWN_MSG_MAX];
+
+/* local prototypes */
+static void     serve( int );
+static void     serve_request( int );
+static void     report_exits( int, int );
+static int      send_event( int, spawn_event_type, pid_t, int,
+                            const struct rusage* );
+static int      pack_strings( size_t*, char** );
+static void     handle_event( const spawn_event* );
+static void     read_events( int );
+static void     lose_server( void );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: start_spawn_server                            */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          forks the spawn helper, connected to the shell by a      */
+/*          SOCK_SEQPACKET socketpair so every request and every     */
+/*          event is one message. Call it early, while the shell     */
+/*          is small: the helper keeps the address space it had at   */
+/*          this point and forks from that. Returns FAILURE and      */
+/*          leaves the shell forking for itself if it can't start.   */
+/*                                                                   */
+/*********************************************************************/
+int start_spawn_server( void )
+{
+    int sv[2];
+    pid_t pid;
+
+    if ( socketpair( AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv ) == -1 )
+    {
+        fprintf( stderr, "Error: Could not create spawn helper socket.\n" );
+        return FAILURE;
+    }
+
+    fflush( NULL );
+
+    if ( ( pid = fork() ) == -1 )
+    {
+        fprintf( stderr, "Error: Could not fork spawn helper.\n" );
+        close( sv[0] );
+        close( sv[1] );
+        return FAILURE;
+    }
+
+    if ( pid == 0 )
+    {
+        close( sv[0] );
+        serve( sv[1] );
+        _exit( EXIT_SUCCESS );
+    }
+
+    close( sv[1] );
+    server_fd = sv[0];
+    server_pid = pid;
+    attached = 0;
+
+    return SUCCESS;
+} /* end start_spawn_server() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: stop_spawn_server                             */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          closes the shell's end of the socket; the helper exits   */
+/*          when it sees EOF and is reaped here. Forked copies of    */
+/*          the shell call this too so they never talk over the      */
+/*          parent's requests; the helper isn't their child, so      */
+/*          waitpid() returns at once for them.                      */
+/*                                                                   */
+/*********************************************************************/
+void stop_spawn_server( void )
+{
+    if ( server_fd == -1 )
+        return;
+
+    if ( attached )
+        forget_source( server_fd );
+
+    close( server_fd );
+
+    while ( waitpid( server_pid, NULL, 0 ) == -1 && errno == EINTR )
+        continue;
+
+    server_fd = -1;
+    server_pid = 0;
+    attached = 0;
+} /* end stop_spawn_server() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: spawn_server_active                           */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*********************************************************************/
+int spawn_server_active( void )
+{
+    return ( server_fd != -1 );
+} /* end spawn_server_active() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: remote_spawn                                  */
+/*      Return type:   pid_t                                         */
+/*      Parameter(s):                                                */
+/*          int fd_in: descriptor to use as the child's stdin.       */
+/*          int fd_out: descriptor to use as the child's stdout.     */
+/*          const char* path: resolved program, NULL to search PATH. */
+/*          char** prog: NULL terminated argv of the program.        */
+/*          pid_t pgid: process group to put the child in.           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          asks the helper to start prog with the shell's current   */
+/*          environment and working directory. The descriptors go    */
+/*          along with SCM_RIGHTS. The child is registered with the  */
+/*          supervisor, which learns of its exit from the helper.    */
+/*          Returns the pid, or -1 if the caller should fork itself. */
+/*                                                                   */
+/*********************************************************************/
+pid_t remote_spawn( int fd_in, int fd_out, const char* path, char** prog,
+                    pid_t pgid )
+{
+    extern char** environ;
+    spawn_request* req = (spawn_request*) msg;
+    spawn_event ev;
+    size_t len = sizeof(spawn_request);
+    char* one[2] = { (char*) path, NULL };
+    int fds[SPAWN_N_FDS];
+    char cbuf[CMSG_SPACE( sizeof(fds) )];
+    struct iovec iov;
+    struct msghdr mh;
+    struct cmsghdr* cm;
+    ssize_t n;
+
+    if ( server_fd == -1 )
+        return -1;
+
+    /* exit events arrive on the same socket, let the loop read them */
+    if ( !attached )
+        attached = watch_source( server_fd, read_events );
+
+    req->has_path = ( path != NULL );
+    req->pgid = pgid;
+
+    if ( ( path != NULL && pack_strings( &len, one ) == FAILURE ) ||
+         ( req->argc = pack_strings( &len, prog ) ) == FAILURE ||
+         ( req->envc = pack_strings( &len, environ ) ) == FAILURE )
+        return -1;
+
+    /* counts were returned plus one so that zero strings isn't FAILURE */
+    req->argc--;
+    req->envc--;
+
+    if ( ( fds[3] = open( ".", O_PATH | O_DIRECTORY | O_CLOEXEC ) ) == -1 )
+        return -1;
+
+    fds[0] = fd_in;
+    fds[1] = fd_out;
+    fds[2] = STDERR_FILENO;
+
+    iov.iov_base = msg;
+    iov.iov_len = len;
+
+    memset( &mh, 0, sizeof(mh) );
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = cbuf;
+    mh.msg_controllen = sizeof(cbuf);
+
+    cm = CMSG_FIRSTHDR( &mh );
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN( sizeof(fds) );
+    memcpy( CMSG_DATA( cm ), fds, sizeof(fds) );
+
+    while ( ( n = sendmsg( server_fd, &mh, MSG_NOSIGNAL ) ) == -1 &&
+            errno == EINTR )
+        continue;
+
+    close( fds[3] );
+
+    if ( n == -1 )
+    {
+        lose_server();
+        return -1;
+    }
+
+    /* earlier children may report their exits ahead of our reply */
+    while ( 1 )
+    {
+        n = recv( server_fd, &ev, sizeof(ev), 0 );
+
+        if ( n == -1 && errno == EINTR )
+            continue;
+
+        if ( n != sizeof(ev) )
+        {
+            lose_server();
+            return -1;
+        }
+
+        if ( ev.type == SPAWN_STARTED )
+            break;
+
+        handle_event( &ev );
+    }
+
+    if ( ev.pid > 0 )
+        watch_remote_child( ev.pid );
+
+    return ( ev.pid > 0 ? ev.pid : -1 );
+} /* end remote_spawn() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: serve                                         */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          int sock: helper's end of the socketpair.                */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the helper's main loop. It sleeps in poll() until either */
+/*          a request or a SIGCHLD arrives, and returns once the     */
+/*          shell closes its end.                                    */
+/*                                                                   */
+/*********************************************************************/
+static void serve( int sock )
+{
+    struct pollfd fds[2];
+    sigset_t mask;
+    int sfd;
+
+    prctl( PR_SET_NAME, SPAWN_SERVER_NAME, 0, 0, 0 );
+
+    /* ctrl-c at the prompt is for the shell's programs, not for us */
+    signal( SIGINT, SIG_IGN );
+    signal( SIGQUIT, SIG_IGN );
+
+    sigemptyset( &mask );
+    sigaddset( &mask, SIGCHLD );
+    sigprocmask( SIG_BLOCK, &mask, NULL );
+
+    if ( ( sfd = signalfd( -1, &mask, SFD_NONBLOCK | SFD_CLOEXEC ) ) == -1 )
+        return;
+
+    fds[0].fd = sock;
+    fds[0].events = POLLIN;
+    fds[1].fd = sfd;
+    fds[1].events = POLLIN;
+
+    while ( 1 )
+    {
+        if ( poll( fds, 2, -1 ) == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            return;
+        }
+
+        if ( fds[1].revents & POLLIN )
+            report_exits( sock, sfd );
+
+        if ( fds[0].revents & ( POLLHUP | POLLERR ) &&
+             !( fds[0].revents & POLLIN ) )
+            return;
+
+        if ( fds[0].revents & POLLIN )
+            serve_request( sock );
+    }
+} /* end serve() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: serve_request                                 */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          int sock: helper's end of the socketpair.                */
+/*                                                                   */
+/*      Description:                                                 */
+/*          reads one request, forks and execs it and replies with   */
+/*          the new pid (-1 if it couldn't be started).              */
+/*                                                                   */
+/*********************************************************************/
+static void serve_request( int sock )
+{
+    extern char** environ;
+    spawn_request req;
+    char cbuf[CMSG_SPACE( sizeof(int) * SPAWN_N_FDS )];
+    int fds[SPAWN_N_FDS];
+    char* strings;
+    char** words;
+    const char* path = NULL;
+    struct iovec iov;
+    struct msghdr mh;
+    struct cmsghdr* cm;
+    ssize_t n;
+    pid_t pid = -1;
+
+    iov.iov_base = msg;
+    iov.iov_len = sizeof(msg);
+
+    memset( &mh, 0, sizeof(mh) );
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = cbuf;
+    mh.msg_controllen = sizeof(cbuf);
+
+    if ( ( n = recvmsg( sock, &mh, MSG_CMSG_CLOEXEC ) ) <= 0 )
+    {
+        /* the shell is gone */
+        if ( n == 0 )
+            _exit( EXIT_SUCCESS );
+
+        return;
+    }
+
+    cm = CMSG_FIRSTHDR( &mh );
+
+    if ( cm == NULL || cm->cmsg_type != SCM_RIGHTS ||
+         cm->cmsg_len != CMSG_LEN( sizeof(fds) ) ||
+         (size_t) n < sizeof(req) )
+    {
+        send_event( sock, SPAWN_STARTED, -1, 0, NULL );
+        return;
+    }
+
+    memcpy( fds, CMSG_DATA( cm ), sizeof(fds) );
+    memcpy( &req, msg, sizeof(req) );
+    msg[n - 1] = '\0';
+
+    if ( ( words = (char**) malloc( ( req.argc + req.envc + 2 ) *
+                                    sizeof(char*) ) ) != NULL )
+    {
+        /* point words at the packed path, argv and environment */
+        strings = msg + sizeof(req);
+
+        if ( req.has_path )
+        {
+            path = strings;
+            strings += strlen( strings ) + 1;
+        }
+
+        for ( int i = 0; i < req.argc + req.envc; i++ )
+        {
+            words[i + ( i >= req.argc )] = strings;
+            strings += strlen( strings ) + 1;
+        }
+
+        words[req.argc] = NULL;
+        words[req.argc + req.envc + 1] = NULL;
+
+        pid = fork();
+
+        if ( pid == 0 )
+        {
+            setpgid( 0, req.pgid );
+            fchdir( fds[3] );
+            dup2( fds[0], STDIN_FILENO );
+            dup2( fds[1], STDOUT_FILENO );
+            dup2( fds[2], STDERR_FILENO );
+
+            environ = &words[req.argc + 1];
+            exec_program( path, words );
+        }
+
+        free( words );
+    }
+
+    for ( int i = 0; i < SPAWN_N_FDS; i++ )
+        close( fds[i] );
+
+    send_event( sock, SPAWN_STARTED, pid, 0, NULL );
+} /* end serve_request() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: report_exits                                  */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          int sock: helper's end of the socketpair.                */
+/*          int sfd: signalfd the SIGCHLD arrived on.                */
+/*                                                                   */
+/*      Description:                                                 */
+/*          reaps every finished child of the helper and passes its  */
+/*          status and usage on to the shell.                        */
+/*                                                                   */
+/*********************************************************************/
+static void report_exits( int sock, int sfd )
+{
+    struct signalfd_siginfo info;
+    struct rusage usage;
+    int status;
+    pid_t pid;
+
+    while ( read( sfd, &info, sizeof(info) ) == sizeof(info) )
+        continue;
+
+    while ( ( pid = wait4( -1, &status, WNOHANG, &usage ) ) > 0 )
+        send_event( sock, SPAWN_EXITED, pid, status, &usage );
+} /* end report_exits() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: send_event                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int sock: helper's end of the socketpair.                */
+/*          spawn_event_type type: kind of event.                    */
+/*          pid_t pid: child concerned.                              */
+/*          int status: wait status for SPAWN_EXITED.                */
+/*          const struct rusage* usage: usage for SPAWN_EXITED.      */
+/*                                                                   */
+/*********************************************************************/
+static int send_event( int sock, spawn_event_type type, pid_t pid,
+                       int status, const struct rusage* usage )
+{
+    spawn_event ev;
+
+    memset( &ev, 0, sizeof(ev) );
+    ev.type = type;
+    ev.pid = pid;
+    ev.status = status;
+
+    if ( usage != NULL )
+        ev.usage = *usage;
+
+    while ( send( sock, &ev, sizeof(ev), MSG_NOSIGNAL ) == -1 )
+        if ( errno != EINTR )
+            return FAILURE;
+
+    return SUCCESS;
+} /* end send_event() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: pack_strings                                  */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          size_t* len: bytes of msg used so far, advanced.         */
+/*          char** strs: NULL terminated strings to append.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          copies strs into msg one after another. Returns one more */
+/*          than the number of strings, or FAILURE if msg is full.   */
+/*                                                                   */
+/*********************************************************************/
+static int pack_strings( size_t* len, char** strs )
+{
+    size_t n;
+    int count = 0;
+
+    for ( ; strs != NULL && strs[count] != NULL; count++ )
+    {
+        n = strlen( strs[count] ) + 1;
+
+        if ( *len + n > SPAWN_MSG_MAX )
+            return FAILURE;
+
+        memcpy( msg + *len, strs[count], n );
+        *len += n;
+    }
+
+    return count + 1;
+} /* end pack_strings() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_event                                  */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          const spawn_event* ev: event read from the helper.       */
+/*                                                                   */
+/*********************************************************************/
+static void handle_event( const spawn_event* ev )
+{
+    if ( ev->type == SPAWN_EXITED )
+        complete_child( ev->pid, ev->status, &ev->usage );
+} /* end handle_event() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: read_events                                   */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          int fd: shell's end of the socketpair.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          supervisor callback, reads every queued event.           */
+/*                                                                   */
+/*********************************************************************/
+static void read_events( int fd )
+{
+    spawn_event ev;
+    ssize_t n;
+
+    while ( ( n = recv( fd, &ev, sizeof(ev), MSG_DONTWAIT ) ) ==
+            sizeof(ev) )
+        handle_event( &ev );
+
+    if ( n == 0 || ( n == -1 && errno != EAGAIN && errno != EINTR ) )
+        lose_server();
+} /* end read_events() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: lose_server                                   */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the helper died. The shell goes back to forking itself.  */
+/*          Exits of the children it still had can't be learned      */
+/*          any more, so their waiters are released.                 */
+/*                                                                   */
+/*********************************************************************/
+static void lose_server( void )
+{
+    fprintf( stderr, "Error: Spawn helper exited, forking directly.\n" );
+    stop_spawn_server();
+    abandon_remote_children();
+} /* end lose_server() */
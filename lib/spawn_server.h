@@ -0,0 +1,79 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: spawn_server.h                              */
+/*          Description:                                             */
+/*              This module provides a small helper process, forked  */
+/*              while the shell is still tiny, that forks and execs  */
+/*              programs on the shell's behalf. The cost of a spawn  */
+/*              then no longer grows with the shell's own memory.    */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef SPAWN_SERVER_H
+#define SPAWN_SERVER_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/prctl.h>
+#include "./supervisor.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define SPAWN_SERVER_ENV "JSHELL_SPAWN_SERVER"
+#define SPAWN_SERVER_NAME "jshell-spawn"
+
+/* requests bigger than this are forked by the shell itself */
+#define SPAWN_MSG_MAX 65536
+
+/* stdin, stdout, stderr and the working directory */
+#define SPAWN_N_FDS 4
+
+/* fixed part of a request, followed by the path (if any), argv and
+ * environment as NUL terminated strings */
+typedef struct spawn_request_t
+{
+    int     argc;
+    int     envc;
+    int     has_path;
+    pid_t   pgid;
+} spawn_request;
+
+/* what the helper sends back */
+typedef enum spawn_event_type_t
+{
+    SPAWN_STARTED,
+    SPAWN_EXITED
+} spawn_event_type;
+
+typedef struct spawn_event_t
+{
+    spawn_event_type    type;
+    pid_t               pid;
+    int                 status;
+    struct rusage       usage;
+} spawn_event;
+
+/* function prototypes */
+int     start_spawn_server( void );
+void    stop_spawn_server( void );
+int     spawn_server_active( void );
+pid_t   remote_spawn( int fd_in, int fd_out, const char* path, char** prog,
+                      pid_t pgid );
+
+#endif
@@ -0,0 +1,387 @@
+#include "stage_attrs.h"
+
+/* local prototypes */
+static int  parse_pin( char**, int, stage_attrs* );
+static int  parse_nice( char**, int, stage_attrs* );
+static int  parse_ionice( char**, int, stage_attrs* );
+static int  parse_sched( char**, int, stage_attrs* );
+static int  parse_int( const char*, int* );
+static int  parse_level( char**, int, int* );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_stage_prefixes                          */
+/*      Return type:   char**                                        */
+/*      Parameter(s):                                                */
+/*          char** prog: NULL terminated words of one program.       */
+/*          stage_attrs* attrs: receives what the prefixes ask for.  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          reads any chain of these off the front of prog:          */
+/*              pin CPUS            e.g. pin 2-3, pin 0,2            */
+/*              nice [-n] N | -N    like nice(1), default 10         */
+/*              ionice -c C [-n L]  like ionice(1)                   */
+/*              ionice CLASS[:L]    idle, be or rt                   */
+/*              sched POLICY[:P]    other, batch, idle, fifo or rr   */
+/*          and returns the words of the program itself. Forms the   */
+/*          prefixes don't cover, or a prefix with no program after  */
+/*          it, leave prog alone so the real nice or ionice runs.    */
+/*          Returns NULL if a prefix is malformed.                   */
+/*                                                                   */
+/*********************************************************************/
+char** parse_stage_prefixes( char** prog, stage_attrs* attrs )
+{
+    int i = 0, next;
+
+    memset( attrs, 0, sizeof(stage_attrs) );
+
+    while ( prog[i] != NULL )
+    {
+        if ( strcmp( prog[i], "pin" ) == 0 )
+            next = parse_pin( prog, i + 1, attrs );
+        else if ( strcmp( prog[i], "nice" ) == 0 )
+            next = parse_nice( prog, i + 1, attrs );
+        else if ( strcmp( prog[i], "ionice" ) == 0 )
+            next = parse_ionice( prog, i + 1, attrs );
+        else if ( strcmp( prog[i], "sched" ) == 0 )
+            next = parse_sched( prog, i + 1, attrs );
+        else
+            break;
+
+        if ( next == -1 )
+            return NULL;
+
+        if ( next == 0 )
+            break;
+
+        i = next;
+    }
+
+    /* nothing left to run, let the first word run as a program */
+    if ( i == 0 || prog[i] == NULL )
+    {
+        memset( attrs, 0, sizeof(stage_attrs) );
+        return prog;
+    }
+
+    attrs->any = 1;
+    return &prog[i];
+} /* end parse_stage_prefixes() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: apply_stage_attrs                             */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          const stage_attrs* attrs: what to change.                */
+/*                                                                   */
+/*      Description:                                                 */
+/*          called in the child after fork and before exec. A change */
+/*          the kernel refuses, e.g. a real-time policy without the  */
+/*          privilege for it, is reported and the program runs       */
+/*          anyway.                                                  */
+/*                                                                   */
+/*********************************************************************/
+void apply_stage_attrs( const stage_attrs* attrs )
+{
+    struct sched_param param;
+
+    if ( attrs->has_cpus &&
+         sched_setaffinity( 0, sizeof(cpu_set_t), &attrs->cpus ) == -1 )
+        fprintf( stderr, "Error: pin: %s\n", strerror( errno ) );
+
+    if ( attrs->has_sched )
+    {
+        param.sched_priority = attrs->priority;
+
+        if ( sched_setscheduler( 0, attrs->policy, &param ) == -1 )
+            fprintf( stderr, "Error: sched: %s\n", strerror( errno ) );
+    }
+
+    if ( attrs->has_nice &&
+         setpriority( PRIO_PROCESS, 0,
+                      getpriority( PRIO_PROCESS, 0 ) + attrs->nice ) == -1 )
+        fprintf( stderr, "Error: nice: %s\n", strerror( errno ) );
+
+    if ( attrs->has_ioprio &&
+         syscall( SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, attrs->ioprio )
+            == -1 )
+        fprintf( stderr, "Error: ionice: %s\n", strerror( errno ) );
+} /* end apply_stage_attrs() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_pin                                     */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: words of the program.                       */
+/*          int i: index of the first word after "pin".              */
+/*          stage_attrs* attrs: receives the cpu set.                */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the lexer splits "0,2-3" into "0" "," "2-3", so the list */
+/*          is glued back together first. Returns the index of the   */
+/*          word after the list, or -1 if it is malformed.           */
+/*                                                                   */
+/*********************************************************************/
+static int parse_pin( char** prog, int i, stage_attrs* attrs )
+{
+    char list[CPU_LIST_SIZE] = "";
+    char* p;
+    char* end;
+    long first, last;
+
+    if ( prog[i] == NULL )
+        return 0;
+
+    /* rebuild the list from its words */
+    do
+    {
+        if ( strlen( list ) + strlen( prog[i] ) + 2 > sizeof(list) )
+            break;
+
+        strcat( list, prog[i++] );
+
+        if ( prog[i] == NULL || strcmp( prog[i], "," ) != 0 )
+            break;
+
+        strcat( list, prog[i++] );
+    } while ( prog[i] != NULL );
+
+    CPU_ZERO( &attrs->cpus );
+
+    /* comma separated cpus and first-last ranges */
+    for ( p = strtok( list, "," ); p != NULL; p = strtok( NULL, "," ) )
+    {
+        first = last = strtol( p, &end, 10 );
+
+        if ( end != p && *end == '-' )
+            last = strtol( end + 1, &end, 10 );
+
+        if ( end == p || *end != '\0' || first < 0 || last < first ||
+             last >= CPU_SETSIZE )
+            break;
+
+        for ( long cpu = first; cpu <= last; cpu++ )
+            CPU_SET( (int) cpu, &attrs->cpus );
+    }
+
+    if ( p != NULL || CPU_COUNT( &attrs->cpus ) == 0 )
+    {
+        fprintf( stderr, "Error: pin: bad cpu list\n" );
+        return -1;
+    }
+
+    attrs->has_cpus = 1;
+    return i;
+} /* end parse_pin() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_nice                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: words of the program.                       */
+/*          int i: index of the first word after "nice".             */
+/*          stage_attrs* attrs: receives the increment.              */
+/*                                                                   */
+/*********************************************************************/
+static int parse_nice( char** prog, int i, stage_attrs* attrs )
+{
+    int inc = 10;
+
+    if ( prog[i] == NULL )
+        return 0;
+
+    if ( strcmp( prog[i], "-n" ) == 0 )
+    {
+        if ( prog[i + 1] == NULL || !parse_int( prog[i + 1], &inc ) )
+            return 0;
+
+        i += 2;
+    }
+    else if ( prog[i][0] == '-' && parse_int( prog[i] + 1, &inc ) )
+        i++;
+    else if ( parse_int( prog[i], &inc ) )
+        i++;
+    else if ( prog[i][0] == '-' )
+        return 0;
+
+    /* chained prefixes add up, like nested nice(1) */
+    attrs->nice += inc;
+    attrs->has_nice = 1;
+    return i;
+} /* end parse_nice() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_ionice                                  */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: words of the program.                       */
+/*          int i: index of the first word after "ionice".           */
+/*          stage_attrs* attrs: receives the I/O priority.           */
+/*                                                                   */
+/*********************************************************************/
+static int parse_ionice( char** prog, int i, stage_attrs* attrs )
+{
+    int class, level = IOPRIO_DEFAULT_LEVEL;
+
+    if ( prog[i] == NULL )
+        return 0;
+
+    if ( strcmp( prog[i], "-c" ) == 0 )
+    {
+        if ( prog[i + 1] == NULL || !parse_int( prog[i + 1], &class ) ||
+             class < IOPRIO_CLASS_RT || class > IOPRIO_CLASS_IDLE )
+            return 0;
+
+        i += 2;
+
+        if ( prog[i] != NULL && strcmp( prog[i], "-n" ) == 0 )
+        {
+            if ( prog[i + 1] == NULL || !parse_int( prog[i + 1], &level ) )
+                return 0;
+
+            i += 2;
+        }
+    }
+    else
+    {
+        if ( strcmp( prog[i], "idle" ) == 0 )
+            class = IOPRIO_CLASS_IDLE;
+        else if ( strcmp( prog[i], "be" ) == 0 )
+            class = IOPRIO_CLASS_BE;
+        else if ( strcmp( prog[i], "rt" ) == 0 )
+            class = IOPRIO_CLASS_RT;
+        else
+            return 0;
+
+        i = parse_level( prog, i + 1, &level );
+    }
+
+    if ( i == -1 || level < 0 || level > 7 )
+    {
+        fprintf( stderr, "Error: ionice: level must be 0 to 7\n" );
+        return -1;
+    }
+
+    attrs->ioprio = ( class << IOPRIO_CLASS_SHIFT ) |
+                    ( class == IOPRIO_CLASS_IDLE ? 0 : level );
+    attrs->has_ioprio = 1;
+
+    return i;
+} /* end parse_ionice() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_sched                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: words of the program.                       */
+/*          int i: index of the first word after "sched".            */
+/*          stage_attrs* attrs: receives the policy.                 */
+/*                                                                   */
+/*      Description:                                                 */
+/*          fifo and rr take a priority, "sched fifo:10", which the  */
+/*          lexer hands over as "fifo" ":" "10".                     */
+/*                                                                   */
+/*********************************************************************/
+static int parse_sched( char** prog, int i, stage_attrs* attrs )
+{
+    int realtime;
+
+    if ( prog[i] == NULL )
+        return 0;
+
+    if ( strcmp( prog[i], "other" ) == 0 )
+        attrs->policy = SCHED_OTHER;
+    else if ( strcmp( prog[i], "batch" ) == 0 )
+        attrs->policy = SCHED_BATCH;
+    else if ( strcmp( prog[i], "idle" ) == 0 )
+        attrs->policy = SCHED_IDLE;
+    else if ( strcmp( prog[i], "fifo" ) == 0 )
+        attrs->policy = SCHED_FIFO;
+    else if ( strcmp( prog[i], "rr" ) == 0 )
+        attrs->policy = SCHED_RR;
+    else
+    {
+        fprintf( stderr, "Error: sched: unknown policy: %s\n", prog[i] );
+        return -1;
+    }
+
+    realtime = ( attrs->policy == SCHED_FIFO || attrs->policy == SCHED_RR );
+    i = parse_level( prog, i + 1, &attrs->priority );
+
+    if ( i == -1 || ( realtime &&
+         ( attrs->priority < sched_get_priority_min( attrs->policy ) ||
+           attrs->priority > sched_get_priority_max( attrs->policy ) ) ) ||
+         ( !realtime && attrs->priority != 0 ) )
+    {
+        fprintf( stderr, "Error: sched: bad priority for %s\n",
+                 realtime ? "a real-time policy" : "this policy" );
+        return -1;
+    }
+
+    attrs->has_sched = 1;
+    return i;
+} /* end parse_sched() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_level                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: words of the program.                       */
+/*          int i: index just after a class or policy name.          */
+/*          int* level: set if ":N" follows, left alone otherwise.   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the index after the optional ":N", or -1 if the  */
+/*          ":" isn't followed by a number.                          */
+/*                                                                   */
+/*********************************************************************/
+static int parse_level( char** prog, int i, int* level )
+{
+    if ( prog[i] == NULL || strcmp( prog[i], ":" ) != 0 )
+        return i;
+
+    if ( prog[i + 1] == NULL || !parse_int( prog[i + 1], level ) )
+        return -1;
+
+    return i + 2;
+} /* end parse_level() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_int                                     */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* word: text to convert.                       */
+/*          int* value: set to the number if word is one.            */
+/*                                                                   */
+/*********************************************************************/
+static int parse_int( const char* word, int* value )
+{
+    char* end;
+    long n;
+
+    if ( *word == '\0' )
+        return 0;
+
+    n = strtol( word, &end, 10 );
+
+    if ( *end != '\0' )
+        return 0;
+
+    *value = (int) n;
+    return 1;
+} /* end parse_int() */
@@ -0,0 +1,62 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: stage_attrs.h                               */
+/*          Description:                                             */
+/*              This module provides the pin, nice, ionice and       */
+/*              sched prefixes. They are read off the front of a     */
+/*              program's words and applied in its child right       */
+/*              before exec, so no wrapper process is needed.        */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef STAGE_ATTRS_H
+#define STAGE_ATTRS_H
+
+/* for sched_setaffinity() and the CPU_* macros */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define CPU_LIST_SIZE 256
+
+/* I/O scheduling classes, as in linux/ioprio.h */
+#define IOPRIO_CLASS_RT 1
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_DEFAULT_LEVEL 4
+
+/* what to change in a child before it runs */
+typedef struct stage_attrs_t
+{
+    int         any;
+    int         has_cpus;
+    cpu_set_t   cpus;
+    int         has_nice;
+    int         nice;
+    int         has_ioprio;
+    int         ioprio;
+    int         has_sched;
+    int         policy;
+    int         priority;
+} stage_attrs;
+
+/* function prototypes */
+char**  parse_stage_prefixes( char** prog, stage_attrs* attrs );
+void    apply_stage_attrs( const stage_attrs* attrs );
+
+#endif
@@ -226,9 +226,10 @@ int parse_string( char* line, char*** cmds, int* n_cmds, int* n_pipes )
     {
         /* special characters to watch out for */
         if ( line[i] == '$' || line[i] == '|' || line[i] == '<' || 
-             line[i] == '>' || line[i] == '&' || line[i] == '?' ||
-             line[i] == '!' || line[i] == ',' || line[i] == '=' || 
-             line[i] == ':'
+             line[i] == '>' || line[i] == '&' || line[i] == '(' ||
+             line[i] == ')' || line[i] == '`' || line[i] == ';' ||
+             ( ( line[i] == '!' || line[i] == ',' || line[i] == '=' ||
+                 line[i] == ':' ) && !in_group( cmd ) )
            )
         {
             /* Count pipes */
@@ -240,6 +241,16 @@ int parse_string( char* line, char*** cmds, int* n_cmds, int* n_pipes )
                 add_string( &cmd, cmds, n_cmds );
 
             build_string( line[i], &cmd );
+
+            /* "<(" and ">(" open a process substitution */
+            if ( ( line[i] == '<' || line[i] == '>' ) && line[i + 1] == '(' )
+                build_string( line[++i], &cmd );
+
+            /* "<<" is a here-document, "<<<" a here-string */
+            else if ( line[i] == '<' )
+                while ( line[i + 1] == '<' && strlen( cmd ) < 3 )
+                    build_string( line[++i], &cmd );
+
             add_string( &cmd, cmds, n_cmds );
         }
         else if ( i == line_size - 1 ) /* end of line */
@@ -276,12 +287,9 @@ int parse_string( char* line, char*** cmds, int* n_cmds, int* n_pipes )
             if ( cmd != NULL )
                 add_string( &cmd, cmds, n_cmds );
 
-            /* if more than one space */
+            /* if more than one space, indentation included */
             while ( isspace( line[i + 1] ) )
-                build_string( line[i++], &cmd );
-
-            if ( cmd != NULL )
-                add_string( &cmd, cmds, n_cmds );
+                i++;
         }
         else /* everything else */
             build_string( line[i], &cmd ); 
@@ -290,6 +298,43 @@ int parse_string( char* line, char*** cmds, int* n_cmds, int* n_pipes )
 } /* end split_input() */
 
 
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: in_group                                      */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* word: the word built so far, may be NULL.    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns T if word ends inside an unclosed "[" or "{",    */
+/*          so that glob sets like [!a] and [[:digit:]] and brace    */
+/*          lists like {a,b} stay one word.                          */
+/*                                                                   */
+/*********************************************************************/
+int in_group( const char* word )
+{
+    const char* open;
+    int depth = 0;
+
+    if ( word == NULL )
+        return F;
+
+    if ( ( open = strrchr( word, '[' ) ) != NULL &&
+         strchr( open, ']' ) == NULL )
+        return T;
+
+    for ( ; *word != '\0'; word++ )
+    {
+        if ( *word == '{' )
+            depth++;
+        else if ( *word == '}' && depth > 0 )
+            depth--;
+    }
+
+    return ( depth > 0 ? T : F );
+} /* end in_group() */
+
+
 /*********************************************************************/
 /*                                                                   */
 /*      Function name: find_string                                   */
@@ -314,3 +359,64 @@ int find_string( const char* str, char*** arr, int arr_size )
     }
     return -1;
 }
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: splice_strings                                */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char*** arr: pointer to array we are adjusting.          */
+/*          int* arr_size: pointer to number of strings in arr.      */
+/*          int start: index of the first string to replace.         */
+/*          int n_remove: number of strings to remove at start.      */
+/*          char** insert: strings to put in their place.            */
+/*          int n_insert: number of strings in insert.               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          replaces n_remove strings of arr with copies of the      */
+/*          strings in insert, shifting the rest of arr as needed.   */
+/*          Removed strings are freed and arr stays NULL             */
+/*          terminated.                                              */
+/*                                                                   */
+/*********************************************************************/
+int splice_strings( char*** arr, int* arr_size, int start, int n_remove,
+                    char** insert, int n_insert )
+{
+    int new_size = *arr_size - n_remove + n_insert;
+    int tail = *arr_size - start - n_remove;
+    char** grown;
+
+    /* free what is being replaced */
+    for ( int i = start; i < start + n_remove; i++ )
+    {
+        free( (*arr)[i] );
+        (*arr)[i] = NULL;
+    }
+
+    /* grow before shifting right */
+    if ( new_size > *arr_size )
+    {
+        if ( ( grown = (char**) realloc( *arr, ( new_size + 1 )
+                                         * sizeof(char*) ) ) == NULL )
+            return FAILURE;
+
+        *arr = grown;
+    }
+
+    /* move the tail to its new position */
+    memmove( &(*arr)[start + n_insert], &(*arr)[start + n_remove],
+             tail * sizeof(char*) );
+
+    /* copy new strings in */
+    for ( int i = 0; i < n_insert; i++ )
+    {
+        if ( ( (*arr)[start + i] = strdup( insert[i] ) ) == NULL )
+            return FAILURE;
+    }
+
+    *arr_size = new_size;
+    (*arr)[*arr_size] = NULL;
+
+    return SUCCESS;
+} /* end splice_strings() */
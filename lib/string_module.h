@@ -20,6 +20,10 @@
 #define T 1
 #define F 0
 
+/* bump whenever parse_string() would split a line differently, the
+ * script cache keeps its words (see script_cache.h) */
+#define LEXER_VERSION 1
+
 /* function prototypes */
 int 	build_string( char, char** );
 int 	parse_string( char* line, char*** cmds, int* n_cmds, int* n_pipes );
@@ -27,5 +31,7 @@ int     add_string( char**, char***, int* );
 int     add_strings( char***, char***, int, int );
 int 	move_strings_down( char***, int*, int, int );
 int		find_string( const char*, char***, int );
+int     splice_strings( char***, int*, int, int, char**, int );
+int     in_group( const char* );
 
 #endif
\ No newline at end of file
@@ -0,0 +1,806 @@
+#include "supervisor.h"
+
+/* globals */
+static child    children[MAX_CHILDREN];
+static int      n_children = 0;
+static int      epoll_fd = -1;
+static int      signal_fd = -1;
+static int      next_job_id = 1;
+
+/* other descriptors serviced by the loop */
+static int            source_fds[MAX_SOURCES];
+static source_handler source_fns[MAX_SOURCES];
+static int            n_sources = 0;
+
+/* timeout applied to children started while it is set */
+static double   cmd_timeout = 0;
+static double   cmd_grace = DEFAULT_KILL_GRACE;
+
+/* saved handlers while the shell waits in the foreground */
+static struct sigaction saved_int, saved_quit;
+static int      n_ignoring = 0;
+
+/* local prototypes */
+static double   now_sec( void );
+static child*   find_child( pid_t );
+static void     collect_exits( void );
+static void     enforce_deadlines( void );
+static int      next_wakeup( int );
+static void     send_signal( child*, int );
+static void     forget_child( child* );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: init_supervisor                               */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          creates the epoll instance and a signalfd for SIGCHLD.   */
+/*          SIGCHLD stays blocked in the shell from here on and is   */
+/*          only ever read through the signalfd; exec_program()      */
+/*          unblocks it for the programs the shell runs. If this     */
+/*          fails, waits fall back to plain blocking wait4().        */
+/*                                                                   */
+/*********************************************************************/
+int init_supervisor( void )
+{
+    struct epoll_event ev;
+    sigset_t mask;
+
+    sigemptyset( &mask );
+    sigaddset( &mask, SIGCHLD );
+    sigprocmask( SIG_BLOCK, &mask, NULL );
+
+    if ( ( epoll_fd = epoll_create1( EPOLL_CLOEXEC ) ) == -1 )
+        return FAILURE;
+
+    if ( ( signal_fd = signalfd( -1, &mask, SFD_NONBLOCK | SFD_CLOEXEC ) )
+            == -1 )
+    {
+        close( epoll_fd );
+        epoll_fd = -1;
+        return FAILURE;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.fd = signal_fd;
+    epoll_ctl( epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev );
+
+    return SUCCESS;
+} /* end init_supervisor() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: reset_supervisor                              */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          called in a forked copy of the shell. The copy must not  */
+/*          share the parent's epoll instance or claim its           */
+/*          children, so it starts over with an empty table.         */
+/*                                                                   */
+/*********************************************************************/
+void reset_supervisor( void )
+{
+    for ( int i = 0; i < n_children; i++ )
+    {
+        if ( children[i].pidfd != -1 )
+            close( children[i].pidfd );
+
+        free( children[i].command );
+    }
+
+    n_children = 0;
+    n_sources = 0;
+    cmd_timeout = 0;
+
+    if ( epoll_fd != -1 )
+        close( epoll_fd );
+
+    if ( signal_fd != -1 )
+        close( signal_fd );
+
+    epoll_fd = signal_fd = -1;
+    init_supervisor();
+} /* end reset_supervisor() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: supervisor_fd                                 */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the epoll descriptor polls readable whenever a child     */
+/*          event is pending, so loops waiting on other descriptors  */
+/*          too can include it and then call supervisor_dispatch().  */
+/*                                                                   */
+/*********************************************************************/
+int supervisor_fd( void )
+{
+    return epoll_fd;
+} /* end supervisor_fd() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: watch_child                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          pid_t pid: child that was just forked.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          starts tracking pid. A pidfd makes its exit wake up the  */
+/*          loop directly; on kernels without pidfd_open() the       */
+/*          SIGCHLD signalfd does the same job. The current          */
+/*          command timeout, if any, is attached to it.              */
+/*                                                                   */
+/*********************************************************************/
+int watch_child( pid_t pid )
+{
+    struct epoll_event ev;
+    child* c;
+
+    if ( epoll_fd == -1 )
+        return FAILURE;
+
+    if ( n_children == MAX_CHILDREN )
+    {
+        fprintf( stderr, "Error: Too many child processes to track.\n" );
+        return FAILURE;
+    }
+
+    c = &children[n_children++];
+    memset( c, 0, sizeof(child) );
+    c->pid = pid;
+    c->pidfd = (int) syscall( SYS_pidfd_open, pid, 0 );
+
+    if ( c->pidfd != -1 )
+    {
+        ev.events = EPOLLIN;
+        ev.data.fd = c->pidfd;
+        epoll_ctl( epoll_fd, EPOLL_CTL_ADD, c->pidfd, &ev );
+    }
+
+    if ( cmd_timeout > 0 )
+        c->deadline = now_sec() + cmd_timeout;
+
+    return SUCCESS;
+} /* end watch_child() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: supervisor_dispatch                           */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int timeout_ms: longest time to sleep, -1 for no limit.  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          sleeps until a child exits, a deadline passes or         */
+/*          timeout_ms runs out, then reaps whatever exited and      */
+/*          sends any due SIGTERM/SIGKILL. Exit statuses stay in the */
+/*          table until their owner collects them.                   */
+/*                                                                   */
+/*********************************************************************/
+int supervisor_dispatch( int timeout_ms )
+{
+    struct epoll_event events[MAX_EVENTS];
+    struct signalfd_siginfo info;
+    int n;
+
+    if ( epoll_fd == -1 )
+        return FAILURE;
+
+    n = epoll_wait( epoll_fd, events, MAX_EVENTS, next_wakeup( timeout_ms ) );
+
+    if ( n == -1 && errno != EINTR )
+        return FAILURE;
+
+    /* drain queued SIGCHLDs, the table scan below does the reaping */
+    for ( int i = 0; i < n; i++ )
+    {
+        if ( events[i].data.fd == signal_fd )
+        {
+            while ( read( signal_fd, &info, sizeof(info) ) == sizeof(info) )
+                continue;
+
+            continue;
+        }
+
+        for ( int j = 0; j < n_sources; j++ )
+            if ( events[i].data.fd == source_fds[j] )
+                source_fns[j]( source_fds[j] );
+    }
+
+    collect_exits();
+    enforce_deadlines();
+
+    return SUCCESS;
+} /* end supervisor_dispatch() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: wait_child                                    */
+/*      Return type:   pid_t                                         */
+/*      Parameter(s):                                                */
+/*          pid_t pid: child to wait for.                            */
+/*          int* status: set to its wait status.                     */
+/*          struct rusage* usage: set to its resource usage.         */
+/*          int options: 0 or WNOHANG.                               */
+/*          int* timed_out: set to 1 if it was killed by a timeout.  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          waits for one tracked child by running the event loop,   */
+/*          then removes it from the table. Events for other         */
+/*          children that arrive meanwhile are kept for their own    */
+/*          waiters. Untracked children are waited for directly.     */
+/*          Returns pid, 0 if WNOHANG and still running, or -1.      */
+/*                                                                   */
+/*********************************************************************/
+pid_t wait_child( pid_t pid, int* status, struct rusage* usage, int options,
+                  int* timed_out )
+{
+    child* c = find_child( pid );
+    pid_t w;
+
+    *timed_out = 0;
+
+    if ( c == NULL )
+    {
+        while ( ( w = wait4( pid, status, options, usage ) ) == -1 &&
+                errno == EINTR )
+            continue;
+
+        return w;
+    }
+
+    while ( !c->done )
+    {
+        if ( supervisor_dispatch( options & WNOHANG ? 0 : -1 ) == FAILURE &&
+             !c->done )
+        {
+            /* the loop is broken, block on the child instead */
+            if ( c->remote ||
+                 wait4( pid, &c->status, options, &c->usage ) != pid )
+                return ( options & WNOHANG ? 0 : -1 );
+
+            c->done = 1;
+        }
+
+        if ( options & WNOHANG )
+            break;
+    }
+
+    if ( !c->done )
+        return 0;
+
+    *status = c->status;
+    *usage = c->usage;
+    *timed_out = c->timed_out;
+    forget_child( c );
+
+    return pid;
+} /* end wait_child() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: watch_remote_child                            */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          pid_t pid: process started for the shell by a helper.    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          tracks a process the shell can't wait for itself. Its    */
+/*          owner reports the exit through complete_child(), so no   */
+/*          pidfd is kept for it: one would stay readable until      */
+/*          the real parent reaped it.                               */
+/*                                                                   */
+/*********************************************************************/
+int watch_remote_child( pid_t pid )
+{
+    child* c;
+
+    if ( watch_child( pid ) == FAILURE )
+        return FAILURE;
+
+    c = &children[n_children - 1];
+
+    if ( c->pidfd != -1 )
+    {
+        epoll_ctl( epoll_fd, EPOLL_CTL_DEL, c->pidfd, NULL );
+        close( c->pidfd );
+        c->pidfd = -1;
+    }
+
+    c->remote = 1;
+    return SUCCESS;
+} /* end watch_remote_child() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: complete_child                                */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          pid_t pid: remote child that exited.                     */
+/*          int status: its wait status.                             */
+/*          const struct rusage* usage: its resource usage.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          records the exit of a remote child so its waiter can     */
+/*          collect it like any other.                               */
+/*                                                                   */
+/*********************************************************************/
+int complete_child( pid_t pid, int status, const struct rusage* usage )
+{
+    child* c = find_child( pid );
+
+    if ( c == NULL || !c->remote )
+        return FAILURE;
+
+    c->status = status;
+    c->usage = *usage;
+    c->done = 1;
+
+    return SUCCESS;
+} /* end complete_child() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: abandon_remote_children                       */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the owner of the remote children went away. They are     */
+/*          marked done with status 127 so nobody waits forever.     */
+/*                                                                   */
+/*********************************************************************/
+void abandon_remote_children( void )
+{
+    for ( int i = 0; i < n_children; i++ )
+    {
+        if ( !children[i].remote || children[i].done )
+            continue;
+
+        memset( &children[i].usage, 0, sizeof(struct rusage) );
+        children[i].status = 127 << 8;
+        children[i].done = 1;
+    }
+} /* end abandon_remote_children() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: watch_source                                  */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int fd: descriptor to add to the loop.                   */
+/*          source_handler fn: called with fd when it is readable.   */
+/*                                                                   */
+/*********************************************************************/
+int watch_source( int fd, source_handler fn )
+{
+    struct epoll_event ev;
+
+    if ( epoll_fd == -1 || n_sources == MAX_SOURCES )
+        return FAILURE;
+
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+
+    if ( epoll_ctl( epoll_fd, EPOLL_CTL_ADD, fd, &ev ) == -1 )
+        return FAILURE;
+
+    source_fds[n_sources] = fd;
+    source_fns[n_sources] = fn;
+    n_sources++;
+
+    return SUCCESS;
+} /* end watch_source() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: forget_source                                 */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          int fd: descriptor added with watch_source().            */
+/*                                                                   */
+/*********************************************************************/
+void forget_source( int fd )
+{
+    for ( int i = 0; i < n_sources; i++ )
+    {
+        if ( source_fds[i] != fd )
+            continue;
+
+        epoll_ctl( epoll_fd, EPOLL_CTL_DEL, fd, NULL );
+        n_sources--;
+        source_fds[i] = source_fds[n_sources];
+        source_fns[i] = source_fns[n_sources];
+        return;
+    }
+} /* end forget_source() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: set_command_timeout                           */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          double secs: time limit, 0 to turn timeouts off.         */
+/*          double grace: time between SIGTERM and SIGKILL.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          children started while a timeout is set get SIGTERM      */
+/*          once it runs out and SIGKILL if still alive after the    */
+/*          grace period.                                            */
+/*                                                                   */
+/*********************************************************************/
+void set_command_timeout( double secs, double grace )
+{
+    cmd_timeout = secs;
+    cmd_grace = ( grace > 0 ? grace : DEFAULT_KILL_GRACE );
+} /* end set_command_timeout() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: ignore_interrupts                             */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          ignores ctrl-c & ctrl-\ while the shell waits for a      */
+/*          foreground command. Calls nest; the handlers come back   */
+/*          with the matching restore_interrupts().                  */
+/*                                                                   */
+/*********************************************************************/
+void ignore_interrupts( void )
+{
+    struct sigaction ign;
+
+    if ( n_ignoring++ > 0 )
+        return;
+
+    memset( &ign, 0, sizeof(ign) );
+    ign.sa_handler = SIG_IGN;
+    sigemptyset( &ign.sa_mask );
+    sigaction( SIGINT, &ign, &saved_int );
+    sigaction( SIGQUIT, &ign, &saved_quit );
+} /* end ignore_interrupts() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: restore_interrupts                            */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*********************************************************************/
+void restore_interrupts( void )
+{
+    if ( n_ignoring == 0 || --n_ignoring > 0 )
+        return;
+
+    sigaction( SIGINT, &saved_int, NULL );
+    sigaction( SIGQUIT, &saved_quit, NULL );
+} /* end restore_interrupts() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: add_job                                       */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          pid_t pid: tracked child running in the background.      */
+/*          const char* command: text to show in job reports.        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          turns a tracked child into a background job. Returns     */
+/*          the job number, or 0 if pid isn't tracked.               */
+/*                                                                   */
+/*********************************************************************/
+int add_job( pid_t pid, const char* command )
+{
+    child* c = find_child( pid );
+
+    if ( c == NULL )
+        return 0;
+
+    c->job_id = next_job_id++;
+    c->command = strdup( command );
+
+    return c->job_id;
+} /* end add_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: report_jobs                                   */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          int all: non-zero to list running jobs too.              */
+/*                                                                   */
+/*      Description:                                                 */
+/*          prints "[n] Done cmd" for every background job that has  */
+/*          finished and forgets it. With all set, running jobs are  */
+/*          listed as well (the "jobs" builtin).                     */
+/*                                                                   */
+/*********************************************************************/
+void report_jobs( int all )
+{
+    child* c;
+
+    supervisor_dispatch( 0 );
+
+    for ( int i = 0; i < n_children; i++ )
+    {
+        c = &children[i];
+
+        if ( c->job_id == 0 )
+            continue;
+
+        if ( !c->done )
+        {
+            if ( all )
+                printf( "[%d] Running\t%d\t%s\n", c->job_id, (int) c->pid,
+                        c->command );
+            continue;
+        }
+
+        if ( WIFEXITED( c->status ) && WEXITSTATUS( c->status ) == 0 )
+            printf( "[%d] Done\t\t%s\n", c->job_id, c->command );
+        else if ( WIFEXITED( c->status ) )
+            printf( "[%d] Exit %d\t\t%s\n", c->job_id,
+                    WEXITSTATUS( c->status ), c->command );
+        else
+            printf( "[%d] Killed (%d)\t%s\n", c->job_id,
+                    WTERMSIG( c->status ), c->command );
+
+        forget_child( c );
+        i--;
+    }
+
+    /* start numbering over once nothing is left in the background */
+    for ( int i = 0; i < n_children; i++ )
+        if ( children[i].job_id != 0 )
+            return;
+
+    next_job_id = 1;
+} /* end report_jobs() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: wait_jobs                                     */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int job_id: job to wait for, 0 for every job.            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          blocks in the event loop until the job(s) finish, then   */
+/*          reports them.                                            */
+/*                                                                   */
+/*********************************************************************/
+int wait_jobs( int job_id )
+{
+    int pending;
+
+    do
+    {
+        pending = 0;
+
+        for ( int i = 0; i < n_children; i++ )
+            if ( children[i].job_id != 0 && !children[i].done &&
+                 ( job_id == 0 || children[i].job_id == job_id ) )
+                pending = 1;
+
+        if ( pending && supervisor_dispatch( -1 ) == FAILURE )
+            return FAILURE;
+    } while ( pending );
+
+    report_jobs( 0 );
+    return SUCCESS;
+} /* end wait_jobs() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: now_sec                                       */
+/*      Return type:   double                                        */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*********************************************************************/
+static double now_sec( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+} /* end now_sec() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: find_child                                    */
+/*      Return type:   child*                                        */
+/*      Parameter(s):                                                */
+/*          pid_t pid: child to look up.                             */
+/*                                                                   */
+/*********************************************************************/
+static child* find_child( pid_t pid )
+{
+    for ( int i = 0; i < n_children; i++ )
+        if ( children[i].pid == pid )
+            return &children[i];
+
+    return NULL;
+} /* end find_child() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: collect_exits                                 */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          reaps every tracked child that has exited. Only pids in  */
+/*          the table are waited for, so nothing the shell doesn't   */
+/*          own is ever reaped by accident.                          */
+/*                                                                   */
+/*********************************************************************/
+static void collect_exits( void )
+{
+    child* c;
+
+    for ( int i = 0; i < n_children; i++ )
+    {
+        c = &children[i];
+
+        if ( c->done || c->remote )
+            continue;
+
+        if ( wait4( c->pid, &c->status, WNOHANG, &c->usage ) != c->pid )
+            continue;
+
+        c->done = 1;
+
+        if ( c->pidfd != -1 )
+        {
+            epoll_ctl( epoll_fd, EPOLL_CTL_DEL, c->pidfd, NULL );
+            close( c->pidfd );
+            c->pidfd = -1;
+        }
+    }
+} /* end collect_exits() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: enforce_deadlines                             */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          sends SIGTERM to children past their deadline and        */
+/*          SIGKILL to those still running after the grace period.   */
+/*                                                                   */
+/*********************************************************************/
+static void enforce_deadlines( void )
+{
+    double now = now_sec();
+    child* c;
+
+    for ( int i = 0; i < n_children; i++ )
+    {
+        c = &children[i];
+
+        if ( c->done || c->deadline == 0 )
+            continue;
+
+        if ( !c->timed_out && now >= c->deadline )
+        {
+            send_signal( c, SIGTERM );
+            c->timed_out = 1;
+            c->kill_at = now + cmd_grace;
+        }
+        else if ( c->timed_out && c->kill_at > 0 && now >= c->kill_at )
+        {
+            send_signal( c, SIGKILL );
+            c->kill_at = 0;
+        }
+    }
+} /* end enforce_deadlines() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: next_wakeup                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int timeout_ms: caller's limit, -1 for none.             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          milliseconds epoll_wait() may sleep before the nearest   */
+/*          deadline needs attention.                                */
+/*                                                                   */
+/*********************************************************************/
+static int next_wakeup( int timeout_ms )
+{
+    double now = now_sec(), due;
+    int ms;
+
+    for ( int i = 0; i < n_children; i++ )
+    {
+        if ( children[i].done || children[i].deadline == 0 )
+            continue;
+
+        due = ( children[i].timed_out ? children[i].kill_at
+                                      : children[i].deadline );
+        if ( due == 0 )
+            continue;
+
+        ms = ( due <= now ? 0 : (int)( ( due - now ) * 1000 ) + 1 );
+
+        if ( timeout_ms == -1 || ms < timeout_ms )
+            timeout_ms = ms;
+    }
+
+    return timeout_ms;
+} /* end next_wakeup() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: send_signal                                   */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          child* c: child to signal.                               */
+/*          int sig: signal to send.                                 */
+/*                                                                   */
+/*      Description:                                                 */
+/*          signals through the pidfd when there is one so a         */
+/*          recycled pid can never be hit.                           */
+/*                                                                   */
+/*********************************************************************/
+static void send_signal( child* c, int sig )
+{
+    if ( c->pidfd != -1 &&
+         syscall( SYS_pidfd_send_signal, c->pidfd, sig, NULL, 0 ) == 0 )
+        return;
+
+    kill( c->pid, sig );
+} /* end send_signal() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: forget_child                                  */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          child* c: reaped child to drop from the table.           */
+/*                                                                   */
+/*********************************************************************/
+static void forget_child( child* c )
+{
+    if ( c->pidfd != -1 )
+    {
+        epoll_ctl( epoll_fd, EPOLL_CTL_DEL, c->pidfd, NULL );
+        close( c->pidfd );
+    }
+
+    free( c->command );
+    *c = children[--n_children];
+} /* end forget_child() */
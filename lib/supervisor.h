@@ -0,0 +1,86 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: supervisor.h                                */
+/*          Description:                                             */
+/*              This module provides a single event loop that        */
+/*              tracks every child the shell starts, reaps them as   */
+/*              they exit, enforces per-command timeouts and keeps   */
+/*              the table of background jobs.                        */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define MAX_CHILDREN 256
+#define MAX_EVENTS 32
+#define MAX_SOURCES 4
+#define TIMEOUT_STATUS 124
+#define DEFAULT_KILL_GRACE 5.0
+
+/* one child the shell is responsible for */
+typedef struct child_t
+{
+    pid_t           pid;
+    int             pidfd;
+    int             done;
+    int             status;
+    struct rusage   usage;
+    int             timed_out;
+    double          deadline;
+    double          kill_at;
+    int             job_id;
+    char*           command;
+    int             remote;
+} child;
+
+/* called when an extra descriptor in the loop turns readable */
+typedef void (*source_handler)( int );
+
+/* function prototypes */
+int     init_supervisor( void );
+void    reset_supervisor( void );
+int     supervisor_fd( void );
+int     watch_child( pid_t );
+int     supervisor_dispatch( int );
+pid_t   wait_child( pid_t, int*, struct rusage*, int, int* );
+void    set_command_timeout( double, double );
+
+/* children forked by someone else on the shell's behalf */
+int     watch_remote_child( pid_t );
+int     complete_child( pid_t, int, const struct rusage* );
+void    abandon_remote_children( void );
+int     watch_source( int, source_handler );
+void    forget_source( int );
+
+/* foreground waits */
+void    ignore_interrupts( void );
+void    restore_interrupts( void );
+
+/* background jobs */
+int     add_job( pid_t, const char* );
+void    report_jobs( int );
+int     wait_jobs( int );
+
+#endif
@@ -0,0 +1,1077 @@
+#include "task_queue.h"
+
+/* globals */
+static queue_job*   jobs = NULL;
+static int          n_jobs = 0;
+static int          jobs_size = 0;
+static int          n_running = 0;
+static int          listen_fd = -1;
+static int          next_id = 1;
+static char         queue_path[QUEUE_PATH_SIZE];
+static job_runner   run_job = NULL;
+static char         msg[QUEUE_MSG_MAX];
+
+static const char* priority_names[N_PRIORITIES] =
+{
+    "high",
+    "normal",
+    "low"
+};
+
+static const char* state_names[N_STATES] =
+{
+    "queued",
+    "running",
+    "done",
+    "lost"
+};
+
+/* local prototypes */
+static int          open_queue_dir( void );
+static int          job_file( char*, int, const char* );
+static int          save_job( const queue_job* );
+static int          load_job( const char*, queue_job* );
+static void         load_jobs( void );
+static queue_job*   new_job( void );
+static queue_job*   find_job( int );
+static int          open_listener( const char* );
+static void         serve_client( int );
+static int          split_message( size_t, char*** );
+static void         submit_job( char**, int, FILE* );
+static void         list_jobs( FILE* );
+static void         print_job( const queue_job*, FILE* );
+static void         start_jobs( int );
+static void         start_job( queue_job* );
+static void         finish_job( queue_job*, int );
+static void         reap_jobs( void );
+static int          parse_priority( const char* );
+static int          send_request( char**, int );
+static int          show_log( const char* );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_queue_daemon                              */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int max_running: most jobs to run at once.               */
+/*          job_runner runner: starts one job's command line.        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          serves the queue until killed. Jobs left on disk by an   */
+/*          earlier daemon are loaded first; ones that were running  */
+/*          when it died are marked lost rather than run twice.      */
+/*          Returns FAILURE if the queue can't be set up.            */
+/*                                                                   */
+/*********************************************************************/
+int run_queue_daemon( int max_running, job_runner runner )
+{
+    char sock_path[QUEUE_PATH_SIZE];
+    struct pollfd fds[2];
+    int client_fd;
+
+    if ( open_queue_dir() == FAILURE )
+        return FAILURE;
+
+    run_job = runner;
+    load_jobs();
+
+    if ( snprintf( sock_path, sizeof(sock_path), "%s/%s", queue_path,
+                   QUEUE_SOCKET_NAME ) >= (int) sizeof(sock_path) )
+    {
+        fprintf( stderr, "Error: Queue path is too long: %s\n", queue_path );
+        return FAILURE;
+    }
+
+    if ( ( listen_fd = open_listener( sock_path ) ) == -1 )
+        return FAILURE;
+
+    /* a client that hangs up early must not kill the daemon */
+    signal( SIGPIPE, SIG_IGN );
+
+    printf( "queue daemon: %s, %d at a time\n", sock_path, max_running );
+    fflush( stdout );
+
+    while ( 1 )
+    {
+        start_jobs( max_running );
+
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = supervisor_fd();
+        fds[1].events = POLLIN;
+
+        if ( poll( fds, fds[1].fd == -1 ? 1 : 2, -1 ) == -1 &&
+             errno != EINTR )
+            break;
+
+        if ( fds[0].revents & POLLIN )
+        {
+            if ( ( client_fd = accept4( listen_fd, NULL, NULL,
+                                        SOCK_CLOEXEC ) ) != -1 )
+            {
+                serve_client( client_fd );
+                close( client_fd );
+            }
+        }
+
+        supervisor_dispatch( 0 );
+        reap_jobs();
+    }
+
+    fprintf( stderr, "Error: Queue daemon stopped: %s\n", strerror( errno ) );
+    close_queue_fds();
+    unlink( sock_path );
+    return FAILURE;
+} /* end run_queue_daemon() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: close_queue_fds                               */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          closes the daemon's listening socket. Forked subshells   */
+/*          call this so a job still running after the daemon dies   */
+/*          doesn't keep answering on the queue socket.              */
+/*                                                                   */
+/*********************************************************************/
+void close_queue_fds( void )
+{
+    if ( listen_fd != -1 )
+        close( listen_fd );
+
+    listen_fd = -1;
+} /* end close_queue_fds() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: queue_command                                 */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** args: the parsed jq command line.                 */
+/*          int n_args: number of strings in args.                   */
+/*          int* status: set to 0 if the command worked, else 1.     */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs "jq submit [-p high|normal|low] command ...",       */
+/*          "jq list", "jq status N" or "jq log N". Returns FAILURE  */
+/*          for anything else so the real jq still runs.             */
+/*                                                                   */
+/*********************************************************************/
+int queue_command( char** args, int n_args, int* status )
+{
+    char cwd[QUEUE_PATH_SIZE];
+    char** request;
+    int first = 2, n_request = 0, priority = PRIO_NORMAL, sent;
+
+    *status = 1;
+
+    if ( n_args < 2 )
+        return FAILURE;
+
+    if ( strcmp( args[1], "list" ) == 0 )
+    {
+        if ( send_request( args + 1, 1 ) == SUCCESS )
+            *status = 0;
+
+        return SUCCESS;
+    }
+
+    if ( strcmp( args[1], "status" ) == 0 || strcmp( args[1], "log" ) == 0 )
+    {
+        if ( n_args != 3 || atoi( args[2] ) <= 0 )
+            fprintf( stderr, "usage: jq %s job-id\n", args[1] );
+        else if ( ( args[1][0] == 's' ? send_request( args + 1, 2 ) :
+                                        show_log( args[2] ) ) == SUCCESS )
+            *status = 0;
+
+        return SUCCESS;
+    }
+
+    if ( strcmp( args[1], "submit" ) != 0 )
+        return FAILURE;
+
+    if ( n_args > 3 && strcmp( args[2], "-p" ) == 0 )
+    {
+        priority = parse_priority( args[3] );
+        first = 4;
+    }
+
+    if ( priority == -1 || first >= n_args )
+    {
+        fprintf( stderr, "usage: jq submit [-p high|normal|low] "
+                         "command ...\n" );
+        return SUCCESS;
+    }
+
+    if ( getcwd( cwd, sizeof(cwd) ) == NULL )
+    {
+        fprintf( stderr, "Error: Could not read the current directory.\n" );
+        return SUCCESS;
+    }
+
+    /* submit, priority, directory, then the words themselves */
+    if ( ( request = malloc( ( n_args - first + 3 ) * sizeof(char*) ) )
+         == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory.\n" );
+        return SUCCESS;
+    }
+
+    request[n_request++] = args[1];
+    request[n_request++] = (char*) priority_names[priority];
+    request[n_request++] = cwd;
+
+    for ( int i = first; i < n_args; i++ )
+        request[n_request++] = args[i];
+
+    sent = send_request( request, n_request );
+    free( request );
+
+    if ( sent == SUCCESS )
+        *status = 0;
+
+    return SUCCESS;
+} /* end queue_command() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: open_queue_dir                                */
+/*      Return type:   static int                                    */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          fills in queue_path from $JSHELL_QUEUE_DIR, or           */
+/*          ~/.j_queue, and creates it private to the user.          */
+/*                                                                   */
+/*********************************************************************/
+static int open_queue_dir( void )
+{
+    const char* dir;
+
+    if ( ( dir = getenv( QUEUE_DIR_ENV ) ) != NULL && dir[0] != '\0' )
+        snprintf( queue_path, sizeof(queue_path), "%s", dir );
+    else if ( ( dir = getenv( "HOME" ) ) != NULL )
+        snprintf( queue_path, sizeof(queue_path), "%s/%s", dir,
+                  QUEUE_DIR_NAME );
+    else
+    {
+        fprintf( stderr, "Error: Set HOME or %s for the job queue.\n",
+                 QUEUE_DIR_ENV );
+        return FAILURE;
+    }
+
+    if ( mkdir( queue_path, 0700 ) == -1 && errno != EEXIST )
+    {
+        fprintf( stderr, "Error: Could not create %s: %s\n", queue_path,
+                 strerror( errno ) );
+        return FAILURE;
+    }
+
+    return SUCCESS;
+} /* end open_queue_dir() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: job_file                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char* path: set to the file's path, QUEUE_PATH_SIZE.     */
+/*          int id: job the file belongs to.                         */
+/*          const char* ext: "job" or "log".                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          FAILURE if the path does not fit.                        */
+/*                                                                   */
+/*********************************************************************/
+static int job_file( char* path, int id, const char* ext )
+{
+    if ( snprintf( path, QUEUE_PATH_SIZE, "%s/%d.%s", queue_path, id, ext )
+         >= QUEUE_PATH_SIZE )
+    {
+        fprintf( stderr, "Error: Queue path is too long: %s\n", queue_path );
+        return FAILURE;
+    }
+
+    return SUCCESS;
+} /* end job_file() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: save_job                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const queue_job* job: job to write out.                  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          writes the job as "key value" lines, one "word" line per */
+/*          word of its command. The file is written beside the old  */
+/*          one and renamed over it, so a crash never leaves half a  */
+/*          record behind.                                           */
+/*                                                                   */
+/*********************************************************************/
+static int save_job( const queue_job* job )
+{
+    char path[QUEUE_PATH_SIZE], tmp[QUEUE_PATH_SIZE];
+    FILE* fp;
+
+    if ( job_file( path, job->id, "job" ) == FAILURE ||
+         job_file( tmp, job->id, "tmp" ) == FAILURE )
+        return FAILURE;
+
+    if ( ( fp = fopen( tmp, "w" ) ) == NULL )
+    {
+        fprintf( stderr, "Error: Could not write %s\n", tmp );
+        return FAILURE;
+    }
+
+    fprintf( fp, "id %d\n", job->id );
+    fprintf( fp, "state %s\n", state_names[job->state] );
+    fprintf( fp, "priority %s\n", priority_names[job->priority] );
+    fprintf( fp, "status %d\n", job->status );
+    fprintf( fp, "submitted %ld\n", (long) job->submitted );
+    fprintf( fp, "started %ld\n", (long) job->started );
+    fprintf( fp, "finished %ld\n", (long) job->finished );
+    fprintf( fp, "cwd %s\n", job->cwd );
+
+    for ( int i = 0; i < job->n_words; i++ )
+        fprintf( fp, "word %s\n", job->words[i] );
+
+    if ( fclose( fp ) != 0 || rename( tmp, path ) == -1 )
+    {
+        fprintf( stderr, "Error: Could not write %s\n", path );
+        unlink( tmp );
+        return FAILURE;
+    }
+
+    return SUCCESS;
+} /* end save_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: load_job                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* path: a file written by save_job().          */
+/*          queue_job* job: filled in from it.                       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns FAILURE if the file is unreadable or has no id,  */
+/*          directory or command.                                    */
+/*                                                                   */
+/*********************************************************************/
+static int load_job( const char* path, queue_job* job )
+{
+    char line[QUEUE_LINE_SIZE];
+    char *value, *word;
+    FILE* fp;
+
+    if ( ( fp = fopen( path, "r" ) ) == NULL )
+        return FAILURE;
+
+    memset( job, 0, sizeof(*job) );
+    job->priority = PRIO_NORMAL;
+
+    while ( fgets( line, sizeof(line), fp ) != NULL )
+    {
+        line[strcspn( line, "\n" )] = '\0';
+
+        if ( ( value = strchr( line, ' ' ) ) == NULL )
+            continue;
+
+        *value++ = '\0';
+
+        if ( strcmp( line, "id" ) == 0 )
+            job->id = atoi( value );
+        else if ( strcmp( line, "status" ) == 0 )
+            job->status = atoi( value );
+        else if ( strcmp( line, "submitted" ) == 0 )
+            job->submitted = (time_t) atol( value );
+        else if ( strcmp( line, "started" ) == 0 )
+            job->started = (time_t) atol( value );
+        else if ( strcmp( line, "finished" ) == 0 )
+            job->finished = (time_t) atol( value );
+        else if ( strcmp( line, "cwd" ) == 0 && job->cwd == NULL )
+            job->cwd = strdup( value );
+        else if ( strcmp( line, "priority" ) == 0 )
+            job->priority = parse_priority( value ) == -1 ? PRIO_NORMAL :
+                            (queue_priority) parse_priority( value );
+        else if ( strcmp( line, "state" ) == 0 )
+        {
+            for ( int i = 0; i < N_STATES; i++ )
+                if ( strcmp( state_names[i], value ) == 0 )
+                    job->state = (queue_state) i;
+        }
+        else if ( strcmp( line, "word" ) == 0 )
+        {
+            word = strdup( value );
+            add_string( &word, &job->words, &job->n_words );
+        }
+    }
+
+    fclose( fp );
+
+    if ( job->id <= 0 || job->cwd == NULL || job->n_words == 0 )
+    {
+        free( job->cwd );
+        for ( int i = 0; i < job->n_words; i++ )
+            free( job->words[i] );
+        free( job->words );
+        return FAILURE;
+    }
+
+    return SUCCESS;
+} /* end load_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: load_jobs                                     */
+/*      Return type:   static void                                   */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          reads every <id>.job in the queue directory and sets     */
+/*          next_id past the largest. A job still marked running     */
+/*          belonged to a daemon that died, and is marked lost.      */
+/*                                                                   */
+/*********************************************************************/
+static void load_jobs( void )
+{
+    char path[QUEUE_PATH_SIZE];
+    struct dirent* entry;
+    queue_job loaded, *job;
+    DIR* dir;
+    char* end;
+
+    if ( ( dir = opendir( queue_path ) ) == NULL )
+        return;
+
+    while ( ( entry = readdir( dir ) ) != NULL )
+    {
+        if ( strtol( entry->d_name, &end, 10 ) <= 0 ||
+             strcmp( end, ".job" ) != 0 )
+            continue;
+
+        if ( snprintf( path, sizeof(path), "%s/%s", queue_path,
+                       entry->d_name ) >= (int) sizeof(path) )
+            continue;
+
+        if ( load_job( path, &loaded ) == FAILURE )
+        {
+            fprintf( stderr, "Error: Skipping bad job file %s\n", path );
+            continue;
+        }
+
+        if ( ( job = new_job() ) == NULL )
+            break;
+
+        *job = loaded;
+
+        if ( job->state == JOB_RUNNING )
+        {
+            job->state = JOB_LOST;
+            save_job( job );
+        }
+
+        if ( job->id >= next_id )
+            next_id = job->id + 1;
+    }
+
+    closedir( dir );
+} /* end load_jobs() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: new_job                                       */
+/*      Return type:   static queue_job*                             */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns a zeroed slot at the end of jobs, growing it if  */
+/*          need be, or NULL if out of memory. Pointers into jobs    */
+/*          are not kept across calls.                               */
+/*                                                                   */
+/*********************************************************************/
+static queue_job* new_job( void )
+{
+    queue_job* grown;
+
+    if ( n_jobs == jobs_size )
+    {
+        jobs_size = ( jobs_size == 0 ? 64 : jobs_size * 2 );
+
+        if ( ( grown = realloc( jobs, jobs_size * sizeof(queue_job) ) )
+             == NULL )
+        {
+            fprintf( stderr, "Error: Out of memory.\n" );
+            jobs_size = n_jobs;
+            return NULL;
+        }
+
+        jobs = grown;
+    }
+
+    memset( &jobs[n_jobs], 0, sizeof(queue_job) );
+    return &jobs[n_jobs++];
+} /* end new_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: find_job                                      */
+/*      Return type:   static queue_job*                             */
+/*      Parameter(s):                                                */
+/*          int id: job to look for.                                 */
+/*                                                                   */
+/*********************************************************************/
+static queue_job* find_job( int id )
+{
+    for ( int i = 0; i < n_jobs; i++ )
+        if ( jobs[i].id == id )
+            return &jobs[i];
+
+    return NULL;
+} /* end find_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: open_listener                                 */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* path: where to bind the socket.              */
+/*                                                                   */
+/*      Description:                                                 */
+/*          binds a Unix stream socket at path. A socket file that   */
+/*          nothing answers on is left over from a dead daemon and   */
+/*          is replaced; a live one means a daemon is already up.    */
+/*          Returns the listening descriptor or -1.                  */
+/*                                                                   */
+/*********************************************************************/
+static int open_listener( const char* path )
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+
+    if ( strlen( path ) >= sizeof(addr.sun_path) )
+    {
+        fprintf( stderr, "Error: Queue socket path is too long: %s\n", path );
+        return -1;
+    }
+
+    strcpy( addr.sun_path, path );
+
+    if ( ( fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 ) ) == -1 )
+    {
+        fprintf( stderr, "Error: Could not create queue socket.\n" );
+        return -1;
+    }
+
+    if ( connect( fd, (struct sockaddr*) &addr, sizeof(addr) ) == 0 )
+    {
+        fprintf( stderr, "Error: A queue daemon is already running on %s\n",
+                 path );
+        close( fd );
+        return -1;
+    }
+
+    unlink( path );
+
+    if ( bind( fd, (struct sockaddr*) &addr, sizeof(addr) ) == -1 ||
+         listen( fd, QUEUE_BACKLOG ) == -1 )
+    {
+        fprintf( stderr, "Error: Could not listen on %s: %s\n", path,
+                 strerror( errno ) );
+        close( fd );
+        return -1;
+    }
+
+    return fd;
+} /* end open_listener() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: serve_client                                  */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          int fd: an accepted connection.                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          a request is a list of NUL terminated words ended by the */
+/*          client shutting down its side. The reply is plain text   */
+/*          and ends when the daemon closes the connection.          */
+/*                                                                   */
+/*********************************************************************/
+static void serve_client( int fd )
+{
+    struct timeval tv = { QUEUE_RECV_TIMEOUT, 0 };
+    char** words = NULL;
+    size_t len = 0;
+    ssize_t n;
+    int n_words, out_fd;
+    queue_job* job;
+    FILE* out;
+
+    /* a stalled client can't hold up the queue for long */
+    setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv) );
+
+    while ( len < sizeof(msg) &&
+            ( n = read( fd, msg + len, sizeof(msg) - len ) ) > 0 )
+        len += (size_t) n;
+
+    if ( len == 0 || len == sizeof(msg) || msg[len - 1] != '\0' )
+        return;
+
+    if ( ( n_words = split_message( len, &words ) ) == 0 )
+        return;
+
+    if ( ( out_fd = dup( fd ) ) == -1 || ( out = fdopen( out_fd, "w" ) )
+         == NULL )
+    {
+        if ( out_fd != -1 )
+            close( out_fd );
+        free( words );
+        return;
+    }
+
+    if ( strcmp( words[0], "submit" ) == 0 && n_words > 3 )
+        submit_job( words + 1, n_words - 1, out );
+    else if ( strcmp( words[0], "list" ) == 0 )
+        list_jobs( out );
+    else if ( strcmp( words[0], "status" ) == 0 && n_words == 2 )
+    {
+        if ( ( job = find_job( atoi( words[1] ) ) ) == NULL )
+            fprintf( out, "Error: No such job: %s\n", words[1] );
+        else
+            print_job( job, out );
+    }
+    else
+        fprintf( out, "Error: Bad request.\n" );
+
+    fclose( out );
+    free( words );
+} /* end serve_client() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: split_message                                 */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          size_t len: bytes of msg in use, the last being '\0'.    */
+/*          char*** words: set to pointers into msg, to be freed.    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the number of words, 0 on failure.               */
+/*                                                                   */
+/*********************************************************************/
+static int split_message( size_t len, char*** words )
+{
+    int n_words = 0, i = 0;
+
+    for ( size_t pos = 0; pos < len; pos++ )
+        if ( msg[pos] == '\0' )
+            n_words++;
+
+    if ( ( *words = malloc( n_words * sizeof(char*) ) ) == NULL )
+        return 0;
+
+    for ( size_t pos = 0; pos < len; pos += strlen( msg + pos ) + 1 )
+        (*words)[i++] = msg + pos;
+
+    return n_words;
+} /* end split_message() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: submit_job                                    */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          char** words: priority, directory, then the command.     */
+/*          int n_words: number of strings in words.                 */
+/*          FILE* out: where to send the reply.                      */
+/*                                                                   */
+/*********************************************************************/
+static void submit_job( char** words, int n_words, FILE* out )
+{
+    queue_job* job;
+    char* word;
+    int priority;
+
+    if ( ( priority = parse_priority( words[0] ) ) == -1 )
+    {
+        fprintf( out, "Error: Bad priority: %s\n", words[0] );
+        return;
+    }
+
+    if ( ( job = new_job() ) == NULL )
+    {
+        fprintf( out, "Error: Out of memory.\n" );
+        return;
+    }
+
+    job->id = next_id++;
+    job->state = JOB_QUEUED;
+    job->priority = (queue_priority) priority;
+    job->submitted = time( NULL );
+    job->cwd = strdup( words[1] );
+
+    for ( int i = 2; i < n_words; i++ )
+    {
+        word = strdup( words[i] );
+        add_string( &word, &job->words, &job->n_words );
+    }
+
+    if ( save_job( job ) == FAILURE )
+        fprintf( out, "Error: Job %d was not saved to disk.\n", job->id );
+
+    fprintf( out, "%d\n", job->id );
+} /* end submit_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: list_jobs                                     */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          FILE* out: where to send the table.                      */
+/*                                                                   */
+/*********************************************************************/
+static void list_jobs( FILE* out )
+{
+    fprintf( out, "%-6s %-8s %-7s %-6s %s\n", "ID", "STATE", "PRIO",
+             "EXIT", "COMMAND" );
+
+    for ( int i = 0; i < n_jobs; i++ )
+        print_job( &jobs[i], out );
+} /* end list_jobs() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: print_job                                     */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          const queue_job* job: job to describe.                   */
+/*          FILE* out: where to send the line.                       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the exit column is blank until the job has finished.     */
+/*                                                                   */
+/*********************************************************************/
+static void print_job( const queue_job* job, FILE* out )
+{
+    char exit_text[16] = "-";
+
+    if ( job->state == JOB_DONE )
+        snprintf( exit_text, sizeof(exit_text), "%d", job->status );
+
+    fprintf( out, "%-6d %-8s %-7s %-6s", job->id, state_names[job->state],
+             priority_names[job->priority], exit_text );
+
+    for ( int i = 0; i < job->n_words; i++ )
+        fprintf( out, " %s", job->words[i] );
+
+    fputc( '\n', out );
+} /* end print_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: start_jobs                                    */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          int max_running: most jobs to run at once.               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          starts queued jobs until max_running are running. Each   */
+/*          free slot goes to the highest priority class, and to the */
+/*          oldest job within it.                                    */
+/*                                                                   */
+/*********************************************************************/
+static void start_jobs( int max_running )
+{
+    queue_job* next;
+
+    while ( n_running < max_running )
+    {
+        next = NULL;
+
+        for ( int i = 0; i < n_jobs; i++ )
+        {
+            if ( jobs[i].state != JOB_QUEUED )
+                continue;
+
+            if ( next == NULL || jobs[i].priority < next->priority ||
+                 ( jobs[i].priority == next->priority &&
+                   jobs[i].id < next->id ) )
+                next = &jobs[i];
+        }
+
+        if ( next == NULL )
+            return;
+
+        start_job( next );
+    }
+} /* end start_jobs() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: start_job                                     */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          queue_job* job: a queued job.                            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs the job in the directory it was submitted from,     */
+/*          with stdout and stderr going to <id>.log. A job that     */
+/*          can't start is finished at once with status 127.         */
+/*                                                                   */
+/*********************************************************************/
+static void start_job( queue_job* job )
+{
+    char path[QUEUE_PATH_SIZE];
+    int log_fd;
+
+    if ( job_file( path, job->id, "log" ) == FAILURE )
+    {
+        finish_job( job, 127 );
+        return;
+    }
+
+    if ( ( log_fd = open( path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                          0600 ) ) == -1 )
+    {
+        fprintf( stderr, "Error: Could not open %s\n", path );
+        finish_job( job, 127 );
+        return;
+    }
+
+    job->started = time( NULL );
+
+    if ( chdir( job->cwd ) == -1 )
+    {
+        dprintf( log_fd, "Error: Could not change to %s: %s\n", job->cwd,
+                 strerror( errno ) );
+        close( log_fd );
+        finish_job( job, 127 );
+        return;
+    }
+
+    job->pid = run_job( job->words, job->n_words, log_fd );
+    close( log_fd );
+
+    if ( job->pid == -1 )
+    {
+        finish_job( job, 127 );
+        return;
+    }
+
+    job->state = JOB_RUNNING;
+    n_running++;
+    save_job( job );
+} /* end start_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: finish_job                                    */
+/*      Return type:   static void                                   */
+/*      Parameter(s):                                                */
+/*          queue_job* job: job that ended.                          */
+/*          int status: its exit status, 128 + signal if killed.     */
+/*                                                                   */
+/*********************************************************************/
+static void finish_job( queue_job* job, int status )
+{
+    job->state = JOB_DONE;
+    job->status = status;
+    job->finished = time( NULL );
+    job->pid = 0;
+    save_job( job );
+} /* end finish_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: reap_jobs                                     */
+/*      Return type:   static void                                   */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          records the exit status of every running job that has    */
+/*          finished, freeing its slot.                              */
+/*                                                                   */
+/*********************************************************************/
+static void reap_jobs( void )
+{
+    struct rusage usage;
+    int wstatus, timed_out, status;
+
+    for ( int i = 0; i < n_jobs; i++ )
+    {
+        if ( jobs[i].state != JOB_RUNNING )
+            continue;
+
+        if ( wait_child( jobs[i].pid, &wstatus, &usage, WNOHANG,
+                         &timed_out ) != jobs[i].pid )
+            continue;
+
+        if ( WIFSIGNALED( wstatus ) )
+            status = 128 + WTERMSIG( wstatus );
+        else
+            status = WEXITSTATUS( wstatus );
+
+        n_running--;
+        finish_job( &jobs[i], status );
+    }
+} /* end reap_jobs() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: parse_priority                                */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* name: "high", "normal" or "low".             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the priority class, or -1 for an unknown name.   */
+/*                                                                   */
+/*********************************************************************/
+static int parse_priority( const char* name )
+{
+    for ( int i = 0; i < N_PRIORITIES; i++ )
+        if ( strcmp( priority_names[i], name ) == 0 )
+            return i;
+
+    return -1;
+} /* end parse_priority() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: send_request                                  */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          char** words: the request, see serve_client().           */
+/*          int n_words: number of strings in words.                 */
+/*                                                                   */
+/*      Description:                                                 */
+/*          sends one request to the daemon and copies its reply to  */
+/*          stdout.                                                  */
+/*                                                                   */
+/*********************************************************************/
+static int send_request( char** words, int n_words )
+{
+    struct sockaddr_un addr;
+    size_t len;
+    ssize_t n;
+    int fd;
+
+    if ( open_queue_dir() == FAILURE )
+        return FAILURE;
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    len = sizeof(addr.sun_path);
+
+    if ( snprintf( addr.sun_path, len, "%s/%s", queue_path,
+                   QUEUE_SOCKET_NAME ) >= (int) len )
+    {
+        fprintf( stderr, "Error: Queue socket path is too long: %s\n",
+                 queue_path );
+        return FAILURE;
+    }
+
+    if ( ( fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 ) ) == -1 )
+        return FAILURE;
+
+    if ( connect( fd, (struct sockaddr*) &addr, sizeof(addr) ) == -1 )
+    {
+        fprintf( stderr, "Error: No queue daemon on %s, start one with "
+                         "\"shell --queue-daemon\".\n", addr.sun_path );
+        close( fd );
+        return FAILURE;
+    }
+
+    for ( int i = 0; i < n_words; i++ )
+    {
+        len = strlen( words[i] ) + 1;
+
+        if ( write( fd, words[i], len ) != (ssize_t) len )
+        {
+            fprintf( stderr, "Error: Could not send to the queue daemon.\n" );
+            close( fd );
+            return FAILURE;
+        }
+    }
+
+    shutdown( fd, SHUT_WR );
+    fflush( stdout );
+
+    while ( ( n = read( fd, msg, sizeof(msg) ) ) > 0 )
+        fwrite( msg, 1, (size_t) n, stdout );
+
+    fflush( stdout );
+    close( fd );
+    return SUCCESS;
+} /* end send_request() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: show_log                                      */
+/*      Return type:   static int                                    */
+/*      Parameter(s):                                                */
+/*          const char* id: job whose output to print.               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          logs are plain files, so they are read straight from     */
+/*          the queue directory without asking the daemon. This      */
+/*          works on a running job too, showing its output so far.   */
+/*                                                                   */
+/*********************************************************************/
+static int show_log( const char* id )
+{
+    char path[QUEUE_PATH_SIZE];
+    ssize_t n;
+    int fd;
+
+    if ( open_queue_dir() == FAILURE )
+        return FAILURE;
+
+    if ( job_file( path, atoi( id ), "log" ) == FAILURE )
+        return FAILURE;
+
+    if ( ( fd = open( path, O_RDONLY | O_CLOEXEC ) ) == -1 )
+    {
+        fprintf( stderr, "Error: No log for job %s\n", id );
+        return FAILURE;
+    }
+
+    fflush( stdout );
+
+    while ( ( n = read( fd, msg, sizeof(msg) ) ) > 0 )
+        fwrite( msg, 1, (size_t) n, stdout );
+
+    fflush( stdout );
+    close( fd );
+    return SUCCESS;
+} /* end show_log() */
@@ -0,0 +1,95 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: task_queue.h                                */
+/*          Description:                                             */
+/*              This module provides a batch job spooler. A shell    */
+/*              started with --queue-daemon keeps a queue of jobs    */
+/*              on disk and runs a few at a time, highest priority   */
+/*              first. Other shells hand it work over a Unix socket  */
+/*              with "jq submit", "jq list", "jq status" and         */
+/*              "jq log".                                            */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef TASK_QUEUE_H
+#define TASK_QUEUE_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "./supervisor.h"
+#include "./string_module.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define QUEUE_DIR_ENV "JSHELL_QUEUE_DIR"
+#define QUEUE_DIR_NAME ".j_queue"
+#define QUEUE_SOCKET_NAME "socket"
+#define QUEUE_PATH_SIZE 4096
+#define QUEUE_MSG_MAX 65536
+#define QUEUE_LINE_SIZE 4096
+#define QUEUE_BACKLOG 16
+#define QUEUE_RECV_TIMEOUT 2
+
+/* priority classes, lower runs first */
+typedef enum queue_priority_t
+{
+    PRIO_HIGH,
+    PRIO_NORMAL,
+    PRIO_LOW,
+    N_PRIORITIES
+} queue_priority;
+
+/* where a job is in its life */
+typedef enum queue_state_t
+{
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE,
+    JOB_LOST,
+    N_STATES
+} queue_state;
+
+/* one job, mirrored in <id>.job in the queue directory */
+typedef struct queue_job_t
+{
+    int             id;
+    queue_state     state;
+    queue_priority  priority;
+    int             status;
+    time_t          submitted;
+    time_t          started;
+    time_t          finished;
+    pid_t           pid;
+    char*           cwd;
+    char**          words;
+    int             n_words;
+} queue_job;
+
+/* starts a job's command line with its output going to log_fd */
+typedef pid_t (*job_runner)( char** words, int n_words, int log_fd );
+
+/* function prototypes */
+int     run_queue_daemon( int max_running, job_runner runner );
+int     queue_command( char** args, int n_args, int* status );
+void    close_queue_fds( void );
+
+#endif
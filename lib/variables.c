@@ -0,0 +1,486 @@
+#include "variables.h"
+#include "./jshell.h"
+
+/* the calling thread's shell's variables (see jshell.h) */
+#define vars        ( jshell->variables.table )
+#define vars_size   ( jshell->variables.size )
+#define n_vars      ( jshell->variables.count )
+#define status      ( jshell->variables.status )
+#define status_text ( jshell->variables.status_text )
+#define frame       ( jshell->variables.frame )
+
+/* local prototypes */
+static shell_var*   find_var( const char*, int );
+static size_t       hash_name( const char* );
+static int          grow_vars( void );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: var_get                                       */
+/*      Return type:   const char*                                   */
+/*      Parameter(s):                                                */
+/*          const char* name: variable to read, "?", "#" or N.       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns the value of name, or NULL if it is set neither  */
+/*          in the shell nor in the environment. "?" is the status   */
+/*          of the last command, "#" the number of positional        */
+/*          parameters and a number N the Nth of them.               */
+/*                                                                   */
+/*********************************************************************/
+const char* var_get( const char* name )
+{
+    shell_var* var;
+    int n;
+
+    if ( strcmp( name, "?" ) == 0 )
+        return status_text;
+
+    if ( strcmp( name, "#" ) == 0 )
+        return ( frame != NULL ? frame->count : "0" );
+
+    if ( isdigit( (unsigned char) *name ) )
+    {
+        n = atoi( name );
+        return ( frame != NULL && n >= 1 && n <= frame->n_args ?
+                 frame->args[n - 1] : NULL );
+    }
+
+    if ( ( var = find_var( name, F ) ) != NULL && var->value != NULL )
+        return var->value;
+
+    return getenv( name );
+} /* end var_get() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: var_set                                       */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* name: variable to set.                       */
+/*          const char* value: its new value.                        */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the value is copied into the variable's own buffer,      */
+/*          which is only reallocated when it is too small.          */
+/*                                                                   */
+/*********************************************************************/
+int var_set( const char* name, const char* value )
+{
+    size_t len = strlen( value ), cap;
+    shell_var* var;
+    char* grown;
+
+    if ( !is_var_name( name ) )
+    {
+        fprintf( stderr, "Error: %s is not a valid variable name.\n", name );
+        return FAILURE;
+    }
+
+    if ( ( var = find_var( name, T ) ) == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory setting %s.\n", name );
+        return FAILURE;
+    }
+
+    if ( len + 1 > var->cap )
+    {
+        for ( cap = ( var->cap == 0 ? VAR_MIN_VALUE : var->cap );
+              cap < len + 1; cap *= 2 )
+            ;
+
+        if ( ( grown = realloc( var->value, cap ) ) == NULL )
+        {
+            fprintf( stderr, "Error: Out of memory setting %s.\n", name );
+            return FAILURE;
+        }
+
+        var->value = grown;
+        var->cap = cap;
+    }
+
+    memmove( var->value, value, len + 1 );
+
+    if ( var->exported )
+        setenv( name, value, 1 );
+
+    return SUCCESS;
+} /* end var_set() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: var_export                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* name: variable to pass on to programs.       */
+/*                                                                   */
+/*********************************************************************/
+int var_export( const char* name )
+{
+    shell_var* var = find_var( name, F );
+
+    if ( var == NULL )
+        return ( getenv( name ) != NULL ? SUCCESS : FAILURE );
+
+    var->exported = T;
+    return ( setenv( name, var->value != NULL ? var->value : "", 1 ) == 0 ?
+             SUCCESS : FAILURE );
+} /* end var_export() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_var_name                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* name: word to check.                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T if name is a letter or "_" followed by letters,        */
+/*          digits and "_".                                          */
+/*                                                                   */
+/*********************************************************************/
+int is_var_name( const char* name )
+{
+    if ( !isalpha( (unsigned char) *name ) && *name != '_' )
+        return F;
+
+    while ( *++name != '\0' )
+        if ( !isalnum( (unsigned char) *name ) && *name != '_' )
+            return F;
+
+    return T;
+} /* end is_var_name() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: set_last_status                               */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          int new_status: exit status of the command just run.     */
+/*                                                                   */
+/*********************************************************************/
+void set_last_status( int new_status )
+{
+    if ( new_status != status )
+    {
+        status = new_status;
+        snprintf( status_text, sizeof(status_text), "%d", status );
+    }
+} /* end set_last_status() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: last_status                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*********************************************************************/
+int last_status( void )
+{
+    return status;
+} /* end last_status() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: free_vars                                     */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*********************************************************************/
+void free_vars( void )
+{
+    for ( size_t i = 0; i < vars_size; i++ )
+    {
+        free( vars[i].name );
+        free( vars[i].value );
+    }
+
+    free( vars );
+    vars = NULL;
+    vars_size = n_vars = 0;
+} /* end free_vars() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: push_frame                                    */
+/*      Return type:   void                                          */
+/*      Parameter(s):                                                */
+/*          var_frame* new_frame: the caller's, on its stack.        */
+/*          char** args: $1..$N, which must outlive the frame.       */
+/*          int n_args: N.                                           */
+/*                                                                   */
+/*********************************************************************/
+void push_frame( var_frame* new_frame, char** args, int n_args )
+{
+    new_frame->args = args;
+    new_frame->n_args = n_args;
+    new_frame->n_saved = 0;
+    new_frame->up = frame;
+    snprintf( new_frame->count, sizeof(new_frame->count), "%d", n_args );
+
+    frame = new_frame;
+} /* end push_frame() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: pop_frame                                     */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          gives the frame's locals back their old values, last     */
+/*          made local first, and makes the caller's frame current.  */
+/*                                                                   */
+/*********************************************************************/
+void pop_frame( void )
+{
+    saved_var* saved;
+    shell_var* var;
+
+    if ( frame == NULL )
+        return;
+
+    while ( frame->n_saved > 0 )
+    {
+        saved = &frame->saved[--frame->n_saved];
+
+        if ( ( var = find_var( saved->name, F ) ) == NULL )
+            continue;
+
+        free( var->value );
+        var->value = saved->value;
+        var->cap = saved->cap;
+
+        if ( var->exported && var->value != NULL )
+            setenv( var->name, var->value, 1 );
+        else if ( var->exported )
+            unsetenv( var->name );
+    }
+
+    frame = frame->up;
+} /* end pop_frame() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: in_frame                                      */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*********************************************************************/
+int in_frame( void )
+{
+    return ( frame != NULL ? T : F );
+} /* end in_frame() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: var_local                                     */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* name: variable the current frame hides.      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          moves name's buffer into the frame, leaving it unset     */
+/*          until it is given a value. Making it local twice in one  */
+/*          frame does nothing.                                      */
+/*                                                                   */
+/*********************************************************************/
+int var_local( const char* name )
+{
+    shell_var* var;
+    saved_var* saved;
+
+    if ( frame == NULL )
+    {
+        fprintf( stderr, "Error: local only works inside a function.\n" );
+        return FAILURE;
+    }
+
+    if ( !is_var_name( name ) )
+    {
+        fprintf( stderr, "Error: %s is not a valid variable name.\n", name );
+        return FAILURE;
+    }
+
+    if ( ( var = find_var( name, T ) ) == NULL )
+    {
+        fprintf( stderr, "Error: Out of memory setting %s.\n", name );
+        return FAILURE;
+    }
+
+    for ( int i = 0; i < frame->n_saved; i++ )
+        if ( strcmp( frame->saved[i].name, var->name ) == 0 )
+            return SUCCESS;
+
+    if ( frame->n_saved == FRAME_LOCALS )
+    {
+        fprintf( stderr, "Error: More than %d locals in one function.\n",
+                 FRAME_LOCALS );
+        return FAILURE;
+    }
+
+    /* the name is owned by the table, which never drops a variable */
+    saved = &frame->saved[frame->n_saved++];
+    saved->name = var->name;
+    saved->value = var->value;
+    saved->cap = var->cap;
+
+    var->value = NULL;
+    var->cap = 0;
+
+    if ( var->exported )
+        unsetenv( var->name );
+
+    return SUCCESS;
+} /* end var_local() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: positional_args                               */
+/*      Return type:   char**                                        */
+/*      Parameter(s):                                                */
+/*          int* n_args: set to how many there are.                  */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns $1..$N of the current frame, for "$@".           */
+/*                                                                   */
+/*********************************************************************/
+char** positional_args( int* n_args )
+{
+    *n_args = ( frame != NULL ? frame->n_args : 0 );
+    return ( frame != NULL ? frame->args : NULL );
+} /* end positional_args() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: shift_args                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int n: how many positional parameters to drop.           */
+/*                                                                   */
+/*********************************************************************/
+int shift_args( int n )
+{
+    if ( frame == NULL || n < 0 || n > frame->n_args )
+        return FAILURE;
+
+    frame->args += n;
+    frame->n_args -= n;
+    snprintf( frame->count, sizeof(frame->count), "%d", frame->n_args );
+
+    return SUCCESS;
+} /* end shift_args() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: find_var                                      */
+/*      Return type:   static shell_var*                             */
+/*      Parameter(s):                                                */
+/*          const char* name: variable to look for.                  */
+/*          int create: T to add it, with no value, if missing.      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          looks name up in an open addressed hash table that is    */
+/*          kept at most half full.                                  */
+/*                                                                   */
+/*********************************************************************/
+static shell_var* find_var( const char* name, int create )
+{
+    size_t i;
+
+    if ( vars_size == 0 && ( !create || grow_vars() == FAILURE ) )
+        return NULL;
+
+    for ( i = hash_name( name ) & ( vars_size - 1 ); vars[i].name != NULL;
+          i = ( i + 1 ) & ( vars_size - 1 ) )
+        if ( strcmp( vars[i].name, name ) == 0 )
+            return &vars[i];
+
+    if ( !create )
+        return NULL;
+
+    if ( ( n_vars + 1 ) * 2 > vars_size )
+    {
+        if ( grow_vars() == FAILURE )
+            return NULL;
+
+        return find_var( name, create );
+    }
+
+    if ( ( vars[i].name = strdup( name ) ) == NULL )
+        return NULL;
+
+    n_vars++;
+    return &vars[i];
+} /* end find_var() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: hash_name                                     */
+/*      Return type:   static size_t                                 */
+/*      Parameter(s):                                                */
+/*          const char* name: variable name.                         */
+/*                                                                   */
+/*********************************************************************/
+static size_t hash_name( const char* name )
+{
+    size_t hash = 5381;
+
+    while ( *name != '\0' )
+        hash = hash * 33 + (unsigned char) *name++;
+
+    return hash;
+} /* end hash_name() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: grow_vars                                     */
+/*      Return type:   static int                                    */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          doubles the table, moving every variable across.         */
+/*                                                                   */
+/*********************************************************************/
+static int grow_vars( void )
+{
+    size_t size = ( vars_size == 0 ? VAR_TABLE_SIZE : vars_size * 2 ), j;
+    shell_var* table;
+
+    if ( ( table = calloc( size, sizeof(shell_var) ) ) == NULL )
+        return FAILURE;
+
+    for ( size_t i = 0; i < vars_size; i++ )
+    {
+        if ( vars[i].name == NULL )
+            continue;
+
+        for ( j = hash_name( vars[i].name ) & ( size - 1 );
+              table[j].name != NULL; j = ( j + 1 ) & ( size - 1 ) )
+            ;
+
+        table[j] = vars[i];
+    }
+
+    free( vars );
+    vars = table;
+    vars_size = size;
+
+    return SUCCESS;
+} /* end grow_vars() */
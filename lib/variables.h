@@ -0,0 +1,87 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: variables.h                                 */
+/*          Description:                                             */
+/*              This module keeps the shell's own variables, set     */
+/*              with "name=value" and read with $name. A variable    */
+/*              keeps its buffer when it is set again, so a loop     */
+/*              counter does not allocate. Names the shell does not  */
+/*              have are looked up in the environment. A function    */
+/*              call pushes a frame that lives on the caller's       */
+/*              stack, holding its $1..$N and the old values of the  */
+/*              variables it made local.                             */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef VARIABLES_H
+#define VARIABLES_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "./string_module.h"
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define VAR_TABLE_SIZE 64
+#define VAR_MIN_VALUE 16
+#define VAR_STATUS_SIZE 16
+#define FRAME_LOCALS 32
+
+/* one variable; exported ones are copied to the environment */
+typedef struct shell_var_t
+{
+    char*   name;
+    char*   value;
+    size_t  cap;
+    int     exported;
+} shell_var;
+
+/* a variable hidden by "local", put back when the frame is popped */
+typedef struct saved_var_t
+{
+    const char* name;
+    char*       value;
+    size_t      cap;
+} saved_var;
+
+/* the positional parameters and locals of one function call */
+typedef struct var_frame_t
+{
+    char**              args;
+    int                 n_args;
+    char                count[VAR_STATUS_SIZE];
+    saved_var           saved[FRAME_LOCALS];
+    int                 n_saved;
+    struct var_frame_t* up;
+} var_frame;
+
+/* one shell's variables and the frames of the calls it is in */
+typedef struct var_state_t
+{
+    shell_var*  table;
+    size_t      size;
+    size_t      count;
+    int         status;
+    char        status_text[VAR_STATUS_SIZE];
+    var_frame*  frame;
+} var_state;
+
+/* function prototypes */
+const char* var_get( const char* name );
+int         var_set( const char* name, const char* value );
+int         var_export( const char* name );
+int         is_var_name( const char* name );
+void        set_last_status( int status );
+int         last_status( void );
+void        free_vars( void );
+void        push_frame( var_frame* frame, char** args, int n_args );
+void        pop_frame( void );
+int         in_frame( void );
+int         var_local( const char* name );
+char**      positional_args( int* n_args );
+int         shift_args( int n );
+
+#endif
@@ -0,0 +1,530 @@
+#include "zero_copy.h"
+
+/* results of one copying strategy */
+#define ZC_DONE 1
+#define ZC_UNSUPPORTED 0
+#define ZC_ERROR -1
+
+/* local prototypes */
+static int  run_cat( char** );
+static int  run_tee( char** );
+static int  by_copy_range( int, int );
+static int  by_splice( int, int );
+static int  by_sendfile( int, int );
+static int  by_read_write( int, int );
+static int  tee_by_splice( int, int, int*, int );
+static int  tee_by_read_write( int, int, int*, int );
+static int  write_all( int, const char*, size_t );
+static int  is_unsupported( int );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_copy_builtin                               */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: NULL terminated argv of a program.          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T if prog is a cat or tee the builtins can run. Any      */
+/*          option they don't implement (cat -n, tee -i, ...) means  */
+/*          the real program is run instead.                         */
+/*                                                                   */
+/*********************************************************************/
+int is_copy_builtin( char** prog )
+{
+    int i = 1;
+
+    if ( strcmp( prog[0], "tee" ) == 0 )
+    {
+        if ( prog[1] != NULL && strcmp( prog[1], "-a" ) == 0 )
+            i++;
+    }
+    else if ( strcmp( prog[0], "cat" ) != 0 )
+        return 0;
+
+    for ( ; prog[i] != NULL; i++ )
+        if ( prog[i][0] == '-' && strcmp( prog[i], "-" ) != 0 )
+            return 0;
+
+    return ( i <= ZC_MAX_FILES );
+} /* end is_copy_builtin() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_copy_builtin                              */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: argv accepted by is_copy_builtin().         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs the builtin on the current stdin/stdout and         */
+/*          returns its exit status. Called in a forked child in     */
+/*          place of exec.                                           */
+/*                                                                   */
+/*********************************************************************/
+int run_copy_builtin( char** prog )
+{
+    if ( strcmp( prog[0], "tee" ) == 0 )
+        return run_tee( prog );
+
+    return run_cat( prog );
+} /* end run_copy_builtin() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: move_data                                     */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int fd_in: descriptor to read until EOF.                 */
+/*          int fd_out: descriptor to write everything to.           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          copies fd_in to fd_out with the cheapest call the pair   */
+/*          supports: copy_file_range() between regular files,       */
+/*          splice() when either end is a pipe, sendfile() from a    */
+/*          regular file to anything else. A call the kernel or      */
+/*          file system refuses before any data has moved falls      */
+/*          through to the next, ending with read()/write().         */
+/*                                                                   */
+/*********************************************************************/
+int move_data( int fd_in, int fd_out )
+{
+    struct stat in_sb, out_sb;
+    int result = ZC_UNSUPPORTED;
+
+    if ( fstat( fd_in, &in_sb ) == -1 || fstat( fd_out, &out_sb ) == -1 )
+        return FAILURE;
+
+    if ( S_ISREG( in_sb.st_mode ) && S_ISREG( out_sb.st_mode ) )
+        result = by_copy_range( fd_in, fd_out );
+
+    if ( result == ZC_UNSUPPORTED &&
+         ( S_ISFIFO( in_sb.st_mode ) || S_ISFIFO( out_sb.st_mode ) ) )
+        result = by_splice( fd_in, fd_out );
+
+    if ( result == ZC_UNSUPPORTED && S_ISREG( in_sb.st_mode ) )
+        result = by_sendfile( fd_in, fd_out );
+
+    if ( result == ZC_UNSUPPORTED )
+        result = by_read_write( fd_in, fd_out );
+
+    return ( result == ZC_DONE ? SUCCESS : FAILURE );
+} /* end move_data() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_cat                                       */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: "cat" followed by files, "-" for stdin.     */
+/*                                                                   */
+/*********************************************************************/
+static int run_cat( char** prog )
+{
+    int status = EXIT_SUCCESS;
+    int fd;
+
+    if ( prog[1] == NULL )
+        return ( move_data( STDIN_FILENO, STDOUT_FILENO ) == SUCCESS ?
+                 EXIT_SUCCESS : EXIT_FAILURE );
+
+    for ( int i = 1; prog[i] != NULL; i++ )
+    {
+        if ( strcmp( prog[i], "-" ) == 0 )
+            fd = STDIN_FILENO;
+        else if ( ( fd = open( prog[i], O_RDONLY ) ) == -1 )
+        {
+            fprintf( stderr, "cat: %s: %s\n", prog[i], strerror( errno ) );
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        if ( move_data( fd, STDOUT_FILENO ) == FAILURE )
+        {
+            fprintf( stderr, "cat: %s: %s\n", prog[i], strerror( errno ) );
+            status = EXIT_FAILURE;
+        }
+
+        if ( fd != STDIN_FILENO )
+            close( fd );
+    }
+
+    return status;
+} /* end run_cat() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_tee                                       */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** prog: "tee [-a]" followed by files.               */
+/*                                                                   */
+/*      Description:                                                 */
+/*          copies stdin to stdout and every file. Between pipes     */
+/*          tee(2) duplicates the data without consuming it and      */
+/*          splice() then moves it into the files, so the bytes are  */
+/*          never copied to user space.                              */
+/*                                                                   */
+/*********************************************************************/
+static int run_tee( char** prog )
+{
+    int fds[ZC_MAX_FILES];
+    int n_fds = 0, flags = O_WRONLY | O_CREAT | O_TRUNC;
+    int status = EXIT_SUCCESS, result;
+    int i = 1;
+
+    if ( prog[1] != NULL && strcmp( prog[1], "-a" ) == 0 )
+    {
+        flags = O_WRONLY | O_CREAT | O_APPEND;
+        i++;
+    }
+
+    for ( ; prog[i] != NULL; i++ )
+    {
+        if ( ( fds[n_fds] = open( prog[i], flags, 0666 ) ) == -1 )
+        {
+            fprintf( stderr, "tee: %s: %s\n", prog[i], strerror( errno ) );
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        n_fds++;
+    }
+
+    /* splice() refuses O_APPEND files, so -a always reads and writes */
+    result = ( flags & O_APPEND ? ZC_UNSUPPORTED :
+               tee_by_splice( STDIN_FILENO, STDOUT_FILENO, fds, n_fds ) );
+
+    if ( result == ZC_UNSUPPORTED )
+        result = tee_by_read_write( STDIN_FILENO, STDOUT_FILENO, fds, n_fds );
+
+    if ( result == ZC_ERROR )
+    {
+        fprintf( stderr, "tee: %s\n", strerror( errno ) );
+        status = EXIT_FAILURE;
+    }
+
+    for ( i = 0; i < n_fds; i++ )
+        close( fds[i] );
+
+    return status;
+} /* end run_tee() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: by_copy_range                                 */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int fd_in: regular file to read.                         */
+/*          int fd_out: regular file to write.                       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          lets the file system copy, or share, the extents.        */
+/*                                                                   */
+/*********************************************************************/
+static int by_copy_range( int fd_in, int fd_out )
+{
+    ssize_t n;
+    int moved = 0;
+
+    while ( ( n = copy_file_range( fd_in, NULL, fd_out, NULL, ZC_CHUNK, 0 ) )
+            != 0 )
+    {
+        if ( n == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            return ( !moved && is_unsupported( errno ) ?
+                     ZC_UNSUPPORTED : ZC_ERROR );
+        }
+
+        moved = 1;
+    }
+
+    return ZC_DONE;
+} /* end by_copy_range() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: by_splice                                     */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int fd_in: descriptor to read.                           */
+/*          int fd_out: descriptor to write, one of them a pipe.     */
+/*                                                                   */
+/*********************************************************************/
+static int by_splice( int fd_in, int fd_out )
+{
+    ssize_t n;
+    int moved = 0;
+
+    while ( ( n = splice( fd_in, NULL, fd_out, NULL, ZC_CHUNK,
+                          SPLICE_F_MOVE | SPLICE_F_MORE ) ) != 0 )
+    {
+        if ( n == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            return ( !moved && is_unsupported( errno ) ?
+                     ZC_UNSUPPORTED : ZC_ERROR );
+        }
+
+        moved = 1;
+    }
+
+    return ZC_DONE;
+} /* end by_splice() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: by_sendfile                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int fd_in: regular file to read.                         */
+/*          int fd_out: descriptor to write.                         */
+/*                                                                   */
+/*********************************************************************/
+static int by_sendfile( int fd_in, int fd_out )
+{
+    ssize_t n;
+    int moved = 0;
+
+    while ( ( n = sendfile( fd_out, fd_in, NULL, ZC_CHUNK ) ) != 0 )
+    {
+        if ( n == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            return ( !moved && is_unsupported( errno ) ?
+                     ZC_UNSUPPORTED : ZC_ERROR );
+        }
+
+        moved = 1;
+    }
+
+    return ZC_DONE;
+} /* end by_sendfile() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: by_read_write                                 */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int fd_in: descriptor to read.                           */
+/*          int fd_out: descriptor to write.                         */
+/*                                                                   */
+/*********************************************************************/
+static int by_read_write( int fd_in, int fd_out )
+{
+    static char buf[ZC_BUF_SIZE];
+    ssize_t n;
+
+    while ( ( n = read( fd_in, buf, sizeof(buf) ) ) != 0 )
+    {
+        if ( n == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            return ZC_ERROR;
+        }
+
+        if ( write_all( fd_out, buf, (size_t) n ) == FAILURE )
+            return ZC_ERROR;
+    }
+
+    return ZC_DONE;
+} /* end by_read_write() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: tee_by_splice                                 */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int fd_in: pipe to read.                                 */
+/*          int fd_out: pipe to copy everything to.                  */
+/*          int* files: extra descriptors to copy everything to.     */
+/*          int n_files: number of descriptors in files.             */
+/*                                                                   */
+/*      Description:                                                 */
+/*          tee() duplicates what is waiting in fd_in into fd_out    */
+/*          and each file's copy goes through a scratch pipe. The    */
+/*          data is finally consumed from fd_in by splicing it       */
+/*          into the last file, or discarding it when there is       */
+/*          none. Only works when fd_in and fd_out are pipes.        */
+/*                                                                   */
+/*********************************************************************/
+static int tee_by_splice( int fd_in, int fd_out, int* files, int n_files )
+{
+    int scratch[2], sink = -1, last;
+    ssize_t n, m, left;
+    int moved = 0, result = ZC_DONE;
+
+    if ( pipe2( scratch, O_CLOEXEC ) == -1 )
+        return ZC_UNSUPPORTED;
+
+    /* something to consume the data into once every copy is made */
+    if ( n_files == 0 && ( sink = open( "/dev/null", O_WRONLY ) ) == -1 )
+    {
+        close( scratch[0] );
+        close( scratch[1] );
+        return ZC_UNSUPPORTED;
+    }
+
+    last = ( n_files == 0 ? sink : files[n_files - 1] );
+
+    while ( 1 )
+    {
+        if ( ( n = tee( fd_in, fd_out, ZC_CHUNK, 0 ) ) == 0 )
+            break;
+
+        if ( n == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            result = ( !moved && is_unsupported( errno ) ?
+                       ZC_UNSUPPORTED : ZC_ERROR );
+            break;
+        }
+
+        moved = 1;
+
+        /* every file but the last gets a duplicate of the same bytes */
+        for ( int i = 0; i < n_files - 1 && result == ZC_DONE; i++ )
+        {
+            for ( left = n; left > 0; left -= m )
+            {
+                if ( ( m = tee( fd_in, scratch[1], (size_t) left, 0 ) ) <= 0 ||
+                     splice( scratch[0], NULL, files[i], NULL, (size_t) m,
+                             SPLICE_F_MOVE ) != m )
+                {
+                    result = ZC_ERROR;
+                    break;
+                }
+            }
+        }
+
+        /* then the bytes are moved out of fd_in for good */
+        for ( left = n; left > 0 && result == ZC_DONE; left -= m )
+        {
+            if ( ( m = splice( fd_in, NULL, last, NULL, (size_t) left,
+                               SPLICE_F_MOVE ) ) <= 0 )
+                result = ZC_ERROR;
+        }
+
+        if ( result != ZC_DONE )
+            break;
+    }
+
+    close( scratch[0] );
+    close( scratch[1] );
+
+    if ( sink != -1 )
+        close( sink );
+
+    return result;
+} /* end tee_by_splice() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: tee_by_read_write                             */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int fd_in: descriptor to read.                           */
+/*          int fd_out: descriptor to copy everything to.            */
+/*          int* files: extra descriptors to copy everything to.     */
+/*          int n_files: number of descriptors in files.             */
+/*                                                                   */
+/*********************************************************************/
+static int tee_by_read_write( int fd_in, int fd_out, int* files,
+                              int n_files )
+{
+    static char buf[ZC_BUF_SIZE];
+    ssize_t n;
+
+    while ( ( n = read( fd_in, buf, sizeof(buf) ) ) != 0 )
+    {
+        if ( n == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            return ZC_ERROR;
+        }
+
+        if ( write_all( fd_out, buf, (size_t) n ) == FAILURE )
+            return ZC_ERROR;
+
+        for ( int i = 0; i < n_files; i++ )
+            if ( write_all( files[i], buf, (size_t) n ) == FAILURE )
+                return ZC_ERROR;
+    }
+
+    return ZC_DONE;
+} /* end tee_by_read_write() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: write_all                                     */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int fd: descriptor to write to.                          */
+/*          const char* data: bytes to write.                        */
+/*          size_t len: number of bytes in data.                     */
+/*                                                                   */
+/*********************************************************************/
+static int write_all( int fd, const char* data, size_t len )
+{
+    ssize_t n;
+
+    while ( len > 0 )
+    {
+        if ( ( n = write( fd, data, len ) ) == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            return FAILURE;
+        }
+
+        data += n;
+        len -= (size_t) n;
+    }
+
+    return SUCCESS;
+} /* end write_all() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_unsupported                                */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int err: errno from a failed call.                       */
+/*                                                                   */
+/*      Description:                                                 */
+/*          T if err means this pair of descriptors can't use the    */
+/*          call at all, rather than a real I/O error.               */
+/*                                                                   */
+/*********************************************************************/
+static int is_unsupported( int err )
+{
+    return ( err == EINVAL || err == ENOSYS || err == EXDEV ||
+             err == EOPNOTSUPP || err == EBADF || err == ESPIPE );
+} /* end is_unsupported() */
@@ -0,0 +1,42 @@
+/*********************************************************************/
+/*                                                                   */
+/*          Module name: zero_copy.h                                 */
+/*          Description:                                             */
+/*              This module provides cat and tee builtins that move  */
+/*              data inside the kernel with copy_file_range(),       */
+/*              sendfile(), splice() and tee() instead of copying it */
+/*              through a user space buffer.                         */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef ZERO_COPY_H
+#define ZERO_COPY_H
+
+/* for splice(), tee() and copy_file_range() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/sendfile.h>
+
+/* macros */
+#define FAILURE 0
+#define SUCCESS 1
+#define ZC_CHUNK ( 1 << 20 )
+#define ZC_BUF_SIZE ( 128 * 1024 )
+#define ZC_MAX_FILES 64
+
+/* function prototypes */
+int     is_copy_builtin( char** prog );
+int     run_copy_builtin( char** prog );
+int     move_data( int fd_in, int fd_out );
+
+#endif
@@ -20,6 +20,9 @@
     // 6) make sure memory leaks don't exist
 
 
+/* for pipe2() */
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -32,12 +35,29 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
 
 /* for custom libraries */
 #include "../lib/alias.h"
 #include "../lib/string_module.h"
 #include "../lib/command_history.h"
 #include "../lib/execution.h"
+#include "../lib/run_stats.h"
+#include "../lib/instrument.h"
+#include "../lib/here_doc.h"
+#include "../lib/supervisor.h"
+#include "../lib/spawn_server.h"
+#include "../lib/shell_options.h"
+#include "../lib/optimizer.h"
+#include "../lib/task_queue.h"
+#include "../lib/command_server.h"
+#include "../lib/job_mux.h"
+#include "../lib/glob_engine.h"
+#include "../lib/brace_expand.h"
+#include "../lib/script_cache.h"
+#include "../lib/interpreter.h"
+#include "../lib/jshell.h"
 
 /* macros */
 #define PROMPT_SIZE 255
@@ -48,28 +68,52 @@
 #define PWD "PWD"
 #define USER "USER"
 #define HOST "HOST"
+#define CAPTURE_SIZE 65536
+#define QUEUE_DAEMON_FLAG "--queue-daemon"
 
 
 /* global variables */
 //char*   cmd = NULL; 
-char**  cmds = NULL; 
-int     n_cmds = 0; 
-int     n_pipes = 0; 
 char    current_path[PROMPT_SIZE];
+script_image* script = NULL;
+char*   request_text = NULL;
 
 /* utility function prototypes */
 void    start_shell( void );
+int     start_queue_daemon( int, char** );
+int     start_command_server( int, char** );
+int     run_request_text( char* );
+int     run_script( const char*, char**, int );
+void    end_shell( void );
 void    parse_input( char* );
 int     process_commands( void );
 
+/* control flow */
+int     run_line( void );
+int     run_words( char**, int, int );
+int     next_line_words( char***, int* );
+
 /* helper function (low level) */
 int     is_directory( const char* );
 int     is_reg_file( const char* );
 void    print_commands( void );
+void    trace_commands( void );
 
 /* history handling */
 int     handle_history( void );
 
+/* resource accounting */
+int     handle_lastrun( void );
+int     handle_time_prefix( void );
+int     handle_timeout_prefix( void );
+int     handle_pipesize_prefix( long* );
+int     handle_meter_prefix( int* );
+int     execute_commands( void );
+
+/* latency instrumentation */
+int     handle_stats( void );
+int     handle_set( void );
+
 /* alias handling */
 int     handle_aliases( void );
 int     check_for_alias( void );
@@ -86,6 +130,45 @@ int     count_parents( const char* );
 char*   get_last_parent( const char* str );
 int     process_path( void );
 
+/* input handling */
+char*   read_line( const char* );
+
+/* here-documents and here-strings */
+int     handle_here_documents( void );
+int     is_operator( const char* );
+int     redirect_from_text( int, int, const char*, size_t );
+
+/* command substitution */
+int     handle_command_substitution( void );
+int     substitute_words( char***, int* );
+int     substitute_output( int, int, char**, int );
+int     builtin_output( char**, int, char**, size_t* );
+int     capture_output( char**, int, char**, size_t* );
+
+/* pathname expansion */
+int     handle_globs( void );
+
+/* brace expansion */
+int     handle_braces( void );
+int     expand_braces( int, brace_gen* );
+
+/* process substitution */
+int     handle_process_substitution( void );
+int     find_closing_paren( int );
+pid_t   spawn_subshell( char**, int, int, int, int );
+pid_t   spawn_job( char**, int, int, int, int );
+void    count_pipes( void );
+
+/* builtin job runner */
+
+// background jobs
+int     handle_background( void );
+int     handle_jobs( void );
+
+/* batch job queue */
+int     handle_queue( void );
+pid_t   run_queued_job( char**, int, int );
+
 /* program execution function prototypes */
 int     handle_program_execution( void );
 int     is_redirection( void );
@@ -97,293 +180,2187 @@ int     is_pipe( void );
 /*                                                                   */
 /*      Function name: main()                                        */
 /*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int argc: number of command line arguments.              */
+/*          char** argv: the arguments.                              */
+/*      Description:                                                 */
+/*          main() will start the shell, or the batch queue daemon   */
+/*          when run as "shell --queue-daemon [-j N]", or the        */
+/*          command server and its client (see command_server.h).    */
+/*                                                                   */
+/*********************************************************************/
+int main( int argc, char** argv )
+{
+    if ( argc > 1 && strcmp( argv[1], QUEUE_DAEMON_FLAG ) == 0 )
+        return start_queue_daemon( argc, argv );
+
+    if ( argc > 1 && strcmp( argv[1], SERVE_FLAG ) == 0 )
+        return start_command_server( argc, argv );
+
+    if ( argc > 1 && strcmp( argv[1], CLIENT_FLAG ) == 0 )
+        return run_client( argc, argv );
+
+    if ( argc > 1 && argv[1][0] != '-' )
+        return run_script( argv[1], argv + 2, argc - 2 );
+
+    start_shell();
+    return EXIT_SUCCESS;
+} /* end main */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: start_queue_daemon                            */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int argc: number of command line arguments.              */
+/*          char** argv: "shell --queue-daemon [-j N]".              */
+/*                                                                   */
+/*      Description:                                                 */
+/*          serves the job queue, running at most N jobs at a time   */
+/*          (one per CPU by default). Only returns on failure.       */
+/*                                                                   */
+/*********************************************************************/
+int start_queue_daemon( int argc, char** argv )
+{
+    int max_running = (int) sysconf( _SC_NPROCESSORS_ONLN );
+
+    if ( argc == 4 && strcmp( argv[2], "-j" ) == 0 && atoi( argv[3] ) > 0 )
+        max_running = atoi( argv[3] );
+    else if ( argc != 2 )
+    {
+        fprintf( stderr, "usage: shell %s [-j max-jobs]\n",
+                 QUEUE_DAEMON_FLAG );
+        return EXIT_FAILURE;
+    }
+
+    if ( max_running < 1 )
+        max_running = 1;
+
+    if ( init_supervisor() == FAILURE )
+    {
+        fprintf( stderr, "Error: Could not start child supervision.\n" );
+        return EXIT_FAILURE;
+    }
+
+    run_queue_daemon( max_running, run_queued_job );
+    return EXIT_FAILURE;
+} /* end start_queue_daemon() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: start_command_server                          */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int argc: number of command line arguments.              */
+/*          char** argv: "shell --serve socket [-j N]".              */
+/*                                                                   */
+/*      Description:                                                 */
+/*          serves requests on socket, running at most N at a time   */
+/*          (one per CPU by default). Only returns on failure.       */
+/*                                                                   */
+/*********************************************************************/
+int start_command_server( int argc, char** argv )
+{
+    int n_workers = (int) sysconf( _SC_NPROCESSORS_ONLN );
+
+    if ( argc == 5 && strcmp( argv[3], "-j" ) == 0 && atoi( argv[4] ) > 0 )
+        n_workers = atoi( argv[4] );
+    else if ( argc != 3 )
+    {
+        fprintf( stderr, "usage: shell %s socket [-j max-requests]\n",
+                 SERVE_FLAG );
+        return EXIT_FAILURE;
+    }
+
+    if ( n_workers < 1 )
+        n_workers = 1;
+
+    run_command_server( argv[2], n_workers, run_request_text );
+    return EXIT_FAILURE;
+} /* end start_command_server() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_request_text                              */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char* text: a request's shell input, lines split by      */
+/*                      newlines.                                    */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the command server's request_runner, called in a fresh   */
+/*          fork of a worker. Runs text in a new shell context as    */
+/*          if it were a script, read_line() taking the lines an     */
+/*          open if, loop or here-document needs from it too.        */
+/*          Returns the last command's status.                       */
+/*                                                                   */
+/*********************************************************************/
+int run_request_text( char* text )
+{
+    struct timespec ts;
+    char* line;
+    int status;
+
+    init_instrument();
+
+    if ( init_supervisor() == FAILURE )
+        fprintf( stderr, "Error: Could not start child supervision.\n" );
+
+    jshell_use( jshell_new() );
+    request_text = text;
+
+    while ( ( line = read_line( NULL ) ) != NULL )
+    {
+        STAT_START( line_start );
+
+        if ( strcmp( line, "exit" ) == 0 )
+        {
+            free( line );
+            break;
+        }
+
+        STAT_START( ts );
+        parse_string( line, &jshell->cmds, &jshell->n_cmds,
+                      &jshell->n_pipes );
+        STAT_STOP( PHASE_PARSE, ts );
+
+        if ( jshell->cmds != NULL )
+            run_line();
+
+        free( line );
+
+        for ( int i = 0; i < jshell->n_cmds; i++ )
+            free( jshell->cmds[i] );
+
+        free( jshell->cmds );
+
+        jshell->cmds = NULL;
+        jshell->n_cmds = 0;
+        jshell->n_pipes = 0;
+
+        if ( interp_flow( &status ) == FLOW_EXIT )
+        {
+            set_last_status( status );
+            break;
+        }
+    }
+
+    fflush( NULL );
+    finish_instrument();
+
+    return last_status();
+} /* end run_request_text() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_script                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* path: the script to run.                     */
+/*          char** args: its arguments, $1..$N.                      */
+/*          int n_args: N.                                           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs each line of a script as if typed at the prompt,    */
+/*          here-documents reading the lines that follow. The        */
+/*          script's words come from its .jshc cache when that is    */
+/*          current (see script_cache.h), so an unchanged script is  */
+/*          never lexed twice. History is paused while it runs.      */
+/*          Returns the last command's status.                       */
+/*                                                                   */
+/*********************************************************************/
+int run_script( const char* path, char** args, int n_args )
+{
+    script_image image;
+    var_frame frame;
+    struct timespec ts;
+    uint32_t line;
+    int status;
+
+    init_instrument();
+
+    if ( init_supervisor() == FAILURE )
+        fprintf( stderr, "Error: Could not start child supervision.\n" );
+
+    if ( load_script( path, &image ) == FAILURE )
+        return EXIT_FAILURE;
+
+    script = &image;
+    push_frame( &frame, args, n_args );
+
+    /* a script's commands aren't the user's, keep them out of
+     * ~/.j_history */
+    pause_history( T );
+
+    while ( image.next < image.header->n_lines )
+    {
+        line = image.next++;
+        STAT_START( line_start );
+
+        if ( strcmp( script_text( &image, line ), "exit" ) == 0 )
+            break;
+
+        STAT_START( ts );
+        if ( script_words( &image, line, &jshell->cmds, &jshell->n_cmds,
+                           &jshell->n_pipes ) == FAILURE )
+            fprintf( stderr, "Error: Could not load line %u of %s.\n",
+                     line + 1, path );
+        STAT_STOP( PHASE_PARSE, ts );
+
+        if ( jshell->cmds != NULL )
+            run_line();
+
+        for ( int i = 0; i < jshell->n_cmds; i++ )
+            free( jshell->cmds[i] );
+
+        free( jshell->cmds );
+
+        jshell->cmds = NULL;
+        jshell->n_cmds = 0;
+        jshell->n_pipes = 0;
+
+        /* "exit N" inside the script */
+        if ( interp_flow( &status ) == FLOW_EXIT )
+        {
+            set_last_status( status );
+            break;
+        }
+    }
+
+    pause_history( F );
+    pop_frame();
+    script = NULL;
+    free_script( &image );
+    free_history();
+    free_aliases();
+    free_functions();
+    free_vars();
+    finish_instrument();
+
+    return last_status();
+} /* end run_script() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: start_shell                                   */
+/*      Return type:   void                                          */
 /*      Parameter(s):  None                                          */
 /*      Description:                                                 */
-/*          main() will start the shell.                             */
+/*          start_shell() will begin a loop prompting the user       */
+/*          for commands and call functions to tokenize and process  */
+/*          those commands.                                          */
+/*                                                                   */
+/*********************************************************************/
+void start_shell( void )
+{
+    char prompt[PROMPT_SIZE];
+    
+    /* assign prompt for readline */
+    if( getenv(HOST) == NULL )
+        sprintf( prompt, "%s@UnknownHost> ", getenv(USER) );
+    else
+        sprintf( prompt, "%s@%s> ", getenv(USER), getenv(HOST) );
+
+    char* line = NULL;
+    struct timespec ts;
+    int status;
+
+    init_instrument();
+
+    /* fork the spawn helper while the shell is still small */
+    if ( getenv( SPAWN_SERVER_ENV ) != NULL )
+        start_spawn_server();
+
+    if ( init_supervisor() == FAILURE )
+        fprintf( stderr, "Error: Could not start child supervision.\n" );
+
+    /* begin infinite loop to control shell */
+    while ( 1 )
+    {
+        /* say which background jobs finished since the last prompt */
+        report_jobs( F );
+
+        /* prompt then read line - line is allocated with malloc(3) */
+        line = read_line(prompt);
+        STAT_START( line_start );
+
+        /* check if user wants to exit the shell, or input ended */
+        if ( line == NULL || strcmp( line, "exit" ) == 0 )
+        {
+            free( line );
+            end_shell();
+            return;
+        }
+        else
+        {
+            STAT_START( ts );
+            parse_string( line, &jshell->cmds, &jshell->n_cmds,
+                          &jshell->n_pipes );
+            STAT_STOP( PHASE_PARSE, ts );
+        }
+
+        //print_commands();
+
+
+        if ( jshell->cmds != NULL )
+            run_line();
+
+        /* free all memory */
+        free( line );
+
+        for ( int i = 0; i < jshell->n_cmds; i++ )
+            free( jshell->cmds[i] );
+
+        free( jshell->cmds );
+
+        jshell->cmds = NULL;
+        jshell->n_cmds = 0;
+        jshell->n_pipes = 0;
+
+        /* "exit N", or an exit inside an if or a loop */
+        if ( interp_flow( &status ) == FLOW_EXIT )
+        {
+            end_shell();
+            exit( status );
+        }
+    }
+
+    free_history();
+    free_aliases();
+    finish_instrument();
+    return;
+}/* end start_shell() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: end_shell                                     */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          says goodbye and frees what the shell holds.             */
+/*                                                                   */
+/*********************************************************************/
+void end_shell( void )
+{
+    puts( "Now exiting the best shell ever created... :(\n" );
+    free_history();
+    free_aliases();
+    free_functions();
+    free_vars();
+    finish_instrument();
+    stop_spawn_server();
+} /* end end_shell() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_line                                      */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs the line in cmds through the interpreter, which     */
+/*          reads on if an if, loop or case is left open, and hands  */
+/*          each simple command back to run_words(). A line of more  */
+/*          than one command goes into history once, as typed.       */
+/*          Returns the line's exit status.                          */
+/*                                                                   */
+/*********************************************************************/
+int run_line( void )
+{
+    node* tree;
+    int status, compound;
+
+    set_substituter( substitute_words );
+    set_text_source( read_line );
+
+    tree = parse_line( jshell->cmds, jshell->n_cmds, next_line_words );
+    compound = is_compound( tree );
+
+    if ( tree == NULL )
+        return last_status();
+
+    if ( compound )
+        pause_history( T );
+
+    status = run_tree( tree, run_words );
+
+    if ( compound )
+    {
+        pause_history( F );
+        add_cmds_to_history( jshell->cmds, jshell->n_cmds, NULL );
+    }
+
+    free_tree( tree );
+    return status;
+} /* end run_line() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: run_words                                     */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** words: one simple command, left as it is.         */
+/*          int n_words: how many words.                             */
+/*          int pipes: how many of them are "|".                     */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the interpreter's command_runner: runs words through     */
+/*          process_commands() as if they were a line of their own   */
+/*          and returns the exit status.                             */
+/*                                                                   */
+/*********************************************************************/
+int run_words( char** words, int n_words, int pipes )
+{
+    char** saved_cmds = jshell->cmds;
+    int saved_n_cmds = jshell->n_cmds, saved_n_pipes = jshell->n_pipes;
+    int status = 0;
+
+    if ( ( jshell->cmds = malloc( ( n_words + 1 ) * sizeof(char*) ) ) == NULL )
+    {
+        jshell->cmds = saved_cmds;
+        return 1;
+    }
+
+    for ( jshell->n_cmds = 0; jshell->n_cmds < n_words; jshell->n_cmds++ )
+        if ( ( jshell->cmds[jshell->n_cmds] = strdup( words[jshell->n_cmds] ) )
+             == NULL )
+            break;
+
+    jshell->cmds[jshell->n_cmds] = NULL;
+    jshell->n_pipes = pipes;
+
+    if ( jshell->n_cmds < n_words || process_commands() == FAILURE )
+        status = 1;
+    else
+        status = last_run.status;
+
+    for ( int i = 0; i < jshell->n_cmds; i++ )
+        free( jshell->cmds[i] );
+
+    free( jshell->cmds );
+
+    jshell->cmds = saved_cmds;
+    jshell->n_cmds = saved_n_cmds;
+    jshell->n_pipes = saved_n_pipes;
+
+    return status;
+} /* end run_words() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: next_line_words                               */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char*** words: set to the next line's words.             */
+/*          int* n_words: set to how many.                           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the interpreter's line_source: the script's next line,   */
+/*          from its cache, or a line read at a "> " prompt.         */
+/*                                                                   */
+/*********************************************************************/
+int next_line_words( char*** words, int* n_words )
+{
+    int pipes = 0;
+    char* line;
+
+    if ( script != NULL )
+        return ( script->next < script->header->n_lines ?
+                 script_words( script, script->next++, words, n_words,
+                               &pipes ) : FAILURE );
+
+    if ( ( line = read_line( "> " ) ) == NULL )
+        return FAILURE;
+
+    *words = NULL;
+    *n_words = 0;
+    parse_string( line, words, n_words, &pipes );
+    free( line );
+
+    return SUCCESS;
+} /* end next_line_words() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: process_commands                              */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          Handles parsed commands for appropriate processing.      */
+/*          After processing certain commands, there is no need to   */
+/*          process the rest. I.E. printing history means we can     */
+/*          print the command history and continue without worrying  */
+/*          about handling other events in this loop iteration.      */
+/*                                                                   */
+/*********************************************************************/
+int process_commands( void )
+{
+    int timed, status, saved_meter;
+    long saved_pipe_size;
+
+    /* error checking */
+    if ( jshell->n_cmds == 0 )
+    {
+        fprintf( stderr, "No commands to process.\n" );
+        return FAILURE;
+    }
+
+    // suggested order of processing: 
+
+    // handle printing of history
+    if( handle_history() == SUCCESS )
+    {
+        add_cmds_to_history( jshell->cmds, jshell->n_cmds, NULL );
+        return SUCCESS; 
+    }
+
+    // handle printing resources used by the previous command
+    if( handle_lastrun() == SUCCESS )
+    {
+        add_cmds_to_history( jshell->cmds, jshell->n_cmds, NULL );
+        return SUCCESS; 
+    }
+
+    // handle printing the shell's own latency stats
+    if( handle_stats() == SUCCESS )
+    {
+        add_cmds_to_history( jshell->cmds, jshell->n_cmds, NULL );
+        return SUCCESS; 
+    }
+
+    // handle changing shell options
+    if( handle_set() == SUCCESS )
+    {
+        add_cmds_to_history( jshell->cmds, jshell->n_cmds, NULL );
+        return SUCCESS; 
+    }
+
+    // handle listing and waiting for background jobs
+    if( handle_jobs() == SUCCESS )
+    {
+        add_cmds_to_history( jshell->cmds, jshell->n_cmds, NULL );
+        return SUCCESS; 
+    }
+
+    // handle a trailing "&"
+    if( handle_background() == SUCCESS )
+    {
+        add_cmds_to_history( jshell->cmds, jshell->n_cmds, NULL );
+        return SUCCESS; 
+    }
+
+    // handle "time" in front of a command
+    timed = handle_time_prefix();
+
+    if ( jshell->n_cmds == 0 )
+    {
+        fprintf( stderr, "usage: time command ...\n" );
+        last_run.status = 1;
+        return FAILURE;
+    }
+
+    // handle "timeout [-k grace] secs" in front of a command
+    if ( handle_timeout_prefix() == FAILURE )
+    {
+        fprintf( stderr, "usage: timeout [-k grace] seconds command ...\n" );
+        last_run.status = 1;
+        return FAILURE;
+    }
+
+    // handle "pipesize N" in front of a pipeline
+    if ( handle_pipesize_prefix( &saved_pipe_size ) == FAILURE )
+    {
+        fprintf( stderr, "usage: pipesize bytes command ...\n" );
+        last_run.status = 1;
+        set_command_timeout( 0, 0 );
+        return FAILURE;
+    }
+
+    // handle "meter" in front of a pipeline
+    if ( handle_meter_prefix( &saved_meter ) == FAILURE )
+    {
+        fprintf( stderr, "usage: meter command | command ...\n" );
+        last_run.status = 1;
+        set_command_timeout( 0, 0 );
+        settings[SET_PIPESIZE] = saved_pipe_size;
+        return FAILURE;
+    }
+
+    /* run the command, recording what it used */
+    begin_run_stats();
+    status = execute_commands();
+    end_run_stats();
+    set_command_timeout( 0, 0 );
+    settings[SET_PIPESIZE] = saved_pipe_size;
+    options[OPT_METER] = saved_meter;
+
+    if ( timed == SUCCESS )
+        print_run_stats( stderr, &last_run );
+
+    /* add to history */
+    add_cmds_to_history( jshell->cmds, jshell->n_cmds, &last_run );
+
+    //print_commands();
+    return status;
+}/* end process_commands */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: execute_commands                              */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          Expands and runs the parsed command line. This is        */
+/*          everything process_commands() does apart from history    */
+/*          and timing.                                              */
+/*                                                                   */
+/*********************************************************************/
+int execute_commands( void )
+{
+    struct timespec ts;
+    int status;
+
+    // handle all alias processing 
+    STAT_START( ts );
+    status = handle_aliases();
+    STAT_STOP( PHASE_ALIAS, ts );
+
+    if ( status == FAILURE )
+        return FAILURE;
+
+    // handle {a,b} and {1..10}
+    if ( handle_braces() == FAILURE )
+        return FAILURE;
+
+    // handle environmental variable translations
+    STAT_START( ts );
+    handle_env_vars();
+    STAT_STOP( PHASE_ENV, ts );
+
+    // handle $(cmd) and `cmd`
+    if ( handle_command_substitution() == FAILURE )
+    {
+        release_held();
+        return FAILURE;
+    }
+
+    // handle <<EOF and <<< word
+    if ( handle_here_documents() == FAILURE )
+    {
+        release_held();
+        return FAILURE;
+    }
+
+    // handle <(cmd) and >(cmd)
+    if ( handle_process_substitution() == FAILURE )
+    {
+        release_held();
+        return FAILURE;
+    }
+
+    // handle *, ?, [...] and **
+    STAT_START( ts );
+    handle_globs();
+    STAT_STOP( PHASE_GLOB, ts );
+
+    // handle directory changes
+    if( handle_directory_change() == SUCCESS )
+        ;
+
+    // handle handing a command to the batch queue
+    else if( handle_queue() == SUCCESS )
+        ;
+        
+    // handle program execution
+    else
+        handle_program_execution();
+        // check for input/output redirection
+        // check for pipes
+        // check for background processes
+
+    /* close substitution pipes and reap their programs */
+    release_held();
+
+    return SUCCESS;
+}/* end execute_commands */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_history                                */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          prints history of commands entered. "history -t" also    */
+/*          prints the time and memory each command used.            */
+/*                                                                   */
+/*********************************************************************/
+int handle_history( void )
+{
+    if ( strcmp( jshell->cmds[0], "history" ) == 0 )
+    {
+        if ( jshell->n_cmds == 2 && strcmp( jshell->cmds[1], "-t" ) == 0 )
+            print_history_stats( stdout );
+        else
+            print_history( stdout ); 
+        last_run.status = 0;
+        return SUCCESS;
+    }
+    return FAILURE;
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_lastrun                                */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          prints the resources used by the previous command.       */
+/*                                                                   */
+/*********************************************************************/
+int handle_lastrun( void )
+{
+    if ( strcmp( jshell->cmds[0], "lastrun" ) != 0 )
+        return FAILURE;
+
+    print_run_stats( stdout, &last_run );
+    last_run.status = 0;
+    return SUCCESS;
+} /* end handle_lastrun() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_stats                                  */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          "stats" prints per-phase latencies, "stats on|off"       */
+/*          switches recording, "stats reset" clears it and          */
+/*          "stats -o FILE" writes it as JSON.                       */
+/*                                                                   */
+/*********************************************************************/
+int handle_stats( void )
+{
+    if ( strcmp( jshell->cmds[0], "stats" ) != 0 )
+        return FAILURE;
+
+    last_run.status = 0;
+
+    if ( jshell->n_cmds == 1 )
+        print_instrument( stdout );
+    else if ( strcmp( jshell->cmds[1], "on" ) == 0 )
+        instrument_enabled = 1;
+    else if ( strcmp( jshell->cmds[1], "off" ) == 0 )
+        instrument_enabled = 0;
+    else if ( strcmp( jshell->cmds[1], "reset" ) == 0 )
+        reset_instrument();
+    else if ( strcmp( jshell->cmds[1], "-o" ) == 0 && jshell->n_cmds > 2 )
+    {
+        if ( dump_instrument_json( jshell->cmds[2] ) == FAILURE )
+            last_run.status = 1;
+    }
+    else
+    {
+        fprintf( stderr, "usage: stats [on | off | reset | -o file]\n" );
+        last_run.status = 1;
+    }
+
+    return SUCCESS;
+} /* end handle_stats() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_pipesize_prefix                        */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          long* saved: receives the pipesize setting to restore    */
+/*                       once the command is done.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          removes a leading "pipesize N" from cmds and uses N as   */
+/*          the pipe size for this command line only. Returns        */
+/*          FAILURE only if the prefix is malformed.                 */
+/*                                                                   */
+/*********************************************************************/
+int handle_pipesize_prefix( long* saved )
+{
+    long size;
+
+    *saved = SETTING( SET_PIPESIZE );
+
+    if ( strcmp( jshell->cmds[0], "pipesize" ) != 0 )
+        return SUCCESS;
+
+    if ( jshell->n_cmds < 3 || ( size = parse_size( jshell->cmds[1] ) ) < 0 )
+        return FAILURE;
+
+    free( jshell->cmds[0] );
+    free( jshell->cmds[1] );
+    memmove( &jshell->cmds[0], &jshell->cmds[2],
+             ( jshell->n_cmds - 1 ) * sizeof(char*) );
+    jshell->n_cmds -= 2;
+
+    settings[SET_PIPESIZE] = size;
+    return SUCCESS;
+} /* end handle_pipesize_prefix() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_meter_prefix                           */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int* saved: receives the meter option to restore once    */
+/*                      the command is done.                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          removes a leading "meter" from cmds and meters this      */
+/*          command line's pipeline only. Returns FAILURE if         */
+/*          nothing follows it.                                      */
+/*                                                                   */
+/*********************************************************************/
+int handle_meter_prefix( int* saved )
+{
+    *saved = OPTION( OPT_METER );
+
+    if ( strcmp( jshell->cmds[0], "meter" ) != 0 )
+        return SUCCESS;
+
+    if ( jshell->n_cmds < 2 )
+        return FAILURE;
+
+    free( jshell->cmds[0] );
+    memmove( &jshell->cmds[0], &jshell->cmds[1],
+             jshell->n_cmds * sizeof(char*) );
+    jshell->n_cmds--;
+
+    options[OPT_METER] = T;
+    return SUCCESS;
+} /* end handle_meter_prefix() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_set                                    */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          lists or changes shell options with "set".               */
+/*                                                                   */
+/*********************************************************************/
+int handle_set( void )
+{
+    if ( strcmp( jshell->cmds[0], "set" ) != 0 )
+        return FAILURE;
+
+    last_run.status = ( run_set( jshell->cmds, jshell->n_cmds ) == SUCCESS ?
+                        0 : 1 );
+    return SUCCESS;
+} /* end handle_set() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_time_prefix                            */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          removes a leading "time" from cmds. Returns SUCCESS if   */
+/*          it was there, so the caller prints the run's stats.      */
+/*                                                                   */
+/*********************************************************************/
+int handle_time_prefix( void )
+{
+    if ( strcmp( jshell->cmds[0], "time" ) != 0 )
+        return FAILURE;
+
+    free( jshell->cmds[0] );
+    memmove( &jshell->cmds[0], &jshell->cmds[1],
+             jshell->n_cmds * sizeof(char*) );
+    jshell->n_cmds--;
+
+    return SUCCESS;
+} /* end handle_time_prefix() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_timeout_prefix                         */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          removes a leading "timeout [-k grace] secs" from cmds    */
+/*          and arms the supervisor, which sends SIGTERM to the      */
+/*          command's children after secs and SIGKILL grace seconds  */
+/*          later. Returns FAILURE only if the prefix is malformed.  */
+/*                                                                   */
+/*********************************************************************/
+int handle_timeout_prefix( void )
+{
+    double secs, grace = DEFAULT_KILL_GRACE;
+    char* end;
+    int n_prefix = 2;
+
+    if ( strcmp( jshell->cmds[0], "timeout" ) != 0 )
+        return SUCCESS;
+
+    if ( jshell->n_cmds > 2 && strcmp( jshell->cmds[1], "-k" ) == 0 )
+    {
+        grace = strtod( jshell->cmds[2], &end );
+        if ( *end != N_TERM || grace <= 0 )
+            return FAILURE;
+
+        n_prefix = 4;
+    }
+
+    if ( jshell->n_cmds <= n_prefix )
+        return FAILURE;
+
+    secs = strtod( jshell->cmds[n_prefix - 1], &end );
+    if ( *end != N_TERM || secs <= 0 )
+        return FAILURE;
+
+    for ( int i = 0; i < n_prefix; i++ )
+        free( jshell->cmds[i] );
+
+    memmove( &jshell->cmds[0], &jshell->cmds[n_prefix],
+             ( jshell->n_cmds - n_prefix + 1 ) * sizeof(char*) );
+    jshell->n_cmds -= n_prefix;
+
+    set_command_timeout( secs, grace );
+    return SUCCESS;
+} /* end handle_timeout_prefix() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: check_for_alias                               */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          Checks for aliases and converts them if found.           */
+/*          Return failure anytime an alias isnt being translated.   */
+/*          This is done so that way we know when we dont need to    */
+/*          use the alias any further.                               */
+/*                                                                   */
+/*********************************************************************/
+int handle_aliases( void )
+{
+    if ( strcmp( jshell->cmds[0], "alias" ) == 0 )
+    {
+        if( jshell->n_cmds < 4 )
+        {
+            fprintf( stderr, "Error, no alias specified to add.\n" );
+            return FAILURE;
+        }
+        add_alias( jshell->cmds[1], jshell->cmds[3] );
+        return FAILURE;
+    }
+    else if ( strcmp( jshell->cmds[0], "unalias" ) == 0 )
+    {
+        if( jshell->n_cmds < 2 )
+        {
+            fprintf( stderr, "Error, no alias specified to remove.\n" );
+            return FAILURE;
+
+        }
+        remove_alias( jshell->cmds[1] );
+        return FAILURE;
+    }
+    else if ( jshell->n_cmds == 2 && 
+              strcmp( jshell->cmds[0], "show" ) == 0 && 
+              strcmp( jshell->cmds[1], "aliases" ) == 0 
+            )
+    {
+        print_aliases();
+        return FAILURE;
+    }
+    else
+        check_for_alias();    
+
+    return SUCCESS; 
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_env_vars                               */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          checks for environmental variables and calls conversion  */
+/*          function.                                                */
+/*                                                                   */
+/*********************************************************************/
+int handle_env_vars( void )
+{
+    int counter = 0, n_args; 
+    char** args;
+
+    for( ; counter < jshell->n_cmds; counter++ )
+    {
+        /* "$(" starts a command substitution, not a variable */
+        if( strcmp( jshell->cmds[counter], "$" ) == 0 && 
+            ( counter + 1 == jshell->n_cmds ||
+              strcmp( jshell->cmds[counter + 1], "(" ) == 0 ) )
+            continue;
+
+        /* "$@" is every positional parameter, each its own word */
+        if( strcmp( jshell->cmds[counter], "$" ) == 0 &&
+            strcmp( jshell->cmds[counter + 1], "@" ) == 0 )
+        {
+            args = positional_args( &n_args );
+
+            if ( splice_strings( &jshell->cmds, &jshell->n_cmds, counter, 2,
+                                 args, n_args ) == SUCCESS )
+                counter += n_args - 1;
+            continue;
+        }
+
+        /* if we find a possible environmental variable */
+        if( strcmp( jshell->cmds[counter], "$" ) == 0 )
+            if ( convert_env_var( counter ) == SUCCESS )
+                counter--; 
+    }
+    return SUCCESS; 
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_directory_change                       */
+/*      Return type:   int.                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          determines and conducts directory change if needed.      */
+/*          Returns SUCCESS for any cd, the status says if it        */
+/*          worked.                                                  */
+/*                                                                   */
+/*********************************************************************/
+int handle_directory_change( void )
+{
+    /* ensure we want to switch directories */
+    if ( strcmp( jshell->cmds[0], "cd" ) != 0 )
+        return FAILURE;
+
+    /* switching to home directory */
+    if ( jshell->n_cmds == 1 || 
+         strcmp( jshell->cmds[1], "~/" ) == 0 || 
+         strcmp( jshell->cmds[1], "~" ) == 0 
+       )
+    {
+        if( is_directory( getenv( "HOME" ) ) != 0 )
+        {
+            if( chdir( getenv( "HOME" ) ) != 0 )
+            {
+                printf("Error: Cannot switch to HOME directory.\n" );
+                last_run.status = 1;
+                return SUCCESS;
+            }
+            else
+            {
+                setenv( PWD, getenv( "HOME" ), 1 );
+                return SUCCESS; 
+            }
+        }
+    }
+
+    /* switching to any other directory */
+    if ( chdir( jshell->cmds[1] ) != 0 )
+    {
+        printf( "Error: Cannot change directory to %s\n", jshell->cmds[1] );
+        last_run.status = 1;
+        return SUCCESS;
+    }
+
+    return SUCCESS;
+} /* end handle_directory_change() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_here_documents                         */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          turns "<< DELIM" into input redirection from the lines   */
+/*          up to DELIM, and "<<< words" into redirection from       */
+/*          words plus a newline. The lines are the ones the         */
+/*          interpreter read with the command (see here_doc_text()), */
+/*          else they are read now. The text is kept in memory       */
+/*          (see here_doc_fd()) and handed to the normal input       */
+/*          redirection as /dev/fd/N.                                */
+/*                                                                   */
+/*********************************************************************/
+int handle_here_documents( void )
+{
+    char* body = NULL;
+    char* text;
+    const char* stored;
+    size_t len = 0, cap = 0;
+    int i, end, status, n_docs = 0;
+
+    for ( i = 0; i < jshell->n_cmds; i++ )
+    {
+        /* here-string: the rest of the words up to the next operator */
+        if ( strcmp( jshell->cmds[i], "<<<" ) == 0 )
+        {
+            for ( end = i + 1;
+                  end < jshell->n_cmds && !is_operator( jshell->cmds[end] );
+                  end++ )
+            {
+                if ( end > i + 1 )
+                    append_text( &body, &len, &cap, " ", 1 );
+
+                append_text( &body, &len, &cap, jshell->cmds[end],
+                             strlen( jshell->cmds[end] ) );
+            }
+
+            append_text( &body, &len, &cap, "\n", 1 );
+        }
+        /* here-document: lines up to one that is just the delimiter */
+        else if ( strcmp( jshell->cmds[i], "<<" ) == 0 )
+        {
+            if ( i + 1 >= jshell->n_cmds || is_operator( jshell->cmds[i + 1] ) )
+            {
+                fprintf( stderr, "Error: Missing here-document delimiter.\n" );
+                return FAILURE;
+            }
+
+            append_text( &body, &len, &cap, "", 0 );
+
+            /* the interpreter read it along with the command */
+            if ( ( stored = here_doc_text( n_docs++ ) ) != NULL )
+                append_text( &body, &len, &cap, stored, strlen( stored ) );
+            else
+            {
+                while ( ( text = read_line( "> " ) ) != NULL &&
+                        strcmp( text, jshell->cmds[i + 1] ) != 0 )
+                {
+                    append_text( &body, &len, &cap, text, strlen( text ) );
+                    append_text( &body, &len, &cap, "\n", 1 );
+                    free( text );
+                }
+
+                free( text );
+            }
+
+            end = i + 2;
+        }
+        else
+            continue;
+
+        status = redirect_from_text( i, end, body, len );
+
+        free( body );
+        body = NULL;
+        len = cap = 0;
+
+        if ( status == FAILURE )
+            return FAILURE;
+    }
+
+    return SUCCESS;
+} /* end handle_here_documents() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: redirect_from_text                            */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int start: index of the "<<" or "<<<" token.             */
+/*          int end: index just past the words it consumed.          */
+/*          const char* text: text the command should read.          */
+/*          size_t len: number of bytes in text.                     */
+/*                                                                   */
+/*      Description:                                                 */
+/*          replaces cmds[start..end) with "< /dev/fd/N", where N    */
+/*          reads back text. N is held until the line is done.       */
+/*                                                                   */
+/*********************************************************************/
+int redirect_from_text( int start, int end, const char* text, size_t len )
+{
+    char fd_path[32];
+    char* words[2] = { "<", fd_path };
+    int fd;
+
+    if ( ( fd = here_doc_fd( text == NULL ? "" : text, len ) ) == -1 )
+        return FAILURE;
+
+    if ( hold_fd( fd ) == FAILURE )
+    {
+        close( fd );
+        return FAILURE;
+    }
+
+    snprintf( fd_path, sizeof(fd_path), "/dev/fd/%d", fd );
+    return splice_strings( &jshell->cmds, &jshell->n_cmds, start, end - start,
+                           words, 2 );
+} /* end redirect_from_text() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: is_operator                                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          const char* word: token to test.                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          returns T if word is a pipe, redirection or background   */
+/*          token, which ends a run of plain words.                  */
+/*                                                                   */
+/*********************************************************************/
+int is_operator( const char* word )
+{
+    return ( strcmp( word, "|" ) == 0 || strcmp( word, "<" ) == 0 ||
+             strcmp( word, ">" ) == 0 || strcmp( word, "&" ) == 0 ||
+             strcmp( word, "<<" ) == 0 || strcmp( word, "<<<" ) == 0 );
+} /* end is_operator() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_command_substitution                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          replaces every $(cmd) and `cmd` with the words cmd       */
+/*          prints. Nested substitutions are expanded by the         */
+/*          subshell that runs the outer one.                        */
+/*                                                                   */
+/*********************************************************************/
+int handle_command_substitution( void )
+{
+    int i, close_pos, added, found = FAILURE;
+
+    for ( i = 0; i < jshell->n_cmds; i++ )
+    {
+        if ( strcmp( jshell->cmds[i], "$" ) == 0 && i + 1 < jshell->n_cmds &&
+             strcmp( jshell->cmds[i + 1], "(" ) == 0 )
+        {
+            if ( ( close_pos = find_closing_paren( i + 1 ) ) == -1 )
+            {
+                fprintf( stderr, "Error: Missing ')' in command substitution.\n" );
+                return FAILURE;
+            }
+
+            added = substitute_output( i, close_pos - i + 1,
+                                       &jshell->cmds[i + 2],
+                                       close_pos - i - 2 );
+        }
+        else if ( strcmp( jshell->cmds[i], "`" ) == 0 )
+        {
+            for ( close_pos = i + 1; close_pos < jshell->n_cmds &&
+                  strcmp( jshell->cmds[close_pos], "`" ) != 0; close_pos++ )
+                continue;
+
+            if ( close_pos == jshell->n_cmds )
+            {
+                fprintf( stderr, "Error: Missing '`' in command substitution.\n" );
+                return FAILURE;
+            }
+
+            added = substitute_output( i, close_pos - i + 1,
+                                       &jshell->cmds[i + 1],
+                                       close_pos - i - 1 );
+        }
+        else
+            continue;
+
+        if ( added == -1 )
+            return FAILURE;
+
+        /* the output is data, don't expand it again */
+        i += added - 1;
+        found = SUCCESS;
+    }
+
+    /* pipes inside substitutions no longer belong to the command */
+    if ( found == SUCCESS )
+        count_pipes();
+
+    return SUCCESS;
+} /* end handle_command_substitution() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: substitute_words                              */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char*** words: malloc'd, NULL terminated words, set to   */
+/*                         the array they end up in.                 */
+/*          int* n_words: how many, updated.                         */
+/*                                                                   */
+/*      Description:                                                 */
+/*          the interpreter's word_substituter: runs                 */
+/*          handle_command_substitution() on words as if they were   */
+/*          the command line, leaving the line itself untouched.     */
+/*                                                                   */
+/*********************************************************************/
+int substitute_words( char*** words, int* n_words )
+{
+    char** saved_cmds = jshell->cmds;
+    int saved_n_cmds = jshell->n_cmds, saved_n_pipes = jshell->n_pipes;
+    int status;
+
+    jshell->cmds = *words;
+    jshell->n_cmds = *n_words;
+
+    status = handle_command_substitution();
+
+    *words = jshell->cmds;
+    *n_words = jshell->n_cmds;
+
+    jshell->cmds = saved_cmds;
+    jshell->n_cmds = saved_n_cmds;
+    jshell->n_pipes = saved_n_pipes;
+
+    return status;
+} /* end substitute_words() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: substitute_output                             */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int start: index of the first token to replace.          */
+/*          int n_remove: number of tokens the substitution spans.   */
+/*          char** words: command line inside the substitution.      */
+/*          int n_words: number of strings in words.                 */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs words, splits what they print on whitespace and     */
+/*          puts the pieces in place of cmds[start..start+n_remove). */
+/*          The words are split inside the capture buffer, so each   */
+/*          is copied only once, into cmds. Returns the number of    */
+/*          words inserted or -1 on failure.                         */
+/*                                                                   */
+/*********************************************************************/
+int substitute_output( int start, int n_remove, char** words, int n_words )
+{
+    char* out = NULL;
+    char** split = NULL;
+    size_t len = 0, pos = 0;
+    int n_split = 0, cap = 0;
+    char** grown;
+
+    if ( builtin_output( words, n_words, &out, &len ) == FAILURE &&
+         capture_output( words, n_words, &out, &len ) == FAILURE )
+        return -1;
+
+    /* terminate each word in place and collect pointers to them */
+    while ( pos < len )
+    {
+        while ( pos < len && isspace( (unsigned char) out[pos] ) )
+            out[pos++] = '\0';
+
+        if ( pos == len )
+            break;
+
+        if ( n_split == cap )
+        {
+            cap = ( cap == 0 ? 16 : cap * 2 );
+            if ( ( grown = (char**) realloc( split, cap * sizeof(char*) ) )
+                    == NULL )
+            {
+                free( split );
+                free( out );
+                return -1;
+            }
+            split = grown;
+        }
+
+        split[n_split++] = &out[pos];
+
+        while ( pos < len && !isspace( (unsigned char) out[pos] ) )
+            pos++;
+    }
+
+    if ( out != NULL )
+        out[len] = '\0';
+
+    if ( splice_strings( &jshell->cmds, &jshell->n_cmds, start, n_remove,
+                         split, n_split ) == FAILURE )
+        n_split = -1;
+
+    free( split );
+    free( out );
+
+    return n_split;
+} /* end substitute_output() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: builtin_output                                */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** words: command line inside the substitution.      */
+/*          int n_words: number of strings in words.                 */
+/*          char** out: set to the output, allocated with malloc.    */
+/*          size_t* len: set to the length of the output.            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          produces the output of simple echo and pwd commands      */
+/*          without forking. Returns FAILURE if words need a real    */
+/*          subshell, which includes echo with options like -n or    */
+/*          -e.                                                      */
+/*                                                                   */
+/*********************************************************************/
+int builtin_output( char** words, int n_words, char** out, size_t* len )
+{
+    size_t cap = 0;
+    char cwd[PATH_MAX];
+
+    if ( n_words == 0 )
+    {
+        *out = NULL;
+        *len = 0;
+        return SUCCESS;
+    }
+
+    /* anything that needs expanding or redirecting goes to a subshell */
+    for ( int i = 0; i < n_words; i++ )
+    {
+        if ( is_operator( words[i] ) || strcmp( words[i], ";" ) == 0 ||
+             strcmp( words[i], "$" ) == 0 ||
+             strcmp( words[i], "`" ) == 0 || strcmp( words[i], "(" ) == 0 ||
+             strcmp( words[i], "<(" ) == 0 || strcmp( words[i], ">(" ) == 0 ||
+             find_alias( words[i] ) != NULL )
+            return FAILURE;
+    }
+
+    *out = NULL;
+    *len = 0;
+
+    if ( strcmp( words[0], "echo" ) == 0 )
+    {
+        /* leave -n, -e and the rest to the real echo */
+        if ( n_words > 1 && words[1][0] == '-' )
+            return FAILURE;
+
+        for ( int i = 1; i < n_words; i++ )
+        {
+            if ( i > 1 )
+                append_text( out, len, &cap, " ", 1 );
+
+            append_text( out, len, &cap, words[i], strlen( words[i] ) );
+        }
+
+        return append_text( out, len, &cap, "\n", 1 );
+    }
+
+    if ( strcmp( words[0], "pwd" ) == 0 && n_words == 1 &&
+         getcwd( cwd, sizeof(cwd) ) != NULL )
+        return append_text( out, len, &cap, cwd, strlen( cwd ) );
+
+    return FAILURE;
+} /* end builtin_output() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: capture_output                                */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          char** words: command line to run.                       */
+/*          int n_words: number of strings in words.                 */
+/*          char** out: set to the output, allocated with malloc.    */
+/*          size_t* len: set to the length of the output.            */
+/*                                                                   */
+/*      Description:                                                 */
+/*          runs words in a subshell and reads everything it writes  */
+/*          to stdout. The buffer doubles whenever it fills so big   */
+/*          outputs take few reads and few reallocations. One byte   */
+/*          is always left free for a terminator. The wait for the   */
+/*          first byte is recorded as first-byte latency.            */
+/*                                                                   */
+/*********************************************************************/
+int capture_output( char** words, int n_words, char** out, size_t* len )
+{
+    int pipe_fd[2];
+    size_t cap = CAPTURE_SIZE;
+    char* buf;
+    char* grown;
+    ssize_t n;
+    pid_t pid;
+    struct timespec started;
+
+    if ( ( buf = (char*) malloc( cap ) ) == NULL )
+    {
+        fprintf( stderr, "Error allocating memory for command output.\n" );
+        return FAILURE;
+    }
+
+    if ( pipe2( pipe_fd, O_CLOEXEC ) == -1 )
+    {
+        fprintf( stderr, "Error: Calling pipe() failed.\n" );
+        free( buf );
+        return FAILURE;
+    }
+
+    STAT_START( started );
+    pid = spawn_subshell( words, n_words, STDIN_FILENO, pipe_fd[WRITE_END],
+                           F );
+    close( pipe_fd[WRITE_END] );
+
+    if ( pid == -1 )
+    {
+        close( pipe_fd[READ_END] );
+        free( buf );
+        return FAILURE;
+    }
+
+    *len = 0;
+    while ( 1 )
+    {
+        if ( cap - *len < CAPTURE_SIZE / 2 )
+        {
+            if ( ( grown = (char*) realloc( buf, cap * 2 ) ) == NULL )
+                break;
+
+            buf = grown;
+            cap *= 2;
+        }
+
+        n = read( pipe_fd[READ_END], buf + *len, cap - *len - 1 );
+
+        if ( n == -1 && errno == EINTR )
+            continue;
+
+        if ( n <= 0 )
+            break;
+
+        /* time until the command produced anything at all */
+        if ( *len == 0 )
+            STAT_STOP( PHASE_FIRST_BYTE, started );
+
+        *len += (size_t) n;
+    }
+
+    close( pipe_fd[READ_END] );
+    reap_child( pid, NULL, 0 );
+
+    *out = buf;
+    return SUCCESS;
+} /* end capture_output() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_globs                                  */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          replaces every word holding *, ? or [...] with the       */
+/*          paths it matches, in sorted order. A word that matches   */
+/*          nothing is passed on as it is. "set +o glob" turns this  */
+/*          off.                                                     */
+/*                                                                   */
+/*********************************************************************/
+int handle_globs( void )
+{
+    char** matches;
+    int n_matches;
+
+    if ( !OPTION( OPT_GLOB ) )
+        return SUCCESS;
+
+    for ( int i = 0; i < jshell->n_cmds; i++ )
+    {
+        if ( has_glob_meta( jshell->cmds[i] ) == FAILURE )
+            continue;
+
+        if ( expand_glob( jshell->cmds[i], &matches, &n_matches ) == FAILURE ||
+             n_matches == 0 )
+        {
+            free_matches( matches, n_matches );
+            continue;
+        }
+
+        if ( splice_strings( &jshell->cmds, &jshell->n_cmds, i, 1, matches,
+                             n_matches ) == FAILURE )
+        {
+            fprintf( stderr, "Error: Could not expand pattern.\n" );
+            free_matches( matches, n_matches );
+            return FAILURE;
+        }
+
+        i += n_matches - 1;
+        free_matches( matches, n_matches );
+    }
+
+    return SUCCESS;
+} /* end handle_globs() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_braces                                 */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          replaces every word holding {a,b} or {X..Y} with its     */
+/*          expansions. A word whose expansions would not fit in     */
+/*          one exec is not expanded here: it is marked with         */
+/*          BRACE_MARKER and the program's child hands the words     */
+/*          out batch by batch, so {1..10000000} is never held.      */
+/*                                                                   */
+/*********************************************************************/
+int handle_braces( void )
+{
+    brace_gen* gen;
+    char* marked;
+    size_t len;
+    long count;
+    int status;
+
+    for ( int i = 0; i < jshell->n_cmds; i++ )
+    {
+        if ( has_braces( jshell->cmds[i] ) == FAILURE ||
+             ( gen = brace_compile( jshell->cmds[i] ) ) == NULL )
+            continue;
+
+        count = brace_count( gen );
+        len = brace_max_len( gen );
+
+        if ( count > (long) ( arg_space() / ARG_COST( len ) ) )
+        {
+            brace_free( gen );
+            len = strlen( jshell->cmds[i] );
+
+            if ( ( marked = malloc( len + 2 ) ) == NULL )
+                return FAILURE;
+
+            marked[0] = BRACE_MARKER;
+            memcpy( marked + 1, jshell->cmds[i], len + 1 );
+            free( jshell->cmds[i] );
+            jshell->cmds[i] = marked;
+            continue;
+        }
+
+        status = expand_braces( i, gen );
+        brace_free( gen );
+
+        if ( status == FAILURE )
+        {
+            fprintf( stderr, "Error: Could not expand braces.\n" );
+            return FAILURE;
+        }
+
+        i += (int) count - 1;
+    }
+
+    return SUCCESS;
+} /* end handle_braces() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: expand_braces                                 */
+/*      Return type:   int                                           */
+/*      Parameter(s):                                                */
+/*          int index: the word in cmds gen was compiled from.       */
+/*          brace_gen* gen: its generator.                           */
+/*                                                                   */
+/*      Description:                                                 */
+/*          puts every expansion of gen in place of cmds[index].     */
+/*          The count is known up front, so the words are laid out   */
+/*          in one block and spliced in with a single resize.        */
 /*                                                                   */
 /*********************************************************************/
-int main( void )
+int expand_braces( int index, brace_gen* gen )
 {
-    start_shell();
-    return EXIT_SUCCESS;
-} /* end main */
+    long count = brace_count( gen );
+    size_t stride = brace_max_len( gen ) + 1;
+    const char* word;
+    char** words;
+    char* arena;
+    int n = 0, status;
+
+    words = malloc( count * sizeof(char*) );
+    arena = malloc( count * stride );
+
+    if ( words == NULL || arena == NULL )
+    {
+        free( words );
+        free( arena );
+        return FAILURE;
+    }
+
+    while ( n < count && brace_next( gen, &word ) == SUCCESS )
+    {
+        words[n] = arena + n * stride;
+        strcpy( words[n++], word );
+    }
+
+    status = splice_strings( &jshell->cmds, &jshell->n_cmds, index, 1,
+                             words, n );
+
+    free( words );
+    free( arena );
+
+    return status;
+} /* end expand_braces() */
 
 
 /*********************************************************************/
 /*                                                                   */
-/*      Function name: start_shell                                   */
-/*      Return type:   void                                          */
-/*      Parameter(s):  None                                          */
+/*      Function name: handle_process_substitution                   */
+/*      Return type:   int                                           */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
 /*      Description:                                                 */
-/*          start_shell() will begin a loop prompting the user       */
-/*          for commands and call functions to tokenize and process  */
-/*          those commands.                                          */
+/*          replaces every <(cmd) and >(cmd) with /dev/fd/N, where   */
+/*          N is one end of a pipe whose other end is connected to   */
+/*          cmd running in a subshell. The subshells run alongside   */
+/*          the outer command, so nothing is written to disk.        */
 /*                                                                   */
 /*********************************************************************/
-void start_shell( void )
+int handle_process_substitution( void )
 {
-    char prompt[PROMPT_SIZE];
-    
-    /* assign prompt for readline */
-    if( getenv(HOST) == NULL )
-        sprintf( prompt, "%s@UnknownHost> ", getenv(USER) );
-    else
-        sprintf( prompt, "%s@%s> ", getenv(USER), getenv(HOST) );
-
-    char* line = NULL;
+    char fd_path[32];
+    char* fd_arg = fd_path;
+    int pipe_fd[2], mine, theirs;
+    int i, close_pos, found = FAILURE;
+    pid_t pid;
 
-    /* begin infinite loop to control shell */
-    while ( 1 )
+    for ( i = 0; i < jshell->n_cmds; i++ )
     {
-        /* prompt then read line - line is allocated with malloc(3) */
-        line = readline(prompt);
+        if ( strcmp( jshell->cmds[i], "<(" ) != 0 &&
+             strcmp( jshell->cmds[i], ">(" ) != 0 )
+            continue;
 
-        /* check if user wants to exit the shell */
-        if ( strcmp( line, "exit" ) == 0 )
+        if ( ( close_pos = find_closing_paren( i ) ) == -1 )
         {
-            puts( "Now exiting the best shell ever created... :(\n" );
-            free( line );
-            free_history();
-            free_aliases();
-            return;
+            fprintf( stderr, "Error: Missing ')' in process substitution.\n" );
+            return FAILURE;
         }
-        else
-            parse_string( line, &cmds, &n_cmds, &n_pipes );
 
-        //print_commands();
+        if ( pipe( pipe_fd ) == -1 )
+        {
+            fprintf( stderr, "Error: Calling pipe() failed.\n" );
+            return FAILURE;
+        }
+
+        /* <(cmd): cmd writes, outer reads. >(cmd): the reverse. */
+        mine = pipe_fd[jshell->cmds[i][0] == '<' ? READ_END : WRITE_END];
+        theirs = pipe_fd[jshell->cmds[i][0] == '<' ? WRITE_END : READ_END];
 
+        /* 
+         * keep our end open, without close-on-exec, for the outer cmd.
+         * Holding it first also makes the subshell close its copy, or
+         * a >(cmd) reader would never see EOF.
+         */
+        if ( hold_fd( mine ) == FAILURE )
+        {
+            close( mine );
+            close( theirs );
+            return FAILURE;
+        }
 
-        if ( cmds != NULL )
-            if ( process_commands() == FAILURE )
-                ;
+        if ( jshell->cmds[i][0] == '<' )
+            pid = spawn_subshell( &jshell->cmds[i + 1], close_pos - i - 1,
+                                  STDIN_FILENO, theirs, F );
+        else
+            pid = spawn_subshell( &jshell->cmds[i + 1], close_pos - i - 1,
+                                  theirs, STDOUT_FILENO, F );
 
-        /* free all memory */
-        free( line );
+        close( theirs );
 
-        for ( int i = 0; i < n_cmds; i++ )
-            free( cmds[i] );
+        if ( pid == -1 )
+            return FAILURE;
 
-        free( cmds );
+        hold_child( pid );
 
-        n_cmds = 0;
-        n_pipes = 0;
+        snprintf( fd_path, sizeof(fd_path), "/dev/fd/%d", mine );
+        splice_strings( &jshell->cmds, &jshell->n_cmds, i, close_pos - i + 1,
+                        &fd_arg, 1 );
+        found = SUCCESS;
     }
 
-    free_history();
-    free_aliases();
-    return;
-}/* end start_shell() */
+    /* pipes inside substitutions no longer belong to the command */
+    if ( found == SUCCESS )
+        count_pipes();
+
+    return SUCCESS;
+} /* end handle_process_substitution() */
 
 
 /*********************************************************************/
 /*                                                                   */
-/*      Function name: process_commands                              */
+/*      Function name: find_closing_paren                            */
 /*      Return type:   int                                           */
-/*      Parameter(s):  none                                          */
+/*      Parameter(s):                                                */
+/*          int open_pos: index of an opening "(" "<(" or ">(".      */
 /*                                                                   */
 /*      Description:                                                 */
-/*          Handles parsed commands for appropriate processing.      */
-/*          After processing certain commands, there is no need to   */
-/*          process the rest. I.E. printing history means we can     */
-/*          print the command history and continue without worrying  */
-/*          about handling other events in this loop iteration.      */
+/*          returns the index of the matching ")", counting nested   */
+/*          parentheses, or -1 if there is none.                     */
 /*                                                                   */
 /*********************************************************************/
-int process_commands( void )
+int find_closing_paren( int open_pos )
 {
-    /* error checking */
-    if ( n_cmds == 0 )
+    int depth = 0;
+
+    for ( int i = open_pos; i < jshell->n_cmds; i++ )
     {
-        fprintf( stderr, "No commands to process.\n" );
-        return FAILURE;
+        if ( strcmp( jshell->cmds[i], "(" ) == 0 ||
+             strcmp( jshell->cmds[i], "<(" ) == 0 ||
+             strcmp( jshell->cmds[i], ">(" ) == 0 )
+            depth++;
+        else if ( strcmp( jshell->cmds[i], ")" ) == 0 && --depth == 0 )
+            return i;
     }
 
-    // suggested order of processing: 
+    return -1;
+} /* end find_closing_paren() */
 
-    // handle printing of history
-    if( handle_history() == SUCCESS )
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: spawn_subshell                                */
+/*      Return type:   pid_t                                         */
+/*      Parameter(s):                                                */
+/*          char** words: command line for the subshell.             */
+/*          int n_words: number of strings in words.                 */
+/*          int fd_in: descriptor to use as the subshell's stdin.    */
+/*          int fd_out: descriptor to use as the subshell's stdout.  */
+/*          int new_group: T to put it in its own process group,     */
+/*                         so ctrl-c at the prompt doesn't reach it. */
+/*                                                                   */
+/*      Description:                                                 */
+/*          forks a copy of the shell that runs words through the    */
+/*          interpreter and exits with their status. Aliases,        */
+/*          variables, pipes, nested substitutions, ";", loops and   */
+/*          functions all work in it. The child is watched by the    */
+/*          supervisor. Returns the child's pid, or -1 on failure.   */
+/*                                                                   */
+/*********************************************************************/
+pid_t spawn_subshell( char** words, int n_words, int fd_in, int fd_out,
+                      int new_group )
+{
+    node* tree;
+    int status, exit_code;
+    pid_t pid;
+
+    /* don't let the child flush our buffered output a second time */
+    fflush( NULL );
+
+    if ( ( pid = fork() ) == -1 )
     {
-        add_cmds_to_history( cmds, n_cmds );
-        return SUCCESS; 
+        fprintf( stderr, "Error: Calling fork() failed.\n" );
+        return -1;
     }
 
-    // handle all alias processing 
-    if ( handle_aliases() == FAILURE )
+    if ( pid != 0 )
     {
-        add_cmds_to_history( cmds, n_cmds );
-        return FAILURE;
+        if ( new_group )
+            setpgid( pid, pid );
+
+        watch_child( pid );
+        return pid;
     }
 
-    // handle environmental variable translations
-    handle_env_vars();
+    /* child: it supervises only the children it starts itself */
+    reset_supervisor();
+    reset_job_mux();
+    stop_spawn_server();
+    close_queue_fds();
 
-    // handle directory changes
-    if( handle_directory_change() == SUCCESS )
+    if ( new_group )
+        setpgid( 0, 0 );
+
+    /* wire up stdio and drop the outer command's pipes */
+    if ( fd_out != STDOUT_FILENO )
     {
-        add_cmds_to_history( cmds, n_cmds );
-        return SUCCESS; 
+        dup2( fd_out, STDOUT_FILENO );
+        close( fd_out );
     }
-        
-    // handle program execution
-    handle_program_execution();
-        // check for input/output redirection
-        // check for pipes
-        // check for background processes
 
-    /* add to history */
-    add_cmds_to_history( cmds, n_cmds );
+    if ( fd_in != STDIN_FILENO )
+    {
+        dup2( fd_in, STDIN_FILENO );
+        close( fd_in );
+    }
 
-    //print_commands();
-    return SUCCESS;
-}/* end process_commands */
+    close_held_fds();
+
+    /* the subshell runs the words as its own command line, with
+     * nothing more to read if they leave a construct open */
+    if ( ( tree = parse_line( words, n_words, NULL ) ) == NULL )
+        exit( last_status() );
+
+    status = run_tree( tree, run_words );
+
+    if ( interp_flow( &exit_code ) == FLOW_EXIT )
+        status = exit_code;
+
+    exit( status );
+} /* end spawn_subshell() */
 
 
 /*********************************************************************/
 /*                                                                   */
-/*      Function name: handle_history                                */
+/*      Function name: count_pipes                                   */
+/*      Return type:   void                                          */
+/*      Parameter(s):  none                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          recounts n_pipes after cmds was rewritten.               */
+/*                                                                   */
+/*********************************************************************/
+void count_pipes( void )
+{
+    jshell->n_pipes = 0;
+
+    for ( int i = 0; i < jshell->n_cmds; i++ )
+        if ( strcmp( jshell->cmds[i], "|" ) == 0 )
+            jshell->n_pipes++;
+} /* end count_pipes() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: handle_background                             */
 /*      Return type:   int                                           */
 /*      Parameter(s):  none                                          */
 /*                                                                   */
 /*      Description:                                                 */
-/*          prints history of commands entered.                      */
+/*          runs a command line ending in "&" in a subshell of its   */
+/*          own process group, reading from /dev/null, and returns   */
+/*          to the prompt at once. The supervisor reaps it and it    */
+/*          is reported as "[n] Done" before a later prompt. With    */
+/*          "set -o jobmux" its output comes back through the shell  */
+/*          as whole lines marked "[n] " (see job_mux.h).            */
 /*                                                                   */
 /*********************************************************************/
-int handle_history( void )
+int handle_background( void )
 {
-    if ( strcmp( cmds[0], "history" ) == 0 )
+    char text[PROMPT_SIZE + 1] = "";
+    size_t len = 0;
+    int fd_in, job_id, muxed;
+    job_pipes pipes;
+    pid_t pid;
+
+    if ( strcmp( jshell->cmds[jshell->n_cmds - 1], "&" ) != 0 )
+        return FAILURE;
+
+    if ( jshell->n_cmds == 1 )
     {
-        print_history( stdout ); 
+        fprintf( stderr, "Error: Nothing to run in the background.\n" );
+        last_run.status = 1;
         return SUCCESS;
     }
-    return FAILURE;
-}
+
+    /* text shown by jobs, cut short if it is long */
+    for ( int i = 0; i < jshell->n_cmds - 1 && len < PROMPT_SIZE; i++ )
+        len += (size_t) snprintf( text + len, sizeof(text) - len, "%s%s",
+                                  i == 0 ? "" : " ", jshell->cmds[i] );
+
+    if ( ( fd_in = open( "/dev/null", O_RDONLY | O_CLOEXEC ) ) == -1 )
+        fd_in = STDIN_FILENO;
+
+    muxed = ( OPTION( OPT_JOBMUX ) && open_job_pipes( &pipes ) == SUCCESS );
+
+    if ( muxed )
+    {
+        pid = spawn_job( jshell->cmds, jshell->n_cmds - 1, fd_in,
+                         pipes.out[WRITE_END], pipes.err[WRITE_END] );
+        close_job_writers( &pipes );
+    }
+    else
+        pid = spawn_subshell( jshell->cmds, jshell->n_cmds - 1, fd_in,
+                              STDOUT_FILENO, T );
+
+    if ( fd_in != STDIN_FILENO )
+        close( fd_in );
+
+    job_id = ( pid == -1 ? 0 : add_job( pid, text ) );
+
+    if ( muxed )
+        mux_job_output( job_id, &pipes );
+
+    if ( job_id != 0 )
+        printf( "[%d] %d\n", job_id, (int) pid );
+
+    last_run.status = ( job_id != 0 ? 0 : 1 );
+    return SUCCESS;
+} /* end handle_background() */
 
 
 /*********************************************************************/
 /*                                                                   */
-/*      Function name: check_for_alias                               */
+/*      Function name: handle_jobs                                   */
 /*      Return type:   int                                           */
 /*      Parameter(s):  none                                          */
 /*                                                                   */
 /*      Description:                                                 */
-/*          Checks for aliases and converts them if found.           */
-/*          Return failure anytime an alias isnt being translated.   */
-/*          This is done so that way we know when we dont need to    */
-/*          use the alias any further.                               */
+/*          "jobs" lists background jobs, "wait" blocks until all of */
+/*          them finish and "wait N" (or %N) until job N does.       */
 /*                                                                   */
 /*********************************************************************/
-int handle_aliases( void )
+int handle_jobs( void )
 {
-    if ( strcmp( cmds[0], "alias" ) == 0 )
+    const char* id;
+    int status;
+
+    if ( strcmp( jshell->cmds[0], "jobs" ) == 0 )
     {
-        if( n_cmds < 4 )
-        {
-            fprintf( stderr, "Error, no alias specified to add.\n" );
-            return FAILURE;
-        }
-        add_alias( cmds[1], cmds[3] );
-        return FAILURE;
+        report_jobs( T );
+        last_run.status = 0;
+        return SUCCESS;
     }
-    else if ( strcmp( cmds[0], "unalias" ) == 0 )
-    {
-        if( n_cmds < 2 )
-        {
-            fprintf( stderr, "Error, no alias specified to remove.\n" );
-            return FAILURE;
 
-        }
-        remove_alias( cmds[1] );
+    if ( strcmp( jshell->cmds[0], "wait" ) != 0 )
         return FAILURE;
-    }
-    else if ( n_cmds == 2 && 
-              strcmp( cmds[0], "show" ) == 0 && 
-              strcmp( cmds[1], "aliases" ) == 0 
-            )
+
+    ignore_interrupts();
+
+    if ( jshell->n_cmds == 1 )
     {
-        print_aliases();
-        return FAILURE;
+        status = wait_jobs( 0 );
+        wait_job_output( 0 );
     }
     else
-        check_for_alias();    
+    {
+        id = jshell->cmds[1];
+        id += ( id[0] == '%' ? 1 : 0 );
+        status = wait_jobs( atoi( id ) );
+        wait_job_output( atoi( id ) );
+    }
 
-    return SUCCESS; 
-}
+    last_run.status = ( status == SUCCESS ? 0 : 1 );
+
+    restore_interrupts();
+    return SUCCESS;
+} /* end handle_jobs() */
 
 
 /*********************************************************************/
 /*                                                                   */
-/*      Function name: handle_env_vars                               */
+/*      Function name: handle_queue                                  */
 /*      Return type:   int                                           */
 /*      Parameter(s):  none                                          */
 /*                                                                   */
 /*      Description:                                                 */
-/*          checks for environmental variables and calls conversion  */
-/*          function.                                                */
+/*          runs "jq submit", "jq list", "jq status" and "jq log".   */
+/*          Other jq command lines are left for the real jq.         */
 /*                                                                   */
 /*********************************************************************/
-int handle_env_vars( void )
+int handle_queue( void )
 {
-    int counter = 0; 
+    if ( strcmp( jshell->cmds[0], "jq" ) != 0 )
+        return FAILURE;
 
-    for( ; counter < n_cmds; counter++ )
-    {
-        /* if we find a possible environmental variable */
-        if( strcmp( cmds[counter], "$" ) == 0 )
-            if ( convert_env_var( counter ) == SUCCESS )
-                counter--; 
-    }
-    return SUCCESS; 
-}
+    return queue_command( jshell->cmds, jshell->n_cmds, &last_run.status );
+} /* end handle_queue() */
 
 
 /*********************************************************************/
 /*                                                                   */
-/*      Function name: handle_directory_change                       */
-/*      Return type:   int.                                          */
-/*      Parameter(s):  none                                          */
+/*      Function name: run_queued_job                                */
+/*      Return type:   pid_t                                         */
+/*      Parameter(s):                                                */
+/*          char** words: the job's command line.                    */
+/*          int n_words: number of strings in words.                 */
+/*          int log_fd: the job's log file.                          */
 /*                                                                   */
 /*      Description:                                                 */
-/*          determines and conducts directory change if needed.      */
+/*          starts a queue daemon job in a subshell of its own       */
+/*          process group, reading /dev/null and writing stdout and  */
+/*          stderr to log_fd. Returns its pid or -1.                 */
 /*                                                                   */
 /*********************************************************************/
-int handle_directory_change( void )
+pid_t run_queued_job( char** words, int n_words, int log_fd )
 {
-    char* new_dir = NULL;
+    int fd_in;
+    pid_t pid;
 
-    /* ensure we want to switch directories */
-    if ( strcmp( cmds[0], "cd" ) != 0 )
-        return FAILURE;
+    if ( ( fd_in = open( "/dev/null", O_RDONLY | O_CLOEXEC ) ) == -1 )
+        return -1;
 
-    /* switching to home directory */
-    if ( n_cmds == 1 || 
-         strcmp( cmds[1], "~/" ) == 0 || 
-         strcmp( cmds[1], "~" ) == 0 
-       )
+    pid = spawn_job( words, n_words, fd_in, log_fd, log_fd );
+
+    close( fd_in );
+    return pid;
+} /* end run_queued_job() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: spawn_job                                     */
+/*      Return type:   pid_t                                         */
+/*      Parameter(s):                                                */
+/*          char** words: the job's command line.                    */
+/*          int n_words: number of strings in words.                 */
+/*          int fd_in: descriptor for its stdin.                     */
+/*          int fd_out: descriptor for its stdout.                   */
+/*          int fd_err: descriptor for its stderr.                   */
+/*                                                                   */
+/*      Description:                                                 */
+/*          spawn_subshell() in a process group of its own, with     */
+/*          stderr swapped only for the fork so the subshell         */
+/*          inherits it. Returns its pid or -1.                      */
+/*                                                                   */
+/*********************************************************************/
+pid_t spawn_job( char** words, int n_words, int fd_in, int fd_out,
+                 int fd_err )
+{
+    int saved_err = -1;
+    pid_t pid;
+
+    if ( fd_err != STDERR_FILENO )
     {
-        if( is_directory( getenv( "HOME" ) ) != 0 )
-        {
-            if( chdir( getenv( "HOME" ) ) != 0 )
-            {
-                printf("Error: Cannot switch to HOME directory.\n" );
-                return FAILURE;
-            }
-            else
-            {
-                setenv( PWD, getenv( "HOME" ), 1 );
-                return SUCCESS; 
-            }
-        }
+        fflush( stderr );
+        saved_err = fcntl( STDERR_FILENO, F_DUPFD_CLOEXEC, 0 );
+        dup2( fd_err, STDERR_FILENO );
     }
 
-    /* switching to any other directory */
-    if ( chdir( cmds[1] ) != 0 )
+    pid = spawn_subshell( words, n_words, fd_in, fd_out, T );
+
+    if ( saved_err != -1 )
     {
-        printf( "Error: Cannot change directory to %s\n", cmds[1] );
-        return FAILURE;
+        dup2( saved_err, STDERR_FILENO );
+        close( saved_err );
     }
 
-    return SUCCESS;
-} /* end handle_directory_change() */
+    return pid;
+} /* end spawn_job() */
 
 
 /*********************************************************************/
@@ -394,22 +2371,32 @@ int handle_directory_change( void )
 /*                                                                   */
 /*      Description:                                                 */
 /*          Routes all program execution to their respected          */
-/*          functions.                                               */
+/*          functions. With "set -o optimize" the pipeline is        */
+/*          rewritten first; "set -o trace" prints what will run.    */
 /*                                                                   */
 /*********************************************************************/
 int handle_program_execution( void )
 {
-    int r_flag = is_redirection(); 
-    int p_flag = is_pipe();
+    int r_flag, p_flag;
+
+    // rewrite the pipeline to use fewer processes
+    if ( OPTION( OPT_OPTIMIZE ) )
+        optimize_pipeline( &jshell->cmds, &jshell->n_cmds, &jshell->n_pipes );
+
+    if ( OPTION( OPT_TRACE ) )
+        trace_commands();
+
+    r_flag = is_redirection(); 
+    p_flag = is_pipe();
 
     switch ( r_flag )
     {
         case INPUT:
             // input redirection
             if ( p_flag == SUCCESS )
-                ;//redirect_input_and_pipe();
-
-            redirect_input();
+                redirect_input_and_pipe( jshell->n_pipes );
+            else
+                redirect_input();
             break;
         case OUTPUT:
             // output redirection
@@ -428,7 +2415,7 @@ int handle_program_execution( void )
         default:
             // no redirection
             if ( p_flag == SUCCESS )
-                execute_and_pipe( n_pipes ); 
+                execute_and_pipe( jshell->n_pipes ); 
             else
                 execute();
 
@@ -459,15 +2446,17 @@ int check_for_alias( void )
 {
     alias* a_ptr;
 
-    for( int i = 0; i < n_cmds; i++ )
+    for( int i = 0; i < jshell->n_cmds; i++ )
     {
-        if( ( a_ptr = find_alias( cmds[i] ) ) != NULL )
+        if( ( a_ptr = find_alias( jshell->cmds[i] ) ) != NULL )
         {
             /* create space for aliases */
-            move_strings_down( &cmds, &n_cmds, a_ptr->n_cmds, i );
+            move_strings_down( &jshell->cmds, &jshell->n_cmds, a_ptr->n_cmds,
+                               i );
 
             /* replace alias in cmds */
-            add_strings( &cmds, &(a_ptr->translated), i, a_ptr->n_cmds );
+            add_strings( &jshell->cmds, &(a_ptr->translated), i,
+                         a_ptr->n_cmds );
 
             return SUCCESS; 
         }
@@ -489,7 +2478,7 @@ int check_for_alias( void )
 /*********************************************************************/
 int convert_env_var( int index )
 {
-    char* env_var = getenv( cmds[index + 1] );
+    const char* env_var = var_get( jshell->cmds[index + 1] );
 
     if( env_var == NULL )
     {
@@ -498,26 +2487,27 @@ int convert_env_var( int index )
     }
 
     /* translate env variable in commands */
-    free( cmds[index + 1] );
-    cmds[index + 1] = NULL;
-    cmds[index + 1] = (char*) malloc( ( strlen( env_var ) + 1 ) 
+    free( jshell->cmds[index + 1] );
+    jshell->cmds[index + 1] = NULL;
+    jshell->cmds[index + 1] = (char*) malloc( ( strlen( env_var ) + 1 ) 
                                         * sizeof(char) );
 
-    if ( cmds[index + 1] == NULL )
+    if ( jshell->cmds[index + 1] == NULL )
     {
         fprintf(stderr, "Could not alocate memory for env variable.\n" );
         return FAILURE;
     }
 
-    strcpy( cmds[index + 1], env_var );
+    strcpy( jshell->cmds[index + 1], env_var );
 
     /* move all commands down one, removing '$' */
-    for( ; index < n_cmds - 1; index++ )
+    for( ; index < jshell->n_cmds - 1; index++ )
     {
-        free( cmds[index] );
+        free( jshell->cmds[index] );
 
-        if( (cmds[index] = (char*) malloc( ( strlen( cmds[index + 1] )
-                                             + 1 ) * sizeof(char) ) ) 
+        if( (jshell->cmds[index] = (char*) malloc(
+                                 ( strlen( jshell->cmds[index + 1] )
+                                   + 1 ) * sizeof(char) ) ) 
                                              == NULL
           )
         {
@@ -525,13 +2515,13 @@ int convert_env_var( int index )
                               commands for env variable.\n" );
         }
 
-        strcpy( cmds[index], cmds[index +1] );
+        strcpy( jshell->cmds[index], jshell->cmds[index +1] );
     }
 
     /* free last element and make null/ lower n_cmds */
-    free( cmds[index] );
-    cmds[index] = NULL;
-    n_cmds -= 1;
+    free( jshell->cmds[index] );
+    jshell->cmds[index] = NULL;
+    jshell->n_cmds -= 1;
 
     return SUCCESS;
 }
@@ -557,12 +2547,12 @@ int is_redirection( void )
     int ctr = 0;
     int o_flag = FAILURE, i_flag = FAILURE;
 
-    for ( ; ctr < n_cmds; ctr++ )
+    for ( ; ctr < jshell->n_cmds; ctr++ )
     {
-        if ( strcmp( cmds[ctr], "<" ) == 0 )
+        if ( strcmp( jshell->cmds[ctr], "<" ) == 0 )
             i_flag = SUCCESS;
 
-        if ( strcmp( cmds[ctr], ">" ) == 0 )
+        if ( strcmp( jshell->cmds[ctr], ">" ) == 0 )
             o_flag = SUCCESS; 
     }
 
@@ -590,7 +2580,7 @@ int is_redirection( void )
 /*********************************************************************/
 int is_pipe( void )
 {
-    return ( n_pipes == 0 ? FAILURE : SUCCESS );
+    return ( jshell->n_pipes == 0 ? FAILURE : SUCCESS );
 }
 
 
@@ -607,13 +2597,78 @@ int is_pipe( void )
 /*********************************************************************/
 void print_commands( void )
 {
-    for ( int i = 0; i <= n_cmds; i++ )
-        printf( "command %d: %s\n", i, cmds[i] );
+    for ( int i = 0; i <= jshell->n_cmds; i++ )
+        printf( "command %d: %s\n", i, jshell->cmds[i] );
 
     return;
 }/* end print_commands() */
 
 
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: trace_commands                                */
+/*      Return type:   void                                          */
+/*      Parameter(s):  None                                          */
+/*                                                                   */
+/*      Description:                                                 */
+/*          Prints the command line about to run on stderr, after    */
+/*          every expansion and rewrite, prefixed with "+".          */
+/*                                                                   */
+/*********************************************************************/
+void trace_commands( void )
+{
+    fputs( "+", stderr );
+
+    for ( int i = 0; i < jshell->n_cmds; i++ )
+        fprintf( stderr, " %s", jshell->cmds[i] );
+
+    fputs( "\n", stderr );
+}/* end trace_commands() */
+
+
+/*********************************************************************/
+/*                                                                   */
+/*      Function name: read_line                                     */
+/*      Return type:   char*                                         */
+/*      Parameter(s):                                                */
+/*          const char* prompt: prompt to show.                      */
+/*                                                                   */
+/*      Description:                                                 */
+/*          reads one line of input, allocated with malloc(3), from  */
+/*          the script or request being run, else the terminal.      */
+/*          Returns NULL at end of input.                            */
+/*                                                                   */
+/*********************************************************************/
+char* read_line( const char* prompt )
+{
+    char* line;
+    char* end;
+    size_t len;
+
+    /* a script's here-documents come from its own next lines */
+    if ( script != NULL )
+        return ( script->next < script->header->n_lines ?
+                 strdup( script_text( script, script->next++ ) ) : NULL );
+
+    /* a command server request's lines come from the request */
+    if ( request_text != NULL )
+    {
+        if ( request_text[0] == '\0' )
+            return NULL;
+
+        end = strchr( request_text, '\n' );
+        len = ( end != NULL ? (size_t) ( end - request_text ) :
+                              strlen( request_text ) );
+        line = strndup( request_text, len );
+        request_text += len + ( end != NULL ? 1 : 0 );
+
+        return line;
+    }
+
+    return readline( prompt );
+} /* end read_line() */
+
+
 /*********************************************************************/
 /*                                                                   */
 /*      Function name: is_directory                                  */